@@ -0,0 +1,700 @@
+#include "analyze.h"
+#include "arena.h"
+#include "constants.h"
+#include "errors.h"
+#include "files.h"
+#include "reporting.h"
+#include "workers.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define TABLE_INITIAL_CAPACITY 256
+#define LENGTH_BUCKETS 5
+#define PHRASE_KEY_SIZE (3 * COLETTE_MAX_TERM_LEN + 3)
+
+/* *
+ * Common function words, sorted for bsearch. They would otherwise fill every
+ * top-words list.
+ * */
+static const char *const STOP_WORDS[] = {
+    "a",     "about", "after", "all",   "an",    "and",   "are",   "as",
+    "at",    "be",    "been",  "but",   "by",    "can",   "could", "did",
+    "do",    "for",   "from",  "had",   "has",   "have",  "he",    "her",
+    "him",   "his",   "i",     "if",    "in",    "into",  "is",    "it",
+    "its",   "just",  "me",    "my",    "no",    "not",   "of",    "on",
+    "one",   "or",    "out",   "over",  "she",   "so",    "than",  "that",
+    "the",   "their", "them",  "then",  "there", "they",  "this",  "to",
+    "up",    "us",    "was",   "we",    "were",  "what",  "when",  "which",
+    "who",   "will",  "with",  "would", "you",   "your",
+};
+
+struct CountEntry {
+    char *key; // NULL marks an empty slot
+    uint32_t len;
+    uint32_t hash;
+    uint64_t count;
+};
+
+/* *
+ * Open-addressing table of counts. Slots and keys live in the owning
+ * Analysis's arena; outgrown slot arrays are simply abandoned there.
+ * */
+struct CountTable {
+    struct CountEntry *slots;
+    size_t capacity;
+    size_t used;
+};
+
+/* *
+ * Counts for one file or, once merged, everything below a directory. The
+ * tables are released as soon as the entry's top words and phrases are taken
+ * from them and they are merged into the parent, leaving only top and the
+ * totals for the report.
+ * */
+struct Analysis {
+    struct Arena arena;
+    struct CountTable words;
+    struct CountTable phrases;
+    char *top;      // top-words and top-phrases columns, tab separated
+    size_t pending; // directories: children not yet merged, plus one for itself
+    pthread_mutex_t lock; // directories: guards the tables and pending
+    uint64_t wordCount;
+    uint64_t sentences;
+    uint64_t sentenceWords; // words in completed sentences
+    uint64_t dialogueWords;
+    uint64_t lengths[LENGTH_BUCKETS];
+    struct ReadFailure failure;
+};
+
+/* *
+ * Scanner state for one file. The last two words of the current sentence are
+ * kept to form three-word phrases.
+ * */
+struct Tokenizer {
+    char word[COLETTE_MAX_TERM_LEN];
+    size_t wordLen;
+    bool wordTooLong;
+    bool wordInQuote;
+    char recent[2][COLETTE_MAX_TERM_LEN];
+    size_t recentLen[2];
+    size_t recentCount;
+    uint64_t sentenceLength;
+    bool inQuote;
+};
+
+struct AnalyzeJob {
+    const struct FileList *entries;
+    struct Analysis *results;
+    size_t *parents; // index of each entry's directory
+};
+
+static bool isWordByte(unsigned char byte) {
+    return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') ||
+           (byte >= '0' && byte <= '9') || byte >= 0x80;
+}
+
+static uint32_t hashKey(const char *key, size_t len) {
+    // FNV-1a, as in the word index
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int tableInit(struct CountTable *table, struct Arena *arena) {
+    table->slots =
+        arenaAlloc(arena, TABLE_INITIAL_CAPACITY * sizeof(struct CountEntry));
+    if (!table->slots) {
+        return -1;
+    }
+    memset(table->slots, 0, TABLE_INITIAL_CAPACITY * sizeof(struct CountEntry));
+    table->capacity = TABLE_INITIAL_CAPACITY;
+    table->used = 0;
+    return 0;
+}
+
+static int tableGrow(struct CountTable *table, struct Arena *arena) {
+    size_t capacity = table->capacity * 2;
+    struct CountEntry *slots =
+        arenaAlloc(arena, capacity * sizeof(struct CountEntry));
+    if (!slots) {
+        return -1;
+    }
+    memset(slots, 0, capacity * sizeof(struct CountEntry));
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        const struct CountEntry *entry = &table->slots[i];
+        if (!entry->key) {
+            continue;
+        }
+        size_t slot = entry->hash & (capacity - 1);
+        while (slots[slot].key) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = *entry;
+    }
+    table->slots = slots;
+    table->capacity = capacity;
+    return 0;
+}
+
+/* *
+ * Adds count to key's entry, copying the key into the arena the first time it
+ * is seen. hash must be hashKey(key, len).
+ * */
+static int tableAdd(struct CountTable *table,
+                    struct Arena *arena,
+                    const char *key,
+                    size_t len,
+                    uint32_t hash,
+                    uint64_t count) {
+    size_t slot = hash & (table->capacity - 1);
+    while (table->slots[slot].key) {
+        struct CountEntry *entry = &table->slots[slot];
+        if (entry->hash == hash && entry->len == len &&
+            memcmp(entry->key, key, len) == 0) {
+            entry->count += count;
+            return 0;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+
+    char *copy = arenaAlloc(arena, len + 1);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, key, len);
+    copy[len] = '\0';
+    table->slots[slot] = (struct CountEntry){
+        .key = copy, .len = (uint32_t)len, .hash = hash, .count = count};
+    table->used++;
+
+    // keep the load under 3/4 so probe runs stay short
+    if (table->used * 4 > table->capacity * 3) {
+        return tableGrow(table, arena);
+    }
+    return 0;
+}
+
+static int analysisInit(struct Analysis *analysis) {
+    arenaInit(&analysis->arena, ARENA_BLOCK_SIZE);
+    if (tableInit(&analysis->words, &analysis->arena) != 0 ||
+        tableInit(&analysis->phrases, &analysis->arena) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void endSentence(struct Analysis *analysis,
+                        struct Tokenizer *tokenizer) {
+    uint64_t length = tokenizer->sentenceLength;
+    tokenizer->recentCount = 0;
+    if (length == 0) {
+        return;
+    }
+
+    analysis->sentences++;
+    analysis->sentenceWords += length;
+    size_t bucket = length <= 5    ? 0
+                    : length <= 10 ? 1
+                    : length <= 20 ? 2
+                    : length <= 40 ? 3
+                                   : 4;
+    analysis->lengths[bucket]++;
+    tokenizer->sentenceLength = 0;
+}
+
+static int endWord(struct Analysis *analysis, struct Tokenizer *tokenizer) {
+    size_t len = tokenizer->wordLen;
+    if (len == 0 && !tokenizer->wordTooLong) {
+        return 0;
+    }
+
+    analysis->wordCount++;
+    tokenizer->sentenceLength++;
+    if (tokenizer->wordInQuote) {
+        analysis->dialogueWords++;
+    }
+
+    if (tokenizer->wordTooLong) {
+        // not a real word; don't count it or let a phrase span it
+        tokenizer->wordLen = 0;
+        tokenizer->wordTooLong = false;
+        tokenizer->recentCount = 0;
+        return 0;
+    }
+
+    const char *word = tokenizer->word;
+    if (tableAdd(&analysis->words,
+                 &analysis->arena,
+                 word,
+                 len,
+                 hashKey(word, len),
+                 1) != 0) {
+        return -1;
+    }
+
+    if (tokenizer->recentCount == 2) {
+        char phrase[PHRASE_KEY_SIZE];
+        size_t phraseLen = 0;
+        for (int r = 0; r < 2; r++) {
+            memcpy(phrase + phraseLen,
+                   tokenizer->recent[r],
+                   tokenizer->recentLen[r]);
+            phraseLen += tokenizer->recentLen[r];
+            phrase[phraseLen++] = ' ';
+        }
+        memcpy(phrase + phraseLen, word, len);
+        phraseLen += len;
+        if (tableAdd(&analysis->phrases,
+                     &analysis->arena,
+                     phrase,
+                     phraseLen,
+                     hashKey(phrase, phraseLen),
+                     1) != 0) {
+            return -1;
+        }
+        memcpy(tokenizer->recent[0],
+               tokenizer->recent[1],
+               tokenizer->recentLen[1]);
+        tokenizer->recentLen[0] = tokenizer->recentLen[1];
+        tokenizer->recentCount = 1;
+    }
+    memcpy(tokenizer->recent[tokenizer->recentCount], word, len);
+    tokenizer->recentLen[tokenizer->recentCount] = len;
+    tokenizer->recentCount++;
+
+    tokenizer->wordLen = 0;
+    return 0;
+}
+
+static void appendWordByte(struct Tokenizer *tokenizer, unsigned char byte) {
+    if (tokenizer->wordLen == 0 && !tokenizer->wordTooLong) {
+        tokenizer->wordInQuote = tokenizer->inQuote;
+    }
+    if (tokenizer->wordLen == sizeof(tokenizer->word)) {
+        tokenizer->wordTooLong = true;
+        tokenizer->wordLen = 0;
+    }
+    if (!tokenizer->wordTooLong) {
+        tokenizer->word[tokenizer->wordLen++] = (char)(
+            (byte >= 'A' && byte <= 'Z') ? byte + ('a' - 'A') : byte);
+    }
+}
+
+/* *
+ * Splits text into words and sentences. Apostrophes, straight or curly,
+ * inside a word are part of it. Sentences end at . ! ? or an ellipsis, and
+ * at a blank line so headings don't run into the next paragraph. Dialogue is
+ * tracked with straight and curly double quotes; a blank line closes an
+ * unterminated quote, as multi-paragraph speech reopens it.
+ * */
+static int analyzeText(struct Analysis *analysis,
+                       const unsigned char *data,
+                       size_t size) {
+    struct Tokenizer tokenizer = {0};
+    bool atLineStart = false;
+    for (size_t i = 0; i < size; i++) {
+        unsigned char byte = data[i];
+        bool inWord = tokenizer.wordLen > 0 || tokenizer.wordTooLong;
+        bool nextIsWord = i + 1 < size && isWordByte(data[i + 1]);
+
+        // U+2018..U+201D quotes and the rest of General Punctuation
+        if (byte == 0xE2 && i + 2 < size && data[i + 1] == 0x80) {
+            unsigned char third = data[i + 2];
+            bool joins = third == 0x99 && inWord && i + 3 < size &&
+                         isWordByte(data[i + 3]);
+            i += 2;
+            atLineStart = false;
+            if (joins) {
+                appendWordByte(&tokenizer, '\'');
+                continue;
+            }
+            if (endWord(analysis, &tokenizer) != 0) {
+                return -1;
+            }
+            if (third == 0x9C) {
+                tokenizer.inQuote = true;
+            } else if (third == 0x9D) {
+                tokenizer.inQuote = false;
+            } else if (third == 0xA6) {
+                endSentence(analysis, &tokenizer);
+            }
+            continue;
+        }
+
+        // the byte order mark collation keeps at the start of a file
+        if (byte == 0xEF && i + 2 < size && data[i + 1] == 0xBB &&
+            data[i + 2] == 0xBF) {
+            i += 2;
+            if (endWord(analysis, &tokenizer) != 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (isWordByte(byte)) {
+            appendWordByte(&tokenizer, byte);
+            atLineStart = false;
+            continue;
+        }
+        if (byte == '\'' && inWord && nextIsWord) {
+            appendWordByte(&tokenizer, byte);
+            continue;
+        }
+
+        if (endWord(analysis, &tokenizer) != 0) {
+            return -1;
+        }
+        if (byte == '\n') {
+            if (atLineStart) {
+                tokenizer.inQuote = false;
+                endSentence(analysis, &tokenizer);
+            }
+            atLineStart = true;
+            continue;
+        }
+        if (byte != ' ' && byte != '\t' && byte != '\r') {
+            atLineStart = false;
+        }
+        if (byte == '"') {
+            tokenizer.inQuote = !tokenizer.inQuote;
+        } else if (byte == '.' || byte == '!' || byte == '?') {
+            endSentence(analysis, &tokenizer);
+        }
+    }
+
+    if (endWord(analysis, &tokenizer) != 0) {
+        return -1;
+    }
+    endSentence(analysis, &tokenizer);
+    return 0;
+}
+
+static int mergeTable(struct CountTable *into,
+                      struct Arena *arena,
+                      const struct CountTable *from) {
+    for (size_t i = 0; i < from->capacity; i++) {
+        const struct CountEntry *entry = &from->slots[i];
+        if (entry->key && tableAdd(into,
+                                   arena,
+                                   entry->key,
+                                   entry->len,
+                                   entry->hash,
+                                   entry->count) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int compareStopWord(const void *key, const void *element) {
+    return strcmp(key, *(const char *const *)element);
+}
+
+static bool isStopWord(const char *word) {
+    return bsearch(word,
+                   STOP_WORDS,
+                   sizeof(STOP_WORDS) / sizeof(STOP_WORDS[0]),
+                   sizeof(STOP_WORDS[0]),
+                   compareStopWord) != NULL;
+}
+
+static bool isTopWord(const struct CountEntry *entry) {
+    return !isStopWord(entry->key);
+}
+
+static bool isTopPhrase(const struct CountEntry *entry) {
+    if (entry->count < 2) {
+        return false;
+    }
+    // "of the same" is overused; "it was the" is just English
+    char words[PHRASE_KEY_SIZE];
+    memcpy(words, entry->key, entry->len + 1);
+    char *save = NULL;
+    for (char *word = strtok_r(words, " ", &save); word;
+         word = strtok_r(NULL, " ", &save)) {
+        if (!isStopWord(word)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ranksAbove(const struct CountEntry *a, const struct CountEntry *b) {
+    if (a->count != b->count) {
+        return a->count > b->count;
+    }
+    return strcmp(a->key, b->key) < 0;
+}
+
+/* *
+ * Writes the limit highest counts that pass keep, highest first with ties in
+ * alphabetical order, as key:count,key:count or "-" if there are none.
+ * */
+static void writeTop(FILE *out,
+                     const struct CountTable *table,
+                     size_t limit,
+                     bool (*keep)(const struct CountEntry *)) {
+    const struct CountEntry *top[COLETTE_ANALYZE_TOP_WORDS +
+                                 COLETTE_ANALYZE_TOP_PHRASES];
+    size_t count = 0;
+    for (size_t i = 0; i < table->capacity; i++) {
+        const struct CountEntry *entry = &table->slots[i];
+        if (!entry->key ||
+            (count == limit && !ranksAbove(entry, top[count - 1])) ||
+            !keep(entry)) {
+            continue;
+        }
+        size_t pos = count < limit ? count++ : limit - 1;
+        while (pos > 0 && ranksAbove(entry, top[pos - 1])) {
+            top[pos] = top[pos - 1];
+            pos--;
+        }
+        top[pos] = entry;
+    }
+
+    if (count == 0) {
+        fputc('-', out);
+    }
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out,
+                "%s%s:%llu",
+                i ? "," : "",
+                top[i]->key,
+                (unsigned long long)top[i]->count);
+    }
+}
+
+/* *
+ * Keeps the report columns taken from the tables, so the tables can go.
+ * */
+static void takeTop(struct Analysis *analysis) {
+    size_t len = 0;
+    FILE *top = open_memstream(&analysis->top, &len);
+    if (!top) {
+        setReadFailure(&analysis->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+        return;
+    }
+    writeTop(top, &analysis->words, COLETTE_ANALYZE_TOP_WORDS, isTopWord);
+    fputc('\t', top);
+    writeTop(top, &analysis->phrases, COLETTE_ANALYZE_TOP_PHRASES, isTopPhrase);
+    if (fclose(top) != 0) {
+        free(analysis->top);
+        analysis->top = NULL;
+        setReadFailure(&analysis->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+    }
+}
+
+/* *
+ * Called once an entry's tables are final: its report columns are taken, it
+ * is merged into its directory and its tables freed. A directory whose last
+ * child this was is finished in turn, so only the directories still being
+ * filled hold tables.
+ * */
+static void finishEntry(struct AnalyzeJob *job, size_t index) {
+    while (index != SIZE_MAX) {
+        struct Analysis *from = &job->results[index];
+        takeTop(from);
+
+        size_t parent = job->parents[index];
+        if (parent == SIZE_MAX) {
+            freeArena(&from->arena);
+            return;
+        }
+        struct Analysis *into = &job->results[parent];
+        pthread_mutex_lock(&into->lock);
+        into->wordCount += from->wordCount;
+        into->sentences += from->sentences;
+        into->sentenceWords += from->sentenceWords;
+        into->dialogueWords += from->dialogueWords;
+        for (size_t b = 0; b < LENGTH_BUCKETS; b++) {
+            into->lengths[b] += from->lengths[b];
+        }
+        if (!into->failure.failed &&
+            (mergeTable(&into->words, &into->arena, &from->words) != 0 ||
+             mergeTable(&into->phrases, &into->arena, &from->phrases) != 0)) {
+            setReadFailure(&into->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+        }
+        bool complete = --into->pending == 0;
+        pthread_mutex_unlock(&into->lock);
+        freeArena(&from->arena);
+
+        index = complete ? parent : SIZE_MAX;
+    }
+}
+
+/* *
+ * Analyses a file, or lets a directory finish once all of its children have
+ * been merged into it.
+ * */
+static void analyzeEntry(size_t index, void *arg) {
+    struct AnalyzeJob *job = arg;
+    const struct FileEntry *entry = &job->entries->entries[index];
+    struct Analysis *analysis = &job->results[index];
+    if (entry->type == FILE_TYPE_DIRECTORY) {
+        pthread_mutex_lock(&analysis->lock);
+        bool complete = --analysis->pending == 0;
+        pthread_mutex_unlock(&analysis->lock);
+        if (complete) {
+            finishEntry(job, index);
+        }
+        return;
+    }
+
+    if (entry->type == FILE_TYPE_REGULAR) {
+        size_t size = 0;
+        unsigned char *data = NULL;
+        if (analysisInit(analysis) != 0) {
+            setReadFailure(&analysis->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+        } else {
+            data = readWholeFile(entry->path,
+                                 entry->encoding,
+                                 &size,
+                                 NULL,
+                                 &analysis->failure);
+        }
+        if (data && analyzeText(analysis, data, size) != 0) {
+            setReadFailure(&analysis->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+        }
+        free(data);
+    }
+    finishEntry(job, index);
+}
+
+static void writeRow(FILE *out,
+                     const struct FileEntry *entry,
+                     const struct Analysis *analysis,
+                     const char *rootDir) {
+    const char *path =
+        entry->depth == 0 ? "." : relativePath(entry->path, rootDir);
+
+    double mean = analysis->sentences ? (double)analysis->sentenceWords /
+                                            (double)analysis->sentences
+                                      : 0.0;
+    unsigned int dialogue =
+        analysis->wordCount ? (unsigned int)(analysis->dialogueWords * 100 /
+                                             analysis->wordCount)
+                            : 0;
+    fprintf(out,
+            "%s\t%s\t%llu\t%llu\t%.1f\t%u%%\t%llu/%llu/%llu/%llu/%llu\t",
+            entry->type == FILE_TYPE_DIRECTORY ? "dir" : "file",
+            path,
+            (unsigned long long)analysis->wordCount,
+            (unsigned long long)analysis->sentences,
+            mean,
+            dialogue,
+            (unsigned long long)analysis->lengths[0],
+            (unsigned long long)analysis->lengths[1],
+            (unsigned long long)analysis->lengths[2],
+            (unsigned long long)analysis->lengths[3],
+            (unsigned long long)analysis->lengths[4]);
+    fputs(analysis->top ? analysis->top : "-\t-", out);
+    fputc('\n', out);
+}
+
+int analyzeProject(const struct FileList *entries,
+                   unsigned int jobs,
+                   const char *rootDir,
+                   FILE *out) {
+    if (!entries || entries->count == 0 ||
+        entries->entries[0].type != FILE_TYPE_DIRECTORY) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_ANALYZE, rootDir, PROC_ERR_INVALID_STATE);
+        return -1;
+    }
+
+    size_t count = entries->count;
+    struct AnalyzeJob job = {.entries = entries};
+    job.results = calloc(count, sizeof(struct Analysis));
+    job.parents = malloc(count * sizeof(size_t));
+    size_t locks = 0; // directories before this have their lock initialised
+    int status = 0;
+    if (!job.results || !job.parents) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_ANALYZE, rootDir, PROC_ERR_MEMORY_ALLOC);
+        status = -1;
+        goto cleanup;
+    }
+
+    // index of the open directory at each depth on the way down, as in
+    // rollUpStats
+    size_t ancestors[COLETTE_PROJECT_DEPTH + 2];
+    for (size_t i = 0; i < count; i++) {
+        const struct FileEntry *entry = &entries->entries[i];
+        struct Analysis *analysis = &job.results[i];
+        if (entry->type == FILE_TYPE_DIRECTORY) {
+            if (pthread_mutex_init(&analysis->lock, NULL) != 0) {
+                reportProcessError(
+                    PROCESS_OP_HANDLE_ANALYZE, rootDir, PROC_ERR_INVALID_STATE);
+                status = -1;
+                goto cleanup;
+            }
+            locks = i + 1;
+            if (analysisInit(analysis) != 0) {
+                reportProcessError(
+                    PROCESS_OP_HANDLE_ANALYZE, rootDir, PROC_ERR_MEMORY_ALLOC);
+                status = -1;
+                goto cleanup;
+            }
+            analysis->pending = 1;
+        }
+
+        size_t depth = entry->depth;
+        if (depth >= sizeof(ancestors) / sizeof(ancestors[0])) {
+            job.parents[i] = SIZE_MAX;
+            continue;
+        }
+        job.parents[i] = depth > 0 ? ancestors[depth - 1] : SIZE_MAX;
+        if (job.parents[i] != SIZE_MAX) {
+            job.results[job.parents[i]].pending++;
+        }
+        if (entry->type == FILE_TYPE_DIRECTORY) {
+            ancestors[depth] = i;
+        }
+    }
+
+    // each file is analysed into its own tables and merged straight into its
+    // directory, which is merged into its own once its last child is in
+    runParallel(count, jobs, analyzeEntry, &job);
+
+    fputs("type\tpath\twords\tsentences\tmean-sentence\tdialogue\tlengths\t"
+          "top-words\ttop-phrases\n",
+          out);
+    for (size_t i = 0; i < count; i++) {
+        const struct Analysis *analysis = &job.results[i];
+        if (reportReadFailure(&analysis->failure,
+                              PROCESS_OP_HANDLE_ANALYZE,
+                              entries->entries[i].path)) {
+            status = -1;
+        }
+        writeRow(out, &entries->entries[i], analysis, rootDir);
+    }
+
+    errno = 0;
+    if (fflush(out) != 0 || ferror(out)) {
+        reportFileError(FILE_OP_WRITE, "analysis report");
+        status = -1;
+    }
+
+cleanup:
+    if (job.results) {
+        for (size_t i = 0; i < count; i++) {
+            freeArena(&job.results[i].arena);
+            free(job.results[i].top);
+            if (i < locks && entries->entries[i].type == FILE_TYPE_DIRECTORY) {
+                pthread_mutex_destroy(&job.results[i].lock);
+            }
+        }
+    }
+    free(job.results);
+    free(job.parents);
+    return status;
+}
@@ -0,0 +1,39 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include "filelist.h"
+#include <stdio.h>
+
+/* *
+ * Writes a style report for every scene and chapter of a resolved project as
+ * tab separated values in draft order, one row per file or directory:
+ *
+ *     type  path  words  sentences  mean-sentence  dialogue  lengths
+ *     top-words  top-phrases
+ *
+ * dialogue is the share of words inside double quotes, lengths counts the
+ * sentences of 1-5, 6-10, 11-20, 21-40 and over 40 words, top-words lists the
+ * most frequent words other than common function words and top-phrases the
+ * three-word phrases used more than once, each as item:count separated by
+ * commas. The root directory row (".") covers the whole project.
+ *
+ * Files are analysed in parallel, each into hash tables in its own arena that
+ * are merged into the file's directory and freed as soon as its row is taken.
+ * A directory is merged into its own the same way once its last child is in,
+ * so only the directories still being filled hold tables.
+ *
+ * @param   entries  Resolved entries in traversal order, root first
+ * @param   jobs     Maximum number of worker threads
+ * @param   rootDir  Project root, stripped from paths
+ * @param   out      Stream the report is written to
+ *
+ * @return  int
+ *          0        if every file was analysed
+ *         -1        if a file could not be read or output failed
+ * */
+int analyzeProject(const struct FileList *entries,
+                   unsigned int jobs,
+                   const char *rootDir,
+                   FILE *out);
+
+#endif
@@ -0,0 +1,116 @@
+#include "arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+// enough for any scalar or pointer on the platforms colette builds on
+#define ARENA_ALIGN 16
+
+// released memory is poisoned under ASAN so a use after arenaRelease() is
+// reported like a use after free
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#define POISON(addr, size) ASAN_POISON_MEMORY_REGION(addr, size)
+#define UNPOISON(addr, size) ASAN_UNPOISON_MEMORY_REGION(addr, size)
+#else
+#define POISON(addr, size) ((void)(addr), (void)(size))
+#define UNPOISON(addr, size) ((void)(addr), (void)(size))
+#endif
+
+struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    // padded so data starts aligned, since malloc returns aligned memory
+    unsigned char pad[ARENA_ALIGN - 3 * sizeof(size_t) % ARENA_ALIGN];
+    unsigned char data[];
+};
+
+void arenaInit(struct Arena *arena, size_t blockSize) {
+    arena->head = NULL;
+    arena->spare = NULL;
+    arena->blockSize = blockSize;
+}
+
+static struct ArenaBlock *takeBlock(struct Arena *arena, size_t size) {
+    // only the first spare is tried; they are all blockSize unless oversized
+    struct ArenaBlock *block = arena->spare;
+    if (block && block->size >= size) {
+        arena->spare = block->next;
+        block->used = 0;
+        return block;
+    }
+
+    size_t blockSize = size > arena->blockSize ? size : arena->blockSize;
+    if (blockSize > SIZE_MAX - sizeof(struct ArenaBlock)) {
+        return NULL;
+    }
+    block = malloc(sizeof(struct ArenaBlock) + blockSize);
+    if (!block) {
+        return NULL;
+    }
+    block->size = blockSize;
+    block->used = 0;
+    POISON(block->data, blockSize);
+    return block;
+}
+
+void *arenaAlloc(struct Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    struct ArenaBlock *block = arena->head;
+    if (!block || block->size - block->used < size) {
+        block = takeBlock(arena, size);
+        if (!block) {
+            return NULL;
+        }
+        if (size > arena->blockSize && arena->head) {
+            // keep allocating from the current block's free space
+            block->next = arena->head->next;
+            arena->head->next = block;
+        } else {
+            block->next = arena->head;
+            arena->head = block;
+        }
+    }
+
+    void *memory = block->data + block->used;
+    block->used += size;
+    UNPOISON(memory, size);
+    return memory;
+}
+
+struct ArenaMark arenaMark(const struct Arena *arena) {
+    struct ArenaMark mark = {.block = arena->head,
+                             .used = arena->head ? arena->head->used : 0};
+    return mark;
+}
+
+void arenaRelease(struct Arena *arena, struct ArenaMark mark) {
+    while (arena->head && arena->head != mark.block) {
+        struct ArenaBlock *block = arena->head;
+        arena->head = block->next;
+        POISON(block->data, block->size);
+        block->next = arena->spare;
+        arena->spare = block;
+    }
+    if (arena->head) {
+        POISON(arena->head->data + mark.used, arena->head->used - mark.used);
+        arena->head->used = mark.used;
+    }
+}
+
+static void freeBlocks(struct ArenaBlock *block) {
+    while (block) {
+        struct ArenaBlock *next = block->next;
+        UNPOISON(block->data, block->size);
+        free(block);
+        block = next;
+    }
+}
+
+void freeArena(struct Arena *arena) {
+    freeBlocks(arena->head);
+    freeBlocks(arena->spare);
+    arena->head = NULL;
+    arena->spare = NULL;
+}
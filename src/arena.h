@@ -0,0 +1,74 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* *
+ * Bump allocator for data that lives and dies together, such as the tables
+ * built while analysing one file. Memory comes from a chain of blocks and is
+ * given back all at once by freeArena(), or down to a mark by arenaRelease()
+ * for data scoped to something narrower, such as one project directory.
+ * */
+struct ArenaBlock;
+
+struct Arena {
+    struct ArenaBlock *head;  // block currently allocated from
+    struct ArenaBlock *spare; // released blocks, reused before malloc
+    size_t blockSize;         // size of new blocks, unless a request is larger
+};
+
+/* *
+ * Position in an arena to release back to. Marks must be released in the
+ * reverse order they were taken, like a stack.
+ * */
+struct ArenaMark {
+    struct ArenaBlock *block;
+    size_t used;
+};
+
+/* *
+ * @param  arena      Arena to set up, holds no memory until the first alloc
+ * @param  blockSize  Bytes to request from malloc at a time
+ * */
+void arenaInit(struct Arena *arena, size_t blockSize);
+
+/* *
+ * Returns size bytes aligned for any object type. The memory is not zeroed.
+ *
+ * @param   arena  Arena to allocate from
+ * @param   size   Number of bytes
+ *
+ * @return  void *
+ *          memory owned by the arena
+ *          NULL if a new block could not be allocated
+ * */
+void *arenaAlloc(struct Arena *arena, size_t size);
+
+/* *
+ * @param   arena  Arena to mark
+ *
+ * @return  struct ArenaMark
+ *          the arena's current position
+ * */
+struct ArenaMark arenaMark(const struct Arena *arena);
+
+/* *
+ * Gives back everything allocated since mark in constant time per block.
+ * Blocks emptied are kept for the next allocations rather than freed, so a
+ * scope that is entered and left repeatedly stops calling malloc once the
+ * arena has grown to its deepest point. Blocks made for requests larger than
+ * blockSize while mark's block was current stay until freeArena().
+ *
+ * @param  arena  Arena to release
+ * @param  mark   Position taken with arenaMark() on the same arena
+ * */
+void arenaRelease(struct Arena *arena, struct ArenaMark mark);
+
+/* *
+ * Frees every block and leaves the arena empty but ready for reuse.
+ *
+ * @param  arena  Arena to release
+ * */
+void freeArena(struct Arena *arena);
+
+#endif
@@ -1,5 +1,7 @@
 #include "args.h"
 #include "constants.h"
+#include "filter.h"
+#include "wordindex.h"
 #include <ctype.h>
 #include <errno.h>
 #include <getopt.h>
@@ -11,6 +13,11 @@
 
 static const char *USAGE_STRING =
     "Usage: colette [OPTIONS] DIRECTORY\n"
+    "       colette grep [OPTIONS] PATTERN DIRECTORY\n"
+    "       colette index [OPTIONS] DIRECTORY\n"
+    "       colette lookup [OPTIONS] WORD DIRECTORY\n"
+    "       colette dupes [OPTIONS] DIRECTORY\n"
+    "       colette spell [OPTIONS] DIRECTORY\n"
     "\n"
     "Options:\n"
     "  -i, --init             Initialize project structure\n"
@@ -18,6 +25,42 @@ static const char *USAGE_STRING =
     "  -l, --as-list          Create ordered list of symlinks\n"
     "  -t, --title TITLE      Set output file title (default: draft)\n"
     "  -p, --prefix NUMBER    Set prefix padding (default: 3)\n"
+    "  -T, --trace FILE       Write Chrome trace-event JSON to FILE\n"
+    "  -r, --report FORMAT    Check report format: text, json (default: text)\n"
+    "  -j, --jobs NUMBER      Worker threads (default: one per processor)\n"
+    "  -R, --readahead NUMBER Files to open and prefetch ahead of collation,\n"
+    "                         0 to 256 (default: 16)\n"
+    "  -u, --validate-utf8    Fail collation on invalid UTF-8 (always on in check)\n"
+    "  -F, --filter LIST      Collation text filters, comma separated: crlf,\n"
+    "                         bom, trim, blank-lines, smart-quotes, all\n"
+    "  -m, --metadata         Strip YAML front matter and write it to a table\n"
+    "  -x, --exclude KEY=VAL  Leave out files whose front matter matches\n"
+    "  -C, --toc              Start the draft with a table of contents\n"
+    "  -f, --format FORMAT    Draft format: md, html, html-chapters,\n"
+    "                         epub (default: md)\n"
+    "  -H, --header TEMPLATE  Write TEMPLATE before each file (default: none)\n"
+    "  -s, --separator TEMPLATE\n"
+    "                         Write TEMPLATE after each file (default: \\n);\n"
+    "                         templates may use {name} {stem} {dir} {path}\n"
+    "                         {depth} {chapter} {scene} {rule}\n"
+    "  -S, --stats FILE       Write word/char/line counts to FILE (- for stdout)\n"
+    "  -M, --manifest         Write hashes of the draft and its sources\n"
+    "  -V, --verify DRAFT     Check DRAFT and the sources against its manifest\n"
+    "  -A, --analyze          Report word and phrase use, sentence length and\n"
+    "                         dialogue per scene and chapter\n"
+    "  -L, --min-length N     dupes: shortest passage in letters and digits\n"
+    "                         (default: 200)\n"
+    "  -D, --dictionary FILE  spell: system word list\n"
+    "                         (default: " COLETTE_SYSTEM_DICTIONARY ")\n"
+    "\n"
+    "grep prints every line containing PATTERN in draft order as\n"
+    "path:line:draft-line:draft-offset:text\n"
+    "index updates the project's word index, _search_.idx, and lookup\n"
+    "prints every occurrence of WORD from it as path:line:draft-line:draft-offset\n"
+    "dupes prints passages shared between files as\n"
+    "path:line:start-end<TAB>path:line:start-end<TAB>length\n"
+    "spell prints words in neither the system word list nor the project's\n"
+    "_dictionary.txt as path:line:draft-line:draft-offset:word\n"
     "\n"
     "For more information, see https://github.com/zacharyarney/colette\n";
 
@@ -27,10 +70,41 @@ static struct option longOpts[] = {
     {"as-list", no_argument, NULL, 'l'},
     {"title", required_argument, NULL, 't'},
     {"prefix", required_argument, NULL, 'p'},
+    {"trace", required_argument, NULL, 'T'},
+    {"report", required_argument, NULL, 'r'},
+    {"jobs", required_argument, NULL, 'j'},
+    {"readahead", required_argument, NULL, 'R'},
+    {"validate-utf8", no_argument, NULL, 'u'},
+    {"filter", required_argument, NULL, 'F'},
+    {"metadata", no_argument, NULL, 'm'},
+    {"exclude", required_argument, NULL, 'x'},
+    {"toc", no_argument, NULL, 'C'},
+    {"format", required_argument, NULL, 'f'},
+    {"header", required_argument, NULL, 'H'},
+    {"separator", required_argument, NULL, 's'},
+    {"stats", required_argument, NULL, 'S'},
+    {"analyze", no_argument, NULL, 'A'},
+    {"min-length", required_argument, NULL, 'L'},
+    {"dictionary", required_argument, NULL, 'D'},
+    {"manifest", no_argument, NULL, 'M'},
+    {"verify", required_argument, NULL, 'V'},
     // {"output", required_argument, NULL, 'o'},
     {0, 0, 0, 0}  // array terminator
 };
 
+struct Subcommand {
+    const char *name;
+    enum ProcessMode mode;
+};
+
+static const struct Subcommand SUBCOMMANDS[] = {
+    {"grep", MODE_GREP},
+    {"index", MODE_INDEX},
+    {"lookup", MODE_LOOKUP},
+    {"dupes", MODE_DUPES},
+    {"spell", MODE_SPELL},
+};
+
 static const char *argErrorToString(enum ArgError error) {
     switch (error) {
     case ARG_SUCCESS:
@@ -49,6 +123,33 @@ static const char *argErrorToString(enum ArgError error) {
         return "Error: Title value required";
     case ARG_INVALID_TITLE:
         return "Error: Invalid title";
+    case ARG_MISSING_TRACE:
+        return "Error: Trace file path required";
+    case ARG_INVALID_REPORT:
+        return "Error: Report format must be text or json";
+    case ARG_INVALID_JOBS:
+        return "Error: Jobs must be a value from 1 to 256";
+    case ARG_INVALID_READAHEAD:
+        return "Error: Readahead must be a value from 0 to 256";
+    case ARG_INVALID_FILTER:
+        return "Error: Unknown filter (use crlf, bom, trim, blank-lines, "
+               "smart-quotes or all)";
+    case ARG_INVALID_EXCLUDE:
+        return "Error: Exclude rules must be KEY=VALUE, at most 16";
+    case ARG_MISSING_STATS:
+        return "Error: Stats report path required";
+    case ARG_MISSING_PATTERN:
+        return "Error: Search pattern or single word required";
+    case ARG_INVALID_MIN_LENGTH:
+        return "Error: Minimum length must be a value from 96 to 1000000";
+    case ARG_MISSING_DICTIONARY:
+        return "Error: Word list path required";
+    case ARG_MISSING_DRAFT:
+        return "Error: Draft path required";
+    case ARG_INVALID_FORMAT:
+        return "Error: Format must be md, html, html-chapters or epub";
+    case ARG_INVALID_TEMPLATE:
+        return "Error: Invalid template (unmatched brace or unknown variable)";
     case ARG_NO_DIR_ACCESS:
         return "Error: Cannot access directory";
     case ARG_CONFLICTING_FLAGS:
@@ -156,6 +257,85 @@ static unsigned int validatePadding(char *paddingArg, enum ArgError *status) {
     return padding;
 }
 
+static unsigned int validateJobs(char *jobsArg, enum ArgError *status) {
+    char *endptr;
+    bool success;
+    unsigned int jobs = stringToUint(jobsArg, &endptr, &success);
+    if (!success || *endptr != '\0' || jobs < 1 || jobs > COLETTE_MAX_JOBS) {
+        *status = ARG_INVALID_JOBS;
+        return 0;
+    }
+
+    *status = ARG_SUCCESS;
+    return jobs;
+}
+
+static unsigned int validateReadahead(char *readaheadArg,
+                                      enum ArgError *status) {
+    char *endptr;
+    bool success;
+    unsigned int files = stringToUint(readaheadArg, &endptr, &success);
+    if (!success || *endptr != '\0' || files > COLETTE_MAX_READAHEAD) {
+        *status = ARG_INVALID_READAHEAD;
+        return COLETTE_READAHEAD_FILES;
+    }
+
+    *status = ARG_SUCCESS;
+    return files;
+}
+
+static unsigned int validateFilters(char *filterArg, enum ArgError *status) {
+    unsigned int filters;
+    if (parseFilterNames(filterArg, &filters) != 0) {
+        *status = ARG_INVALID_FILTER;
+        return FILTER_NONE;
+    }
+
+    *status = ARG_SUCCESS;
+    return filters;
+}
+
+static void validateExclude(char *excludeArg, struct Arguments *args) {
+    if (args->excludeCount >= COLETTE_MAX_EXCLUDES ||
+        parseMetaExclude(excludeArg, &args->excludes[args->excludeCount]) !=
+            0) {
+        args->status = ARG_INVALID_EXCLUDE;
+        return;
+    }
+
+    args->excludeCount++;
+    args->metadata = true; // rules match front matter, so it must be read
+    args->status = ARG_SUCCESS;
+}
+
+static void validateTemplate(char *templateArg,
+                             struct Template *tmpl,
+                             enum ArgError *status) {
+    freeTemplate(tmpl); // the last of repeated options wins
+    if (compileTemplate(templateArg, tmpl) != 0) {
+        *status = ARG_INVALID_TEMPLATE;
+        return;
+    }
+
+    *status = ARG_SUCCESS;
+}
+
+static unsigned int validateMinLength(char *lengthArg, enum ArgError *status) {
+    char *endptr;
+    bool success;
+    unsigned int length = stringToUint(lengthArg, &endptr, &success);
+    // shorter passages can slip between fingerprints
+    unsigned int shortest = COLETTE_DUPES_KGRAM + COLETTE_DUPES_WINDOW;
+    if (!success || *endptr != '\0' || length < shortest ||
+        length > COLETTE_DUPES_MAX_LENGTH) {
+        *status = ARG_INVALID_MIN_LENGTH;
+        return COLETTE_DUPES_MIN_LENGTH;
+    }
+
+    *status = ARG_SUCCESS;
+    return length;
+}
+
 static char *validateTitle(char *titleArg, enum ArgError *status) {
     if (!titleArg || titleArg[0] == '\0') {
         *status = ARG_MISSING_TITLE;
@@ -197,15 +377,140 @@ static char *validateTitle(char *titleArg, enum ArgError *status) {
     return titleBuf;
 }
 
+static char *validateTraceFile(char *traceArg, enum ArgError *status) {
+    if (!traceArg || traceArg[0] == '\0') {
+        *status = ARG_MISSING_TRACE;
+        return NULL;
+    }
+
+    // points into argv, which outlives the arguments struct
+    *status = ARG_SUCCESS;
+    return traceArg;
+}
+
+static char *validateStatsFile(char *statsArg, enum ArgError *status) {
+    if (!statsArg || statsArg[0] == '\0') {
+        *status = ARG_MISSING_STATS;
+        return NULL;
+    }
+
+    // points into argv, like the trace path
+    *status = ARG_SUCCESS;
+    return statsArg;
+}
+
+static char *validateDictionary(char *dictionaryArg, enum ArgError *status) {
+    if (!dictionaryArg || dictionaryArg[0] == '\0') {
+        *status = ARG_MISSING_DICTIONARY;
+        return NULL;
+    }
+
+    // points into argv, like the trace path
+    *status = ARG_SUCCESS;
+    return dictionaryArg;
+}
+
+static char *validateVerifyDraft(char *draftArg, enum ArgError *status) {
+    if (!draftArg || draftArg[0] == '\0') {
+        *status = ARG_MISSING_DRAFT;
+        return NULL;
+    }
+
+    // points into argv, like the trace path
+    *status = ARG_SUCCESS;
+    return draftArg;
+}
+
+static char *validatePattern(char *patternArg,
+                             enum ProcessMode mode,
+                             enum ArgError *status) {
+    // the index only holds single words, so a phrase would never match
+    if (!patternArg || patternArg[0] == '\0' ||
+        (mode == MODE_LOOKUP && !isIndexWord(patternArg))) {
+        *status = ARG_MISSING_PATTERN;
+        return NULL;
+    }
+
+    // points into argv, like the trace path
+    *status = ARG_SUCCESS;
+    return patternArg;
+}
+
+static enum OutputFormat validateOutputFormat(char *formatArg,
+                                              enum ArgError *status) {
+    static const struct {
+        const char *name;
+        enum OutputFormat format;
+    } FORMATS[] = {
+        {"md", FORMAT_MARKDOWN},
+        {"html", FORMAT_HTML},
+        {"html-chapters", FORMAT_HTML_CHAPTERS},
+        {"epub", FORMAT_EPUB},
+    };
+
+    for (size_t i = 0; formatArg && i < sizeof(FORMATS) / sizeof(FORMATS[0]);
+         i++) {
+        if (strcmp(formatArg, FORMATS[i].name) == 0) {
+            *status = ARG_SUCCESS;
+            return FORMATS[i].format;
+        }
+    }
+
+    *status = ARG_INVALID_FORMAT;
+    return FORMAT_MARKDOWN;
+}
+
+static enum ReportFormat validateReportFormat(char *formatArg,
+                                              enum ArgError *status) {
+    if (formatArg && strcmp(formatArg, "text") == 0) {
+        *status = ARG_SUCCESS;
+        return REPORT_TEXT;
+    }
+    if (formatArg && strcmp(formatArg, "json") == 0) {
+        *status = ARG_SUCCESS;
+        return REPORT_JSON;
+    }
+
+    *status = ARG_INVALID_REPORT;
+    return REPORT_TEXT;
+}
+
 struct Arguments parseArgs(int argc, char **argv) {
     struct Arguments args = {.directory = NULL,
+                             .traceFile = NULL,
+                             .statsFile = NULL,
+                             .pattern = NULL,
+                             .dictionary = NULL,
+                             .verifyDraft = NULL,
                              .initMode = false,
                              .mode = MODE_COLLATE,
                              .prefixPadding = 3,
+                             .reportFormat = REPORT_TEXT,
+                             .jobs = 0,
+                             .readahead = COLETTE_READAHEAD_FILES,
+                             .minLength = COLETTE_DUPES_MIN_LENGTH,
+                             .validateUtf8 = false,
+                             .filters = FILTER_NONE,
+                             .metadata = false,
+                             .toc = false,
+                             .manifest = false,
+                             .format = FORMAT_MARKDOWN,
+                             .excludeCount = 0,
                              .status = ARG_SUCCESS};
 
+    // subcommands come before any options
+    size_t subcommandCount = sizeof(SUBCOMMANDS) / sizeof(SUBCOMMANDS[0]);
+    for (size_t i = 0; argc > 1 && i < subcommandCount; i++) {
+        if (strcmp(argv[1], SUBCOMMANDS[i].name) == 0) {
+            args.mode = SUBCOMMANDS[i].mode;
+            optind = 2;
+            break;
+        }
+    }
+    bool takesPattern = args.mode == MODE_GREP || args.mode == MODE_LOOKUP;
+
     int opt;
-    char *shortOpts = "cilt:p:";
+    char *shortOpts = "cilumACMt:p:T:r:j:R:F:x:f:H:s:S:L:D:V:";
 
     while ((opt = getopt_long(argc, argv, shortOpts, longOpts, NULL)) != -1) {
         switch (opt) {
@@ -218,18 +523,112 @@ struct Arguments parseArgs(int argc, char **argv) {
         case 'l':
             args.mode = validateModes(&args, MODE_LIST, &args.status);
             break;
+        case 'A':
+            args.mode = validateModes(&args, MODE_ANALYZE, &args.status);
+            break;
+        case 'u':
+            args.validateUtf8 = true;
+            break;
         case 't':
             args.title = validateTitle(optarg, &args.status);
             break;
         case 'p':
             args.prefixPadding = validatePadding(optarg, &args.status);
             break;
+        case 'T':
+            args.traceFile = validateTraceFile(optarg, &args.status);
+            break;
+        case 'r':
+            args.reportFormat = validateReportFormat(optarg, &args.status);
+            break;
+        case 'j':
+            args.jobs = validateJobs(optarg, &args.status);
+            break;
+        case 'R':
+            args.readahead = validateReadahead(optarg, &args.status);
+            break;
+        case 'F':
+            args.filters = validateFilters(optarg, &args.status);
+            break;
+        case 'm':
+            args.metadata = true;
+            break;
+        case 'x':
+            validateExclude(optarg, &args);
+            break;
+        case 'C':
+            args.toc = true;
+            break;
+        case 'f':
+            args.format = validateOutputFormat(optarg, &args.status);
+            break;
+        case 'H':
+            validateTemplate(optarg, &args.header, &args.status);
+            break;
+        case 's':
+            validateTemplate(optarg, &args.separator, &args.status);
+            break;
+        case 'S':
+            args.statsFile = validateStatsFile(optarg, &args.status);
+            break;
+        case 'L':
+            args.minLength = validateMinLength(optarg, &args.status);
+            break;
+        case 'D':
+            args.dictionary = validateDictionary(optarg, &args.status);
+            break;
+        case 'M':
+            args.manifest = true;
+            break;
+        case 'V':
+            args.verifyDraft = validateVerifyDraft(optarg, &args.status);
+            args.mode = validateModes(&args, MODE_VERIFY, &args.status);
+            break;
         case '?':
             args.status = ARG_INVALID_OPT;
             break;
         }
     }
 
+    // subcommands only read the project, and report draft positions for
+    // plain collation
+    if (args.mode >= MODE_GREP &&
+        (args.initMode || args.statsFile || args.header.text ||
+         args.separator.text || args.filters != FILTER_NONE || args.metadata ||
+         args.excludeCount > 0 || args.toc)) {
+        args.status = ARG_CONFLICTING_FLAGS;
+    }
+    // both would write reports of their own to stdout
+    if (args.mode == MODE_ANALYZE && args.statsFile) {
+        args.status = ARG_CONFLICTING_FLAGS;
+    }
+    // verifying only reads the project
+    if (args.mode == MODE_VERIFY && (args.initMode || args.statsFile)) {
+        args.status = ARG_CONFLICTING_FLAGS;
+    }
+    // the draft is hashed as it is written, and a table of contents is put
+    // in front of the body afterwards
+    if (args.manifest && (args.mode != MODE_COLLATE || args.toc)) {
+        args.status = ARG_CONFLICTING_FLAGS;
+    }
+    // HTML is rendered from the sources, not from a collated draft, so the
+    // options that shape the draft don't apply to it
+    if (args.format != FORMAT_MARKDOWN) {
+        if (args.mode != MODE_COLLATE || args.toc || args.metadata ||
+            args.filters != FILTER_NONE || args.statsFile || args.manifest) {
+            args.status = ARG_CONFLICTING_FLAGS;
+        }
+        args.mode = MODE_HTML;
+    }
+
+    // files have always been followed by a line feed
+    if (!args.header.text && compileTemplate("", &args.header) != 0) {
+        args.status = ARG_MEMORY_ERROR;
+    }
+    if (!args.separator.text && compileTemplate("\n", &args.separator) != 0) {
+        args.status = ARG_MEMORY_ERROR;
+    }
+
     // Set default title if not supplied by user
     if (!args.title) {
         char *defaultTitle = "_draft_";
@@ -241,7 +640,16 @@ struct Arguments parseArgs(int argc, char **argv) {
     }
     // After optional args are parsed, optint points to first non-optional arg.
     // This allows us to set args->directory to DIRECTORY.
-    args.directory = validateDirectory(argv[optind], &args.status);
+    // don't let a valid directory mask an earlier option error
+    if (args.status == ARG_SUCCESS && takesPattern) {
+        args.pattern = validatePattern(argv[optind], args.mode, &args.status);
+        if (args.status == ARG_SUCCESS) {
+            optind++;
+        }
+    }
+    if (args.status == ARG_SUCCESS) {
+        args.directory = validateDirectory(argv[optind], &args.status);
+    }
     if (args.status != ARG_SUCCESS) {
         fprintf(stderr, "%s\n", argErrorToString(args.status));
         fprintf(stderr, "%s\n", getUsageString());
@@ -253,4 +661,6 @@ struct Arguments parseArgs(int argc, char **argv) {
 void freeArguments(struct Arguments *args) {
     free(args->directory);
     free(args->title);
+    freeTemplate(&args->header);
+    freeTemplate(&args->separator);
 }
@@ -1,6 +1,10 @@
 #ifndef ARGS_H
 #define ARGS_H
 
+#include "constants.h"
+#include "diagnostics.h"
+#include "metadata.h"
+#include "template.h"
 #include <stdbool.h>
 
 /* *
@@ -15,6 +19,19 @@ enum ArgError {
     ARG_PADDING_RANGE,        // Padding value outside allowed range (1-10)
     ARG_MISSING_TITLE,        // No title provided with -t flag
     ARG_INVALID_TITLE,        // Title contains invalid characters
+    ARG_MISSING_TRACE,        // No file provided with -T flag
+    ARG_INVALID_REPORT,       // Unknown report format provided with -r flag
+    ARG_INVALID_JOBS,         // Job count is not a number from 1 to 256
+    ARG_INVALID_READAHEAD,    // -R value not a number from 0 to 256
+    ARG_INVALID_FILTER,       // Unknown name in -F filter list
+    ARG_INVALID_EXCLUDE,      // -x rule not KEY=VALUE, or too many rules
+    ARG_MISSING_STATS,        // No file provided with -S flag
+    ARG_MISSING_PATTERN,      // grep or lookup without a non-empty PATTERN
+    ARG_INVALID_MIN_LENGTH,   // -L value not a number in the allowed range
+    ARG_MISSING_DICTIONARY,   // No file provided with -D flag
+    ARG_MISSING_DRAFT,        // No draft provided with -V flag
+    ARG_INVALID_TEMPLATE,     // -H or -s template doesn't compile
+    ARG_INVALID_FORMAT,       // Unknown output format provided with -f flag
     ARG_NO_DIR_ACCESS,        // Cannot access specified directory
     ARG_CONFLICTING_FLAGS,    // Incompatible flags used together
     ARG_INVALID_OPT,          // Unknown option flag provided
@@ -29,6 +46,26 @@ enum ProcessMode {
     MODE_COLLATE,
     MODE_LIST,
     MODE_CHECK,
+    MODE_ANALYZE, // --analyze: style report on stdout
+    MODE_HTML,    // --format html, html-chapters or epub: rendered draft
+    MODE_VERIFY,  // --verify DRAFT: compare against its manifest
+    // subcommands, kept last
+    MODE_GREP,   // `colette grep PATTERN DIRECTORY`
+    MODE_INDEX,  // `colette index DIRECTORY`
+    MODE_LOOKUP, // `colette lookup WORD DIRECTORY`
+    MODE_DUPES,  // `colette dupes DIRECTORY`
+    MODE_SPELL,  // `colette spell DIRECTORY`
+};
+
+/* *
+ * Draft formats. Markdown is collated as written; the rendered formats switch
+ * to MODE_HTML once options are parsed.
+ * */
+enum OutputFormat {
+    FORMAT_MARKDOWN,      // _draft_.md
+    FORMAT_HTML,          // _draft_.html, one document
+    FORMAT_HTML_CHAPTERS, // _draft_/, one document per top-level entry
+    FORMAT_EPUB,          // _draft_.epub, a chapter per top-level entry
 };
 
 /* *
@@ -38,9 +75,28 @@ enum ProcessMode {
 struct Arguments {
     char *directory;             // Path to project root directory
     char *title;                 // Name of output file or directory
+    char *traceFile;             // Chrome trace output path, NULL if disabled
+    char *statsFile;             // word count report path ("-" is stdout)
+    char *pattern;               // grep, lookup: string to search for
+    char *dictionary;            // spell: system word list, NULL for default
+    char *verifyDraft;           // --verify: draft whose manifest is checked
     bool initMode;               // --init flag used
     enum ProcessMode mode;       // check, collate, list
     unsigned int prefixPadding;  // number of digits in output numeric prefix
+    enum ReportFormat reportFormat; // check mode report: text or json
+    unsigned int jobs;           // worker threads, 0 picks one per processor
+    unsigned int readahead;      // collate: files opened ahead, 0 for none
+    unsigned int minLength;      // dupes: shortest passage to report
+    bool validateUtf8;           // collate: fail on invalid UTF-8 input
+    unsigned int filters;        // collate: TextFilterFlag bits, 0 copies raw
+    bool metadata;               // collate: strip front matter, write table
+    bool toc;                    // collate: table of contents at the front
+    bool manifest;               // collate: write hashes of draft and sources
+    enum OutputFormat format;    // collate: draft format
+    struct Template header;      // collate: written before each file
+    struct Template separator;   // collate: written after each file
+    struct MetaExclude excludes[COLETTE_MAX_EXCLUDES]; // --exclude rules
+    size_t excludeCount;
     enum ArgError status;        // status of parsing for error reporting
 };
 
@@ -0,0 +1,329 @@
+#include "check.h"
+#include "constants.h"
+#include "encoding.h"
+#include "errors.h"
+#include "files.h"
+#include "reporting.h"
+#include "trace.h"
+#include "utf8.h"
+#include "workers.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* *
+ * Outcome of validating one entry. Workers only write to their own result,
+ * the calling thread turns results into reports once every worker is done.
+ * */
+enum CheckProblem {
+    CHECK_OK,
+    CHECK_PROCESS_ERROR, // detail says what went wrong
+    CHECK_READ_ERROR,    // opened but reading failed part way
+    CHECK_INVALID_UTF8,  // errorOffset/errorLine locate the first bad sequence
+};
+
+struct CheckResult {
+    enum CheckProblem problem;
+    enum ProcessErrorDetail detail;
+    int savedErrno;
+    size_t errorOffset;
+    size_t errorLine;
+    long long bytes;       // files only: bytes read while validating
+    struct TraceSpan span; // files only: validation, recorded by the caller
+    struct TraceSpan spanEnd;
+    char **orphans; // directories only: included names not in any index
+    size_t orphanCount;
+};
+
+struct CheckJob {
+    struct FileList *entries;
+    bool countStats;
+    const char **referenced; // sorted paths of every non-root entry
+    size_t referencedCount;
+    struct CheckResult *results;
+};
+
+static int comparePaths(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static bool isReferenced(const struct CheckJob *job, const char *path) {
+    return bsearch(&path,
+                   job->referenced,
+                   job->referencedCount,
+                   sizeof(const char *),
+                   comparePaths) != NULL;
+}
+
+/* *
+ * joinPath() reports failures, which isn't safe from worker threads. Paths in
+ * the entry list were built by joinPath(), so this builds them the same way.
+ * */
+static int joinEntryPath(char *buffer, const char *dir, const char *name) {
+    size_t dirLen = strlen(dir);
+    const char *separator = (dirLen > 0 && dir[dirLen - 1] == '/') ? "" : "/";
+    int len = snprintf(
+        buffer, COLETTE_PATH_BUF_SIZE, "%s%s%s", dir, separator, name);
+    return (len < 0 || len > COLETTE_MAX_PATH_LEN) ? -1 : 0;
+}
+
+static void validateFile(const char *path,
+                         enum TextEncoding declared,
+                         struct CheckResult *result,
+                         struct TextStats *stats) {
+    errno = 0;
+    // O_NOFOLLOW catches a file swapped for a link after resolution and
+    // O_NONBLOCK keeps a FIFO from stalling the worker
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK);
+    if (fd < 0) {
+        result->problem = CHECK_PROCESS_ERROR;
+        result->savedErrno = errno;
+        result->detail = openErrorDetail(errno);
+        return;
+    }
+
+    // the file is read anyway to prove it's readable, so validate its
+    // encoding in the same pass
+    unsigned char buffer[COLETTE_SCAN_BUF_SIZE];
+    struct Utf8Validator validator;
+    utf8Init(&validator);
+    struct StatsCounter counter;
+    statsCounterReset(&counter);
+
+    // files collation transcodes are UTF-8 by the time they reach the draft
+    bool validating = true;
+    bool firstBlock = true;
+
+    ssize_t bytesRead;
+    while ((bytesRead = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result->problem = CHECK_READ_ERROR;
+            result->savedErrno = errno;
+            close(fd);
+            return;
+        }
+        result->bytes += bytesRead;
+        if (firstBlock) {
+            validating = detectEncoding(declared, buffer, (size_t)bytesRead) ==
+                         ENCODING_UTF8;
+            firstBlock = false;
+        }
+        if (stats) {
+            statsUpdate(&counter, stats, buffer, (size_t)bytesRead);
+        }
+        // only the first invalid sequence is reported, the rest of the file
+        // is read only if it still needs counting
+        if (validating &&
+            !utf8Update(&validator, buffer, (size_t)bytesRead) && !stats) {
+            break;
+        }
+    }
+    close(fd);
+
+    if (validating && !utf8Finish(&validator)) {
+        result->problem = CHECK_INVALID_UTF8;
+        result->errorOffset = validator.errorOffset;
+        result->errorLine = validator.errorLine;
+    }
+}
+
+static bool isProjectEntry(const char *dirPath, const struct dirent *entry) {
+#ifdef _DIRENT_HAVE_D_TYPE
+    if (entry->d_type == DT_REG || entry->d_type == DT_DIR) {
+        return true;
+    }
+    if (entry->d_type != DT_UNKNOWN) {
+        return false; // links, devices, sockets are never project files
+    }
+#endif
+
+    char path[COLETTE_PATH_BUF_SIZE];
+    if (joinEntryPath(path, dirPath, entry->d_name) != 0) {
+        return false;
+    }
+    struct stat statBuf;
+    return lstat(path, &statBuf) == 0 &&
+           (S_ISREG(statBuf.st_mode) || S_ISDIR(statBuf.st_mode));
+}
+
+static int addOrphan(struct CheckResult *result, const char *name) {
+    char **newOrphans =
+        realloc(result->orphans, (result->orphanCount + 1) * sizeof(char *));
+    if (!newOrphans) {
+        return -1;
+    }
+    result->orphans = newOrphans;
+
+    size_t nameLen = strlen(name) + 1;
+    char *nameCopy = malloc(nameLen);
+    if (!nameCopy) {
+        return -1;
+    }
+    memcpy(nameCopy, name, nameLen);
+    result->orphans[result->orphanCount] = nameCopy;
+    result->orphanCount++;
+
+    return 0;
+}
+
+static void findOrphans(const struct CheckJob *job,
+                        const char *dirPath,
+                        struct CheckResult *result) {
+    errno = 0;
+    DIR *dir = opendir(dirPath);
+    if (!dir) {
+        result->problem = CHECK_PROCESS_ERROR;
+        result->savedErrno = errno;
+        result->detail =
+            errno == EACCES ? PROC_ERR_ACCESS_DENIED : PROC_ERR_OPEN_FILE;
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!isIncluded(entry->d_name)) {
+            continue;
+        }
+
+        char path[COLETTE_PATH_BUF_SIZE];
+        if (joinEntryPath(path, dirPath, entry->d_name) != 0) {
+            continue;
+        }
+        if (isReferenced(job, path) || !isProjectEntry(dirPath, entry)) {
+            continue;
+        }
+        if (addOrphan(result, path) != 0) {
+            result->problem = CHECK_PROCESS_ERROR;
+            result->savedErrno = ENOMEM;
+            result->detail = PROC_ERR_MEMORY_ALLOC;
+            break;
+        }
+    }
+
+    closedir(dir);
+
+    // readdir order is filesystem dependent, keep the report stable
+    if (result->orphanCount > 1) {
+        qsort(result->orphans, result->orphanCount, sizeof(char *), comparePaths);
+    }
+}
+
+static void checkEntry(size_t index, void *arg) {
+    struct CheckJob *job = arg;
+    struct FileEntry *entry = &job->entries->entries[index];
+    struct CheckResult *result = &job->results[index];
+
+    if (entry->type == FILE_TYPE_DIRECTORY) {
+        findOrphans(job, entry->path, result);
+    } else if (entry->type == FILE_TYPE_REGULAR) {
+        result->span = traceBegin();
+        validateFile(entry->path,
+                     entry->encoding,
+                     result,
+                     job->countStats ? &entry->stats : NULL);
+        result->spanEnd = traceBegin();
+    } else {
+        result->problem = CHECK_PROCESS_ERROR;
+        result->detail = PROC_ERR_NOT_REGULAR;
+    }
+}
+
+static void reportDuplicates(const struct CheckJob *job) {
+    for (size_t i = 1; i < job->referencedCount; i++) {
+        bool isRepeat = strcmp(job->referenced[i - 1], job->referenced[i]) == 0;
+        bool isFirstRepeat =
+            i < 2 || strcmp(job->referenced[i - 2], job->referenced[i]) != 0;
+        if (isRepeat && isFirstRepeat) {
+            errno = 0;
+            reportProcessWarning(PROCESS_OP_HANDLE_CHECK,
+                                 job->referenced[i],
+                                 PROC_ERR_DUPLICATE_REF);
+        }
+    }
+}
+
+int validateProjectFiles(struct FileList *entries,
+                         unsigned int jobs,
+                         bool countStats) {
+    if (!entries || entries->count == 0) {
+        reportProcessError(PROCESS_OP_HANDLE_CHECK, NULL, PROC_ERR_INVALID_STATE);
+        return -1;
+    }
+
+    struct CheckJob job = {.entries = entries, .countStats = countStats};
+    job.results = calloc(entries->count, sizeof(struct CheckResult));
+    job.referenced = malloc(entries->count * sizeof(const char *));
+    if (!job.results || !job.referenced) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_CHECK, entries->entries[0].path, PROC_ERR_MEMORY_ALLOC);
+        free(job.results);
+        free(job.referenced);
+        return -1;
+    }
+
+    // the root directory is never listed in an index
+    for (size_t i = 1; i < entries->count; i++) {
+        job.referenced[job.referencedCount] = entries->entries[i].path;
+        job.referencedCount++;
+    }
+    qsort(job.referenced, job.referencedCount, sizeof(const char *), comparePaths);
+
+    runParallel(entries->count, jobs, checkEntry, &job);
+
+    int status = 0;
+    for (size_t i = 0; i < entries->count; i++) {
+        struct CheckResult *result = &job.results[i];
+        const char *path = entries->entries[i].path;
+        if (entries->entries[i].type == FILE_TYPE_REGULAR) {
+            traceEndAt(result->span,
+                       result->spanEnd,
+                       TRACE_HANDLER,
+                       path,
+                       result->bytes);
+        }
+        switch (result->problem) {
+        case CHECK_OK:
+            break;
+        case CHECK_PROCESS_ERROR:
+            errno = result->savedErrno;
+            reportProcessError(PROCESS_OP_HANDLE_CHECK, path, result->detail);
+            status = -1;
+            break;
+        case CHECK_READ_ERROR:
+            errno = result->savedErrno;
+            reportFileError(FILE_OP_READ, path);
+            status = -1;
+            break;
+        case CHECK_INVALID_UTF8:
+            reportEncodingError(PROCESS_OP_HANDLE_CHECK,
+                                path,
+                                result->errorOffset,
+                                result->errorLine);
+            status = -1;
+            break;
+        }
+        for (size_t j = 0; j < result->orphanCount; j++) {
+            errno = 0;
+            reportProcessWarning(PROCESS_OP_HANDLE_CHECK,
+                                 result->orphans[j],
+                                 PROC_ERR_ORPHANED_FILE);
+            free(result->orphans[j]);
+        }
+        free(result->orphans);
+    }
+    reportDuplicates(&job);
+
+    free(job.results);
+    free(job.referenced);
+
+    return status;
+}
@@ -0,0 +1,31 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "filelist.h"
+#include <stdbool.h>
+
+/* *
+ * Validates a resolved project in parallel. Every regular file is read to
+ * confirm it still exists, is readable, is not a symbolic link and is valid
+ * UTF-8. Every directory is scanned for project files that no .index lists,
+ * and files referenced more than once are flagged. Work is spread across up to
+ * jobs threads; results are reported from the calling thread in traversal
+ * order so the report is identical regardless of scheduling.
+ *
+ * Unreadable, missing or badly encoded files are errors. Duplicate references
+ * and orphaned files are warnings.
+ *
+ * @param   entries     Resolved entries in traversal order, root directory
+ *                      first
+ * @param   jobs        Maximum number of worker threads
+ * @param   countStats  Also fill in each file's word/char/line stats
+ *
+ * @return  int
+ *          0        if no errors were found
+ *         -1        if any file failed validation
+ * */
+int validateProjectFiles(struct FileList *entries,
+                         unsigned int jobs,
+                         bool countStats);
+
+#endif
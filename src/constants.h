@@ -14,6 +14,12 @@
 #define COLETTE_PATH_BUF_SIZE 4096
 #define COLETTE_MAX_PATH_LEN (COLETTE_PATH_BUF_SIZE - 1)
 
+/* *
+ * Components a path builder can hold above its root: directory levels, the
+ * entry and its extension.
+ * */
+#define COLETTE_PATH_COMPONENTS 64
+
 /* *
  * Common system filename size
  * */
@@ -24,13 +30,150 @@
  * */
 #define COLETTE_EXT_BUF_SIZE 16
 
+/* *
+ * Blocks of the arena holding the directories being traversed: a path and an
+ * index read buffer per level of nesting, so a few levels fit in one block.
+ * */
+#define COLETTE_TRAVERSAL_ARENA_SIZE (COLETTE_PATH_BUF_SIZE * 4)
+#define COLETTE_INDEX_BUF_SIZE 4096
+
+/* *
+ * Collation hands resolved entries to its handler this many at a time; the
+ * paths of one batch are held in blocks of the given size.
+ * */
+#define COLETTE_BATCH_ENTRIES 64
+#define COLETTE_FILE_LIST_ARENA_SIZE (COLETTE_PATH_BUF_SIZE * 4)
+
 /* *
  * Size of read buffer for file collation
  * */
 #define COLETTE_FILE_BUF_SIZE 8192
 
+/* *
+ * Ring of buffers between collation and the thread writing the draft: the
+ * most draft bytes held in memory is their product.
+ * */
+#define COLETTE_PIPELINE_SLOTS 8
+#define COLETTE_PIPELINE_BUF_SIZE 65536
+
+/* *
+ * Collation opens this many files ahead of the one being copied and asks the
+ * kernel to start reading them (--readahead). Each holds a descriptor.
+ * */
+#define COLETTE_READAHEAD_FILES 16
+#define COLETTE_MAX_READAHEAD 256
+
+/* *
+ * Sources at least this large are dropped from the page cache once copied,
+ * so a draft of a few huge files doesn't push everything else out. Smaller
+ * files stay cached for the next collation.
+ * */
+#define COLETTE_READAHEAD_DROP_SIZE (8 * 1024 * 1024)
+
+/* *
+ * Size of read buffer for scanning file contents without copying them, e.g.
+ * encoding validation in check mode. Allocated on worker thread stacks.
+ * */
+#define COLETTE_SCAN_BUF_SIZE 65536
+
+/* *
+ * Largest YAML front matter block buffered while collating with --metadata. A
+ * longer block is treated as ordinary text.
+ * */
+#define COLETTE_FRONT_MATTER_MAX 65536
+
+/* *
+ * Most --exclude KEY=VALUE rules accepted on one command line.
+ * */
+#define COLETTE_MAX_EXCLUDES 16
+
+/* *
+ * Name of the word index `colette index` keeps in the project root. The
+ * leading underscore keeps it out of traversal like the draft.
+ * */
+#define COLETTE_WORD_INDEX_NAME "_search_.idx"
+
+/* *
+ * Longest word, in bytes, held in the word index. Longer runs are skipped.
+ * */
+#define COLETTE_MAX_TERM_LEN 64
+
+/* *
+ * `colette dupes` fingerprints every run of COLETTE_DUPES_KGRAM letters and
+ * digits and keeps the smallest fingerprint in each window of
+ * COLETTE_DUPES_WINDOW of them, so every shared passage at least
+ * KGRAM + WINDOW - 1 long is guaranteed to be found.
+ * */
+#define COLETTE_DUPES_KGRAM 32
+#define COLETTE_DUPES_WINDOW 64
+#define COLETTE_DUPES_MIN_LENGTH 200
+#define COLETTE_DUPES_MAX_LENGTH 1000000
+
+/* *
+ * Fingerprints held at once by `colette dupes`. Larger projects are hashed in
+ * several passes, each keeping a slice of the hash space.
+ * */
+#define COLETTE_DUPES_MEMORY (256u * 1024u * 1024u)
+
+/* *
+ * Fingerprints shared by more places than this are boilerplate, not copied
+ * passages, and are skipped.
+ * */
+#define COLETTE_DUPES_MAX_OCCURRENCES 16
+
+/* *
+ * Word lists for `colette spell`: the system list, the project's own list in
+ * its root and the compiled cache of both, kept beside it. Leading
+ * underscores keep the project files out of traversal.
+ * */
+#define COLETTE_SYSTEM_DICTIONARY "/usr/share/dict/words"
+#define COLETTE_PROJECT_DICTIONARY_NAME "_dictionary.txt"
+#define COLETTE_SPELL_CACHE_NAME "_spell_.dict"
+
+/* *
+ * Entries in the top-words and top-phrases columns of an --analyze report.
+ * */
+#define COLETTE_ANALYZE_TOP_WORDS 10
+#define COLETTE_ANALYZE_TOP_PHRASES 5
+
+/* *
+ * --toc: heading of the table of contents, and how much of a heading line is
+ * read back for its title.
+ * */
+#define COLETTE_TOC_TITLE "Contents"
+#define COLETTE_TOC_LINE_MAX 1024
+
+/* *
+ * --format html: files rendered ahead of the writer per worker thread. Only
+ * this many files' HTML is held at once.
+ * */
+#define COLETTE_HTML_WINDOW_PER_JOB 4
+
 /* *
  * Initial project depth value allows for 5 layers of nesting.
  * */
 #define COLETTE_PROJECT_DEPTH 5
+
+/* *
+ * Upper bound on worker threads for parallel stages (--jobs).
+ * */
+#define COLETTE_MAX_JOBS 256
+
+/* *
+ * Size of a single formatted error report line. Fits the longest path plus
+ * operation and detail text.
+ * */
+#define COLETTE_REPORT_BUF_SIZE (COLETTE_PATH_BUF_SIZE + 512)
+
+/* *
+ * Number of events held by the --trace ring buffer. Older events are
+ * overwritten once it fills up.
+ * */
+#define COLETTE_TRACE_BUF_EVENTS 16384
+
+/* *
+ * Bytes of path kept per trace event. Longer paths keep their tail, which is
+ * the part that identifies the file.
+ * */
+#define COLETTE_TRACE_PATH_SIZE 256
 #endif
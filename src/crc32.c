@@ -0,0 +1,146 @@
+#include "crc32.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define COLETTE_CRC32_CLMUL 1
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+static const uint32_t CRC32_POLY = 0xEDB88320u;
+
+// CRC_TABLE[k][b]: CRC of byte b followed by k zero bytes
+static uint32_t CRC_TABLE[8][256];
+static pthread_once_t tablesBuilt = PTHREAD_ONCE_INIT;
+
+static void buildTables(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? CRC32_POLY ^ (c >> 1) : c >> 1;
+        }
+        CRC_TABLE[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t c = CRC_TABLE[k - 1][n];
+            CRC_TABLE[k][n] = (c >> 8) ^ CRC_TABLE[0][c & 0xff];
+        }
+    }
+}
+
+static uint32_t loadLittle32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+           (uint32_t)p[3] << 24;
+}
+
+// state is the inverted CRC, as the register holds it
+static uint32_t crc32Slice8(uint32_t state,
+                            const unsigned char *p,
+                            size_t len) {
+    while (len >= 8) {
+        uint32_t one = loadLittle32(p) ^ state;
+        uint32_t two = loadLittle32(p + 4);
+        state = CRC_TABLE[7][one & 0xff] ^ CRC_TABLE[6][(one >> 8) & 0xff] ^
+                CRC_TABLE[5][(one >> 16) & 0xff] ^ CRC_TABLE[4][one >> 24] ^
+                CRC_TABLE[3][two & 0xff] ^ CRC_TABLE[2][(two >> 8) & 0xff] ^
+                CRC_TABLE[1][(two >> 16) & 0xff] ^ CRC_TABLE[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0) {
+        state = CRC_TABLE[0][(state ^ *p++) & 0xff] ^ (state >> 8);
+    }
+    return state;
+}
+
+#ifdef COLETTE_CRC32_CLMUL
+/* *
+ * Folding constants for the reflected polynomial: x^(512+64) and x^512 mod P
+ * for four lanes, x^(128+64) and x^128 for one, x^64 for the last 64 bits,
+ * then P and its Barrett quotient.
+ * */
+static const uint64_t FOLD_BY_4[2] = {0x154442bd4ull, 0x1c6e41596ull};
+static const uint64_t FOLD_BY_1[2] = {0x1751997d0ull, 0x0ccaa009eull};
+static const uint64_t FOLD_64[2] = {0x163cd6124ull, 0};
+static const uint64_t BARRETT[2] = {0x1db710641ull, 0x1f7011641ull};
+
+__attribute__((target("pclmul,sse2"))) static __m128i
+fold(__m128i lane, __m128i constants, __m128i next) {
+    __m128i low = _mm_clmulepi64_si128(lane, constants, 0x00);
+    __m128i high = _mm_clmulepi64_si128(lane, constants, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(low, high), next);
+}
+
+/* *
+ * Carry-less multiplication folding over len bytes, a multiple of 16 and at
+ * least 64: four 128-bit lanes are folded forward 64 bytes at a time, folded
+ * into one, reduced to 64 bits and then to 32 by Barrett reduction.
+ * */
+__attribute__((target("pclmul,sse2"))) static uint32_t
+crc32Clmul(uint32_t state, const unsigned char *p, size_t len) {
+    const __m128i *blocks = (const __m128i *)(const void *)p;
+    __m128i x1 = _mm_loadu_si128(blocks + 0);
+    __m128i x2 = _mm_loadu_si128(blocks + 1);
+    __m128i x3 = _mm_loadu_si128(blocks + 2);
+    __m128i x4 = _mm_loadu_si128(blocks + 3);
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)state));
+    blocks += 4;
+    len -= 64;
+
+    __m128i constants = _mm_loadu_si128((const __m128i *)(const void *)FOLD_BY_4);
+    while (len >= 64) {
+        x1 = fold(x1, constants, _mm_loadu_si128(blocks + 0));
+        x2 = fold(x2, constants, _mm_loadu_si128(blocks + 1));
+        x3 = fold(x3, constants, _mm_loadu_si128(blocks + 2));
+        x4 = fold(x4, constants, _mm_loadu_si128(blocks + 3));
+        blocks += 4;
+        len -= 64;
+    }
+
+    constants = _mm_loadu_si128((const __m128i *)(const void *)FOLD_BY_1);
+    x1 = fold(x1, constants, x2);
+    x1 = fold(x1, constants, x3);
+    x1 = fold(x1, constants, x4);
+    while (len >= 16) {
+        x1 = fold(x1, constants, _mm_loadu_si128(blocks++));
+        len -= 16;
+    }
+
+    // 128 to 64 bits, which also appends the 32 zero bits the CRC needs
+    __m128i mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+    __m128i t = _mm_clmulepi64_si128(x1, constants, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+
+    constants = _mm_loadu_si128((const __m128i *)(const void *)FOLD_64);
+    t = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), constants, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+
+    // Barrett reduction from 64 bits to 32
+    constants = _mm_loadu_si128((const __m128i *)(const void *)BARRETT);
+    t = _mm_and_si128(x1, mask32);
+    t = _mm_clmulepi64_si128(t, constants, 0x10);
+    t = _mm_and_si128(t, mask32);
+    t = _mm_clmulepi64_si128(t, constants, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+    return (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif
+
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len) {
+    pthread_once(&tablesBuilt, buildTables);
+
+    const unsigned char *p = data;
+    uint32_t state = ~crc;
+#ifdef COLETTE_CRC32_CLMUL
+    if (len >= 64 && __builtin_cpu_supports("pclmul")) {
+        size_t folded = len & ~(size_t)15;
+        state = crc32Clmul(state, p, folded);
+        p += folded;
+        len -= folded;
+    }
+#endif
+    return ~crc32Slice8(state, p, len);
+}
@@ -0,0 +1,24 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* *
+ * Continues a CRC-32 (the ZIP and gzip checksum, reflected polynomial
+ * 0xEDB88320) over the next bytes, so it can be computed while data streams
+ * through. Start with 0; the result after any number of updates is the CRC of
+ * everything fed so far.
+ *
+ * Long runs are folded 64 bytes at a time with carry-less multiplication on
+ * x86-64 processors that have it, and the rest uses slicing-by-8 tables.
+ *
+ * @param   crc   CRC of the bytes before data, 0 at the start
+ * @param   data  Next bytes
+ * @param   len   Number of bytes in data
+ *
+ * @return  uint32_t  CRC of the bytes so far
+ * */
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len);
+
+#endif
@@ -0,0 +1,247 @@
+#include "dafsa.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PENDING_STATE UINT32_MAX
+
+/* *
+ * A state on the path of the last word added. Its last edge leads to the
+ * next node on the path until that node is registered.
+ * */
+struct DafsaPathNode {
+    struct DafsaEdge edges[256];
+    size_t edgeCount;
+    bool final;
+};
+
+bool dafsaContains(const struct Dafsa *dafsa, const char *word, size_t len) {
+    uint32_t state = dafsa->root;
+    for (size_t i = 0; i < len; i++) {
+        const struct DafsaState *current = &dafsa->states[state];
+        const struct DafsaEdge *edges = &dafsa->edges[current->firstEdge];
+        unsigned char label = (unsigned char)word[i];
+
+        size_t low = 0;
+        size_t high = current->edgeCount;
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (edges[mid].label < label) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low == current->edgeCount || edges[low].label != label) {
+            return false;
+        }
+        state = edges[low].target;
+    }
+    return dafsa->states[state].final;
+}
+
+static uint32_t hashState(bool final,
+                          const struct DafsaEdge *edges,
+                          size_t edgeCount) {
+    // FNV-1a over the label and target of each edge
+    uint32_t hash = final ? 2166136261u : 84696351u;
+    for (size_t e = 0; e < edgeCount; e++) {
+        uint32_t target = edges[e].target;
+        hash = (hash ^ edges[e].label) * 16777619u;
+        for (int shift = 0; shift < 32; shift += 8) {
+            hash = (hash ^ ((target >> shift) & 0xFF)) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+static uint32_t hashRegistered(const struct DafsaBuilder *builder,
+                               uint32_t id) {
+    const struct DafsaState *state = &builder->states[id];
+    return hashState(state->final,
+                     &builder->edges[state->firstEdge],
+                     state->edgeCount);
+}
+
+static int growRegistry(struct DafsaBuilder *builder) {
+    size_t size = builder->registrySize ? builder->registrySize * 2 : 1024;
+    uint32_t *registry = calloc(size, sizeof(uint32_t));
+    if (!registry) {
+        return -1;
+    }
+    for (size_t id = 0; id < builder->stateCount; id++) {
+        size_t slot = hashRegistered(builder, (uint32_t)id) & (size - 1);
+        while (registry[slot]) {
+            slot = (slot + 1) & (size - 1);
+        }
+        registry[slot] = (uint32_t)id + 1;
+    }
+    free(builder->registry);
+    builder->registry = registry;
+    builder->registrySize = size;
+    return 0;
+}
+
+static int reserve(void **items, size_t *capacity, size_t need, size_t size) {
+    if (need <= *capacity) {
+        return 0;
+    }
+    size_t grown = *capacity ? *capacity : 1024;
+    while (grown < need) {
+        grown *= 2;
+    }
+    void *resized = realloc(*items, grown * size);
+    if (!resized) {
+        return -1;
+    }
+    *items = resized;
+    *capacity = grown;
+    return 0;
+}
+
+/* *
+ * Returns the id of the registered state equivalent to node, registering a
+ * new one if there is none. Equivalent states have the same finality and
+ * the same labelled edges to the same (already registered) targets.
+ * */
+static uint32_t registerNode(struct DafsaBuilder *builder,
+                             const struct DafsaPathNode *node) {
+    if ((builder->stateCount + 1) * 2 > builder->registrySize &&
+        growRegistry(builder) != 0) {
+        return PENDING_STATE;
+    }
+
+    uint32_t hash = hashState(node->final, node->edges, node->edgeCount);
+    size_t slot = hash & (builder->registrySize - 1);
+    while (builder->registry[slot]) {
+        uint32_t id = builder->registry[slot] - 1;
+        const struct DafsaState *state = &builder->states[id];
+        if (state->final == node->final &&
+            state->edgeCount == node->edgeCount &&
+            (node->edgeCount == 0 ||
+             memcmp(&builder->edges[state->firstEdge],
+                    node->edges,
+                    node->edgeCount * sizeof(struct DafsaEdge)) == 0)) {
+            return id;
+        }
+        slot = (slot + 1) & (builder->registrySize - 1);
+    }
+
+    if (builder->stateCount >= PENDING_STATE ||
+        reserve((void **)&builder->states,
+                &builder->stateCapacity,
+                builder->stateCount + 1,
+                sizeof(struct DafsaState)) != 0 ||
+        reserve((void **)&builder->edges,
+                &builder->edgeCapacity,
+                builder->edgeCount + node->edgeCount,
+                sizeof(struct DafsaEdge)) != 0) {
+        return PENDING_STATE;
+    }
+
+    uint32_t id = (uint32_t)builder->stateCount++;
+    builder->states[id] =
+        (struct DafsaState){.firstEdge = (uint32_t)builder->edgeCount,
+                            .edgeCount = (uint16_t)node->edgeCount,
+                            .final = node->final};
+    if (node->edgeCount > 0) {
+        memcpy(&builder->edges[builder->edgeCount],
+               node->edges,
+               node->edgeCount * sizeof(struct DafsaEdge));
+        builder->edgeCount += node->edgeCount;
+    }
+    builder->registry[slot] = id + 1;
+    return id;
+}
+
+/* *
+ * Registers the path nodes deeper than depth, deepest first, pointing each
+ * parent's last edge at the registered state.
+ * */
+static int registerPath(struct DafsaBuilder *builder, size_t depth) {
+    for (size_t d = builder->previousLen; d > depth; d--) {
+        uint32_t id = registerNode(builder, &builder->path[d]);
+        if (id == PENDING_STATE) {
+            return -1;
+        }
+        struct DafsaPathNode *parent = &builder->path[d - 1];
+        parent->edges[parent->edgeCount - 1].target = id;
+    }
+    return 0;
+}
+
+int dafsaBuilderInit(struct DafsaBuilder *builder) {
+    memset(builder, 0, sizeof(*builder));
+    builder->path =
+        malloc((COLETTE_MAX_TERM_LEN + 1) * sizeof(struct DafsaPathNode));
+    if (!builder->path) {
+        return -1;
+    }
+    builder->path[0].edgeCount = 0;
+    builder->path[0].final = false;
+    return 0;
+}
+
+int dafsaBuilderAdd(struct DafsaBuilder *builder, const char *word, size_t len) {
+    if (len > COLETTE_MAX_TERM_LEN) {
+        return -1;
+    }
+
+    size_t common = 0;
+    if (builder->started) {
+        size_t shorter =
+            len < builder->previousLen ? len : builder->previousLen;
+        while (common < shorter && word[common] == builder->previous[common]) {
+            common++;
+        }
+        bool ordered = common == shorter
+                           ? len > builder->previousLen
+                           : (unsigned char)word[common] >
+                                 (unsigned char)builder->previous[common];
+        if (!ordered) {
+            return len == builder->previousLen && common == len ? 0 : -1;
+        }
+    }
+
+    if (registerPath(builder, common) != 0) {
+        return -1;
+    }
+    for (size_t d = common + 1; d <= len; d++) {
+        struct DafsaPathNode *parent = &builder->path[d - 1];
+        parent->edges[parent->edgeCount++] = (struct DafsaEdge){
+            .target = PENDING_STATE, .label = (uint8_t)word[d - 1]};
+        builder->path[d].edgeCount = 0;
+        builder->path[d].final = false;
+    }
+    builder->path[len].final = true;
+
+    memcpy(builder->previous, word, len);
+    builder->previousLen = len;
+    builder->started = true;
+    return 0;
+}
+
+int dafsaBuilderFinish(struct DafsaBuilder *builder, struct Dafsa *dafsa) {
+    if (registerPath(builder, 0) != 0) {
+        return -1;
+    }
+    builder->previousLen = 0;
+    uint32_t root = registerNode(builder, &builder->path[0]);
+    if (root == PENDING_STATE) {
+        return -1;
+    }
+
+    dafsa->states = builder->states;
+    dafsa->edges = builder->edges;
+    dafsa->stateCount = builder->stateCount;
+    dafsa->edgeCount = builder->edgeCount;
+    dafsa->root = root;
+    return 0;
+}
+
+void freeDafsaBuilder(struct DafsaBuilder *builder) {
+    free(builder->path);
+    free(builder->states);
+    free(builder->edges);
+    free(builder->registry);
+    memset(builder, 0, sizeof(*builder));
+}
@@ -0,0 +1,117 @@
+#ifndef DAFSA_H
+#define DAFSA_H
+
+#include "constants.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* *
+ * Deterministic acyclic finite state automaton: a trie whose identical
+ * suffixes are shared, so a word list of a few megabytes becomes a few
+ * hundred kilobytes of flat arrays that can be written out and mapped back
+ * without any parsing. States and edges are 8 bytes each so both arrays stay
+ * aligned inside a mapped file.
+ * */
+struct DafsaState {
+    uint32_t firstEdge;
+    uint16_t edgeCount;
+    uint8_t final; // a word ends here
+    uint8_t reserved;
+};
+
+struct DafsaEdge {
+    uint32_t target;
+    uint8_t label;
+    uint8_t reserved[3];
+};
+
+/* *
+ * A finished automaton. Edges of each state are sorted by label.
+ * */
+struct Dafsa {
+    const struct DafsaState *states;
+    const struct DafsaEdge *edges;
+    size_t stateCount;
+    size_t edgeCount;
+    uint32_t root;
+};
+
+/* *
+ * @param   dafsa  Automaton to search
+ * @param   word   Bytes to look up
+ * @param   len    Number of bytes in word
+ *
+ * @return  bool   true if word was one of the words the automaton was built
+ *                 from
+ * */
+bool dafsaContains(const struct Dafsa *dafsa, const char *word, size_t len);
+
+/* *
+ * Path state of a word being added, one per depth.
+ * */
+struct DafsaPathNode;
+
+/* *
+ * Builds a minimal automaton from words added in strictly ascending byte
+ * order, using Daciuk's incremental algorithm: once a word is added, the
+ * states of the previous word below the shared prefix can never change, so
+ * they are merged with an equivalent registered state or registered
+ * themselves. Memory is the size of the result plus one path of states.
+ * */
+struct DafsaBuilder {
+    struct DafsaPathNode *path; // COLETTE_MAX_TERM_LEN + 1 nodes
+    char previous[COLETTE_MAX_TERM_LEN];
+    size_t previousLen;
+    bool started;
+    struct DafsaState *states;
+    size_t stateCount;
+    size_t stateCapacity;
+    struct DafsaEdge *edges;
+    size_t edgeCount;
+    size_t edgeCapacity;
+    uint32_t *registry; // open addressing table of state id + 1
+    size_t registrySize;
+};
+
+/* *
+ * @param   builder  Builder to set up
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if memory could not be allocated
+ * */
+int dafsaBuilderInit(struct DafsaBuilder *builder);
+
+/* *
+ * Adds the next word. A word equal to the previous one is ignored.
+ *
+ * @param   builder  Builder to add to
+ * @param   word     Bytes of the word, at most COLETTE_MAX_TERM_LEN
+ * @param   len      Number of bytes in word
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if the word is out of order, too long or memory ran out
+ * */
+int dafsaBuilderAdd(struct DafsaBuilder *builder, const char *word, size_t len);
+
+/* *
+ * Registers the remaining states and describes the result. The automaton
+ * points into the builder and lives until freeDafsaBuilder().
+ *
+ * @param   builder  Builder holding every word
+ * @param   dafsa    Set to the finished automaton
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if memory could not be allocated
+ * */
+int dafsaBuilderFinish(struct DafsaBuilder *builder, struct Dafsa *dafsa);
+
+/* *
+ * @param  builder  Builder to free, along with any automaton it finished
+ * */
+void freeDafsaBuilder(struct DafsaBuilder *builder);
+
+#endif
@@ -0,0 +1,325 @@
+#include "deflate.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+
+/* *
+ * Candidates tried per position. Longer chains find slightly longer matches
+ * in prose for a lot more time.
+ * */
+#define DEFLATE_MAX_CHAIN 8
+
+static const uint16_t LENGTH_BASE[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                         1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                         4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DISTANCE_BASE[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,   25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513,  769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0,  0,  1,  1,  2,  2,
+                                           3, 3, 4,  4,  5,  5,  6,  6,
+                                           7, 7, 8,  8,  9,  9,  10, 10,
+                                           11, 11, 12, 12, 13, 13};
+
+// fixed Huffman codes, bit-reversed since the stream is packed from the LSB
+static uint16_t LITERAL_CODE[288];
+static uint8_t LITERAL_BITS[288];
+static uint8_t DISTANCE_CODE[30];
+static uint8_t LENGTH_SYMBOL[DEFLATE_MAX_MATCH + 1]; // length code - 257
+static pthread_once_t tablesBuilt = PTHREAD_ONCE_INIT;
+
+static unsigned int reverseBits(unsigned int code, unsigned int bits) {
+    unsigned int reversed = 0;
+    for (unsigned int i = 0; i < bits; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    return reversed;
+}
+
+static void buildTables(void) {
+    for (unsigned int symbol = 0; symbol < 288; symbol++) {
+        unsigned int code;
+        unsigned int bits;
+        if (symbol < 144) {
+            code = 0x30 + symbol;
+            bits = 8;
+        } else if (symbol < 256) {
+            code = 0x190 + symbol - 144;
+            bits = 9;
+        } else if (symbol < 280) {
+            code = symbol - 256;
+            bits = 7;
+        } else {
+            code = 0xc0 + symbol - 280;
+            bits = 8;
+        }
+        LITERAL_CODE[symbol] = (uint16_t)reverseBits(code, bits);
+        LITERAL_BITS[symbol] = (uint8_t)bits;
+    }
+    for (unsigned int symbol = 0; symbol < 30; symbol++) {
+        DISTANCE_CODE[symbol] = (uint8_t)reverseBits(symbol, 5);
+    }
+    unsigned int symbol = 0;
+    for (unsigned int length = DEFLATE_MIN_MATCH; length <= DEFLATE_MAX_MATCH;
+         length++) {
+        // 258 has a code of its own though 284 could reach it
+        while (symbol < 28 && length >= LENGTH_BASE[symbol + 1]) {
+            symbol++;
+        }
+        LENGTH_SYMBOL[length] = (uint8_t)symbol;
+    }
+}
+
+static unsigned int distanceSymbol(size_t distance) {
+    unsigned int symbol = 29;
+    while (DISTANCE_BASE[symbol] > distance) {
+        symbol--;
+    }
+    return symbol;
+}
+
+static void putBits(struct Deflater *deflater,
+                    unsigned int value,
+                    unsigned int count) {
+    deflater->bits |= (uint64_t)value << deflater->bitCount;
+    deflater->bitCount += count;
+    while (deflater->bitCount >= 8) {
+        deflater->out[deflater->outLen++] = (unsigned char)deflater->bits;
+        deflater->bits >>= 8;
+        deflater->bitCount -= 8;
+    }
+}
+
+static void putLiteral(struct Deflater *deflater, unsigned int symbol) {
+    putBits(deflater, LITERAL_CODE[symbol], LITERAL_BITS[symbol]);
+}
+
+static void putMatch(struct Deflater *deflater,
+                     size_t length,
+                     size_t distance) {
+    unsigned int symbol = LENGTH_SYMBOL[length];
+    putLiteral(deflater, 257 + symbol);
+    putBits(deflater,
+            (unsigned int)(length - LENGTH_BASE[symbol]),
+            LENGTH_EXTRA[symbol]);
+
+    symbol = distanceSymbol(distance);
+    putBits(deflater, DISTANCE_CODE[symbol], 5);
+    putBits(deflater,
+            (unsigned int)(distance - DISTANCE_BASE[symbol]),
+            DISTANCE_EXTRA[symbol]);
+}
+
+// output for coding up to len bytes; no symbol takes more than 9 bits a byte
+static int reserveOutput(struct Deflater *deflater, size_t len) {
+    size_t needed = len / 8 * 9 + 32;
+    if (needed <= deflater->outCapacity) {
+        return 0;
+    }
+    unsigned char *grown = realloc(deflater->out, needed);
+    if (!grown) {
+        return -1;
+    }
+    deflater->out = grown;
+    deflater->outCapacity = needed;
+    return 0;
+}
+
+static unsigned int hashAt(const unsigned char *p) {
+    return ((unsigned int)p[0] << 10 ^ (unsigned int)p[1] << 5 ^ p[2]) &
+           (DEFLATE_HASH_SIZE - 1);
+}
+
+static void insertHash(struct Deflater *deflater, size_t pos) {
+    unsigned int hash = hashAt(deflater->window + pos);
+    deflater->prev[pos & (DEFLATE_WINDOW - 1)] = deflater->head[hash];
+    deflater->head[hash] = (int32_t)pos;
+}
+
+static size_t longestMatch(const struct Deflater *deflater,
+                           size_t pos,
+                           size_t maxLen,
+                           size_t *distance) {
+    const unsigned char *window = deflater->window;
+    size_t best = 0;
+    int32_t candidate = deflater->prev[pos & (DEFLATE_WINDOW - 1)];
+    for (unsigned int chain = 0; candidate >= 0 && chain < DEFLATE_MAX_CHAIN;
+         chain++) {
+        size_t from = (size_t)candidate;
+        if (pos - from > DEFLATE_WINDOW) {
+            break;
+        }
+        // the byte past the best match so far decides quickly
+        if (window[from + best] == window[pos + best]) {
+            size_t len = 0;
+            while (len < maxLen && window[from + len] == window[pos + len]) {
+                len++;
+            }
+            if (len > best) {
+                best = len;
+                *distance = pos - from;
+                if (len == maxLen) {
+                    break;
+                }
+            }
+        }
+
+        int32_t next = deflater->prev[from & (DEFLATE_WINDOW - 1)];
+        if (next >= candidate) {
+            break; // the slot was reused by a newer position
+        }
+        candidate = next;
+    }
+    return best >= DEFLATE_MIN_MATCH ? best : 0;
+}
+
+/* *
+ * Codes bytes from pos on. Unless finishing, DEFLATE_MAX_MATCH bytes are left
+ * so every match can be as long as the format allows.
+ * */
+static void compress(struct Deflater *deflater, bool finishing) {
+    if (!deflater->started) {
+        putBits(deflater, 1, 1); // the only block is the last
+        putBits(deflater, 1, 2); // fixed Huffman codes
+        deflater->started = true;
+    }
+
+    size_t end = deflater->windowLen;
+    size_t limit = finishing ? end
+                   : end > DEFLATE_MAX_MATCH ? end - DEFLATE_MAX_MATCH
+                                             : 0;
+    size_t pos = deflater->pos;
+    while (pos < limit) {
+        size_t avail = end - pos;
+        size_t length = 0;
+        size_t distance = 0;
+        if (avail >= DEFLATE_MIN_MATCH) {
+            insertHash(deflater, pos);
+            length = longestMatch(deflater,
+                                  pos,
+                                  avail < DEFLATE_MAX_MATCH ? avail
+                                                            : DEFLATE_MAX_MATCH,
+                                  &distance);
+        }
+
+        if (length == 0) {
+            putLiteral(deflater, deflater->window[pos]);
+            pos++;
+            continue;
+        }
+
+        putMatch(deflater, length, distance);
+        for (size_t i = 1; i < length; i++) {
+            if (pos + i + DEFLATE_MIN_MATCH <= end) {
+                insertHash(deflater, pos + i);
+            }
+        }
+        pos += length;
+    }
+    deflater->pos = pos;
+}
+
+// drops the older half of the window once it is full
+static void slide(struct Deflater *deflater) {
+    memmove(deflater->window,
+            deflater->window + DEFLATE_WINDOW,
+            deflater->windowLen - DEFLATE_WINDOW);
+    deflater->windowLen -= DEFLATE_WINDOW;
+    deflater->pos -= DEFLATE_WINDOW;
+    for (size_t i = 0; i < DEFLATE_HASH_SIZE; i++) {
+        int32_t v = deflater->head[i];
+        deflater->head[i] = v >= DEFLATE_WINDOW ? v - DEFLATE_WINDOW : -1;
+    }
+    for (size_t i = 0; i < DEFLATE_WINDOW; i++) {
+        int32_t v = deflater->prev[i];
+        deflater->prev[i] = v >= DEFLATE_WINDOW ? v - DEFLATE_WINDOW : -1;
+    }
+}
+
+int deflaterInit(struct Deflater *deflater) {
+    pthread_once(&tablesBuilt, buildTables);
+
+    memset(deflater, 0, sizeof(*deflater));
+    deflater->window = malloc(2 * DEFLATE_WINDOW);
+    deflater->head = malloc(DEFLATE_HASH_SIZE * sizeof(int32_t));
+    deflater->prev = malloc(DEFLATE_WINDOW * sizeof(int32_t));
+    if (!deflater->window || !deflater->head || !deflater->prev) {
+        deflaterFree(deflater);
+        return -1;
+    }
+    deflaterReset(deflater);
+    return 0;
+}
+
+void deflaterReset(struct Deflater *deflater) {
+    deflater->windowLen = 0;
+    deflater->pos = 0;
+    deflater->bits = 0;
+    deflater->bitCount = 0;
+    deflater->started = false;
+    deflater->outLen = 0;
+    memset(deflater->head, 0xff, DEFLATE_HASH_SIZE * sizeof(int32_t));
+    memset(deflater->prev, 0xff, DEFLATE_WINDOW * sizeof(int32_t));
+}
+
+int deflaterUpdate(struct Deflater *deflater,
+                   const void *data,
+                   size_t len,
+                   const unsigned char **out,
+                   size_t *outLen) {
+    deflater->outLen = 0;
+    if (reserveOutput(deflater, len + DEFLATE_MAX_MATCH) != 0) {
+        return -1;
+    }
+
+    const unsigned char *bytes = data;
+    while (len > 0) {
+        if (deflater->windowLen == 2 * DEFLATE_WINDOW) {
+            slide(deflater);
+        }
+        size_t room = 2 * DEFLATE_WINDOW - deflater->windowLen;
+        size_t take = len < room ? len : room;
+        memcpy(deflater->window + deflater->windowLen, bytes, take);
+        deflater->windowLen += take;
+        bytes += take;
+        len -= take;
+        compress(deflater, false);
+    }
+
+    *out = deflater->out;
+    *outLen = deflater->outLen;
+    return 0;
+}
+
+int deflaterFinish(struct Deflater *deflater,
+                   const unsigned char **out,
+                   size_t *outLen) {
+    deflater->outLen = 0;
+    if (reserveOutput(deflater, DEFLATE_MAX_MATCH) != 0) {
+        return -1;
+    }
+
+    compress(deflater, true);
+    putLiteral(deflater, 256); // end of block
+    if (deflater->bitCount > 0) {
+        putBits(deflater, 0, 8 - deflater->bitCount);
+    }
+
+    *out = deflater->out;
+    *outLen = deflater->outLen;
+    return 0;
+}
+
+void deflaterFree(struct Deflater *deflater) {
+    free(deflater->window);
+    free(deflater->head);
+    free(deflater->prev);
+    free(deflater->out);
+    memset(deflater, 0, sizeof(*deflater));
+}
@@ -0,0 +1,91 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_HASH_SIZE 32768
+
+/* *
+ * Streaming DEFLATE (RFC 1951) compressor. Input is fed in chunks of any size
+ * and matched against the previous 32 KiB with a hash chain, then coded with
+ * the fixed Huffman tables in a single block, so nothing has to be buffered
+ * to build code tables. Prose compresses to roughly half its size this way.
+ *
+ * The window holds the history and the bytes not yet coded; it slides down
+ * when full, so memory stays fixed however long the stream is.
+ * */
+struct Deflater {
+    unsigned char *window; // 2 * DEFLATE_WINDOW bytes
+    size_t windowLen;      // bytes in the window
+    size_t pos;            // next byte to code
+    int32_t *head;         // newest position for each hash, -1 if none
+    int32_t *prev;         // older position with the same hash, by pos
+    uint64_t bits;         // coded bits not yet whole bytes
+    unsigned int bitCount;
+    bool started;          // block header written
+    unsigned char *out;    // output of the last update
+    size_t outLen;
+    size_t outCapacity;
+};
+
+/* *
+ * @param   deflater  Compressor to initialize
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if memory could not be allocated
+ * */
+int deflaterInit(struct Deflater *deflater);
+
+/* *
+ * Starts a new stream, keeping the buffers.
+ *
+ * @param  deflater  Compressor to reset
+ * */
+void deflaterReset(struct Deflater *deflater);
+
+/* *
+ * Compresses the next chunk. Some bytes are held back until enough follows
+ * them to find the longest match. The output points into the compressor and
+ * stays valid until the next call.
+ *
+ * @param   deflater  Compressor state
+ * @param   data      Next bytes of the stream
+ * @param   len       Number of bytes in data
+ * @param   out       Receives a pointer to the compressed bytes
+ * @param   outLen    Receives the number of compressed bytes
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if the output buffer could not be grown
+ * */
+int deflaterUpdate(struct Deflater *deflater,
+                   const void *data,
+                   size_t len,
+                   const unsigned char **out,
+                   size_t *outLen);
+
+/* *
+ * Codes the bytes held back and ends the stream.
+ *
+ * @param   deflater  Compressor state
+ * @param   out       Receives a pointer to the remaining compressed bytes
+ * @param   outLen    Receives the number of remaining compressed bytes
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if the output buffer could not be grown
+ * */
+int deflaterFinish(struct Deflater *deflater,
+                   const unsigned char **out,
+                   size_t *outLen);
+
+/* *
+ * @param  deflater  Compressor to free
+ * */
+void deflaterFree(struct Deflater *deflater);
+
+#endif
@@ -0,0 +1,223 @@
+#include "diagnostics.h"
+#include "json.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *copyString(const char *str, bool *failed) {
+    if (!str) {
+        return NULL;
+    }
+
+    size_t len = strlen(str) + 1;
+    char *copy = malloc(len);
+    if (!copy) {
+        *failed = true;
+        return NULL;
+    }
+    memcpy(copy, str, len);
+
+    return copy;
+}
+
+static void freeDiagnostic(struct Diagnostic *diagnostic) {
+    free(diagnostic->path);
+    free(diagnostic->operation);
+    free(diagnostic->detail);
+    free(diagnostic->systemError);
+    free(diagnostic->message);
+}
+
+static int compareOptional(const char *a, const char *b) {
+    if (!a || !b) {
+        return (a != NULL) - (b != NULL); // NULL sorts first
+    }
+    return strcmp(a, b);
+}
+
+static int compareDiagnostics(const void *a, const void *b) {
+    const struct Diagnostic *left = a;
+    const struct Diagnostic *right = b;
+
+    int pathOrder = compareOptional(left->path, right->path);
+    if (pathOrder != 0) {
+        return pathOrder;
+    }
+    return strcmp(left->message, right->message);
+}
+
+int addDiagnostic(struct DiagnosticList *list,
+                  enum DiagnosticSeverity severity,
+                  const char *path,
+                  const char *operation,
+                  const char *detail,
+                  const char *systemError,
+                  const char *message) {
+    if (!list || !operation || !message) {
+        return -1;
+    }
+
+    if (list->count >= list->capacity) {
+        size_t newCapacity = list->capacity ? list->capacity * 2 : 16;
+        if (newCapacity > SIZE_MAX / sizeof(struct Diagnostic)) {
+            return -1;
+        }
+        struct Diagnostic *newItems =
+            realloc(list->items, newCapacity * sizeof(struct Diagnostic));
+        if (!newItems) {
+            return -1;
+        }
+        list->items = newItems;
+        list->capacity = newCapacity;
+    }
+
+    bool failed = false;
+    struct Diagnostic diagnostic = {
+        .path = copyString(path, &failed),
+        .operation = copyString(operation, &failed),
+        .detail = copyString(detail, &failed),
+        .systemError = copyString(systemError, &failed),
+        .message = copyString(message, &failed),
+        .severity = severity,
+    };
+    if (failed) {
+        freeDiagnostic(&diagnostic);
+        return -1;
+    }
+
+    list->items[list->count] = diagnostic;
+    list->count++;
+
+    return 0;
+}
+
+void sortDiagnostics(struct DiagnosticList *list) {
+    if (!list || list->count < 2) {
+        return;
+    }
+
+    qsort(list->items, list->count, sizeof(struct Diagnostic), compareDiagnostics);
+
+    size_t kept = 1;
+    for (size_t i = 1; i < list->count; i++) {
+        if (compareDiagnostics(&list->items[kept - 1], &list->items[i]) == 0) {
+            freeDiagnostic(&list->items[i]);
+            continue;
+        }
+        list->items[kept] = list->items[i];
+        kept++;
+    }
+    list->count = kept;
+}
+
+static void writeTextReport(const struct DiagnosticList *list, FILE *out) {
+    for (size_t i = 0; i < list->count; i++) {
+        fputs(list->items[i].message, out);
+        fputc('\n', out);
+    }
+
+    if (list->count > 0) {
+        size_t errors = countDiagnosticErrors(list);
+        size_t warnings = list->count - errors;
+        fprintf(out,
+                "%zu problem%s found (%zu error%s, %zu warning%s)\n",
+                list->count,
+                list->count == 1 ? "" : "s",
+                errors,
+                errors == 1 ? "" : "s",
+                warnings,
+                warnings == 1 ? "" : "s");
+    }
+}
+
+static void writeJsonReport(const struct DiagnosticList *list, FILE *out) {
+    fputs("{\"problems\":[", out);
+    for (size_t i = 0; i < list->count; i++) {
+        const struct Diagnostic *diagnostic = &list->items[i];
+        fputs(i == 0 ? "\n  {\"severity\":" : ",\n  {\"severity\":", out);
+        writeJsonString(
+            out, diagnostic->severity == DIAG_ERROR ? "error" : "warning");
+        fputs(",\"path\":", out);
+        writeJsonString(out, diagnostic->path);
+        fputs(",\"operation\":", out);
+        writeJsonString(out, diagnostic->operation);
+        fputs(",\"detail\":", out);
+        writeJsonString(out, diagnostic->detail);
+        fputs(",\"systemError\":", out);
+        writeJsonString(out, diagnostic->systemError);
+        fputs(",\"message\":", out);
+        writeJsonString(out, diagnostic->message);
+        fputc('}', out);
+    }
+    fprintf(out,
+            "%s],\"count\":%zu,\"errors\":%zu}\n",
+            list->count ? "\n" : "",
+            list->count,
+            countDiagnosticErrors(list));
+}
+
+int writeDiagnostics(const struct DiagnosticList *list,
+                     enum ReportFormat format,
+                     FILE *out) {
+    if (!list || !out) {
+        return -1;
+    }
+
+    // assemble the report in memory so it reaches the stream in one write
+    char *report = NULL;
+    size_t reportLen = 0;
+    FILE *buffer = open_memstream(&report, &reportLen);
+    if (!buffer) {
+        return -1;
+    }
+
+    if (format == REPORT_JSON) {
+        writeJsonReport(list, buffer);
+    } else {
+        writeTextReport(list, buffer);
+    }
+
+    if (fclose(buffer) != 0) {
+        free(report);
+        return -1;
+    }
+
+    int status = 0;
+    if (reportLen > 0 && fwrite(report, 1, reportLen, out) != reportLen) {
+        status = -1;
+    }
+    fflush(out);
+    free(report);
+
+    return status;
+}
+
+size_t countDiagnosticErrors(const struct DiagnosticList *list) {
+    if (!list) {
+        return 0;
+    }
+
+    size_t errors = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        if (list->items[i].severity == DIAG_ERROR) {
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+void freeDiagnostics(struct DiagnosticList *list) {
+    if (!list) {
+        return;
+    }
+
+    for (size_t i = 0; i < list->count; i++) {
+        freeDiagnostic(&list->items[i]);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
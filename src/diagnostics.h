@@ -0,0 +1,102 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdio.h>
+
+enum DiagnosticSeverity {
+    DIAG_ERROR,   // project cannot be processed as-is
+    DIAG_WARNING, // suspicious but harmless, does not fail the check
+};
+
+/* *
+ * A single problem found while processing a project. Strings are owned by the
+ * diagnostic. operation is the human readable action that failed, detail and
+ * systemError may be NULL when not applicable.
+ * */
+struct Diagnostic {
+    char *path;
+    char *operation;
+    char *detail;
+    char *systemError;
+    char *message; // fully formatted line as printed to stderr
+    enum DiagnosticSeverity severity;
+};
+
+/* *
+ * Growable list of diagnostics. Check mode collects every problem here while
+ * traversal keeps going, then emits one sorted, deduplicated report.
+ * */
+struct DiagnosticList {
+    struct Diagnostic *items;
+    size_t count;
+    size_t capacity;
+};
+
+enum ReportFormat {
+    REPORT_TEXT,
+    REPORT_JSON,
+};
+
+/* *
+ * Appends a diagnostic to the list, copying all strings.
+ *
+ * @param   list         List to append to
+ * @param   severity     Error or warning
+ * @param   path         Path related to the problem, may be NULL
+ * @param   operation    Operation that failed
+ * @param   detail       Specific problem, may be NULL
+ * @param   systemError  strerror() text, may be NULL
+ * @param   message      Preformatted report line
+ *
+ * @return  int
+ *          0            on success
+ *         -1            if memory could not be allocated
+ * */
+int addDiagnostic(struct DiagnosticList *list,
+                  enum DiagnosticSeverity severity,
+                  const char *path,
+                  const char *operation,
+                  const char *detail,
+                  const char *systemError,
+                  const char *message);
+
+/* *
+ * Sorts diagnostics by path, then message, and removes exact duplicates so the
+ * report is stable across runs regardless of discovery order.
+ *
+ * @param  list  List to sort in place
+ * */
+void sortDiagnostics(struct DiagnosticList *list);
+
+/* *
+ * Writes the whole report in a single write to the given stream. The text
+ * format prints one line per problem followed by a summary; the JSON format
+ * prints an object with a "problems" array and a "count".
+ *
+ * @param   list    Sorted list of diagnostics
+ * @param   format  Text or JSON
+ * @param   out     Stream to write to
+ *
+ * @return  int
+ *          0       on success
+ *         -1       if the report could not be written
+ * */
+int writeDiagnostics(const struct DiagnosticList *list,
+                     enum ReportFormat format,
+                     FILE *out);
+
+/* *
+ * @param   list    List of diagnostics
+ *
+ * @return  size_t  number of diagnostics with DIAG_ERROR severity
+ * */
+size_t countDiagnosticErrors(const struct DiagnosticList *list);
+
+/* *
+ * Frees all diagnostics and resets the list to empty.
+ *
+ * @param  list  List to free
+ * */
+void freeDiagnostics(struct DiagnosticList *list);
+
+#endif
@@ -0,0 +1,909 @@
+#include "dupes.h"
+#include "constants.h"
+#include "encoding.h"
+#include "errors.h"
+#include "files.h"
+#include "reporting.h"
+#include "workers.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KGRAM COLETTE_DUPES_KGRAM
+#define WINDOW COLETTE_DUPES_WINDOW
+#define HASH_BASE 0x100000001B3ull
+#define OPEN_PASSAGES 8
+#define EXTEND_BYTES 4096
+// an edited word breaks every k-gram over it, leaving at most this long a gap
+// between matches on either side
+#define MAX_GAP (WINDOW + 2 * KGRAM)
+
+/* *
+ * A selected k-gram. norm counts compared characters from the start of the
+ * file; start, end and line locate the k-gram in the file itself.
+ * */
+struct Fingerprint {
+    uint64_t hash;
+    uint32_t file; // position among the project's regular files
+    uint32_t norm;
+    uint32_t start;
+    uint32_t end;
+    uint32_t line;
+};
+
+struct CharPosition {
+    uint32_t offset;
+    uint32_t line;
+};
+
+struct FingerprintList {
+    struct Fingerprint *items;
+    size_t count;
+    size_t capacity;
+};
+
+/* *
+ * Rolling hash over the last KGRAM compared characters, plus the last WINDOW
+ * k-gram fingerprints for winnowing. Only this state is kept per file, so a
+ * file of any size is fingerprinted in constant memory.
+ * */
+struct Winnower {
+    uint64_t hash;
+    uint64_t power; // HASH_BASE^(KGRAM - 1), removes the outgoing character
+    uint64_t chars; // compared characters seen
+    unsigned char ring[KGRAM];
+    struct CharPosition ringPosition[KGRAM];
+    struct Fingerprint window[WINDOW];
+    uint64_t kgrams;   // k-grams hashed so far
+    uint64_t minimum;  // k-gram selected in the current window
+    uint64_t recorded; // last k-gram recorded + 1, 0 if none yet
+};
+
+struct DupeResult {
+    struct FingerprintList fingerprints;
+    struct ReadFailure failure;
+};
+
+struct DupeJob {
+    const struct FileList *entries;
+    size_t *regular; // entry index of each regular file
+    struct DupeResult *results;
+    uint64_t pass;
+    uint64_t passes;
+};
+
+/* *
+ * Fingerprints the same stretch of text in two files. fileA comes first in
+ * the draft.
+ * */
+struct DupeMatch {
+    uint32_t fileA;
+    uint32_t fileB;
+    struct Fingerprint a;
+    struct Fingerprint b;
+};
+
+struct MatchList {
+    struct DupeMatch *items;
+    size_t count;
+    size_t capacity;
+};
+
+/* *
+ * A run of matches between two files that lie on roughly the same diagonal,
+ * i.e. the same text with at most small edits in between.
+ * */
+struct Passage {
+    uint32_t fileA;
+    uint32_t fileB;
+    uint32_t firstNorm; // in file A
+    uint32_t lastNorm;
+    uint32_t lastNormB;
+    uint32_t length; // compared characters, once extended
+    struct Fingerprint a; // start and line of the first match, end of the last
+    struct Fingerprint b;
+};
+
+/* *
+ * Compared characters of a stretch of raw text, with the byte offset of each
+ * and whether it starts or ends a word.
+ * */
+struct ComparedText {
+    unsigned char chars[EXTEND_BYTES];
+    uint32_t offsets[EXTEND_BYTES];
+    bool wordStart[EXTEND_BYTES];
+    bool wordEnd[EXTEND_BYTES];
+    size_t count;
+};
+
+/* *
+ * A whole file as collated, for comparing the text around its passages.
+ * */
+struct FileText {
+    unsigned char *data;
+    size_t size;
+};
+
+struct PassageList {
+    struct Passage *items;
+    size_t count;
+    size_t capacity;
+};
+
+static bool isComparedByte(unsigned char byte) {
+    return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') ||
+           (byte >= '0' && byte <= '9') || byte >= 0x80;
+}
+
+static unsigned char foldCase(unsigned char byte) {
+    return (byte >= 'A' && byte <= 'Z') ? (unsigned char)(byte + 32) : byte;
+}
+
+static uint64_t mixHash(uint64_t hash) {
+    // splitmix64 finalizer: the window minimum needs evenly spread bits
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBull;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+static int appendFingerprint(struct FingerprintList *list,
+                             const struct Fingerprint *fingerprint) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        struct Fingerprint *grown =
+            realloc(list->items, capacity * sizeof(struct Fingerprint));
+        if (!grown) {
+            return -1;
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count] = *fingerprint;
+    list->count++;
+    return 0;
+}
+
+static void winnowerInit(struct Winnower *winnower) {
+    memset(winnower, 0, sizeof(*winnower));
+    winnower->power = 1;
+    for (int i = 1; i < KGRAM; i++) {
+        winnower->power *= HASH_BASE;
+    }
+}
+
+/* *
+ * Keeps a fingerprint for this pass if its hash falls in the pass's slice.
+ * The same k-gram can be selected by several windows in a row but is only
+ * recorded once.
+ * */
+static int recordMinimum(struct Winnower *winnower,
+                         const struct DupeJob *job,
+                         struct DupeResult *result) {
+    if (winnower->recorded == winnower->minimum + 1) {
+        return 0;
+    }
+    winnower->recorded = winnower->minimum + 1;
+
+    const struct Fingerprint *fingerprint =
+        &winnower->window[winnower->minimum % WINDOW];
+    if (fingerprint->hash % job->passes != job->pass) {
+        return 0;
+    }
+    return appendFingerprint(&result->fingerprints, fingerprint);
+}
+
+static void rescanWindow(struct Winnower *winnower, uint64_t first) {
+    // rightmost minimum, so a window that slides on keeps its choice longer
+    winnower->minimum = first;
+    for (uint64_t g = first + 1; g < winnower->kgrams; g++) {
+        if (winnower->window[g % WINDOW].hash <=
+            winnower->window[winnower->minimum % WINDOW].hash) {
+            winnower->minimum = g;
+        }
+    }
+}
+
+static int addCharacter(struct Winnower *winnower,
+                        const struct DupeJob *job,
+                        struct DupeResult *result,
+                        uint32_t file,
+                        unsigned char byte,
+                        uint32_t offset,
+                        uint32_t line) {
+    size_t slot = winnower->chars % KGRAM;
+    if (winnower->chars >= KGRAM) {
+        winnower->hash -= winnower->ring[slot] * winnower->power;
+    }
+    winnower->hash = winnower->hash * HASH_BASE + byte;
+    winnower->ring[slot] = byte;
+    winnower->ringPosition[slot] =
+        (struct CharPosition){.offset = offset, .line = line};
+    winnower->chars++;
+    if (winnower->chars < KGRAM) {
+        return 0;
+    }
+
+    const struct CharPosition *first =
+        &winnower->ringPosition[(winnower->chars - KGRAM) % KGRAM];
+    uint64_t g = winnower->kgrams;
+    winnower->window[g % WINDOW] =
+        (struct Fingerprint){.hash = mixHash(winnower->hash),
+                             .file = file,
+                             .norm = (uint32_t)(winnower->chars - KGRAM),
+                             .start = first->offset,
+                             .end = offset + 1,
+                             .line = first->line};
+    winnower->kgrams++;
+
+    if (winnower->kgrams < WINDOW) {
+        return 0; // first window not full yet
+    }
+    if (winnower->kgrams == WINDOW || winnower->minimum + WINDOW <= g) {
+        rescanWindow(winnower, g + 1 - WINDOW);
+    } else if (winnower->window[g % WINDOW].hash <=
+               winnower->window[winnower->minimum % WINDOW].hash) {
+        winnower->minimum = g;
+    }
+    return recordMinimum(winnower, job, result);
+}
+
+static int finishWinnower(struct Winnower *winnower,
+                          const struct DupeJob *job,
+                          struct DupeResult *result) {
+    // a file too short to fill one window still gets its best k-gram
+    if (winnower->kgrams == 0 || winnower->kgrams >= WINDOW) {
+        return 0;
+    }
+    rescanWindow(winnower, 0);
+    return recordMinimum(winnower, job, result);
+}
+
+/* *
+ * Feeds the next stretch of a file's text to the winnower. offset and line
+ * carry the position in the file from one stretch to the next.
+ * */
+static int addText(struct Winnower *winnower,
+                   const struct DupeJob *job,
+                   struct DupeResult *result,
+                   uint32_t file,
+                   const unsigned char *text,
+                   size_t len,
+                   uint64_t *offset,
+                   uint32_t *line) {
+    for (size_t i = 0; i < len && *offset < UINT32_MAX; i++, (*offset)++) {
+        unsigned char byte = text[i];
+        if (byte == '\n') {
+            (*line)++;
+        }
+        if (isComparedByte(byte) &&
+            addCharacter(winnower,
+                         job,
+                         result,
+                         file,
+                         foldCase(byte),
+                         (uint32_t)*offset,
+                         *line) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void fingerprintFile(size_t index, void *arg) {
+    struct DupeJob *job = arg;
+    struct DupeResult *result = &job->results[index];
+    const struct FileEntry *entry =
+        &job->entries->entries[job->regular[index]];
+
+    int fd = openProjectFile(entry->path, O_NOFOLLOW, &result->failure);
+    if (fd < 0) {
+        return;
+    }
+
+    struct Winnower winnower;
+    winnowerInit(&winnower);
+    // offsets are into the text as collated, so other encodings become UTF-8
+    struct Transcoder transcoder;
+    transcoderInit(&transcoder);
+    bool transcoding = false;
+    bool firstBlock = true;
+    unsigned char buffer[COLETTE_SCAN_BUF_SIZE];
+    uint64_t offset = 0;
+    uint32_t line = 1;
+    int status = 0;
+    ssize_t bytesRead;
+    // offsets are stored in 32 bits; text past 4 GiB in one file is ignored
+    while (status == 0 && offset < UINT32_MAX &&
+           (bytesRead = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            setReadFailure(&result->failure, PROC_ERR_OPEN_FILE, errno);
+            result->failure.readFailed = true;
+            break;
+        }
+
+        const unsigned char *text = buffer;
+        size_t textLen = (size_t)bytesRead;
+        if (firstBlock) {
+            enum TextEncoding encoding = detectEncoding(
+                entry->encoding,
+                buffer,
+                textLen < COLETTE_FILE_BUF_SIZE ? textLen
+                                                : COLETTE_FILE_BUF_SIZE);
+            transcoding = encoding != ENCODING_UTF8;
+            if (transcoding) {
+                transcoderReset(&transcoder, encoding);
+            }
+            firstBlock = false;
+        }
+        if (transcoding && transcoderUpdate(&transcoder,
+                                            buffer,
+                                            (size_t)bytesRead,
+                                            &text,
+                                            &textLen) != 0) {
+            status = -1;
+            break;
+        }
+        status = addText(&winnower,
+                         job,
+                         result,
+                         (uint32_t)index,
+                         text,
+                         textLen,
+                         &offset,
+                         &line);
+    }
+    close(fd);
+
+    if (status == 0 && !result->failure.failed) {
+        const unsigned char *tail = NULL;
+        size_t tailLen = 0;
+        if (transcoding) {
+            transcoderFinish(&transcoder, &tail, &tailLen);
+        }
+        if (addText(&winnower,
+                    job,
+                    result,
+                    (uint32_t)index,
+                    tail,
+                    tailLen,
+                    &offset,
+                    &line) != 0 ||
+            finishWinnower(&winnower, job, result) != 0) {
+            status = -1;
+        }
+    }
+    transcoderFree(&transcoder);
+
+    if (status != 0) {
+        setReadFailure(&result->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+    }
+}
+
+static int compareFingerprints(const void *a, const void *b) {
+    const struct Fingerprint *left = a;
+    const struct Fingerprint *right = b;
+    if (left->hash != right->hash) {
+        return left->hash < right->hash ? -1 : 1;
+    }
+    if (left->file != right->file) {
+        return left->file < right->file ? -1 : 1;
+    }
+    return (left->norm > right->norm) - (left->norm < right->norm);
+}
+
+static int appendMatch(struct MatchList *list,
+                       const struct Fingerprint *a,
+                       const struct Fingerprint *b) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        struct DupeMatch *grown =
+            realloc(list->items, capacity * sizeof(struct DupeMatch));
+        if (!grown) {
+            return -1;
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count] =
+        (struct DupeMatch){.fileA = a->file, .fileB = b->file, .a = *a, .b = *b};
+    list->count++;
+    return 0;
+}
+
+/* *
+ * Turns fingerprints shared between files into matches. Sorting brings equal
+ * hashes together, ordered by file, so every pair in a run with different
+ * files is a match with fileA first in the draft.
+ * */
+static int collectMatches(struct Fingerprint *all,
+                          size_t count,
+                          struct MatchList *matches) {
+    if (count > 1) {
+        qsort(all, count, sizeof(struct Fingerprint), compareFingerprints);
+    }
+
+    size_t runStart = 0;
+    while (runStart < count) {
+        size_t runEnd = runStart + 1;
+        while (runEnd < count && all[runEnd].hash == all[runStart].hash) {
+            runEnd++;
+        }
+        size_t runLength = runEnd - runStart;
+        bool shared = all[runStart].file != all[runEnd - 1].file;
+        if (shared && runLength <= COLETTE_DUPES_MAX_OCCURRENCES) {
+            for (size_t i = runStart; i < runEnd; i++) {
+                for (size_t j = i + 1; j < runEnd; j++) {
+                    if (all[i].file != all[j].file &&
+                        appendMatch(matches, &all[i], &all[j]) != 0) {
+                        return -1;
+                    }
+                }
+            }
+        }
+        runStart = runEnd;
+    }
+
+    return 0;
+}
+
+static int compareMatches(const void *a, const void *b) {
+    const struct DupeMatch *left = a;
+    const struct DupeMatch *right = b;
+    if (left->fileA != right->fileA) {
+        return left->fileA < right->fileA ? -1 : 1;
+    }
+    if (left->fileB != right->fileB) {
+        return left->fileB < right->fileB ? -1 : 1;
+    }
+    if (left->a.norm != right->a.norm) {
+        return left->a.norm < right->a.norm ? -1 : 1;
+    }
+    return (left->b.norm > right->b.norm) - (left->b.norm < right->b.norm);
+}
+
+static int comparePassages(const void *a, const void *b) {
+    const struct Passage *left = a;
+    const struct Passage *right = b;
+    if (left->fileA != right->fileA) {
+        return left->fileA < right->fileA ? -1 : 1;
+    }
+    if (left->a.start != right->a.start) {
+        return left->a.start < right->a.start ? -1 : 1;
+    }
+    if (left->fileB != right->fileB) {
+        return left->fileB < right->fileB ? -1 : 1;
+    }
+    return (left->b.start > right->b.start) - (left->b.start < right->b.start);
+}
+
+static int closePassage(struct PassageList *passages,
+                        const struct Passage *passage,
+                        unsigned int minLength) {
+    // the text either side of the outer fingerprints is only compared later,
+    // and can add up to a window each way
+    uint32_t span = passage->lastNorm + KGRAM - passage->firstNorm;
+    if (span + 2 * WINDOW < minLength) {
+        return 0;
+    }
+    if (passages->count == passages->capacity) {
+        size_t capacity = passages->capacity ? passages->capacity * 2 : 64;
+        struct Passage *grown =
+            realloc(passages->items, capacity * sizeof(struct Passage));
+        if (!grown) {
+            return -1;
+        }
+        passages->items = grown;
+        passages->capacity = capacity;
+    }
+    passages->items[passages->count] = *passage;
+    passages->count++;
+    return 0;
+}
+
+static bool extendsPassage(const struct Passage *passage,
+                           const struct DupeMatch *match) {
+    int64_t diagonal = (int64_t)match->b.norm - (int64_t)match->a.norm;
+    int64_t passageDiagonal =
+        (int64_t)passage->lastNormB - (int64_t)passage->lastNorm;
+    int64_t drift = diagonal - passageDiagonal;
+    return match->a.norm - passage->lastNorm <= MAX_GAP &&
+           match->b.norm >= passage->lastNormB && drift <= KGRAM &&
+           drift >= -KGRAM;
+}
+
+/* *
+ * Chains matches into passages. Matches are sorted by file pair and position
+ * in file A; a few passages per pair are kept open at once so a passage copied
+ * twice into the same file is followed along both diagonals.
+ * */
+static int chainPassages(struct MatchList *matches,
+                         unsigned int minLength,
+                         struct PassageList *passages) {
+    if (matches->count > 1) {
+        qsort(matches->items,
+              matches->count,
+              sizeof(struct DupeMatch),
+              compareMatches);
+    }
+
+    struct Passage open[OPEN_PASSAGES];
+    size_t openCount = 0;
+    for (size_t m = 0; m < matches->count; m++) {
+        const struct DupeMatch *match = &matches->items[m];
+
+        // close everything from another pair or too far behind to extend
+        size_t kept = 0;
+        for (size_t p = 0; p < openCount; p++) {
+            bool samePair = open[p].fileA == match->fileA &&
+                            open[p].fileB == match->fileB;
+            if (samePair &&
+                match->a.norm - open[p].lastNorm <= MAX_GAP) {
+                open[kept++] = open[p];
+            } else if (closePassage(passages, &open[p], minLength) != 0) {
+                return -1;
+            }
+        }
+        openCount = kept;
+
+        bool extended = false;
+        for (size_t p = 0; p < openCount && !extended; p++) {
+            if (extendsPassage(&open[p], match)) {
+                open[p].lastNorm = match->a.norm;
+                open[p].lastNormB = match->b.norm;
+                if (match->a.end > open[p].a.end) {
+                    open[p].a.end = match->a.end;
+                }
+                if (match->b.end > open[p].b.end) {
+                    open[p].b.end = match->b.end;
+                }
+                extended = true;
+            }
+        }
+        if (extended) {
+            continue;
+        }
+
+        if (openCount == OPEN_PASSAGES) {
+            if (closePassage(passages, &open[0], minLength) != 0) {
+                return -1;
+            }
+            memmove(&open[0], &open[1], (OPEN_PASSAGES - 1) * sizeof(open[0]));
+            openCount--;
+        }
+        open[openCount++] = (struct Passage){.fileA = match->fileA,
+                                             .fileB = match->fileB,
+                                             .firstNorm = match->a.norm,
+                                             .lastNorm = match->a.norm,
+                                             .lastNormB = match->b.norm,
+                                             .a = match->a,
+                                             .b = match->b};
+    }
+    for (size_t p = 0; p < openCount; p++) {
+        if (closePassage(passages, &open[p], minLength) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* *
+ * Keeps the compared characters among bytes [from, to) of a file's text.
+ * Returns the number of line feeds among them.
+ * */
+static size_t readComparedText(const struct FileText *file,
+                               uint32_t from,
+                               uint32_t to,
+                               struct ComparedText *text) {
+    text->count = 0;
+    if (from >= file->size) {
+        return 0;
+    }
+    const unsigned char *raw = file->data + from;
+    size_t bytesRead = (to < file->size ? to : file->size) - from;
+
+    // the edges of the stretch count as word boundaries
+    size_t newlines = 0;
+    for (size_t i = 0; i < bytesRead; i++) {
+        if (raw[i] == '\n') {
+            newlines++;
+        }
+        if (isComparedByte(raw[i])) {
+            text->chars[text->count] = foldCase(raw[i]);
+            text->offsets[text->count] = from + (uint32_t)i;
+            text->wordStart[text->count] = i == 0 || !isComparedByte(raw[i - 1]);
+            text->wordEnd[text->count] =
+                i + 1 == bytesRead || !isComparedByte(raw[i + 1]);
+            text->count++;
+        }
+    }
+    return newlines;
+}
+
+static size_t countNewlines(const struct FileText *file,
+                            uint32_t from,
+                            uint32_t to) {
+    struct ComparedText text;
+    return readComparedText(file, from, to, &text);
+}
+
+/* *
+ * Winnowing only pins down the matched text between the first and last shared
+ * fingerprint. Compares the text just before and after both copies to find
+ * where the passage really starts and ends, and sets its length.
+ * */
+static void extendPassage(struct Passage *passage,
+                          const struct FileText *files) {
+    // only called from the main thread, and too large for the stack
+    static struct ComparedText before[2];
+    static struct ComparedText after[2];
+    struct Fingerprint *copies[2] = {&passage->a, &passage->b};
+
+    for (int c = 0; c < 2; c++) {
+        uint32_t start = copies[c]->start;
+        uint32_t from = start > EXTEND_BYTES ? start - EXTEND_BYTES : 0;
+        uint32_t end = copies[c]->end;
+        uint32_t to = end > UINT32_MAX - EXTEND_BYTES ? UINT32_MAX
+                                                      : end + EXTEND_BYTES;
+        readComparedText(&files[c], from, start, &before[c]);
+        readComparedText(&files[c], end, to, &after[c]);
+    }
+
+    size_t back = 0;
+    while (back < before[0].count && back < before[1].count &&
+           before[0].chars[before[0].count - 1 - back] ==
+               before[1].chars[before[1].count - 1 - back]) {
+        back++;
+    }
+    size_t forward = 0;
+    while (forward < after[0].count && forward < after[1].count &&
+           after[0].chars[forward] == after[1].chars[forward]) {
+        forward++;
+    }
+    // a letter or two in common before or after a copy is chance, not text
+    while (back && !(before[0].wordStart[before[0].count - back] &&
+                     before[1].wordStart[before[1].count - back])) {
+        back--;
+    }
+    while (forward && !(after[0].wordEnd[forward - 1] &&
+                        after[1].wordEnd[forward - 1])) {
+        forward--;
+    }
+
+    for (int c = 0; c < 2; c++) {
+        if (back) {
+            uint32_t start = before[c].offsets[before[c].count - back];
+            copies[c]->line -=
+                (uint32_t)countNewlines(&files[c], start, copies[c]->start);
+            copies[c]->start = start;
+        }
+        if (forward) {
+            copies[c]->end = after[c].offsets[forward - 1] + 1;
+        }
+    }
+    passage->length = passage->lastNorm + KGRAM - passage->firstNorm +
+                      (uint32_t)(back + forward);
+}
+
+/* *
+ * Extends every candidate passage and keeps those at least minLength long.
+ * Passages are grouped by file pair, so each pair of files is read once.
+ * */
+static int extendPassages(const struct FileList *entries,
+                          const size_t *regular,
+                          unsigned int minLength,
+                          struct PassageList *passages) {
+    int status = 0;
+    size_t kept = 0;
+    size_t p = 0;
+    while (p < passages->count) {
+        uint32_t fileA = passages->items[p].fileA;
+        uint32_t fileB = passages->items[p].fileB;
+        const struct FileEntry *pair[2] = {&entries->entries[regular[fileA]],
+                                           &entries->entries[regular[fileB]]};
+        struct FileText files[2] = {{0}};
+        bool readable = true;
+        for (int c = 0; c < 2; c++) {
+            struct ReadFailure failure = {0};
+            files[c].data = readWholeFile(pair[c]->path,
+                                          pair[c]->encoding,
+                                          &files[c].size,
+                                          NULL,
+                                          &failure);
+            if (readable && reportReadFailure(&failure,
+                                              PROCESS_OP_HANDLE_DUPES,
+                                              pair[c]->path)) {
+                readable = false;
+                status = -1;
+            }
+        }
+
+        for (; p < passages->count && passages->items[p].fileA == fileA &&
+               passages->items[p].fileB == fileB;
+             p++) {
+            struct Passage *passage = &passages->items[p];
+            if (!readable) {
+                continue;
+            }
+            extendPassage(passage, files);
+            if (passage->length >= minLength) {
+                passages->items[kept++] = *passage;
+            }
+        }
+
+        free(files[0].data);
+        free(files[1].data);
+    }
+    passages->count = kept;
+
+    if (passages->count > 1) {
+        qsort(passages->items,
+              passages->count,
+              sizeof(struct Passage),
+              comparePassages);
+    }
+    return status;
+}
+
+/* *
+ * Picks the number of passes from the project size: roughly two fingerprints
+ * per window of text, each held twice while a pass is merged.
+ * */
+static uint64_t countPasses(const struct FileList *entries,
+                            const size_t *regular,
+                            size_t fileCount) {
+    uint64_t bytes = 0;
+    for (size_t f = 0; f < fileCount; f++) {
+        struct stat info;
+        if (lstat(entries->entries[regular[f]].path, &info) == 0 &&
+            info.st_size > 0) {
+            bytes += (uint64_t)info.st_size;
+        }
+    }
+
+    uint64_t fingerprints = bytes * 2 / (WINDOW + 1) + fileCount;
+    uint64_t memory = fingerprints * sizeof(struct Fingerprint) * 2;
+    return memory / COLETTE_DUPES_MEMORY + 1;
+}
+
+/* *
+ * Runs one pass over every file and adds the matches among fingerprints in
+ * this pass's slice of the hash space. Failed files are reported on the first
+ * pass only.
+ * */
+static int runPass(struct DupeJob *job,
+                   size_t fileCount,
+                   unsigned int jobs,
+                   struct MatchList *matches,
+                   int *status) {
+    runParallel(fileCount, jobs, fingerprintFile, job);
+
+    size_t total = 0;
+    for (size_t f = 0; f < fileCount; f++) {
+        total += job->results[f].fingerprints.count;
+    }
+    struct Fingerprint *all =
+        malloc((total ? total : 1) * sizeof(struct Fingerprint));
+
+    size_t filled = 0;
+    for (size_t f = 0; f < fileCount; f++) {
+        struct DupeResult *result = &job->results[f];
+        if (job->pass == 0 &&
+            reportReadFailure(&result->failure,
+                              PROCESS_OP_HANDLE_DUPES,
+                              job->entries->entries[job->regular[f]].path)) {
+            *status = -1;
+        }
+        if (all && result->fingerprints.count) {
+            memcpy(all + filled,
+                   result->fingerprints.items,
+                   result->fingerprints.count * sizeof(struct Fingerprint));
+            filled += result->fingerprints.count;
+        }
+        free(result->fingerprints.items);
+        memset(result, 0, sizeof(*result));
+    }
+
+    if (!all) {
+        return -1;
+    }
+    int collected = collectMatches(all, filled, matches);
+    free(all);
+    return collected;
+}
+
+int findDuplicatePassages(const struct FileList *entries,
+                          unsigned int minLength,
+                          unsigned int jobs,
+                          const char *rootDir,
+                          FILE *out) {
+    if (!entries || minLength < KGRAM) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_DUPES, rootDir, PROC_ERR_INVALID_STATE);
+        return -1;
+    }
+
+    size_t capacity = entries->count ? entries->count : 1;
+    struct DupeJob job = {.entries = entries};
+    job.regular = malloc(capacity * sizeof(size_t));
+    job.results = calloc(capacity, sizeof(struct DupeResult));
+    if (!job.regular || !job.results) {
+        free(job.regular);
+        free(job.results);
+        reportProcessError(
+            PROCESS_OP_HANDLE_DUPES, rootDir, PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+
+    size_t fileCount = 0;
+    for (size_t i = 0; i < entries->count; i++) {
+        if (entries->entries[i].type == FILE_TYPE_REGULAR) {
+            job.regular[fileCount++] = i;
+        }
+    }
+
+    int status = 0;
+    struct MatchList matches = {0};
+    struct PassageList passages = {0};
+    job.passes = countPasses(entries, job.regular, fileCount);
+    for (job.pass = 0; job.pass < job.passes; job.pass++) {
+        if (runPass(&job, fileCount, jobs, &matches, &status) != 0) {
+            reportProcessError(
+                PROCESS_OP_HANDLE_DUPES, rootDir, PROC_ERR_MEMORY_ALLOC);
+            status = -1;
+            goto cleanup;
+        }
+    }
+
+    if (chainPassages(&matches, minLength, &passages) != 0) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_DUPES, rootDir, PROC_ERR_MEMORY_ALLOC);
+        status = -1;
+        goto cleanup;
+    }
+    if (extendPassages(entries, job.regular, minLength, &passages) != 0) {
+        status = -1;
+    }
+
+    for (size_t p = 0; p < passages.count; p++) {
+        const struct Passage *passage = &passages.items[p];
+        const char *pathA =
+            entries->entries[job.regular[passage->fileA]].path;
+        const char *pathB =
+            entries->entries[job.regular[passage->fileB]].path;
+        fprintf(out,
+                "%s:%u:%u-%u\t%s:%u:%u-%u\t%u\n",
+                relativePath(pathA, rootDir),
+                passage->a.line,
+                passage->a.start,
+                passage->a.end,
+                relativePath(pathB, rootDir),
+                passage->b.line,
+                passage->b.start,
+                passage->b.end,
+                passage->length);
+    }
+
+    errno = 0;
+    if (fflush(out) != 0 || ferror(out)) {
+        reportFileError(FILE_OP_WRITE, "duplicate passages");
+        status = -1;
+    }
+
+cleanup:
+    free(matches.items);
+    free(passages.items);
+    free(job.regular);
+    free(job.results);
+    return status;
+}
@@ -0,0 +1,39 @@
+#ifndef DUPES_H
+#define DUPES_H
+
+#include "filelist.h"
+#include <stdio.h>
+
+/* *
+ * Finds passages that appear in more than one file of a resolved project.
+ * Text is compared as letters and digits only, folded to lower case, so
+ * re-wrapped, re-punctuated and lightly edited copies still match.
+ *
+ * Files are fingerprinted in parallel with a rolling hash and winnowing.
+ * Fingerprints are kept within COLETTE_DUPES_MEMORY by splitting the hash
+ * space over as many passes as the project size calls for. Each shared
+ * passage of at least minLength compared characters is written to out in draft
+ * order as
+ *
+ *     path:line:start-end<TAB>path:line:start-end<TAB>length
+ *
+ * giving, for each copy, its file, first line and byte range, then the
+ * length in compared characters.
+ *
+ * @param   entries    Resolved entries in traversal order
+ * @param   minLength  Shortest passage to report, in compared characters
+ * @param   jobs       Maximum number of worker threads
+ * @param   rootDir    Project root, stripped from paths
+ * @param   out        Stream the passages are written to
+ *
+ * @return  int
+ *          0          if every file was compared
+ *         -1          if a file could not be read or output failed
+ * */
+int findDuplicatePassages(const struct FileList *entries,
+                          unsigned int minLength,
+                          unsigned int jobs,
+                          const char *rootDir,
+                          FILE *out);
+
+#endif
@@ -0,0 +1,378 @@
+#include "encoding.h"
+#include "utf8.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// how much of the first block is looked at for the zero bytes of UTF-16
+#define UTF16_SNIFF_BYTES 512
+
+struct EncodingName {
+    const char *name;
+    enum TextEncoding encoding;
+};
+
+static const struct EncodingName ENCODING_NAMES[] = {
+    {"auto", ENCODING_AUTO},
+    {"utf-8", ENCODING_UTF8},
+    {"utf8", ENCODING_UTF8},
+    {"utf-16", ENCODING_UTF16LE}, // a byte order mark still picks the order
+    {"utf-16le", ENCODING_UTF16LE},
+    {"utf-16be", ENCODING_UTF16BE},
+    {"latin-1", ENCODING_LATIN1},
+    {"latin1", ENCODING_LATIN1},
+    {"iso-8859-1", ENCODING_LATIN1},
+    {"windows-1252", ENCODING_WINDOWS_1252},
+    {"cp1252", ENCODING_WINDOWS_1252},
+};
+
+/* *
+ * Windows-1252 differs from Latin-1 only in 0x80-0x9F. The five bytes it
+ * leaves undefined map to the C1 controls, as browsers do.
+ * */
+static const uint16_t WINDOWS_1252_HIGH[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+int parseEncodingName(const char *name, enum TextEncoding *encoding) {
+    if (!name || !encoding) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(ENCODING_NAMES) / sizeof(ENCODING_NAMES[0]);
+         i++) {
+        if (strcasecmp(ENCODING_NAMES[i].name, name) == 0) {
+            *encoding = ENCODING_NAMES[i].encoding;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+bool isEncodingLine(const char *line, const char **name) {
+    if (!line || line[0] != '#') {
+        return false;
+    }
+
+    const char *cursor = line + 1;
+    cursor += strspn(cursor, " \t");
+    if (strncasecmp(cursor, "encoding:", 9) != 0) {
+        return false;
+    }
+    cursor += 9;
+    cursor += strspn(cursor, " \t");
+
+    *name = cursor;
+    return true;
+}
+
+static bool isLegacyEncoding(enum TextEncoding encoding) {
+    return encoding == ENCODING_LATIN1 || encoding == ENCODING_WINDOWS_1252;
+}
+
+/* *
+ * Text in a Latin script stored as UTF-16 without a byte order mark has a zero
+ * byte in every other position. UTF-8 text never contains zero bytes.
+ * */
+static enum TextEncoding sniffUtf16(const unsigned char *data, size_t len) {
+    size_t sniffLen = len < UTF16_SNIFF_BYTES ? len : UTF16_SNIFF_BYTES;
+    size_t pairs = sniffLen / 2;
+    if (pairs < 2) {
+        return ENCODING_UTF8;
+    }
+
+    size_t evenZeros = 0;
+    size_t oddZeros = 0;
+    for (size_t i = 0; i + 1 < sniffLen; i += 2) {
+        evenZeros += data[i] == 0;
+        oddZeros += data[i + 1] == 0;
+    }
+
+    if (evenZeros == 0 && oddZeros * 2 >= pairs) {
+        return ENCODING_UTF16LE;
+    }
+    if (oddZeros == 0 && evenZeros * 2 >= pairs) {
+        return ENCODING_UTF16BE;
+    }
+    return ENCODING_UTF8;
+}
+
+enum TextEncoding detectEncoding(enum TextEncoding declared,
+                                 const unsigned char *data,
+                                 size_t len) {
+    if (isLegacyEncoding(declared)) {
+        return declared;
+    }
+
+    if (len >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+        return ENCODING_UTF16LE;
+    }
+    if (len >= 2 && data[0] == 0xFE && data[1] == 0xFF) {
+        return ENCODING_UTF16BE;
+    }
+    if (len >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
+        return ENCODING_UTF8;
+    }
+
+    switch (declared) {
+    case ENCODING_UTF8:
+    case ENCODING_UTF16LE:
+    case ENCODING_UTF16BE:
+        return declared;
+    case ENCODING_AUTO: {
+        enum TextEncoding sniffed = sniffUtf16(data, len);
+        if (sniffed != ENCODING_UTF8) {
+            return sniffed;
+        }
+        // a sequence cut off by the end of the block isn't held against it
+        struct Utf8Validator validator;
+        utf8Init(&validator);
+        return utf8Update(&validator, data, len) ? ENCODING_UTF8
+                                                 : ENCODING_WINDOWS_1252;
+    }
+    default:
+        return sniffUtf16(data, len);
+    }
+}
+
+void transcoderInit(struct Transcoder *transcoder) {
+    memset(transcoder, 0, sizeof(*transcoder));
+    transcoder->encoding = ENCODING_UTF8;
+}
+
+void transcoderReset(struct Transcoder *transcoder, enum TextEncoding encoding) {
+    transcoder->encoding = encoding;
+    transcoder->highSurrogate = 0;
+    transcoder->hasPendingByte = false;
+    transcoder->replacements = 0;
+}
+
+static size_t putUtf8(unsigned char *out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out[0] = (unsigned char)codePoint;
+        return 1;
+    }
+    if (codePoint < 0x800) {
+        out[0] = (unsigned char)(0xC0 | (codePoint >> 6));
+        out[1] = (unsigned char)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if (codePoint < 0x10000) {
+        out[0] = (unsigned char)(0xE0 | (codePoint >> 12));
+        out[1] = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out[2] = (unsigned char)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    out[0] = (unsigned char)(0xF0 | (codePoint >> 18));
+    out[1] = (unsigned char)(0x80 | ((codePoint >> 12) & 0x3F));
+    out[2] = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+    out[3] = (unsigned char)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+static size_t putReplacement(struct Transcoder *transcoder,
+                             unsigned char *out) {
+    transcoder->replacements++;
+    return putUtf8(out, 0xFFFD);
+}
+
+static size_t convertLegacy(struct Transcoder *transcoder,
+                            const unsigned char *bytes,
+                            size_t len,
+                            unsigned char *out) {
+    bool windows = transcoder->encoding == ENCODING_WINDOWS_1252;
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < len) {
+#if defined(__SSE2__)
+        // ASCII is the same in all three encodings: copy it 16 bytes at a
+        // time, up to the first byte with its high bit set
+        while (len - i >= 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+            _mm_storeu_si128((__m128i *)(out + o), chunk);
+            unsigned int mask = (unsigned int)_mm_movemask_epi8(chunk);
+            size_t ascii = mask ? (size_t)__builtin_ctz(mask) : 16;
+            i += ascii;
+            o += ascii;
+            if (mask) {
+                break;
+            }
+        }
+        if (i >= len) {
+            break;
+        }
+#endif
+        unsigned char c = bytes[i++];
+        if (c < 0x80) {
+            out[o++] = c;
+        } else if (windows && c < 0xA0) {
+            o += putUtf8(out + o, WINDOWS_1252_HIGH[c - 0x80]);
+        } else {
+            o += putUtf8(out + o, c);
+        }
+    }
+
+    return o;
+}
+
+/* *
+ * Decodes one UTF-16 code unit, pairing surrogates. A lead surrogate produces
+ * nothing until the unit after it is known.
+ * */
+static size_t putUtf16Unit(struct Transcoder *transcoder,
+                           unsigned int unit,
+                           unsigned char *out) {
+    size_t o = 0;
+    if (transcoder->highSurrogate) {
+        if (unit >= 0xDC00 && unit <= 0xDFFF) {
+            uint32_t codePoint = 0x10000 +
+                                 ((transcoder->highSurrogate - 0xD800) << 10) +
+                                 (unit - 0xDC00);
+            transcoder->highSurrogate = 0;
+            return putUtf8(out, codePoint);
+        }
+        transcoder->highSurrogate = 0;
+        o += putReplacement(transcoder, out);
+    }
+
+    if (unit >= 0xD800 && unit <= 0xDBFF) {
+        transcoder->highSurrogate = unit;
+        return o;
+    }
+    if (unit >= 0xDC00 && unit <= 0xDFFF) {
+        return o + putReplacement(transcoder, out + o);
+    }
+    return o + putUtf8(out + o, unit);
+}
+
+static size_t convertUtf16(struct Transcoder *transcoder,
+                           const unsigned char *bytes,
+                           size_t len,
+                           unsigned char *out) {
+    bool bigEndian = transcoder->encoding == ENCODING_UTF16BE;
+    size_t i = 0;
+    size_t o = 0;
+
+    if (transcoder->hasPendingByte && len > 0) {
+        unsigned int unit =
+            bigEndian ? ((unsigned int)transcoder->pendingByte << 8) | bytes[0]
+                      : transcoder->pendingByte | ((unsigned int)bytes[0] << 8);
+        transcoder->hasPendingByte = false;
+        o += putUtf16Unit(transcoder, unit, out);
+        i = 1;
+    }
+
+#if defined(__SSE2__)
+    const __m128i highBits = _mm_set1_epi16(-128); // 0xFF80
+    const __m128i zero = _mm_setzero_si128();
+#endif
+
+    while (len - i >= 2) {
+#if defined(__SSE2__)
+        // eight units at a time while they are all ASCII, narrowed to bytes
+        // with a saturating pack
+        while (!transcoder->highSurrogate && len - i >= 16) {
+            __m128i units = _mm_loadu_si128((const __m128i *)(bytes + i));
+            if (bigEndian) {
+                units = _mm_or_si128(_mm_slli_epi16(units, 8),
+                                     _mm_srli_epi16(units, 8));
+            }
+            unsigned int asciiMask = (unsigned int)_mm_movemask_epi8(
+                _mm_cmpeq_epi16(_mm_and_si128(units, highBits), zero));
+            _mm_storel_epi64((__m128i *)(out + o),
+                             _mm_packus_epi16(units, units));
+            size_t ascii = asciiMask == 0xFFFF
+                               ? 8
+                               : (size_t)__builtin_ctz(~asciiMask) / 2;
+            i += ascii * 2;
+            o += ascii;
+            if (ascii < 8) {
+                break;
+            }
+        }
+        if (len - i < 2) {
+            break;
+        }
+#endif
+        unsigned int unit =
+            bigEndian ? ((unsigned int)bytes[i] << 8) | bytes[i + 1]
+                      : bytes[i] | ((unsigned int)bytes[i + 1] << 8);
+        o += putUtf16Unit(transcoder, unit, out + o);
+        i += 2;
+    }
+
+    if (i < len) {
+        transcoder->pendingByte = bytes[i];
+        transcoder->hasPendingByte = true;
+    }
+
+    return o;
+}
+
+int transcoderUpdate(struct Transcoder *transcoder,
+                     const void *data,
+                     size_t len,
+                     const unsigned char **out,
+                     size_t *outLen) {
+    // no input byte grows past three output bytes; the slack covers a
+    // surrogate held from the previous chunk and the 16 byte vector stores
+    if (len > (SIZE_MAX - 16) / 3) {
+        return -1;
+    }
+    size_t needed = len * 3 + 16;
+    if (needed > transcoder->outCapacity) {
+        unsigned char *grown = realloc(transcoder->out, needed);
+        if (!grown) {
+            return -1;
+        }
+        transcoder->out = grown;
+        transcoder->outCapacity = needed;
+    }
+
+    const unsigned char *bytes = data;
+    if (isLegacyEncoding(transcoder->encoding)) {
+        *outLen = convertLegacy(transcoder, bytes, len, transcoder->out);
+    } else if (transcoder->encoding == ENCODING_UTF16LE ||
+               transcoder->encoding == ENCODING_UTF16BE) {
+        *outLen = convertUtf16(transcoder, bytes, len, transcoder->out);
+    } else {
+        memcpy(transcoder->out, bytes, len);
+        *outLen = len;
+    }
+
+    *out = transcoder->out;
+    return 0;
+}
+
+void transcoderFinish(struct Transcoder *transcoder,
+                      const unsigned char **out,
+                      size_t *outLen) {
+    size_t o = 0;
+    if (transcoder->highSurrogate) {
+        transcoder->highSurrogate = 0;
+        o += putReplacement(transcoder, transcoder->tail + o);
+    }
+    if (transcoder->hasPendingByte) {
+        transcoder->hasPendingByte = false;
+        o += putReplacement(transcoder, transcoder->tail + o);
+    }
+
+    *out = transcoder->tail;
+    *outLen = o;
+}
+
+void transcoderFree(struct Transcoder *transcoder) {
+    free(transcoder->out);
+    transcoder->out = NULL;
+    transcoder->outCapacity = 0;
+}
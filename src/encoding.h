@@ -0,0 +1,135 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *
+ * Source encodings collation can read. ENCODING_DEFAULT is what a directory
+ * without an encoding line in its .index gets: a byte order mark or the
+ * zero-byte pattern of UTF-16 is recognised, anything else is UTF-8 and is
+ * copied through untouched. ENCODING_AUTO also reads text that isn't valid
+ * UTF-8 as Windows-1252.
+ * */
+enum TextEncoding {
+    ENCODING_DEFAULT,
+    ENCODING_AUTO,
+    ENCODING_UTF8,
+    ENCODING_UTF16LE,
+    ENCODING_UTF16BE,
+    ENCODING_LATIN1,
+    ENCODING_WINDOWS_1252,
+};
+
+/* *
+ * Parses an encoding name as written in an .index file (utf-8, utf-16,
+ * utf-16le, utf-16be, latin-1, iso-8859-1, windows-1252, cp1252, auto).
+ * Case is ignored.
+ *
+ * @param   name      Encoding name
+ * @param   encoding  Receives the encoding
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if the name is not recognised
+ * */
+int parseEncodingName(const char *name, enum TextEncoding *encoding);
+
+/* *
+ * Recognises an encoding line in an .index file: "# encoding: NAME". Any
+ * other line, comment or not, is left alone.
+ *
+ * @param   line  Index line without its line feed
+ * @param   name  Receives a pointer to the name within line
+ *
+ * @return  bool  true if line is an encoding line
+ * */
+bool isEncodingLine(const char *line, const char **name);
+
+/* *
+ * Picks the encoding of a file from the first block read from it. A UTF-16
+ * byte order mark wins over anything but an explicit 8-bit encoding; the
+ * UTF-8 mark keeps the file on the UTF-8 path.
+ *
+ * @param   declared  Encoding given for the file's directory
+ * @param   data      First bytes of the file
+ * @param   len       Number of bytes in data
+ *
+ * @return  enum TextEncoding  ENCODING_UTF8 if no transcoding is needed,
+ *                             otherwise the encoding to transcode from
+ * */
+enum TextEncoding detectEncoding(enum TextEncoding declared,
+                                 const unsigned char *data,
+                                 size_t len);
+
+/* *
+ * Streaming converter from one source encoding to UTF-8. A UTF-16 code unit
+ * split across chunks, or a surrogate pair split between them, is carried to
+ * the next update. Unpaired surrogates and a dangling odd byte become U+FFFD,
+ * so the output is always valid UTF-8. A byte order mark is converted like
+ * any other character, leaving it to the bom filter.
+ * */
+struct Transcoder {
+    enum TextEncoding encoding;
+    unsigned int highSurrogate; // UTF-16 lead surrogate waiting for its pair
+    bool hasPendingByte;        // UTF-16 chunk ended halfway through a unit
+    unsigned char pendingByte;
+    unsigned char tail[6];      // output of finish
+    size_t replacements;        // characters that became U+FFFD
+    unsigned char *out;         // output of the last update
+    size_t outCapacity;
+};
+
+/* *
+ * @param  transcoder  Transcoder to initialize; nothing is allocated yet
+ * */
+void transcoderInit(struct Transcoder *transcoder);
+
+/* *
+ * Resets per-file state. Call before the first chunk of every file.
+ *
+ * @param  transcoder  Transcoder to reset
+ * @param  encoding    Encoding the file is read from, as chosen by
+ *                     detectEncoding(); never ENCODING_DEFAULT or AUTO
+ * */
+void transcoderReset(struct Transcoder *transcoder, enum TextEncoding encoding);
+
+/* *
+ * Converts the next chunk of the current file. The output points into the
+ * transcoder and stays valid until the next call.
+ *
+ * @param   transcoder  Transcoder state
+ * @param   data        Next bytes of the file
+ * @param   len         Number of bytes in data
+ * @param   out         Receives a pointer to the UTF-8 bytes
+ * @param   outLen      Receives the number of UTF-8 bytes
+ *
+ * @return  int
+ *          0           on success
+ *         -1           if the output buffer could not be grown
+ * */
+int transcoderUpdate(struct Transcoder *transcoder,
+                     const void *data,
+                     size_t len,
+                     const unsigned char **out,
+                     size_t *outLen);
+
+/* *
+ * Flushes a code unit or surrogate cut off by the end of the file as U+FFFD.
+ *
+ * @param  transcoder  Transcoder state
+ * @param  out         Receives a pointer to the remaining bytes
+ * @param  outLen      Receives the number of remaining bytes
+ * */
+void transcoderFinish(struct Transcoder *transcoder,
+                      const unsigned char **out,
+                      size_t *outLen);
+
+/* *
+ * Frees the output buffer.
+ *
+ * @param  transcoder  Transcoder to free
+ * */
+void transcoderFree(struct Transcoder *transcoder);
+
+#endif
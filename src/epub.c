@@ -0,0 +1,365 @@
+#include "epub.h"
+#include "constants.h"
+#include "crc32.h"
+#include "errors.h"
+#include "files.h"
+#include "html.h"
+#include "markdown.h"
+#include "reporting.h"
+#include "zip.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// chapter-NNN, however many chapters there are
+#define EPUB_CHAPTER_NAME_SIZE 32
+
+static const char MIMETYPE[] = "application/epub+zip";
+
+static const char CONTAINER[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<container version=\"1.0\" "
+    "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\">\n"
+    "<rootfiles>\n"
+    "<rootfile full-path=\"OEBPS/content.opf\" "
+    "media-type=\"application/oebps-package+xml\"/>\n"
+    "</rootfiles>\n"
+    "</container>\n";
+
+static const char XHTML_START[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<!DOCTYPE html>\n"
+    "<html xmlns=\"http://www.w3.org/1999/xhtml\" "
+    "xmlns:epub=\"http://www.idpf.org/2007/ops\">\n"
+    "<head>\n<meta charset=\"utf-8\" />\n<title>";
+
+static const char XHTML_END[] = "</body>\n</html>\n";
+
+/* *
+ * The archive being written. Chapter titles are kept for the navigation
+ * document and package file, which follow the chapters.
+ * */
+struct EpubOutput {
+    struct ZipWriter zip;
+    const char *path; // of the archive, for errors
+    char **titles;
+    unsigned int chapters;
+    unsigned int capacity;
+    bool inChapter;
+    bool failed; // already reported
+};
+
+static int writeFailed(struct EpubOutput *output) {
+    reportFileError(FILE_OP_WRITE, output->path);
+    output->failed = true;
+    return -1;
+}
+
+static int memoryFailed(struct EpubOutput *output) {
+    reportProcessError(
+        PROCESS_OP_HANDLE_EPUB, output->path, PROC_ERR_MEMORY_ALLOC);
+    output->failed = true;
+    return -1;
+}
+
+static void chapterName(char *buffer, size_t size, unsigned int chapter) {
+    snprintf(buffer, size, "chapter-%03u", chapter);
+}
+
+static int endChapter(struct EpubOutput *output) {
+    if (!output->inChapter) {
+        return 0;
+    }
+    output->inChapter = false;
+    if (zipWriteEntry(&output->zip, XHTML_END, sizeof(XHTML_END) - 1) != 0 ||
+        zipEndEntry(&output->zip) != 0) {
+        return writeFailed(output);
+    }
+    return 0;
+}
+
+static int startChapter(struct EpubOutput *output, const char *title) {
+    if (endChapter(output) != 0) {
+        return -1;
+    }
+
+    if (output->chapters == output->capacity) {
+        unsigned int capacity = output->capacity ? output->capacity * 2 : 16;
+        char **grown = realloc(output->titles, capacity * sizeof(char *));
+        if (!grown) {
+            return memoryFailed(output);
+        }
+        output->titles = grown;
+        output->capacity = capacity;
+    }
+    char *copy = strdup(title);
+    if (!copy) {
+        return memoryFailed(output);
+    }
+    output->titles[output->chapters++] = copy;
+
+    char name[EPUB_CHAPTER_NAME_SIZE];
+    char entryName[EPUB_CHAPTER_NAME_SIZE + 16];
+    chapterName(name, sizeof(name), output->chapters);
+    snprintf(entryName, sizeof(entryName), "OEBPS/%s.xhtml", name);
+
+    struct HtmlBuffer start = {0};
+    if (appendHtml(&start, XHTML_START) != 0 ||
+        appendEscapedHtml(&start, title, strlen(title)) != 0 ||
+        appendHtml(&start, "</title>\n</head>\n<body>\n") != 0) {
+        freeHtmlBuffer(&start);
+        return memoryFailed(output);
+    }
+    int status = zipBeginEntry(&output->zip, entryName, ZIP_DEFLATED) != 0 ||
+                         zipWriteEntry(&output->zip, start.data, start.len) !=
+                             0
+                     ? -1
+                     : 0;
+    freeHtmlBuffer(&start);
+    if (status != 0) {
+        return writeFailed(output);
+    }
+    output->inChapter = true;
+    return 0;
+}
+
+static int beginEpubChapter(void *arg, const struct FileEntry *entry) {
+    char stem[COLETTE_NAME_BUF_SIZE];
+    htmlEntryStem(entry, stem, sizeof(stem));
+    return startChapter(arg, stem);
+}
+
+static int writeEpub(void *arg, const char *data, size_t len) {
+    struct EpubOutput *output = arg;
+    if (output->inChapter && zipWriteEntry(&output->zip, data, len) != 0) {
+        return writeFailed(output);
+    }
+    return 0;
+}
+
+static int buildNavigation(const struct EpubOutput *output,
+                           const char *displayTitle,
+                           struct HtmlBuffer *nav) {
+    if (appendHtml(nav, XHTML_START) != 0 ||
+        appendEscapedHtml(nav, displayTitle, strlen(displayTitle)) != 0 ||
+        appendHtml(nav,
+                   "</title>\n</head>\n<body>\n"
+                   "<nav epub:type=\"toc\" id=\"toc\">\n<h1>") != 0 ||
+        appendEscapedHtml(nav, displayTitle, strlen(displayTitle)) != 0 ||
+        appendHtml(nav, "</h1>\n<ol>\n") != 0) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < output->chapters; i++) {
+        char name[EPUB_CHAPTER_NAME_SIZE];
+        chapterName(name, sizeof(name), i + 1);
+        if (appendHtml(nav, "<li><a href=\"") != 0 ||
+            appendHtml(nav, name) != 0 ||
+            appendHtml(nav, ".xhtml\">") != 0 ||
+            appendEscapedHtml(
+                nav, output->titles[i], strlen(output->titles[i])) != 0 ||
+            appendHtml(nav, "</a></li>\n") != 0) {
+            return -1;
+        }
+    }
+    return appendHtml(nav, "</ol>\n</nav>\n") != 0 ||
+                   appendHtml(nav, XHTML_END) != 0
+               ? -1
+               : 0;
+}
+
+/* *
+ * Readers tell books apart by identifier, so it is derived from the project
+ * and title rather than made up each time: rebuilding a book replaces it.
+ * The UUID is marked as version 8, custom.
+ * */
+static void bookIdentifier(const char *rootDir,
+                           const char *title,
+                           char *buffer,
+                           size_t size) {
+    uint32_t a = crc32Update(0, rootDir, strlen(rootDir));
+    uint32_t b = crc32Update(0, title, strlen(title));
+    uint32_t c = crc32Update(a, title, strlen(title));
+    uint32_t d = crc32Update(b, rootDir, strlen(rootDir));
+    snprintf(buffer,
+             size,
+             "urn:uuid:%08x-%04x-%04x-%04x-%04x%08x",
+             (unsigned int)a,
+             (unsigned int)(b >> 16),
+             (unsigned int)((b & 0x0fff) | 0x8000),
+             (unsigned int)(((c >> 16) & 0x3fff) | 0x8000),
+             (unsigned int)(c & 0xffff),
+             (unsigned int)d);
+}
+
+static int buildPackage(const struct EpubOutput *output,
+                        const char *rootDir,
+                        const char *title,
+                        const char *displayTitle,
+                        struct HtmlBuffer *opf) {
+    char identifier[64];
+    bookIdentifier(rootDir, title, identifier, sizeof(identifier));
+    char modified[32] = "1970-01-01T00:00:00Z";
+    time_t now = time(NULL);
+    struct tm utc;
+    if (gmtime_r(&now, &utc)) {
+        strftime(modified, sizeof(modified), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    }
+
+    if (appendHtml(opf,
+                   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<package xmlns=\"http://www.idpf.org/2007/opf\" "
+                   "version=\"3.0\" unique-identifier=\"book-id\">\n"
+                   "<metadata xmlns:dc=\"http://purl.org/dc/elements/1.1/\">\n"
+                   "<dc:identifier id=\"book-id\">") != 0 ||
+        appendHtml(opf, identifier) != 0 ||
+        appendHtml(opf, "</dc:identifier>\n<dc:title>") != 0 ||
+        appendEscapedHtml(opf, displayTitle, strlen(displayTitle)) != 0 ||
+        appendHtml(opf,
+                   "</dc:title>\n<dc:language>en</dc:language>\n"
+                   "<meta property=\"dcterms:modified\">") != 0 ||
+        appendHtml(opf, modified) != 0 ||
+        appendHtml(opf,
+                   "</meta>\n</metadata>\n<manifest>\n"
+                   "<item id=\"nav\" href=\"nav.xhtml\" "
+                   "media-type=\"application/xhtml+xml\" "
+                   "properties=\"nav\"/>\n") != 0) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < output->chapters; i++) {
+        char name[EPUB_CHAPTER_NAME_SIZE];
+        chapterName(name, sizeof(name), i + 1);
+        if (appendHtml(opf, "<item id=\"") != 0 ||
+            appendHtml(opf, name) != 0 ||
+            appendHtml(opf, "\" href=\"") != 0 ||
+            appendHtml(opf, name) != 0 ||
+            appendHtml(opf,
+                       ".xhtml\" media-type=\"application/xhtml+xml\"/>\n") !=
+                0) {
+            return -1;
+        }
+    }
+    if (appendHtml(opf, "</manifest>\n<spine>\n") != 0) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < output->chapters; i++) {
+        char name[EPUB_CHAPTER_NAME_SIZE];
+        chapterName(name, sizeof(name), i + 1);
+        if (appendHtml(opf, "<itemref idref=\"") != 0 ||
+            appendHtml(opf, name) != 0 || appendHtml(opf, "\"/>\n") != 0) {
+            return -1;
+        }
+    }
+    return appendHtml(opf, "</spine>\n</package>\n");
+}
+
+/* *
+ * Ends the last chapter and writes the documents that list the chapters.
+ * A project with nothing in its root .index still gets one, empty chapter,
+ * since a book needs something to read.
+ * */
+static int finishBook(struct EpubOutput *output,
+                      const char *rootDir,
+                      const char *title,
+                      const char *displayTitle) {
+    if (output->chapters == 0 && startChapter(output, displayTitle) != 0) {
+        return -1;
+    }
+    if (endChapter(output) != 0) {
+        return -1;
+    }
+
+    struct HtmlBuffer nav = {0};
+    struct HtmlBuffer opf = {0};
+    if (buildNavigation(output, displayTitle, &nav) != 0 ||
+        buildPackage(output, rootDir, title, displayTitle, &opf) != 0) {
+        freeHtmlBuffer(&nav);
+        freeHtmlBuffer(&opf);
+        return memoryFailed(output);
+    }
+    int status =
+        zipAddEntry(
+            &output->zip, "OEBPS/nav.xhtml", nav.data, nav.len, ZIP_DEFLATED) !=
+                    0 ||
+                zipAddEntry(&output->zip,
+                            "OEBPS/content.opf",
+                            opf.data,
+                            opf.len,
+                            ZIP_DEFLATED) != 0
+            ? -1
+            : 0;
+    freeHtmlBuffer(&nav);
+    freeHtmlBuffer(&opf);
+    return status != 0 ? writeFailed(output) : 0;
+}
+
+int writeProjectEpub(const struct FileList *entries,
+                     unsigned int jobs,
+                     const char *rootDir,
+                     const char *title) {
+    if (!entries || !rootDir || !title) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_EPUB, rootDir, PROC_ERR_INVALID_STATE);
+        return -1;
+    }
+
+    char displayTitle[COLETTE_NAME_BUF_SIZE];
+    htmlDisplayTitle(title, displayTitle, sizeof(displayTitle));
+
+    char outPath[COLETTE_PATH_BUF_SIZE];
+    char bookPath[COLETTE_PATH_BUF_SIZE];
+    if (joinPath(outPath, sizeof(outPath), rootDir, title) != 0 ||
+        joinExtension(bookPath, sizeof(bookPath), outPath, ".epub") != 0) {
+        return -1;
+    }
+
+    struct EpubOutput output = {.path = bookPath};
+    errno = 0;
+    if (zipOpen(&output.zip, bookPath) != 0) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_EPUB, bookPath, PROC_ERR_INVALID_OUTPUT);
+        return -1;
+    }
+
+    // readers find the type in the first entry, uncompressed
+    int status = 0;
+    if (zipAddEntry(&output.zip,
+                    "mimetype",
+                    MIMETYPE,
+                    sizeof(MIMETYPE) - 1,
+                    ZIP_STORED) != 0 ||
+        zipAddEntry(&output.zip,
+                    "META-INF/container.xml",
+                    CONTAINER,
+                    sizeof(CONTAINER) - 1,
+                    ZIP_DEFLATED) != 0) {
+        status = writeFailed(&output);
+    }
+
+    if (status == 0) {
+        struct HtmlSink sink = {
+            .beginChapter = beginEpubChapter,
+            .write = writeEpub,
+            .arg = &output,
+        };
+        status = renderHtmlEntries(entries, jobs, rootDir, &sink);
+    }
+    if (!output.failed &&
+        finishBook(&output, rootDir, title, displayTitle) != 0) {
+        status = -1;
+    }
+
+    if (output.failed) {
+        zipAbort(&output.zip);
+    } else if (zipClose(&output.zip) != 0) {
+        reportFileError(FILE_OP_WRITE, bookPath);
+        status = -1;
+    }
+    for (unsigned int i = 0; i < output.chapters; i++) {
+        free(output.titles[i]);
+    }
+    free(output.titles);
+    return status;
+}
@@ -0,0 +1,27 @@
+#ifndef EPUB_H
+#define EPUB_H
+
+#include "filelist.h"
+
+/* *
+ * Writes the draft as an EPUB 3 book, <rootDir>/<title>.epub. Each entry in
+ * the root .index is a chapter, rendered as for --format html-chapters into
+ * an XHTML document, with a navigation document and package file listing the
+ * chapters in draft order. Chapters are compressed into the archive as they
+ * are rendered; nothing is staged on disk.
+ *
+ * @param   entries  Resolved entries in traversal order
+ * @param   jobs     Maximum number of worker threads
+ * @param   rootDir  Project root the book is written to
+ * @param   title    Output name, as for the Markdown draft
+ *
+ * @return  int
+ *          0        if every file was rendered and the book written
+ *         -1        if any file could not be read or output failed
+ * */
+int writeProjectEpub(const struct FileList *entries,
+                     unsigned int jobs,
+                     const char *rootDir,
+                     const char *title);
+
+#endif
@@ -47,6 +47,14 @@ enum ProcessOperation {
     PROCESS_OP_HANDLE_INIT,    // Failed during project initialization
     PROCESS_OP_HANDLE_LIST,    // Failed during symlink creation
     PROCESS_OP_HANDLE_COLLATE, // Failed during file collation
+    PROCESS_OP_HANDLE_GREP,    // Failed during project search
+    PROCESS_OP_HANDLE_INDEX,   // Failed while updating the word index
+    PROCESS_OP_HANDLE_DUPES,   // Failed while comparing files for copies
+    PROCESS_OP_HANDLE_ANALYZE, // Failed while analysing project text
+    PROCESS_OP_HANDLE_SPELL,   // Failed while checking spelling
+    PROCESS_OP_HANDLE_HTML,    // Failed while rendering the draft as HTML
+    PROCESS_OP_HANDLE_EPUB,    // Failed while writing the EPUB archive
+    PROCESS_OP_HANDLE_VERIFY,  // Failed while checking a draft's manifest
 };
 
 enum ProcessErrorDetail {
@@ -71,6 +79,7 @@ enum ProcessErrorDetail {
     PROC_ERR_INVALID_STATE,    // Invalid internal state
     PROC_ERR_INVALID_SEQUENCE, // Operations in wrong order
     PROC_ERR_INVALID_LINK,     // Symbolic links not allowed
+    PROC_ERR_NOT_REGULAR,      // Special file where a project file belongs
     PROC_ERR_INVALID_PATH,
     PROC_ERR_INVALID_OUTPUT,
     PROC_ERR_FILE_NOT_FOUND,
@@ -82,11 +91,15 @@ enum ProcessErrorDetail {
     // Data errors
     PROC_ERR_BUFFER_OVERFLOW, // Internal buffer overflow
     PROC_ERR_DATA_CORRUPT,    // Data corruption detected
+    PROC_ERR_INVALID_UTF8,    // File content is not valid UTF-8
+    PROC_ERR_UNKNOWN_ENCODING, // .index names an encoding we can't read
 
     // Project structure errors
     PROC_ERR_TOO_DEEP,          // Project hierarchy too deep
     PROC_ERR_TOO_MANY_FILES,    // Too many files in project
     PROC_ERR_INVALID_STRUCTURE, // Invalid project structure
+    PROC_ERR_DUPLICATE_REF,     // Same file listed more than once
+    PROC_ERR_ORPHANED_FILE,     // Project file not listed in any index
 
     // Other
     PROC_ERR_OPEN_FILE
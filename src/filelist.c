@@ -0,0 +1,85 @@
+#include "constants.h"
+#include "filelist.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int appendFileEntry(struct FileList *list,
+                    const char *path,
+                    enum FileType type,
+                    size_t depth) {
+    if (!list || !path) {
+        return -1;
+    }
+
+    if (list->count >= list->capacity) {
+        size_t newCapacity = list->capacity ? list->capacity * 2 : 64;
+        if (newCapacity > SIZE_MAX / sizeof(struct FileEntry)) {
+            return -1;
+        }
+        struct FileEntry *newEntries =
+            realloc(list->entries, newCapacity * sizeof(struct FileEntry));
+        if (!newEntries) {
+            return -1;
+        }
+        list->entries = newEntries;
+        list->capacity = newCapacity;
+    }
+
+    // lists start zeroed, so the arena is set up by the first append
+    if (list->paths.blockSize == 0) {
+        arenaInit(&list->paths, COLETTE_FILE_LIST_ARENA_SIZE);
+    }
+    size_t pathLen = strlen(path) + 1;
+    char *pathCopy = arenaAlloc(&list->paths, pathLen);
+    if (!pathCopy) {
+        return -1;
+    }
+    memcpy(pathCopy, path, pathLen);
+
+    struct FileEntry entry = {.path = pathCopy,
+                              .type = type,
+                              .depth = depth,
+                              .size = -1,
+                              .topEntry = 0,
+                              .nameOffset = 0,
+                              .fd = -1,
+                              .encoding = ENCODING_DEFAULT,
+                              .stats = {0}};
+    list->entries[list->count] = entry;
+    list->count++;
+
+    return 0;
+}
+
+static void closeEntries(struct FileList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (list->entries[i].fd >= 0) {
+            close(list->entries[i].fd);
+        }
+    }
+}
+
+void resetFileList(struct FileList *list) {
+    if (!list) {
+        return;
+    }
+
+    closeEntries(list);
+    arenaRelease(&list->paths, (struct ArenaMark){0});
+    list->count = 0;
+}
+
+void freeFileList(struct FileList *list) {
+    if (!list) {
+        return;
+    }
+
+    closeEntries(list);
+    freeArena(&list->paths);
+    free(list->entries);
+    list->entries = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
@@ -0,0 +1,80 @@
+#ifndef FILELIST_H
+#define FILELIST_H
+
+#include "arena.h"
+#include "encoding.h"
+#include "stats.h"
+#include <stddef.h>
+
+enum FileType { FILE_TYPE_UNKNOWN, FILE_TYPE_DIRECTORY, FILE_TYPE_REGULAR };
+
+/* *
+ * A resolved project entry. depth is 0 for the project root, 1 for entries
+ * listed in the root .index and so on. encoding is the one declared for the
+ * entry's directory. stats is only filled in when --stats is used.
+ * */
+struct FileEntry {
+    char *path;
+    enum FileType type;
+    size_t depth;
+    long long size;    // bytes, or -1 if resolving the entry didn't learn it
+    size_t topEntry;   // root .index entries read up to and including it
+    size_t nameOffset; // where path's last component starts
+    int fd;            // opened ahead for collation, or -1; the list closes it
+    enum TextEncoding encoding;
+    struct TextStats stats;
+};
+
+/* *
+ * Growable list of resolved entries in traversal (draft) order. Paths are
+ * copied into the list's arena, so a list that is reset and refilled stops
+ * allocating once it has held its largest batch.
+ * */
+struct FileList {
+    struct FileEntry *entries;
+    size_t count;
+    size_t capacity;
+    struct Arena paths;
+};
+
+/* *
+ * A run of consecutive entries in a list, handed to a batch handler.
+ * */
+struct FileSpan {
+    struct FileEntry *entries;
+    size_t count;
+};
+
+/* *
+ * Appends a copy of path to the list.
+ *
+ * @param   list   List to append to
+ * @param   path   Resolved path of the entry
+ * @param   type   Directory or regular file
+ * @param   depth  Nesting level below the project root
+ *
+ * @return  int
+ *          0      on success
+ *         -1      if memory could not be allocated
+ * */
+int appendFileEntry(struct FileList *list,
+                    const char *path,
+                    enum FileType type,
+                    size_t depth);
+
+/* *
+ * Empties the list but keeps its memory for the entries appended next.
+ * Pointers to the old entries and their paths are no longer valid.
+ *
+ * @param  list  List to reset
+ * */
+void resetFileList(struct FileList *list);
+
+/* *
+ * Frees every entry and resets the list to empty.
+ *
+ * @param  list  List to free
+ * */
+void freeFileList(struct FileList *list);
+
+#endif
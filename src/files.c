@@ -1,15 +1,19 @@
 #include "constants.h"
+#include "encoding.h"
 #include "errors.h"
 #include "files.h"
 #include "reporting.h"
 #include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 static const char *SUPPORTED_FILE_EXTENSIONS[] = {
     ".md",
@@ -121,15 +125,224 @@ resolveFile(char *buffer, size_t buffSize, const char *path) {
     return RESOLVE_NOT_FOUND;
 }
 
+enum ResolveStatus resolveBuilderPath(struct PathBuilder *builder,
+                                      long long *size) {
+    *size = -1;
+    if (builder->len == 0) {
+        return RESOLVE_ERROR;
+    }
+
+    struct stat statBuf;
+    if (lstat(builder->path, &statBuf) == 0) {
+        if (S_ISLNK(statBuf.st_mode)) {
+            return RESOLVE_LINK;
+        }
+        if (S_ISDIR(statBuf.st_mode)) {
+            return RESOLVE_DIR;
+        }
+        if (S_ISREG(statBuf.st_mode)) {
+            *size = (long long)statBuf.st_size;
+            return RESOLVE_EXACT;
+        }
+
+        return RESOLVE_ERROR;
+    }
+
+    const char **extensions = getSupportedExtensions();
+    while (*extensions != NULL) {
+        if (pathBuilderPushExtension(builder, *extensions) != 0) {
+            return RESOLVE_ERROR;
+        }
+
+        if (lstat(builder->path, &statBuf) == 0) {
+            if (S_ISLNK(statBuf.st_mode)) {
+                return RESOLVE_LINK;
+            }
+
+            if (S_ISREG(statBuf.st_mode)) {
+                *size = (long long)statBuf.st_size;
+                return RESOLVE_FILE; // found with the extension left pushed
+            }
+        }
+
+        pathBuilderPop(builder);
+        extensions++;
+    }
+
+    return RESOLVE_NOT_FOUND;
+}
+
+void setReadFailure(struct ReadFailure *failure,
+                    enum ProcessErrorDetail detail,
+                    int savedErrno) {
+    failure->failed = true;
+    failure->detail = detail;
+    failure->savedErrno = savedErrno;
+}
+
+enum ProcessErrorDetail openErrorDetail(int error) {
+    switch (error) {
+    case ELOOP:
+        return PROC_ERR_INVALID_LINK;
+    case EACCES:
+        return PROC_ERR_ACCESS_DENIED;
+    case ENOENT:
+        return PROC_ERR_FILE_NOT_FOUND;
+    default:
+        return PROC_ERR_OPEN_FILE;
+    }
+}
+
+int openProjectFile(const char *path, int flags, struct ReadFailure *failure) {
+    errno = 0;
+    int fd = open(path, O_RDONLY | O_NONBLOCK | flags);
+    if (fd < 0) {
+        setReadFailure(failure, openErrorDetail(errno), errno);
+    }
+    return fd;
+}
+
+/* *
+ * Replaces a file read whole with its UTF-8 conversion. raw is freed either
+ * way.
+ * */
+static unsigned char *transcodeWholeFile(unsigned char *raw,
+                                         size_t *size,
+                                         enum TextEncoding encoding,
+                                         struct ReadFailure *failure) {
+    struct Transcoder transcoder;
+    transcoderInit(&transcoder);
+    transcoderReset(&transcoder, encoding);
+
+    unsigned char *buffer = NULL;
+    const unsigned char *text;
+    size_t textLen;
+    if (transcoderUpdate(&transcoder, raw, *size, &text, &textLen) == 0) {
+        const unsigned char *tail;
+        size_t tailLen;
+        transcoderFinish(&transcoder, &tail, &tailLen);
+        buffer = malloc(textLen + tailLen + 1);
+        if (buffer) {
+            memcpy(buffer, text, textLen);
+            memcpy(buffer + textLen, tail, tailLen);
+            *size = textLen + tailLen;
+        }
+    }
+    transcoderFree(&transcoder);
+    free(raw);
+
+    if (!buffer) {
+        setReadFailure(failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+    }
+    return buffer;
+}
+
+unsigned char *readWholeFile(const char *path,
+                             enum TextEncoding encoding,
+                             size_t *size,
+                             struct stat *info,
+                             struct ReadFailure *failure) {
+    int fd = openProjectFile(path, O_NOFOLLOW, failure);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat status;
+    if (!info) {
+        info = &status;
+    }
+    size_t capacity = 4096;
+    if (fstat(fd, info) != 0) {
+        setReadFailure(failure, openErrorDetail(errno), errno);
+        close(fd);
+        return NULL;
+    }
+    if (info->st_size > 0 && (uintmax_t)info->st_size < SIZE_MAX) {
+        capacity = (size_t)info->st_size + 1; // +1 sees EOF without regrowing
+    }
+
+    unsigned char *buffer = malloc(capacity);
+    size_t used = 0;
+    while (buffer) {
+        if (used == capacity) {
+            unsigned char *grown =
+                capacity <= SIZE_MAX / 2 ? realloc(buffer, capacity * 2) : NULL;
+            if (!grown) {
+                free(buffer);
+                buffer = NULL;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+
+        ssize_t bytesRead = read(fd, buffer + used, capacity - used);
+        if (bytesRead == 0) {
+            break;
+        }
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            setReadFailure(failure, PROC_ERR_OPEN_FILE, errno);
+            failure->readFailed = true;
+            free(buffer);
+            close(fd);
+            return NULL;
+        }
+        used += (size_t)bytesRead;
+    }
+    close(fd);
+
+    if (!buffer) {
+        setReadFailure(failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+        return NULL;
+    }
+
+    *size = used;
+    // collation picks the encoding from its first block, so this does too
+    enum TextEncoding source = detectEncoding(
+        encoding,
+        buffer,
+        used < COLETTE_FILE_BUF_SIZE ? used : COLETTE_FILE_BUF_SIZE);
+    if (source != ENCODING_UTF8) {
+        return transcodeWholeFile(buffer, size, source, failure);
+    }
+    return buffer;
+}
+
+bool reportReadFailure(const struct ReadFailure *failure,
+                       enum ProcessOperation op,
+                       const char *path) {
+    if (!failure->failed) {
+        return false;
+    }
+    errno = failure->savedErrno;
+    if (failure->readFailed) {
+        reportFileError(FILE_OP_READ, path);
+    } else {
+        reportProcessError(op, path, failure->detail);
+    }
+    return true;
+}
+
+const char *relativePath(const char *path, const char *rootDir) {
+    size_t rootLen = strlen(rootDir);
+    if (strncmp(path, rootDir, rootLen) == 0 && path[rootLen] == '/') {
+        return path + rootLen + 1;
+    }
+    return path;
+}
+
 int getBasename(char *buffer, const char *path, size_t size) {
     if (!buffer || !path || size == 0) {
         return -1;
     }
 
+    // basename may modify its argument
     size_t len = strlen(path) + 1;
-    char *pathCopy = malloc(len);
-    if (!pathCopy) {
-        reportFileError(FILE_OP_ACCESS, path); // memory error accessing path
+    char pathCopy[COLETTE_PATH_BUF_SIZE];
+    if (len > sizeof(pathCopy)) {
         return -1;
     }
     memcpy(pathCopy, path, len);
@@ -137,12 +350,10 @@ int getBasename(char *buffer, const char *path, size_t size) {
     char *base = basename(pathCopy);
     size_t baseLen = strlen(base) + 1;
     if (baseLen > size) {
-        free(pathCopy);
         return -1;
     }
     memcpy(buffer, base, baseLen);
 
-    free(pathCopy);
     return 0;
 }
 
@@ -264,3 +475,58 @@ int joinExtension(char *buffer,
 
     return 0;
 }
+
+static int writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+int appendFileContents(int outFd, int inFd, size_t length) {
+    off_t inOffset = 0;
+    size_t remaining = length;
+    while (remaining > 0) {
+        ssize_t copied =
+            copy_file_range(inFd, &inOffset, outFd, NULL, remaining, 0);
+        if (copied > 0) {
+            remaining -= (size_t)copied;
+            continue;
+        }
+        if (copied == 0) {
+            return -1; // the source is shorter than it was
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+            errno == EOPNOTSUPP) {
+            break; // not something the kernel can copy, do it by hand
+        }
+        return -1;
+    }
+
+    char buffer[COLETTE_FILE_BUF_SIZE];
+    while (remaining > 0) {
+        size_t chunk = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+        ssize_t bytesRead = pread(inFd, buffer, chunk, inOffset);
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0 || writeAll(outFd, buffer, (size_t)bytesRead) != 0) {
+            return -1;
+        }
+        inOffset += bytesRead;
+        remaining -= (size_t)bytesRead;
+    }
+
+    return 0;
+}
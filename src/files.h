@@ -1,7 +1,9 @@
 #ifndef FILES_H
 #define FILES_H
 
+#include "encoding.h"
 #include "errors.h"
+#include "pathbuilder.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <sys/stat.h>
@@ -66,6 +68,107 @@ bool isReg(const char *path);
  * */
 enum ResolveStatus resolveFile(char *buffer, size_t buffSize, const char *path);
 
+/* *
+ * resolveFile() for the path in a builder, resolved in place. When a
+ * supported extension had to be added to find the file, it is left pushed on
+ * the builder; otherwise the path is unchanged.
+ *
+ * @param   builder  Builder holding the path to resolve
+ * @param   size     Receives a regular file's size from the lstat() that
+ *                   found it, or -1
+ *
+ * @return  ResolveStatus  as for resolveFile()
+ * */
+enum ResolveStatus resolveBuilderPath(struct PathBuilder *builder,
+                                      long long *size);
+
+/* *
+ * Why a project file couldn't be read. Workers fill one in per file, and the
+ * calling thread reports it with reportReadFailure() once they are done.
+ * */
+struct ReadFailure {
+    bool failed;
+    bool readFailed; // opened but reading failed part way
+    enum ProcessErrorDetail detail;
+    int savedErrno;
+};
+
+/* *
+ * @param  failure     Failure to record
+ * @param  detail      What went wrong
+ * @param  savedErrno  errno to report with it
+ * */
+void setReadFailure(struct ReadFailure *failure,
+                    enum ProcessErrorDetail detail,
+                    int savedErrno);
+
+/* *
+ * @param   error  errno left by a failed open()
+ *
+ * @return  ProcessErrorDetail  describing why the file couldn't be opened
+ * */
+enum ProcessErrorDetail openErrorDetail(int error);
+
+/* *
+ * Opens a project file for reading the way every worker does: O_NONBLOCK
+ * keeps a FIFO from stalling the worker, and callers pass O_NOFOLLOW to
+ * catch a file swapped for a link after resolution.
+ *
+ * @param   path     File to open
+ * @param   flags    Flags added to O_RDONLY | O_NONBLOCK
+ * @param   failure  Records why the file couldn't be opened
+ *
+ * @return  int
+ *          file descriptor  on success
+ *         -1                on failure
+ * */
+int openProjectFile(const char *path, int flags, struct ReadFailure *failure);
+
+/* *
+ * Reads a whole project file into a heap buffer. Scenes are small, and
+ * holding a file at once lets a match, word or sentence run past what would
+ * otherwise be a read boundary. A file in another encoding is converted to
+ * UTF-8 as collation converts it, so positions in the text are positions in
+ * the draft.
+ *
+ * @param   path      File to read, opened with O_NOFOLLOW
+ * @param   encoding  Encoding declared for the file's directory
+ * @param   size      Receives the number of bytes of UTF-8 text
+ * @param   info      Receives the open file's status, may be NULL
+ * @param   failure   Records why the file couldn't be read
+ *
+ * @return  unsigned char *  buffer the caller frees, or NULL on failure
+ * */
+unsigned char *readWholeFile(const char *path,
+                             enum TextEncoding encoding,
+                             size_t *size,
+                             struct stat *info,
+                             struct ReadFailure *failure);
+
+/* *
+ * Reports a recorded failure, if there is one.
+ *
+ * @param   failure  Failure recorded by a worker
+ * @param   op       Operation the file was read for
+ * @param   path     File the failure belongs to
+ *
+ * @return  bool
+ *          true     if a failure was reported
+ *          false    if the file was read
+ * */
+bool reportReadFailure(const struct ReadFailure *failure,
+                       enum ProcessOperation op,
+                       const char *path);
+
+/* *
+ * @param   path     Path under rootDir
+ * @param   rootDir  Project root
+ *
+ * @return  const char *  path without the root and its slash, pointing into
+ *                        path, or path itself if it isn't under rootDir
+ * */
+const char *relativePath(const char *path, const char *rootDir);
+
 /* *
  * Wrapper around POSIX basename() with added buffer safety. Extracts the
  * basename (filename) from a path string. Handles trailing slashes.
@@ -132,4 +235,19 @@ int joinExtension(char *buffer,
                   size_t buffSize,
                   const char *file,
                   const char *ext);
+
+/* *
+ * Appends the first length bytes of one open file to another with
+ * copy_file_range(), which shares extents on file systems that support it,
+ * and falls back to reading and writing where the kernel can't copy.
+ *
+ * @param   outFd   File to append to, at its current offset
+ * @param   inFd    File to copy from its start
+ * @param   length  Number of bytes to copy
+ *
+ * @return  int
+ *          0       on success
+ *         -1       if reading or writing failed
+ * */
+int appendFileContents(int outFd, int inFd, size_t length);
 #endif /* FILES_H */
@@ -0,0 +1,381 @@
+#include "filter.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const unsigned char UTF8_BOM[3] = {0xEF, 0xBB, 0xBF};
+
+struct FilterName {
+    const char *name;
+    unsigned int flags;
+};
+
+static const struct FilterName FILTER_NAMES[] = {
+    {"crlf", FILTER_CRLF},
+    {"bom", FILTER_BOM},
+    {"trim", FILTER_TRIM},
+    {"blank-lines", FILTER_BLANK_LINES},
+    {"smart-quotes", FILTER_SMART_QUOTES},
+    {"all",
+     FILTER_CRLF | FILTER_BOM | FILTER_TRIM | FILTER_BLANK_LINES |
+         FILTER_SMART_QUOTES},
+};
+
+int parseFilterNames(const char *names, unsigned int *flags) {
+    if (!names || !flags || names[0] == '\0') {
+        return -1;
+    }
+
+    unsigned int parsed = FILTER_NONE;
+    const char *cursor = names;
+    for (;;) {
+        size_t nameLen = strcspn(cursor, ",");
+        bool found = false;
+        for (size_t i = 0; i < sizeof(FILTER_NAMES) / sizeof(FILTER_NAMES[0]);
+             i++) {
+            if (strlen(FILTER_NAMES[i].name) == nameLen &&
+                strncmp(FILTER_NAMES[i].name, cursor, nameLen) == 0) {
+                parsed |= FILTER_NAMES[i].flags;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return -1;
+        }
+
+        if (cursor[nameLen] == '\0') {
+            break;
+        }
+        cursor += nameLen + 1;
+    }
+
+    *flags = parsed;
+    return 0;
+}
+
+static void addSpecial(struct TextFilter *filter, unsigned char byte) {
+    if (!filter->isSpecial[byte]) {
+        filter->isSpecial[byte] = true;
+        filter->special[filter->specialCount] = byte;
+        filter->specialCount++;
+    }
+}
+
+void filterInit(struct TextFilter *filter, unsigned int flags) {
+    memset(filter, 0, sizeof(*filter));
+    filter->flags = flags;
+
+    if (flags & (FILTER_TRIM | FILTER_BLANK_LINES)) {
+        addSpecial(filter, '\n');
+    }
+    if (flags & FILTER_CRLF) {
+        addSpecial(filter, '\r');
+    }
+    if (flags & FILTER_SMART_QUOTES) {
+        addSpecial(filter, '"');
+        addSpecial(filter, '\'');
+    }
+
+    filterReset(filter);
+}
+
+bool filterActive(const struct TextFilter *filter) {
+    return filter && filter->flags != FILTER_NONE;
+}
+
+void filterReset(struct TextFilter *filter) {
+    filter->heldLen = 0;
+    filter->bomMatched = (filter->flags & FILTER_BOM) ? 0 : -1;
+    filter->pendingCR = false;
+    filter->lineLen = 0;
+    filter->blankRun = 0;
+    filter->prev = 0;
+}
+
+void filterFree(struct TextFilter *filter) {
+    if (!filter) {
+        return;
+    }
+
+    free(filter->out);
+    free(filter->held);
+    filter->out = NULL;
+    filter->held = NULL;
+    filter->outCapacity = 0;
+    filter->heldCapacity = 0;
+    filter->heldLen = 0;
+}
+
+static int reserve(unsigned char **buffer, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+
+    unsigned char *grown = realloc(*buffer, needed);
+    if (!grown) {
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = needed;
+
+    return 0;
+}
+
+/* *
+ * Length of the leading run of bytes that pass through unchanged. This is
+ * almost all of the input, so the scan compares 16 bytes at a time against
+ * every special byte where SSE2 is available.
+ * */
+static size_t plainRunLength(const struct TextFilter *filter,
+                             const unsigned char *bytes,
+                             size_t len) {
+    if (filter->specialCount == 0) {
+        return len;
+    }
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128i targets[4];
+    for (size_t s = 0; s < filter->specialCount; s++) {
+        targets[s] = _mm_set1_epi8((char)filter->special[s]);
+    }
+    while (len - i >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+        __m128i hits = _mm_cmpeq_epi8(chunk, targets[0]);
+        for (size_t s = 1; s < filter->specialCount; s++) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, targets[s]));
+        }
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned int)mask);
+        }
+        i += 16;
+    }
+#endif
+    while (i < len && !filter->isSpecial[bytes[i]]) {
+        i++;
+    }
+
+    return i;
+}
+
+static bool isBlank(unsigned char byte) {
+    return byte == ' ' || byte == '\t';
+}
+
+/* *
+ * A quote opens when it follows the start of a line, whitespace, an opening
+ * bracket, a dash or another opening quote; otherwise it closes. Opening
+ * quotes end in 0x9C/0x98 and an em dash ends in 0x94 once encoded.
+ * */
+static bool opensQuote(unsigned char prev) {
+    switch (prev) {
+    case 0:
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+    case '(':
+    case '[':
+    case '{':
+    case '-':
+    case 0x9C:
+    case 0x98:
+    case 0x94:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static size_t emitQuote(struct TextFilter *filter,
+                        unsigned char *out,
+                        unsigned char quote) {
+    unsigned char last;
+    if (quote == '"') {
+        last = opensQuote(filter->prev) ? 0x9C : 0x9D; // “ or ”
+    } else {
+        last = opensQuote(filter->prev) ? 0x98 : 0x99; // ‘ or ’
+    }
+    out[0] = 0xE2;
+    out[1] = 0x80;
+    out[2] = last;
+    filter->prev = last;
+    filter->lineLen += 3;
+
+    return 3;
+}
+
+static size_t endLine(struct TextFilter *filter, unsigned char *out, size_t o) {
+    if (filter->flags & FILTER_TRIM) {
+        while (o > 0 && filter->lineLen > 0 && isBlank(out[o - 1])) {
+            o--;
+            filter->lineLen--;
+        }
+    }
+
+    if (filter->lineLen == 0) {
+        filter->blankRun++;
+        if ((filter->flags & FILTER_BLANK_LINES) && filter->blankRun > 1) {
+            return o; // already emitted one blank line in this run
+        }
+    } else {
+        filter->blankRun = 0;
+    }
+
+    out[o++] = '\n';
+    filter->lineLen = 0;
+    filter->prev = '\n';
+
+    return o;
+}
+
+int filterUpdate(struct TextFilter *filter,
+                 const void *data,
+                 size_t len,
+                 const unsigned char **out,
+                 size_t *outLen) {
+    const unsigned char *bytes = data;
+
+    // quotes triple in size; held whitespace, a CR and a BOM prefix come first
+    if (len > (SIZE_MAX - filter->heldLen - 8) / 3 ||
+        reserve(&filter->out,
+                &filter->outCapacity,
+                filter->heldLen + len * 3 + 8) != 0) {
+        return -1;
+    }
+    unsigned char *buffer = filter->out;
+    size_t o = 0;
+    size_t i = 0;
+
+    if (filter->heldLen > 0) {
+        memcpy(buffer, filter->held, filter->heldLen);
+        o += filter->heldLen;
+        filter->heldLen = 0;
+    }
+
+    while (filter->bomMatched >= 0 && i < len) {
+        if (bytes[i] != UTF8_BOM[filter->bomMatched]) {
+            // not a BOM after all, the bytes matched so far are content
+            memcpy(buffer + o, UTF8_BOM, (size_t)filter->bomMatched);
+            o += (size_t)filter->bomMatched;
+            filter->lineLen += (size_t)filter->bomMatched;
+            if (filter->bomMatched > 0) {
+                filter->prev = UTF8_BOM[filter->bomMatched - 1];
+            }
+            filter->bomMatched = -1;
+            break;
+        }
+        filter->bomMatched++;
+        i++;
+        if (filter->bomMatched == 3) {
+            filter->bomMatched = -1;
+        }
+    }
+
+    if (filter->pendingCR && i < len) {
+        filter->pendingCR = false;
+        if (bytes[i] != '\n') {
+            buffer[o++] = '\r'; // a lone CR is kept as-is
+            filter->lineLen++;
+            filter->prev = '\r';
+        }
+    }
+
+    while (i < len) {
+        size_t run = plainRunLength(filter, bytes + i, len - i);
+        if (run > 0) {
+            memcpy(buffer + o, bytes + i, run);
+            o += run;
+            i += run;
+            filter->lineLen += run;
+            filter->prev = bytes[i - 1];
+            continue;
+        }
+
+        unsigned char c = bytes[i++];
+        switch (c) {
+        case '\r':
+            if (i == len) {
+                filter->pendingCR = true;
+            } else if (bytes[i] != '\n') {
+                buffer[o++] = '\r';
+                filter->lineLen++;
+                filter->prev = '\r';
+            }
+            break;
+        case '\n':
+            o = endLine(filter, buffer, o);
+            break;
+        case '"':
+        case '\'':
+            o += emitQuote(filter, buffer + o, c);
+            break;
+        default:
+            buffer[o++] = c; // special only for a filter that isn't enabled
+            filter->lineLen++;
+            filter->prev = c;
+        }
+    }
+
+    // whitespace at the end of the chunk is trailing if the next chunk starts
+    // with a line ending, so hold it back until then
+    if (filter->flags & FILTER_TRIM) {
+        size_t blanks = 0;
+        while (blanks < o && blanks < filter->lineLen &&
+               isBlank(buffer[o - blanks - 1])) {
+            blanks++;
+        }
+        if (blanks > 0) {
+            if (reserve(&filter->held, &filter->heldCapacity, blanks) != 0) {
+                return -1;
+            }
+            memcpy(filter->held, buffer + o - blanks, blanks);
+            filter->heldLen = blanks;
+            o -= blanks;
+        }
+    }
+
+    *out = buffer;
+    *outLen = o;
+
+    return 0;
+}
+
+int filterFinish(struct TextFilter *filter,
+                 const unsigned char **out,
+                 size_t *outLen) {
+    if (reserve(&filter->out, &filter->outCapacity, filter->heldLen + 8) != 0) {
+        return -1;
+    }
+    unsigned char *buffer = filter->out;
+    size_t o = 0;
+
+    // file shorter than a BOM that started like one
+    if (filter->bomMatched > 0) {
+        memcpy(buffer, UTF8_BOM, (size_t)filter->bomMatched);
+        o += (size_t)filter->bomMatched;
+    }
+    filter->bomMatched = -1;
+
+    // whitespace held at end of file is trailing unless a lone CR follows it
+    if (filter->pendingCR) {
+        if (filter->heldLen > 0) {
+            memcpy(buffer + o, filter->held, filter->heldLen);
+        }
+        o += filter->heldLen;
+        buffer[o++] = '\r';
+        filter->pendingCR = false;
+    }
+    filter->heldLen = 0;
+
+    *out = buffer;
+    *outLen = o;
+
+    return 0;
+}
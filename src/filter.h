@@ -0,0 +1,122 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *
+ * Text transforms that can be applied while collating. Any combination may be
+ * enabled; all of them run in a single pass over each buffer.
+ * */
+enum TextFilterFlag {
+    FILTER_NONE = 0,
+    FILTER_CRLF = 1 << 0,         // CRLF line endings become LF
+    FILTER_BOM = 1 << 1,          // UTF-8 byte order mark removed
+    FILTER_TRIM = 1 << 2,         // spaces and tabs before line ends removed
+    FILTER_BLANK_LINES = 1 << 3,  // runs of blank lines collapsed to one
+    FILTER_SMART_QUOTES = 1 << 4, // straight quotes become curly quotes
+};
+
+/* *
+ * Streaming state for one enabled set of filters. Per-file state (start of
+ * file, partial line endings, trailing whitespace not yet known to be
+ * trailing) is carried between chunks so files can be fed in any chunk size.
+ * */
+struct TextFilter {
+    unsigned int flags;
+    bool isSpecial[256];          // bytes that stop the plain-copy scan
+    unsigned char special[4];     // same bytes, for the vector scan
+    size_t specialCount;
+    unsigned char *out;           // output of the last update or finish
+    size_t outCapacity;
+    unsigned char *held;          // whitespace that may still turn out trailing
+    size_t heldLen;
+    size_t heldCapacity;
+    int bomMatched;               // BOM bytes seen at file start, -1 once past
+    bool pendingCR;               // chunk ended on CR, waiting to see LF
+    size_t lineLen;               // bytes emitted on the current line
+    size_t blankRun;              // consecutive blank lines emitted
+    unsigned char prev;           // last byte emitted, 0 at start of file
+};
+
+/* *
+ * Parses a comma separated list of filter names (crlf, bom, trim, blank-lines,
+ * smart-quotes, all).
+ *
+ * @param   names  List of filter names
+ * @param   flags  Receives the combined TextFilterFlag bits
+ *
+ * @return  int
+ *          0      on success
+ *         -1      if a name is not recognised
+ * */
+int parseFilterNames(const char *names, unsigned int *flags);
+
+/* *
+ * Prepares a filter for the given flags. With no flags nothing is allocated
+ * and filterActive() returns false so callers can keep a raw copy path.
+ *
+ * @param   filter  Filter to initialize
+ * @param   flags   Combination of TextFilterFlag bits
+ * */
+void filterInit(struct TextFilter *filter, unsigned int flags);
+
+/* *
+ * @param   filter  Filter to query
+ *
+ * @return  bool    true if any transform is enabled
+ * */
+bool filterActive(const struct TextFilter *filter);
+
+/* *
+ * Resets per-file state. Call before the first chunk of every file.
+ *
+ * @param  filter  Filter to reset
+ * */
+void filterReset(struct TextFilter *filter);
+
+/* *
+ * Transforms the next chunk of the current file. The output points into the
+ * filter and stays valid until the next call. Some bytes may be held back
+ * until the following chunk shows whether they are trailing whitespace or
+ * half of a CRLF.
+ *
+ * @param   filter  Filter state
+ * @param   data    Next bytes of the file
+ * @param   len     Number of bytes in data
+ * @param   out     Receives a pointer to the transformed bytes
+ * @param   outLen  Receives the number of transformed bytes
+ *
+ * @return  int
+ *          0       on success
+ *         -1       if the output buffer could not be grown
+ * */
+int filterUpdate(struct TextFilter *filter,
+                 const void *data,
+                 size_t len,
+                 const unsigned char **out,
+                 size_t *outLen);
+
+/* *
+ * Flushes anything still held back at the end of the current file.
+ *
+ * @param   filter  Filter state
+ * @param   out     Receives a pointer to the remaining bytes
+ * @param   outLen  Receives the number of remaining bytes
+ *
+ * @return  int
+ *          0       on success
+ *         -1       if the output buffer could not be grown
+ * */
+int filterFinish(struct TextFilter *filter,
+                 const unsigned char **out,
+                 size_t *outLen);
+
+/* *
+ * Frees buffers owned by the filter.
+ *
+ * @param  filter  Filter to free
+ * */
+void filterFree(struct TextFilter *filter);
+
+#endif
@@ -0,0 +1,322 @@
+#include "constants.h"
+#include "frontmatter.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned char UTF8_BOM[3] = {0xEF, 0xBB, 0xBF};
+
+void frontMatterInit(struct FrontMatter *frontMatter) {
+    memset(frontMatter, 0, sizeof(*frontMatter));
+    frontMatter->state = FRONT_MATTER_START;
+}
+
+void freeMetaFields(struct MetaField *fields, size_t count) {
+    if (!fields) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        free(fields[i].key);
+        free(fields[i].value);
+    }
+    free(fields);
+}
+
+void frontMatterReset(struct FrontMatter *frontMatter) {
+    freeMetaFields(frontMatter->fields, frontMatter->fieldCount);
+    frontMatter->fields = NULL;
+    frontMatter->fieldCount = 0;
+    frontMatter->fieldCapacity = 0;
+    frontMatter->state = FRONT_MATTER_START;
+    frontMatter->blockLen = 0;
+    frontMatter->contentStart = 0;
+    frontMatter->lineStart = 0;
+}
+
+void frontMatterFree(struct FrontMatter *frontMatter) {
+    if (!frontMatter) {
+        return;
+    }
+
+    frontMatterReset(frontMatter);
+    free(frontMatter->block);
+    free(frontMatter->out);
+    frontMatter->block = NULL;
+    frontMatter->out = NULL;
+    frontMatter->blockCapacity = 0;
+    frontMatter->outCapacity = 0;
+}
+
+struct MetaField *frontMatterTakeFields(struct FrontMatter *frontMatter,
+                                        size_t *count) {
+    struct MetaField *fields = frontMatter->fields;
+    *count = frontMatter->fieldCount;
+    frontMatter->fields = NULL;
+    frontMatter->fieldCount = 0;
+    frontMatter->fieldCapacity = 0;
+
+    return fields;
+}
+
+static int reserve(unsigned char **buffer, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+
+    size_t newCapacity = *capacity ? *capacity : 1024;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    unsigned char *grown = realloc(*buffer, newCapacity);
+    if (!grown) {
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = newCapacity;
+
+    return 0;
+}
+
+/* *
+ * True while the first line read so far could still be "---", optionally
+ * behind a BOM and followed by CR. complete is set once the whole fence,
+ * including its LF, has been seen.
+ * */
+static bool matchesOpeningFence(const unsigned char *line,
+                                size_t len,
+                                bool *complete) {
+    size_t i = 0;
+    *complete = false;
+
+    if (len > 0 && line[0] == UTF8_BOM[0]) {
+        for (size_t b = 0; b < sizeof(UTF8_BOM); b++, i++) {
+            if (i == len) {
+                return true;
+            }
+            if (line[i] != UTF8_BOM[b]) {
+                return false;
+            }
+        }
+    }
+    for (int dash = 0; dash < 3; dash++, i++) {
+        if (i == len) {
+            return true;
+        }
+        if (line[i] != '-') {
+            return false;
+        }
+    }
+    if (i < len && line[i] == '\r') {
+        i++;
+    }
+    if (i == len) {
+        return true;
+    }
+    if (line[i] != '\n' || i + 1 != len) {
+        return false;
+    }
+
+    *complete = true;
+    return true;
+}
+
+static bool isClosingFence(const unsigned char *line, size_t len) {
+    // len includes the LF
+    if (len >= 2 && line[len - 2] == '\r') {
+        len--;
+    }
+    return len == 4 && (memcmp(line, "---", 3) == 0 || memcmp(line, "...", 3) == 0);
+}
+
+static char *copyTrimmed(const unsigned char *start, const unsigned char *end) {
+    while (start < end && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        end--;
+    }
+    // "quoted" and 'quoted' scalars lose their quotes
+    if (end - start >= 2 && (*start == '"' || *start == '\'') &&
+        end[-1] == *start) {
+        start++;
+        end--;
+    }
+
+    size_t len = (size_t)(end - start);
+    char *copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, start, len);
+        copy[len] = '\0';
+    }
+
+    return copy;
+}
+
+static int addField(struct FrontMatter *frontMatter,
+                    const unsigned char *line,
+                    size_t len) {
+    if (len == 0 || line[0] == ' ' || line[0] == '\t' || line[0] == '#' ||
+        line[0] == '-' || line[0] == '\r' || line[0] == '\n') {
+        return 0; // blank, nested, comment or list item
+    }
+    const unsigned char *colon = memchr(line, ':', len);
+    if (!colon || colon == line) {
+        return 0;
+    }
+
+    if (frontMatter->fieldCount == frontMatter->fieldCapacity) {
+        size_t newCapacity =
+            frontMatter->fieldCapacity ? frontMatter->fieldCapacity * 2 : 8;
+        struct MetaField *grown =
+            realloc(frontMatter->fields, newCapacity * sizeof(struct MetaField));
+        if (!grown) {
+            return -1;
+        }
+        frontMatter->fields = grown;
+        frontMatter->fieldCapacity = newCapacity;
+    }
+
+    struct MetaField field = {.key = copyTrimmed(line, colon),
+                              .value = copyTrimmed(colon + 1, line + len)};
+    if (!field.key || !field.value) {
+        free(field.key);
+        free(field.value);
+        return -1;
+    }
+    frontMatter->fields[frontMatter->fieldCount] = field;
+    frontMatter->fieldCount++;
+
+    return 0;
+}
+
+static int parseBlock(struct FrontMatter *frontMatter) {
+    const unsigned char *cursor = frontMatter->block + frontMatter->contentStart;
+    const unsigned char *end = frontMatter->block + frontMatter->lineStart;
+
+    while (cursor < end) {
+        const unsigned char *newline = memchr(cursor, '\n', (size_t)(end - cursor));
+        const unsigned char *lineEnd = newline ? newline : end;
+        if (addField(frontMatter, cursor, (size_t)(lineEnd - cursor)) != 0) {
+            return -1;
+        }
+        cursor = lineEnd + 1;
+    }
+
+    return 0;
+}
+
+/* *
+ * The buffered bytes weren't front matter: emit them followed by the rest of
+ * the chunk. When the buffer holds only bytes from this chunk, the chunk can
+ * be passed through as-is without copying.
+ * */
+static int passThrough(struct FrontMatter *frontMatter,
+                       const unsigned char *data,
+                       size_t len,
+                       size_t consumed,
+                       size_t appended,
+                       const unsigned char **body,
+                       size_t *bodyLen) {
+    frontMatter->state = FRONT_MATTER_BODY;
+
+    if (frontMatter->blockLen == appended) {
+        *body = data;
+        *bodyLen = len;
+        frontMatter->blockLen = 0;
+        return 0;
+    }
+
+    size_t rest = len - consumed;
+    if (reserve(&frontMatter->out,
+                &frontMatter->outCapacity,
+                frontMatter->blockLen + rest) != 0) {
+        return -1;
+    }
+    memcpy(frontMatter->out, frontMatter->block, frontMatter->blockLen);
+    memcpy(frontMatter->out + frontMatter->blockLen, data + consumed, rest);
+    *body = frontMatter->out;
+    *bodyLen = frontMatter->blockLen + rest;
+    frontMatter->blockLen = 0;
+
+    return 0;
+}
+
+int frontMatterUpdate(struct FrontMatter *frontMatter,
+                      const void *data,
+                      size_t len,
+                      const unsigned char **body,
+                      size_t *bodyLen) {
+    const unsigned char *bytes = data;
+    *body = bytes;
+    *bodyLen = 0;
+
+    if (frontMatter->state == FRONT_MATTER_BODY) {
+        *bodyLen = len;
+        return 0;
+    }
+
+    size_t i = 0;
+    size_t appended = 0;
+    while (i < len) {
+        const unsigned char *newline = memchr(bytes + i, '\n', len - i);
+        size_t take = newline ? (size_t)(newline - (bytes + i)) + 1 : len - i;
+
+        if (frontMatter->blockLen + take > COLETTE_FRONT_MATTER_MAX) {
+            return passThrough(
+                frontMatter, bytes, len, i, appended, body, bodyLen);
+        }
+        if (reserve(&frontMatter->block,
+                    &frontMatter->blockCapacity,
+                    frontMatter->blockLen + take) != 0) {
+            return -1;
+        }
+        memcpy(frontMatter->block + frontMatter->blockLen, bytes + i, take);
+        frontMatter->blockLen += take;
+        appended += take;
+        i += take;
+
+        if (frontMatter->state == FRONT_MATTER_START) {
+            bool complete;
+            if (!matchesOpeningFence(
+                    frontMatter->block, frontMatter->blockLen, &complete)) {
+                return passThrough(
+                    frontMatter, bytes, len, i, appended, body, bodyLen);
+            }
+            if (complete) {
+                frontMatter->state = FRONT_MATTER_BLOCK;
+                frontMatter->contentStart = frontMatter->blockLen;
+                frontMatter->lineStart = frontMatter->blockLen;
+            }
+            continue;
+        }
+
+        if (!newline) {
+            continue; // line continues in the next chunk
+        }
+        if (isClosingFence(frontMatter->block + frontMatter->lineStart,
+                           frontMatter->blockLen - frontMatter->lineStart)) {
+            if (parseBlock(frontMatter) != 0) {
+                return -1;
+            }
+            frontMatter->state = FRONT_MATTER_BODY;
+            frontMatter->blockLen = 0;
+            *body = bytes + i;
+            *bodyLen = len - i;
+            return 0;
+        }
+        frontMatter->lineStart = frontMatter->blockLen;
+    }
+
+    return 0;
+}
+
+void frontMatterFinish(struct FrontMatter *frontMatter,
+                       const unsigned char **body,
+                       size_t *bodyLen) {
+    // an unterminated block is ordinary text
+    *body = frontMatter->block;
+    *bodyLen = frontMatter->state == FRONT_MATTER_BODY ? 0 : frontMatter->blockLen;
+    frontMatter->state = FRONT_MATTER_BODY;
+    frontMatter->blockLen = 0;
+}
@@ -0,0 +1,117 @@
+#ifndef FRONTMATTER_H
+#define FRONTMATTER_H
+
+#include <stddef.h>
+
+enum FrontMatterState {
+    FRONT_MATTER_START, // reading the first line, may be an opening fence
+    FRONT_MATTER_BLOCK, // inside a front matter block
+    FRONT_MATTER_BODY,  // past the front matter, or there was none
+};
+
+/* *
+ * A top-level key/value pair from a front matter block. Both strings are owned
+ * by whoever holds the field.
+ * */
+struct MetaField {
+    char *key;
+    char *value;
+};
+
+/* *
+ * Streaming YAML front matter splitter. A file whose first line is "---"
+ * (after an optional BOM) starts a block that ends at the next "---" or "..."
+ * line. The block is buffered, up to COLETTE_FRONT_MATTER_MAX bytes, then
+ * parsed into flat key: value fields and dropped from the output; everything
+ * after it is passed straight through from the caller's buffer. A block that
+ * is never closed, or grows past the limit, isn't front matter and is passed
+ * through unchanged.
+ *
+ * Only top-level scalar fields are extracted. Nested maps, lists and comments
+ * are skipped.
+ * */
+struct FrontMatter {
+    enum FrontMatterState state;
+    unsigned char *block; // raw bytes of the block read so far
+    size_t blockLen;
+    size_t blockCapacity;
+    size_t contentStart;  // end of the opening fence line in block
+    size_t lineStart;     // start of the line being read in block
+    unsigned char *out;   // passthrough output when block turns out not to be
+    size_t outCapacity;
+    struct MetaField *fields;
+    size_t fieldCount;
+    size_t fieldCapacity;
+};
+
+/* *
+ * @param  frontMatter  Splitter to initialize, ready for the first file
+ * */
+void frontMatterInit(struct FrontMatter *frontMatter);
+
+/* *
+ * Resets per-file state and frees fields that weren't taken.
+ *
+ * @param  frontMatter  Splitter to reset before the next file
+ * */
+void frontMatterReset(struct FrontMatter *frontMatter);
+
+/* *
+ * Consumes the next chunk of the current file. Body bytes are only produced
+ * once state is FRONT_MATTER_BODY, and by then every field has been parsed,
+ * so callers can decide what to do with the file before writing any of it.
+ *
+ * @param   frontMatter  Splitter state
+ * @param   data         Next bytes of the file
+ * @param   len          Number of bytes in data
+ * @param   body         Receives a pointer to body bytes in this chunk
+ * @param   bodyLen      Receives the number of body bytes
+ *
+ * @return  int
+ *          0            on success
+ *         -1            if memory could not be allocated
+ * */
+int frontMatterUpdate(struct FrontMatter *frontMatter,
+                      const void *data,
+                      size_t len,
+                      const unsigned char **body,
+                      size_t *bodyLen);
+
+/* *
+ * Ends the current file. Anything still buffered was not front matter and is
+ * returned as body.
+ *
+ * @param   frontMatter  Splitter state
+ * @param   body         Receives a pointer to the remaining body bytes
+ * @param   bodyLen      Receives the number of remaining body bytes
+ * */
+void frontMatterFinish(struct FrontMatter *frontMatter,
+                       const unsigned char **body,
+                       size_t *bodyLen);
+
+/* *
+ * Hands the parsed fields to the caller, who must free them with
+ * freeMetaFields().
+ *
+ * @param   frontMatter  Splitter state
+ * @param   count        Receives the number of fields
+ *
+ * @return  struct MetaField*  fields in file order, NULL if there were none
+ * */
+struct MetaField *frontMatterTakeFields(struct FrontMatter *frontMatter,
+                                        size_t *count);
+
+/* *
+ * @param  fields  Fields to free
+ * @param  count   Number of fields
+ * */
+void freeMetaFields(struct MetaField *fields, size_t count);
+
+/* *
+ * Frees buffers owned by the splitter.
+ *
+ * @param  frontMatter  Splitter to free
+ * */
+void frontMatterFree(struct FrontMatter *frontMatter);
+
+#endif
@@ -0,0 +1,215 @@
+#include "grep.h"
+#include "errors.h"
+#include "files.h"
+#include "literal.h"
+#include "reporting.h"
+#include "workers.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* *
+ * A matching line. text is a copy of the line without its line ending, so the
+ * file buffer can be freed as soon as the file has been scanned.
+ * */
+struct GrepMatch {
+    size_t offset; // byte offset of the first match on the line
+    size_t line;
+    char *text;
+    size_t textLen;
+};
+
+/* *
+ * Outcome of searching one file. Workers only write to their own result, the
+ * calling thread prints results in draft order once every worker is done.
+ * */
+struct GrepResult {
+    struct ReadFailure failure;
+    size_t size;     // bytes in the file
+    size_t newlines; // line feeds in the file
+    struct GrepMatch *matches;
+    size_t matchCount;
+    size_t matchCapacity;
+};
+
+struct GrepJob {
+    const struct FileList *entries;
+    struct LiteralSearch search;
+    struct GrepResult *results;
+};
+
+static size_t countNewlines(const unsigned char *data, size_t len) {
+    size_t count = 0;
+    const unsigned char *end = data + len;
+    while ((data = memchr(data, '\n', (size_t)(end - data))) != NULL) {
+        count++;
+        data++;
+    }
+    return count;
+}
+
+static int addMatch(struct GrepResult *result,
+                    size_t offset,
+                    size_t line,
+                    const unsigned char *text,
+                    size_t textLen) {
+    if (result->matchCount == result->matchCapacity) {
+        size_t newCapacity =
+            result->matchCapacity ? result->matchCapacity * 2 : 16;
+        struct GrepMatch *grown =
+            realloc(result->matches, newCapacity * sizeof(struct GrepMatch));
+        if (!grown) {
+            return -1;
+        }
+        result->matches = grown;
+        result->matchCapacity = newCapacity;
+    }
+
+    char *copy = malloc(textLen + 1);
+    if (!copy) {
+        return -1;
+    }
+    if (textLen > 0) {
+        memcpy(copy, text, textLen);
+    }
+    copy[textLen] = '\0';
+
+    result->matches[result->matchCount] = (struct GrepMatch){
+        .offset = offset, .line = line, .text = copy, .textLen = textLen};
+    result->matchCount++;
+
+    return 0;
+}
+
+static void searchFile(const struct GrepJob *job,
+                       const struct FileEntry *entry,
+                       struct GrepResult *result) {
+    size_t size = 0;
+    unsigned char *data = readWholeFile(
+        entry->path, entry->encoding, &size, NULL, &result->failure);
+    if (!data) {
+        return;
+    }
+
+    // lines are only counted up to each match, not scanned one by one
+    size_t line = 1;
+    size_t counted = 0;
+    size_t lineStart = 0;
+    size_t pos = 0;
+    const unsigned char *hit;
+    while (pos < size &&
+           (hit = literalFind(&job->search, data + pos, size - pos)) != NULL) {
+        size_t offset = (size_t)(hit - data);
+        for (const unsigned char *nl = data + counted;
+             (nl = memchr(nl, '\n', offset - (size_t)(nl - data))) != NULL;
+             nl++) {
+            line++;
+            lineStart = (size_t)(nl - data) + 1;
+        }
+        counted = offset;
+
+        const unsigned char *lineEnd = memchr(hit, '\n', size - offset);
+        size_t lineLen =
+            (lineEnd ? (size_t)(lineEnd - data) : size) - lineStart;
+        size_t textLen = lineLen;
+        if (textLen > 0 && data[lineStart + textLen - 1] == '\r') {
+            textLen--;
+        }
+        if (addMatch(result, offset, line, data + lineStart, textLen) != 0) {
+            setReadFailure(&result->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+            break;
+        }
+
+        // the rest of a matching line adds nothing, resume on the next one
+        pos = lineStart + lineLen;
+    }
+
+    result->size = size;
+    result->newlines =
+        (line - 1) + countNewlines(data + counted, size - counted);
+    free(data);
+}
+
+static void grepEntry(size_t index, void *arg) {
+    struct GrepJob *job = arg;
+    const struct FileEntry *entry = &job->entries->entries[index];
+    if (entry->type == FILE_TYPE_REGULAR) {
+        searchFile(job, entry, &job->results[index]);
+    }
+}
+
+static void freeGrepResult(struct GrepResult *result) {
+    for (size_t m = 0; m < result->matchCount; m++) {
+        free(result->matches[m].text);
+    }
+    free(result->matches);
+}
+
+int searchProjectFiles(const struct FileList *entries,
+                       const char *pattern,
+                       unsigned int jobs,
+                       const char *rootDir,
+                       FILE *out) {
+    if (!entries || !pattern || pattern[0] == '\0') {
+        reportProcessError(
+            PROCESS_OP_HANDLE_GREP, rootDir, PROC_ERR_INVALID_STATE);
+        return -1;
+    }
+
+    struct GrepJob job = {.entries = entries};
+    literalInit(&job.search, pattern, strlen(pattern));
+    job.results = calloc(entries->count ? entries->count : 1,
+                         sizeof(struct GrepResult));
+    if (!job.results) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_GREP, rootDir, PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+
+    runParallel(entries->count, jobs, grepEntry, &job);
+
+    /* *
+     * Collation writes each file followed by a line feed, so a file's place
+     * in the draft is the sum of the sizes and line counts of the files
+     * before it, plus one byte and one line each for the separators.
+     * */
+    int status = 0;
+    uint64_t draftOffset = 0;
+    uint64_t draftLine = 1;
+    for (size_t i = 0; i < entries->count; i++) {
+        struct GrepResult *result = &job.results[i];
+        const char *path = entries->entries[i].path;
+        if (reportReadFailure(&result->failure, PROCESS_OP_HANDLE_GREP, path)) {
+            status = -1;
+        }
+
+        for (size_t m = 0; m < result->matchCount; m++) {
+            const struct GrepMatch *match = &result->matches[m];
+            fprintf(out,
+                    "%s:%zu:%llu:%llu:",
+                    relativePath(path, rootDir),
+                    match->line,
+                    (unsigned long long)(draftLine + match->line - 1),
+                    (unsigned long long)(draftOffset + match->offset));
+            fwrite(match->text, 1, match->textLen, out);
+            fputc('\n', out);
+        }
+
+        if (entries->entries[i].type == FILE_TYPE_REGULAR) {
+            draftOffset += result->size + 1;
+            draftLine += result->newlines + 1;
+        }
+        freeGrepResult(result);
+    }
+    free(job.results);
+
+    errno = 0;
+    if (fflush(out) != 0 || ferror(out)) {
+        reportFileError(FILE_OP_WRITE, "search results");
+        status = -1;
+    }
+
+    return status;
+}
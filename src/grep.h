@@ -0,0 +1,36 @@
+#ifndef GREP_H
+#define GREP_H
+
+#include "filelist.h"
+#include <stdio.h>
+
+/* *
+ * Searches every regular file in a resolved project for a fixed string. Files
+ * are scanned in parallel by up to jobs threads and matching lines are written
+ * to out in draft order, one per line:
+ *
+ *     path:line:draft-line:draft-offset:text
+ *
+ * path is relative to rootDir and line is 1-based within the file. draft-line
+ * and draft-offset (0-based, in bytes) locate the first match on the line in
+ * the draft that plain collation would produce, so a hit can be found in the
+ * draft without building it. Each line is reported once however many times
+ * the pattern occurs on it.
+ *
+ * @param   entries  Resolved entries in traversal order
+ * @param   pattern  String to search for, not empty
+ * @param   jobs     Maximum number of worker threads
+ * @param   rootDir  Project root, stripped from paths
+ * @param   out      Stream the matches are written to
+ *
+ * @return  int
+ *          0        if every file was searched
+ *         -1        if any file could not be read or output failed
+ * */
+int searchProjectFiles(const struct FileList *entries,
+                       const char *pattern,
+                       unsigned int jobs,
+                       const char *rootDir,
+                       FILE *out);
+
+#endif
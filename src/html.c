@@ -0,0 +1,353 @@
+#include "html.h"
+#include "constants.h"
+#include "encoding.h"
+#include "errors.h"
+#include "files.h"
+#include "frontmatter.h"
+#include "markdown.h"
+#include "reporting.h"
+#include "workers.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char DOCUMENT_END[] = "</body>\n</html>\n";
+
+/* *
+ * A rendered file. Workers only write to their own result; the calling thread
+ * writes the HTML out in draft order and frees it before the next window.
+ * */
+struct HtmlResult {
+    struct ReadFailure failure;
+    struct HtmlBuffer html;
+};
+
+struct HtmlJob {
+    const struct FileList *entries;
+    size_t first; // entry rendered into results[0]
+    struct HtmlResult *results;
+};
+
+/* *
+ * Streams one source through the same stages collation uses, transcoding and
+ * front matter, into the renderer. Only a read buffer and the renderer's
+ * current lines are held besides the output.
+ * */
+static void renderFile(const struct FileEntry *entry,
+                       struct HtmlResult *result) {
+    int fd = openProjectFile(entry->path, O_NOFOLLOW, &result->failure);
+    if (fd < 0) {
+        return;
+    }
+
+    struct Transcoder transcoder;
+    struct FrontMatter frontMatter;
+    struct MarkdownRenderer renderer;
+    transcoderInit(&transcoder);
+    frontMatterInit(&frontMatter);
+    markdownInit(&renderer);
+
+    unsigned char buffer[COLETTE_FILE_BUF_SIZE];
+    bool firstBlock = true;
+    bool transcoding = false;
+    bool splitting = true;
+    int status = 0;
+    ssize_t bytesRead;
+    while (status == 0 &&
+           (bytesRead = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            setReadFailure(&result->failure, PROC_ERR_OPEN_FILE, errno);
+            result->failure.readFailed = true;
+            break;
+        }
+
+        const unsigned char *text = buffer;
+        size_t textLen = (size_t)bytesRead;
+        if (firstBlock) {
+            enum TextEncoding encoding =
+                detectEncoding(entry->encoding, buffer, textLen);
+            transcoding = encoding != ENCODING_UTF8;
+            if (transcoding) {
+                transcoderReset(&transcoder, encoding);
+            }
+            firstBlock = false;
+        }
+        if (transcoding &&
+            transcoderUpdate(&transcoder, buffer, textLen, &text, &textLen) !=
+                0) {
+            status = -1;
+            break;
+        }
+
+        if (splitting) {
+            if (frontMatterUpdate(
+                    &frontMatter, text, textLen, &text, &textLen) != 0) {
+                status = -1;
+                break;
+            }
+            if (frontMatter.state != FRONT_MATTER_BODY) {
+                continue;
+            }
+            splitting = false;
+        }
+        status = markdownUpdate(&renderer, text, textLen, &result->html);
+    }
+    close(fd);
+
+    if (status == 0 && !result->failure.failed) {
+        const unsigned char *rest;
+        size_t restLen;
+        if (splitting) {
+            frontMatterFinish(&frontMatter, &rest, &restLen);
+            status = markdownUpdate(&renderer, rest, restLen, &result->html);
+        }
+        if (status == 0 && transcoding) {
+            transcoderFinish(&transcoder, &rest, &restLen);
+            status = markdownUpdate(&renderer, rest, restLen, &result->html);
+        }
+        if (status == 0) {
+            status = markdownFinish(&renderer, &result->html);
+        }
+    }
+    if (status != 0) {
+        setReadFailure(&result->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+    }
+
+    markdownFree(&renderer);
+    frontMatterFree(&frontMatter);
+    transcoderFree(&transcoder);
+}
+
+static void renderEntry(size_t index, void *arg) {
+    struct HtmlJob *job = arg;
+    const struct FileEntry *entry = &job->entries->entries[job->first + index];
+    if (entry->type == FILE_TYPE_REGULAR) {
+        renderFile(entry, &job->results[index]);
+    }
+}
+
+void htmlEntryStem(const struct FileEntry *entry, char *buffer, size_t size) {
+    const char *name = strrchr(entry->path, '/');
+    name = name ? name + 1 : entry->path;
+    size_t len = strlen(name);
+    const char *dot = strrchr(name, '.');
+    if (entry->type == FILE_TYPE_REGULAR && dot && dot != name) {
+        len = (size_t)(dot - name);
+    }
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(buffer, name, len);
+    buffer[len] = '\0';
+}
+
+void htmlDisplayTitle(const char *title, char *buffer, size_t size) {
+    size_t titleLen = strlen(title);
+    size_t start = title[0] == '_' ? 1 : 0;
+    size_t end = titleLen > start && title[titleLen - 1] == '_' ? titleLen - 1
+                                                                : titleLen;
+    size_t len = end - start < size - 1 ? end - start : size - 1;
+    for (size_t i = 0; i < len; i++) {
+        char c = title[start + i];
+        buffer[i] = c == '_' ? ' ' : c;
+    }
+    buffer[len] = '\0';
+}
+
+int renderHtmlEntries(const struct FileList *entries,
+                      unsigned int jobs,
+                      const char *rootDir,
+                      const struct HtmlSink *sink) {
+    // rendered HTML is held for one window of files at a time
+    size_t window = (size_t)jobs * COLETTE_HTML_WINDOW_PER_JOB;
+    struct HtmlJob job = {.entries = entries};
+    job.results = calloc(window, sizeof(struct HtmlResult));
+    if (!job.results) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_HTML, rootDir, PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+
+    int status = 0;
+    bool sinkFailed = false;
+    for (size_t first = 0; !sinkFailed && first < entries->count;
+         first += window) {
+        size_t count = entries->count - first < window ? entries->count - first
+                                                       : window;
+        memset(job.results, 0, count * sizeof(struct HtmlResult));
+        job.first = first;
+        runParallel(count, jobs, renderEntry, &job);
+
+        for (size_t i = 0; i < count; i++) {
+            const struct FileEntry *entry = &entries->entries[first + i];
+            struct HtmlResult *result = &job.results[i];
+
+            // each entry in the root .index starts a chapter
+            if (!sinkFailed && sink->beginChapter && entry->depth == 1 &&
+                sink->beginChapter(sink->arg, entry) != 0) {
+                sinkFailed = true;
+            }
+
+            if (reportReadFailure(
+                    &result->failure, PROCESS_OP_HANDLE_HTML, entry->path)) {
+                status = -1;
+            } else if (!sinkFailed && result->html.len > 0 &&
+                       sink->write(
+                           sink->arg, result->html.data, result->html.len) !=
+                           0) {
+                sinkFailed = true;
+            }
+            freeHtmlBuffer(&result->html);
+        }
+    }
+    free(job.results);
+    return sinkFailed ? -1 : status;
+}
+
+static FILE *openDocument(const char *path, const char *title) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_HTML, path, PROC_ERR_INVALID_OUTPUT);
+        return NULL;
+    }
+
+    struct HtmlBuffer escaped = {0};
+    if (appendEscapedHtml(&escaped, title, strlen(title)) != 0) {
+        reportProcessError(PROCESS_OP_HANDLE_HTML, path, PROC_ERR_MEMORY_ALLOC);
+        fclose(out);
+        return NULL;
+    }
+    fputs("<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>",
+          out);
+    fwrite(escaped.data, 1, escaped.len, out);
+    fputs("</title>\n</head>\n<body>\n", out);
+    freeHtmlBuffer(&escaped);
+    return out;
+}
+
+static int closeDocument(FILE *out, const char *path) {
+    fputs(DOCUMENT_END, out);
+    errno = 0;
+    bool failed = ferror(out) != 0;
+    if (fclose(out) != 0 || failed) {
+        reportFileError(FILE_OP_WRITE, path);
+        return -1;
+    }
+    return 0;
+}
+
+/* *
+ * The document being written: the whole draft, or the current chapter in
+ * outDir.
+ * */
+struct HtmlOutput {
+    const char *outDir;
+    unsigned int padding;
+    unsigned int chapter;
+    char path[COLETTE_PATH_BUF_SIZE];
+    FILE *out;
+};
+
+/* *
+ * Names a chapter's document by its position and stem, the way list output
+ * prefixes its links: 001_prologue.html.
+ * */
+static int beginHtmlChapter(void *arg, const struct FileEntry *entry) {
+    struct HtmlOutput *output = arg;
+    if (output->out) {
+        FILE *out = output->out;
+        output->out = NULL;
+        if (closeDocument(out, output->path) != 0) {
+            return -1;
+        }
+    }
+
+    char stem[COLETTE_NAME_BUF_SIZE];
+    char name[COLETTE_NAME_BUF_SIZE];
+    htmlEntryStem(entry, stem, sizeof(stem));
+    int nameLen = snprintf(name,
+                           sizeof(name),
+                           "%0*u_%s.html",
+                           (int)output->padding,
+                           ++output->chapter,
+                           stem);
+    if (nameLen < 0 || (size_t)nameLen >= sizeof(name)) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_HTML, entry->path, PROC_ERR_NAME_TOO_LONG);
+        return -1;
+    }
+    if (joinPath(output->path, sizeof(output->path), output->outDir, name) !=
+        0) {
+        return -1;
+    }
+
+    output->out = openDocument(output->path, stem);
+    return output->out ? 0 : -1;
+}
+
+static int writeHtml(void *arg, const char *data, size_t len) {
+    struct HtmlOutput *output = arg;
+    if (output->out) {
+        fwrite(data, 1, len, output->out);
+    }
+    return 0;
+}
+
+int renderProjectHtml(const struct FileList *entries,
+                      unsigned int jobs,
+                      const char *rootDir,
+                      const char *title,
+                      unsigned int padding,
+                      bool chapters) {
+    if (!entries || !rootDir || !title) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_HTML, rootDir, PROC_ERR_INVALID_STATE);
+        return -1;
+    }
+
+    // _My_Book_ is shown as My Book
+    char displayTitle[COLETTE_NAME_BUF_SIZE];
+    htmlDisplayTitle(title, displayTitle, sizeof(displayTitle));
+
+    char outPath[COLETTE_PATH_BUF_SIZE];
+    struct HtmlOutput output = {.outDir = outPath, .padding = padding};
+    if (joinPath(outPath, sizeof(outPath), rootDir, title) != 0) {
+        return -1;
+    }
+    if (chapters) {
+        errno = 0;
+        if (mkdir(outPath, 0777) != 0 && errno != EEXIST) {
+            reportProcessError(
+                PROCESS_OP_HANDLE_HTML, outPath, PROC_ERR_INVALID_OUTPUT);
+            return -1;
+        }
+    } else {
+        if (joinExtension(output.path, sizeof(output.path), outPath, ".html") !=
+            0) {
+            return -1;
+        }
+        output.out = openDocument(output.path, displayTitle);
+        if (!output.out) {
+            return -1;
+        }
+    }
+
+    struct HtmlSink sink = {
+        .beginChapter = chapters ? beginHtmlChapter : NULL,
+        .write = writeHtml,
+        .arg = &output,
+    };
+    int status = renderHtmlEntries(entries, jobs, rootDir, &sink);
+    if (output.out && closeDocument(output.out, output.path) != 0) {
+        status = -1;
+    }
+    return status;
+}
@@ -0,0 +1,84 @@
+#ifndef HTML_H
+#define HTML_H
+
+#include "filelist.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *
+ * Where rendered HTML goes. beginChapter, if set, is called before each entry
+ * in the root .index; write gets each rendered file in draft order. Either
+ * returns -1 after reporting a failure, which stops the rendering.
+ * */
+struct HtmlSink {
+    int (*beginChapter)(void *arg, const struct FileEntry *entry);
+    int (*write)(void *arg, const char *data, size_t len);
+    void *arg;
+};
+
+/* *
+ * Renders every entry into a sink. Files are rendered from their sources in
+ * parallel by up to jobs threads, a window of files at a time, and handed to
+ * the sink in draft order, so memory is bounded by the window rather than the
+ * project. Front matter is left out and non-UTF-8 sources are transcoded as
+ * they are when collating.
+ *
+ * @param   entries  Resolved entries in traversal order
+ * @param   jobs     Maximum number of worker threads
+ * @param   rootDir  Project root, for error messages
+ * @param   sink     Receives the HTML
+ *
+ * @return  int
+ *          0        if every file was rendered and taken by the sink
+ *         -1        if any file could not be read or the sink failed
+ * */
+int renderHtmlEntries(const struct FileList *entries,
+                      unsigned int jobs,
+                      const char *rootDir,
+                      const struct HtmlSink *sink);
+
+/* *
+ * Copies the last path component, without its extension for files, into
+ * buffer.
+ *
+ * @param  entry   Entry to name
+ * @param  buffer  Receives the stem
+ * @param  size    Size of buffer
+ * */
+void htmlEntryStem(const struct FileEntry *entry, char *buffer, size_t size);
+
+/* *
+ * Turns an output name into a title for people: _My_Book_ is My Book.
+ *
+ * @param  title   Output name, as for the Markdown draft
+ * @param  buffer  Receives the title
+ * @param  size    Size of buffer
+ * */
+void htmlDisplayTitle(const char *title, char *buffer, size_t size);
+
+/* *
+ * Renders a resolved project to HTML documents with renderHtmlEntries().
+ *
+ * With chapters false the draft is one document, <rootDir>/<title>.html.
+ * Otherwise <rootDir>/<title>/ holds a document per entry in the root .index,
+ * named by its position and name, e.g. 001_prologue.html.
+ *
+ * @param   entries   Resolved entries in traversal order
+ * @param   jobs      Maximum number of worker threads
+ * @param   rootDir   Project root the output is written to
+ * @param   title     Output name, as for the Markdown draft
+ * @param   padding   Digits in chapter file numbers
+ * @param   chapters  Write a document per chapter
+ *
+ * @return  int
+ *          0         if every file was rendered and written
+ *         -1         if any file could not be read or output failed
+ * */
+int renderProjectHtml(const struct FileList *entries,
+                      unsigned int jobs,
+                      const char *rootDir,
+                      const char *title,
+                      unsigned int padding,
+                      bool chapters);
+
+#endif
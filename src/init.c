@@ -66,40 +66,30 @@ static int addToIndexFile(FILE *indexFile, const char *entryName) {
     return 0;
 }
 
-static FILE *openOrCreateIndexFile(const char *dirPath) {
-    if (!dirPath) {
-        return NULL;
-    }
-
-    char indexFilePath[COLETTE_PATH_BUF_SIZE];
-    if (joinPath(indexFilePath, sizeof(indexFilePath), dirPath, ".index") !=
-        0) {
+static FILE *openOrCreateIndexFile(struct PathBuilder *dirPath) {
+    if (pathBuilderPush(dirPath, ".index") != 0) {
         reportProcessError(
-            PROCESS_OP_HANDLE_INIT, dirPath, PROC_ERR_PATH_TOO_LONG);
+            PROCESS_OP_HANDLE_INIT, dirPath->path, PROC_ERR_PATH_TOO_LONG);
         return NULL;
     }
+    const char *indexFilePath = dirPath->path;
 
+    FILE *indexFile;
+    errno = 0;
     if (isReg(indexFilePath)) {
-        errno = 0;
-        FILE *indexFile = fopen(indexFilePath, "a+");
-        if (!indexFile) {
-            reportProcessError(
-                PROCESS_OP_HANDLE_INIT, indexFilePath, PROC_ERR_OPEN_FILE);
-            return NULL;
+        indexFile = fopen(indexFilePath, "a+");
+        if (indexFile) {
+            rewind(indexFile); // move to beginning of index file
         }
-
-        rewind(indexFile); // move to beginning of index file
-        return indexFile;
+    } else {
+        indexFile = fopen(indexFilePath, "w+");
     }
-
-    errno = 0;
-    FILE *indexFile = fopen(indexFilePath, "w+");
     if (!indexFile) {
         reportProcessError(
             PROCESS_OP_HANDLE_INIT, indexFilePath, PROC_ERR_OPEN_FILE);
-        return NULL;
     }
 
+    pathBuilderPop(dirPath);
     return indexFile;
 }
 
@@ -110,7 +100,13 @@ static int isIncludedFilter(const struct dirent *entry) {
     return isIncluded(entry->d_name);
 }
 
-int enqueue(struct InitQueue **queue, const char *dirPath) {
+void initQueueInit(struct InitQueue *queue) {
+    queue->head = NULL;
+    queue->tail = NULL;
+    arenaInit(&queue->arena, COLETTE_TRAVERSAL_ARENA_SIZE);
+}
+
+int enqueue(struct InitQueue *queue, const char *dirPath) {
     if (!queue) {
         return -1;
     }
@@ -119,41 +115,31 @@ int enqueue(struct InitQueue **queue, const char *dirPath) {
         return -1;
     }
 
-    struct InitQueue *newNode = malloc(sizeof(struct InitQueue));
-    if (!newNode) {
-        return -1;
-    }
-
     size_t dirPathLen = strlen(dirPath) + 1;
-    char *pathCopy = malloc(dirPathLen);
-    if (!pathCopy) {
-        free(newNode);
+    struct InitQueueNode *newNode =
+        arenaAlloc(&queue->arena, sizeof(struct InitQueueNode) + dirPathLen);
+    if (!newNode) {
         return -1;
     }
-    memcpy(pathCopy, dirPath, dirPathLen);
-
-    newNode->dirPath = pathCopy;
+    memcpy(newNode->dirPath, dirPath, dirPathLen);
     newNode->next = NULL;
 
-    if (!*queue) {
-        *queue = newNode;
+    if (!queue->head) {
+        queue->head = newNode;
     } else {
-        struct InitQueue *cur = *queue;
-        while (cur->next) {
-            cur = cur->next;
-        }
-        cur->next = newNode;
+        queue->tail->next = newNode;
     }
+    queue->tail = newNode;
 
     return 0;
 }
 
-int dequeue(struct InitQueue **queue, char *outPath, size_t outPathLen) {
-    if (!*queue) {
+int dequeue(struct InitQueue *queue, char *outPath, size_t outPathLen) {
+    if (!queue->head) {
         return -1;
     }
 
-    struct InitQueue *oldHead = *queue;
+    struct InitQueueNode *oldHead = queue->head;
 
     size_t pathLen = strlen(oldHead->dirPath) + 1;
     if (pathLen > outPathLen) {
@@ -163,14 +149,20 @@ int dequeue(struct InitQueue **queue, char *outPath, size_t outPathLen) {
     }
     memcpy(outPath, oldHead->dirPath, pathLen);
 
-    *queue = oldHead->next;
-
-    free(oldHead->dirPath);
-    free(oldHead);
+    queue->head = oldHead->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
 
     return 0;
 }
 
+void freeInitQueue(struct InitQueue *queue) {
+    freeArena(&queue->arena);
+    queue->head = NULL;
+    queue->tail = NULL;
+}
+
 int handleInit(char *rootDir) {
     if (!rootDir) {
         reportProcessError(PROCESS_OP_HANDLE_INIT, "(root directory is NULL)", PROC_ERR_INVALID_PATH);
@@ -178,34 +170,42 @@ int handleInit(char *rootDir) {
     }
 
     int errorCount = 0;
-    struct InitQueue *queue = NULL;
+    struct InitQueue queue;
+    initQueueInit(&queue);
+    // the directory being indexed, with each of its entries pushed in turn
+    struct PathBuilder curDir;
 
     if (enqueue(&queue, rootDir) != 0) {
                     reportProcessError(PROCESS_OP_HANDLE_INIT, rootDir, PROC_ERR_MEMORY_ALLOC);
+        freeInitQueue(&queue);
         return -1;
     }
 
-    while (queue) {
-        char curDir[COLETTE_PATH_BUF_SIZE];
+    while (queue.head) {
+        char curDirPath[COLETTE_PATH_BUF_SIZE];
 
-        if (dequeue(&queue, curDir, sizeof(curDir)) != 0) {
+        if (dequeue(&queue, curDirPath, sizeof(curDirPath)) != 0) {
             break;
         }
+        if (pathBuilderSet(&curDir, curDirPath) != 0) {
+            errorCount++;
+            continue;
+        }
 
-        FILE *indexFile = openOrCreateIndexFile(curDir);
+        FILE *indexFile = openOrCreateIndexFile(&curDir);
         if (!indexFile) {
             reportProcessError(
-                PROCESS_OP_HANDLE_INIT, curDir, PROC_ERR_INDEX_MISSING);
+                PROCESS_OP_HANDLE_INIT, curDirPath, PROC_ERR_INDEX_MISSING);
             errorCount++;
             continue;
         }
 
         struct dirent **nameList;
         int entryCount =
-            scandir(curDir, &nameList, isIncludedFilter, alphasort);
+            scandir(curDirPath, &nameList, isIncludedFilter, alphasort);
         if (entryCount < 0) {
             reportProcessError(
-                PROCESS_OP_HANDLE_INIT, curDir, PROC_ERR_OPEN_FILE);
+                PROCESS_OP_HANDLE_INIT, curDirPath, PROC_ERR_OPEN_FILE);
             errorCount++;
             fclose(indexFile);
             continue;
@@ -213,21 +213,21 @@ int handleInit(char *rootDir) {
 
         for (int i = 0; i < entryCount; i++) {
             const char *entry = nameList[i]->d_name;
-            char fullPath[COLETTE_PATH_BUF_SIZE];
-            if (joinPath(fullPath, sizeof(fullPath), curDir, entry)) {
+            if (pathBuilderPush(&curDir, entry) != 0) {
                 errorCount++;
                 free(nameList[i]);
                 continue;
             }
 
-            if (isReg(fullPath)) {
+            if (isReg(curDir.path)) {
                 addToIndexFile(indexFile, entry);
-            } else if (isDir(fullPath)) {
+            } else if (isDir(curDir.path)) {
                 addToIndexFile(indexFile, entry);
-                if (enqueue(&queue, fullPath) != 0) {
-                    reportProcessError(PROCESS_OP_HANDLE_INIT, curDir, PROC_ERR_MEMORY_ALLOC);
+                if (enqueue(&queue, curDir.path) != 0) {
+                    reportProcessError(PROCESS_OP_HANDLE_INIT, curDirPath, PROC_ERR_MEMORY_ALLOC);
                 }
             }
+            pathBuilderPop(&curDir);
             free(nameList[i]);
         }
 
@@ -236,10 +236,7 @@ int handleInit(char *rootDir) {
         fclose(indexFile);
     }
 
-    while (queue) {
-        char tmpPath[COLETTE_PATH_BUF_SIZE];
-        dequeue(&queue, tmpPath, sizeof(tmpPath));
-    }
+    freeInitQueue(&queue);
 
     return errorCount > 0 ? -1 : 0;
 }
@@ -1,15 +1,28 @@
 #ifndef INIT_H
 #define INIT_H
 
+#include "arena.h"
 #include <stdlib.h>
 
+struct InitQueueNode {
+    struct InitQueueNode *next;
+    char dirPath[]; // the node and its path are one arena allocation
+};
+
+/* *
+ * Directories waiting to be indexed, first in first out. Nodes come from a
+ * run-scoped arena and are only given back, all at once, by freeInitQueue().
+ * */
 struct InitQueue {
-    char *dirPath;
-    struct InitQueue *next;
+    struct InitQueueNode *head;
+    struct InitQueueNode *tail;
+    struct Arena arena;
 };
 
-int enqueue(struct InitQueue **queue, const char *dirPath);
-int dequeue(struct InitQueue **queue, char *outPath, size_t outPathLen);
+void initQueueInit(struct InitQueue *queue);
+int enqueue(struct InitQueue *queue, const char *dirPath);
+int dequeue(struct InitQueue *queue, char *outPath, size_t outPathLen);
+void freeInitQueue(struct InitQueue *queue);
 int handleInit(char *rootDir);
 
 #endif
@@ -0,0 +1,33 @@
+#include "json.h"
+
+void writeJsonString(FILE *out, const char *str) {
+    if (!str) {
+        fputs("null", out);
+        return;
+    }
+
+    fputc('"', out);
+    for (const unsigned char *c = (const unsigned char *)str; *c; c++) {
+        switch (*c) {
+        case '"':
+            fputs("\\\"", out);
+            break;
+        case '\\':
+            fputs("\\\\", out);
+            break;
+        case '\n':
+            fputs("\\n", out);
+            break;
+        case '\t':
+            fputs("\\t", out);
+            break;
+        default:
+            if (*c < 0x20) {
+                fprintf(out, "\\u%04x", *c);
+            } else {
+                fputc(*c, out);
+            }
+        }
+    }
+    fputc('"', out);
+}
@@ -0,0 +1,15 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <stdio.h>
+
+/* *
+ * Writes a string as a quoted JSON string literal, escaping quotes,
+ * backslashes and control characters. NULL is written as null.
+ *
+ * @param  out  Stream to write to
+ * @param  str  String to write, may be NULL
+ * */
+void writeJsonString(FILE *out, const char *str);
+
+#endif
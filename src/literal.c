@@ -0,0 +1,70 @@
+#include "literal.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void literalInit(struct LiteralSearch *search,
+                 const void *pattern,
+                 size_t len) {
+    search->pattern = pattern;
+    search->len = len;
+}
+
+const unsigned char *literalFind(const struct LiteralSearch *search,
+                                 const unsigned char *text,
+                                 size_t len) {
+    const unsigned char *pattern = search->pattern;
+    size_t n = search->len;
+    if (n == 0) {
+        return text;
+    }
+    if (n > len) {
+        return NULL;
+    }
+    if (n == 1) {
+        return memchr(text, pattern[0], len);
+    }
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    /* *
+     * Lane k of the mask is set when text[i + k] matches the first byte and
+     * text[i + k + n - 1] matches the last one. Only those lanes are compared
+     * in full, and the middle of the pattern is all that's left to check.
+     * */
+    const __m128i first = _mm_set1_epi8((char)pattern[0]);
+    const __m128i last = _mm_set1_epi8((char)pattern[n - 1]);
+
+    while (len - i >= n - 1 + 16) {
+        __m128i head = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i tail = _mm_loadu_si128((const __m128i *)(text + i + n - 1));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        while (mask != 0) {
+            size_t candidate = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(text + candidate + 1, pattern + 1, n - 2) == 0) {
+                return text + candidate;
+            }
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+#endif
+
+    while (len - i >= n) {
+        const unsigned char *candidate =
+            memchr(text + i, pattern[0], len - i - n + 1);
+        if (!candidate) {
+            return NULL;
+        }
+        if (candidate[n - 1] == pattern[n - 1] &&
+            memcmp(candidate + 1, pattern + 1, n - 2) == 0) {
+            return candidate;
+        }
+        i = (size_t)(candidate - text) + 1;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef LITERAL_H
+#define LITERAL_H
+
+#include <stddef.h>
+
+/* *
+ * Fixed-string searcher. Candidates are found by comparing the pattern's first
+ * and last bytes against 16 positions at once, so text that only shares a
+ * common first letter with the pattern is rejected without a memcmp.
+ * */
+struct LiteralSearch {
+    const unsigned char *pattern; // not copied, must outlive the searcher
+    size_t len;
+};
+
+/* *
+ * @param  search   Searcher to set up
+ * @param  pattern  Bytes to look for, kept by reference
+ * @param  len      Number of bytes in pattern
+ * */
+void literalInit(struct LiteralSearch *search, const void *pattern, size_t len);
+
+/* *
+ * Finds the first occurrence of the pattern, like memmem().
+ *
+ * @param   search  Initialized searcher
+ * @param   text    Bytes to search
+ * @param   len     Number of bytes in text
+ *
+ * @return  const unsigned char *
+ *          start of the first match in text
+ *          NULL if the pattern doesn't occur
+ * */
+const unsigned char *literalFind(const struct LiteralSearch *search,
+                                 const unsigned char *text,
+                                 size_t len);
+
+#endif
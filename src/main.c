@@ -1,7 +1,9 @@
 #include "args.h"
 #include "process.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 int main(int argc, char *argv[]) {
     struct Arguments args = parseArgs(argc, argv);
@@ -10,16 +12,37 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (args.traceFile && traceOpen(args.traceFile) != 0) {
+        fprintf(stderr, "Error: Unable to start tracing to %s\n", args.traceFile);
+        freeArguments(&args);
+        return EXIT_FAILURE;
+    }
+
     int projectSuccess = processProject(&args);
+    if (traceClose() != 0) {
+        projectSuccess = -1;
+    }
+
+    // keep stdout parseable when search results, a JSON check report or
+    // stats go there
+    bool quiet = args.mode == MODE_GREP || args.mode == MODE_LOOKUP ||
+                 args.mode == MODE_DUPES || args.mode == MODE_SPELL ||
+                 args.mode == MODE_ANALYZE || args.mode == MODE_VERIFY ||
+                 (args.mode == MODE_CHECK && args.reportFormat == REPORT_JSON) ||
+                 (args.statsFile && strcmp(args.statsFile, "-") == 0);
 
     // DON'T FORGET TO FREE
     freeArguments(&args);
 
     if (projectSuccess != 0) {
-        printf("PROJECT FAILED: %d\n", projectSuccess);
+        if (!quiet) {
+            printf("PROJECT FAILED: %d\n", projectSuccess);
+        }
         return EXIT_FAILURE;
     }
 
-    fprintf(stdout, "Success");
+    if (!quiet) {
+        fprintf(stdout, "Success");
+    }
     return EXIT_SUCCESS;
 }
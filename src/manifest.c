@@ -0,0 +1,372 @@
+#include "manifest.h"
+#include "constants.h"
+#include "errors.h"
+#include "files.h"
+#include "reporting.h"
+#include "workers.h"
+#include "xxh3.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char MANIFEST_HEADER[] = "xxh3\tpath\n";
+
+int manifestPath(char *buffer, size_t size, const char *draftPath) {
+    size_t stemLen = strlen(draftPath);
+    if (stemLen >= 3 && strcmp(draftPath + stemLen - 3, ".md") == 0) {
+        stemLen -= 3;
+    }
+
+    int len = snprintf(
+        buffer, size, "%.*s.manifest.tsv", (int)stemLen, draftPath);
+    if (len < 0 || (size_t)len >= size) {
+        reportProcessError(
+            PROCESS_OP_CTX_OUTPUT, draftPath, PROC_ERR_PATH_TOO_LONG);
+        return -1;
+    }
+    return 0;
+}
+
+int appendManifestEntry(struct Manifest *manifest,
+                        const char *path,
+                        uint64_t hash) {
+    if (manifest->count == manifest->capacity) {
+        size_t capacity = manifest->capacity ? manifest->capacity * 2 : 64;
+        struct ManifestEntry *grown = realloc(
+            manifest->entries, capacity * sizeof(struct ManifestEntry));
+        if (!grown) {
+            return -1;
+        }
+        manifest->entries = grown;
+        manifest->capacity = capacity;
+    }
+
+    size_t pathLen = strlen(path) + 1;
+    char *copy = malloc(pathLen);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, path, pathLen);
+    manifest->entries[manifest->count++] =
+        (struct ManifestEntry){.path = copy, .hash = hash};
+    return 0;
+}
+
+int writeManifest(const struct Manifest *manifest,
+                  const char *outPath,
+                  const char *draftPath,
+                  const char *rootDir) {
+    errno = 0;
+    FILE *out = fopen(outPath, "w");
+    if (!out) {
+        reportFileError(FILE_OP_OPEN, outPath);
+        return -1;
+    }
+
+    fputs(MANIFEST_HEADER, out);
+    fprintf(out,
+            "%016" PRIx64 "\t%s\n",
+            manifest->draftHash,
+            relativePath(draftPath, rootDir));
+    for (size_t i = 0; i < manifest->count; i++) {
+        fprintf(out,
+                "%016" PRIx64 "\t%s\n",
+                manifest->entries[i].hash,
+                relativePath(manifest->entries[i].path, rootDir));
+    }
+
+    int status = 0;
+    errno = 0;
+    if (ferror(out)) {
+        status = -1;
+    }
+    if (fclose(out) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        reportFileError(FILE_OP_WRITE, outPath);
+    }
+    return status;
+}
+
+// a line is 16 hex digits, a tab and a path; the line feed is removed
+static int parseLine(char *line, uint64_t *hash, char **path) {
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\n') {
+        line[--len] = '\0';
+    }
+    if (len < 18 || line[16] != '\t') {
+        return -1;
+    }
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < 16; i++) {
+        char c = line[i];
+        unsigned int digit;
+        if (c >= '0' && c <= '9') {
+            digit = (unsigned int)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = (unsigned int)(c - 'a' + 10);
+        } else {
+            return -1;
+        }
+        value = value << 4 | digit;
+    }
+    *hash = value;
+    *path = line + 17;
+    return 0;
+}
+
+static int readManifest(struct Manifest *manifest, const char *path) {
+    errno = 0;
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        reportFileError(FILE_OP_OPEN, path);
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    size_t lineNumber = 0;
+    bool corrupt = false;
+    int status = 0;
+    while (status == 0 && getline(&line, &lineCapacity, in) != -1) {
+        uint64_t hash;
+        char *entryPath;
+        if (lineNumber++ == 0) {
+            corrupt = strcmp(line, MANIFEST_HEADER) != 0;
+        } else if (parseLine(line, &hash, &entryPath) != 0) {
+            corrupt = true;
+        } else if (lineNumber == 2) {
+            manifest->draftHash = hash; // the draft comes first
+        } else if (appendManifestEntry(manifest, entryPath, hash) != 0) {
+            reportProcessError(
+                PROCESS_OP_HANDLE_VERIFY, path, PROC_ERR_MEMORY_ALLOC);
+            status = -1;
+        }
+        if (corrupt) {
+            status = -1;
+        }
+    }
+    if (status == 0 && ferror(in)) {
+        reportFileError(FILE_OP_READ, path);
+        status = -1;
+    } else if (corrupt || (status == 0 && lineNumber < 2)) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_VERIFY, path, PROC_ERR_DATA_CORRUPT);
+        status = -1;
+    }
+    free(line);
+    fclose(in);
+    return status;
+}
+
+/* *
+ * A file hashed again. Workers only write to their own result; the calling
+ * thread compares and reports once every worker is done.
+ * */
+struct HashResult {
+    struct ReadFailure failure;
+    uint64_t hash;
+};
+
+struct HashJob {
+    const char **paths; // the draft, then every source
+    struct HashResult *results;
+};
+
+static void hashFile(size_t index, void *arg) {
+    struct HashJob *job = arg;
+    struct HashResult *result = &job->results[index];
+
+    // sources are held to the rules traversal applies; the draft is
+    // whatever file the user named
+    int fd = openProjectFile(
+        job->paths[index], index > 0 ? O_NOFOLLOW : 0, &result->failure);
+    if (fd < 0) {
+        return;
+    }
+
+    unsigned char buffer[COLETTE_SCAN_BUF_SIZE];
+    struct Xxh3State state;
+    xxh3Reset(&state);
+    ssize_t bytesRead;
+    while ((bytesRead = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            setReadFailure(&result->failure, PROC_ERR_OPEN_FILE, errno);
+            result->failure.readFailed = true;
+            close(fd);
+            return;
+        }
+        xxh3Update(&state, buffer, (size_t)bytesRead);
+    }
+    close(fd);
+    result->hash = xxh3Digest(&state);
+}
+
+static bool reportHashFailure(const struct HashResult *result,
+                              const char *path) {
+    return reportReadFailure(&result->failure, PROCESS_OP_HANDLE_VERIFY, path);
+}
+
+struct SortedEntry {
+    const char *path;
+    size_t index;
+};
+
+static int compareSorted(const void *a, const void *b) {
+    return strcmp(((const struct SortedEntry *)a)->path,
+                  ((const struct SortedEntry *)b)->path);
+}
+
+/* *
+ * Walks the project in draft order against the manifest, looking each source
+ * up by path. A source found at an earlier manifest position than the one
+ * before it has moved.
+ * */
+static int compareSources(const struct Manifest *manifest,
+                          const char **paths,
+                          const struct HashResult *results,
+                          size_t fileCount,
+                          const char *rootDir,
+                          FILE *out) {
+    struct SortedEntry *sorted =
+        malloc((manifest->count + 1) * sizeof(struct SortedEntry));
+    bool *seen = calloc(manifest->count + 1, sizeof(bool));
+    if (!sorted || !seen) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_VERIFY, rootDir, PROC_ERR_MEMORY_ALLOC);
+        free(sorted);
+        free(seen);
+        return -1;
+    }
+    for (size_t i = 0; i < manifest->count; i++) {
+        sorted[i] = (struct SortedEntry){manifest->entries[i].path, i};
+    }
+    qsort(sorted, manifest->count, sizeof(*sorted), compareSorted);
+
+    int status = 0;
+    bool matched = false;
+    size_t lastIndex = 0;
+    for (size_t i = 1; i <= fileCount; i++) {
+        const char *path = relativePath(paths[i], rootDir);
+        struct SortedEntry key = {path, 0};
+        const struct SortedEntry *found = bsearch(
+            &key, sorted, manifest->count, sizeof(*sorted), compareSorted);
+        if (reportHashFailure(&results[i], paths[i])) {
+            status = -1;
+        }
+        if (!found) {
+            fprintf(out, "added\t%s\n", path);
+            status = -1;
+            continue;
+        }
+
+        seen[found->index] = true;
+        if (!results[i].failure.failed &&
+            results[i].hash != manifest->entries[found->index].hash) {
+            fprintf(out, "changed\t%s\n", path);
+            status = -1;
+        }
+        if (matched && found->index < lastIndex) {
+            fprintf(out, "moved\t%s\n", path);
+            status = -1;
+        } else {
+            lastIndex = found->index;
+            matched = true;
+        }
+    }
+    for (size_t i = 0; i < manifest->count; i++) {
+        if (!seen[i]) {
+            fprintf(out, "removed\t%s\n", manifest->entries[i].path);
+            status = -1;
+        }
+    }
+
+    free(sorted);
+    free(seen);
+    return status;
+}
+
+int verifyDraft(const struct FileList *entries,
+                unsigned int jobs,
+                const char *rootDir,
+                const char *draftPath,
+                FILE *out) {
+    if (!entries || !rootDir || !draftPath || !out) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_VERIFY, rootDir, PROC_ERR_INVALID_STATE);
+        return -1;
+    }
+
+    char path[COLETTE_PATH_BUF_SIZE];
+    struct Manifest manifest = {0};
+    if (manifestPath(path, sizeof(path), draftPath) != 0 ||
+        readManifest(&manifest, path) != 0) {
+        freeManifest(&manifest);
+        return -1;
+    }
+
+    size_t fileCount = 0;
+    for (size_t i = 0; i < entries->count; i++) {
+        fileCount += entries->entries[i].type == FILE_TYPE_REGULAR;
+    }
+    const char **paths = malloc((fileCount + 1) * sizeof(char *));
+    struct HashResult *results =
+        calloc(fileCount + 1, sizeof(struct HashResult));
+    if (!paths || !results) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_VERIFY, rootDir, PROC_ERR_MEMORY_ALLOC);
+        free(paths);
+        free(results);
+        freeManifest(&manifest);
+        return -1;
+    }
+    paths[0] = draftPath;
+    for (size_t i = 0, file = 1; i < entries->count; i++) {
+        if (entries->entries[i].type == FILE_TYPE_REGULAR) {
+            paths[file++] = entries->entries[i].path;
+        }
+    }
+
+    struct HashJob job = {.paths = paths, .results = results};
+    runParallel(fileCount + 1, jobs, hashFile, &job);
+
+    int status = 0;
+    if (reportHashFailure(&results[0], draftPath)) {
+        status = -1;
+    } else if (results[0].hash != manifest.draftHash) {
+        fprintf(out, "changed\t%s\n", relativePath(draftPath, rootDir));
+        status = -1;
+    }
+    if (compareSources(&manifest, paths, results, fileCount, rootDir, out) !=
+        0) {
+        status = -1;
+    }
+
+    free(paths);
+    free(results);
+    freeManifest(&manifest);
+    return status;
+}
+
+void freeManifest(struct Manifest *manifest) {
+    if (!manifest) {
+        return;
+    }
+
+    for (size_t i = 0; i < manifest->count; i++) {
+        free(manifest->entries[i].path);
+    }
+    free(manifest->entries);
+    manifest->entries = NULL;
+    manifest->count = 0;
+    manifest->capacity = 0;
+}
@@ -0,0 +1,103 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include "filelist.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* *
+ * A source file and the XXH3 64-bit hash of its bytes as they are on disk.
+ * */
+struct ManifestEntry {
+    char *path;
+    uint64_t hash;
+};
+
+/* *
+ * Hashes proving a draft was collated from a set of sources: the draft's own
+ * hash and one per source in draft order. Written next to the draft as
+ * <draft>.manifest.tsv, a header line followed by hash and path columns, the
+ * draft first and then every source relative to the project root.
+ * */
+struct Manifest {
+    uint64_t draftHash;
+    struct ManifestEntry *entries;
+    size_t count;
+    size_t capacity;
+};
+
+/* *
+ * Names the manifest of a draft: _draft_.md has _draft_.manifest.tsv.
+ *
+ * @param   buffer     Receives the path
+ * @param   size       Size of buffer
+ * @param   draftPath  Path of the draft
+ *
+ * @return  int
+ *          0          on success
+ *         -1          if the path doesn't fit; reported
+ * */
+int manifestPath(char *buffer, size_t size, const char *draftPath);
+
+/* *
+ * @param   manifest  Manifest to append to
+ * @param   path      Source path, copied
+ * @param   hash      Hash of the source
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if memory could not be allocated
+ * */
+int appendManifestEntry(struct Manifest *manifest,
+                        const char *path,
+                        uint64_t hash);
+
+/* *
+ * @param   manifest   Hashes to write
+ * @param   outPath    Manifest file to create or replace
+ * @param   draftPath  Path of the draft the manifest describes
+ * @param   rootDir    Project root, stripped from paths
+ *
+ * @return  int
+ *          0          on success
+ *         -1          if the file could not be written; reported
+ * */
+int writeManifest(const struct Manifest *manifest,
+                  const char *outPath,
+                  const char *draftPath,
+                  const char *rootDir);
+
+/* *
+ * Checks a draft against its manifest and the project as it is now: the
+ * draft and every source are hashed again in parallel, up to jobs threads,
+ * and compared, without collating or writing anything. Differences are
+ * printed to out as status and path columns:
+ *
+ *   changed   the draft or a source no longer has the hash in the manifest
+ *   added     a source the manifest doesn't list
+ *   removed   a source in the manifest the project no longer lists
+ *   moved     a source listed earlier in the draft than it was
+ *
+ * @param   entries    Resolved entries in traversal order
+ * @param   jobs       Maximum number of worker threads
+ * @param   rootDir    Project root, stripped from paths
+ * @param   draftPath  Draft to verify; its manifest sits next to it
+ * @param   out        Stream the differences are printed to
+ *
+ * @return  int
+ *          0          if the draft and sources match the manifest
+ *         -1          if anything differs or could not be read
+ * */
+int verifyDraft(const struct FileList *entries,
+                unsigned int jobs,
+                const char *rootDir,
+                const char *draftPath,
+                FILE *out);
+
+/* *
+ * @param  manifest  Manifest to free
+ * */
+void freeManifest(struct Manifest *manifest);
+
+#endif
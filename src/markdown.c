@@ -0,0 +1,1214 @@
+#include "markdown.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* *
+ * Emphasis and links render their contents recursively. Deeper nesting than
+ * this is written as literal text.
+ * */
+#define MARKDOWN_MAX_NESTING 16
+
+// bytes renderInline has to look at; every other byte is copied in runs
+static const bool INLINE_SPECIAL[256] = {
+    ['\\'] = true,
+    ['`'] = true,
+    ['*'] = true,
+    ['_'] = true,
+    ['['] = true,
+    ['!'] = true,
+    ['<'] = true,
+    ['>'] = true,
+    ['&'] = true,
+    ['"'] = true,
+};
+
+static int reserve(struct HtmlBuffer *out, size_t extra) {
+    if (extra > SIZE_MAX - out->len) {
+        return -1;
+    }
+    size_t needed = out->len + extra;
+    if (needed <= out->capacity) {
+        return 0;
+    }
+
+    size_t capacity = out->capacity ? out->capacity : 1024;
+    while (capacity < needed) {
+        capacity = capacity > SIZE_MAX / 2 ? needed : capacity * 2;
+    }
+    char *grown = realloc(out->data, capacity);
+    if (!grown) {
+        return -1;
+    }
+    out->data = grown;
+    out->capacity = capacity;
+    return 0;
+}
+
+static int appendBytes(struct HtmlBuffer *out, const char *bytes, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    if (reserve(out, len) != 0) {
+        return -1;
+    }
+    memcpy(out->data + out->len, bytes, len);
+    out->len += len;
+    return 0;
+}
+
+static int appendString(struct HtmlBuffer *out, const char *text) {
+    return appendBytes(out, text, strlen(text));
+}
+
+int appendEscapedHtml(struct HtmlBuffer *out, const char *text, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        size_t run = i;
+        while (run < len && text[run] != '&' && text[run] != '<' &&
+               text[run] != '>' && text[run] != '"') {
+            run++;
+        }
+        if (appendBytes(out, text + i, run - i) != 0) {
+            return -1;
+        }
+        if (run == len) {
+            break;
+        }
+
+        const char *entity = text[run] == '&'   ? "&amp;"
+                             : text[run] == '<' ? "&lt;"
+                             : text[run] == '>' ? "&gt;"
+                                                : "&quot;";
+        if (appendString(out, entity) != 0) {
+            return -1;
+        }
+        i = run + 1;
+    }
+    return 0;
+}
+
+static bool isSpaceOrTab(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static size_t countRun(const char *text, size_t len, size_t start, char c) {
+    size_t end = start;
+    while (end < len && text[end] == c) {
+        end++;
+    }
+    return end - start;
+}
+
+static size_t trimTrailing(const char *text, size_t len) {
+    while (len > 0 && isSpaceOrTab(text[len - 1])) {
+        len--;
+    }
+    return len;
+}
+
+static bool isBlank(const char *text, size_t len) {
+    return trimTrailing(text, len) == 0;
+}
+
+/* *
+ * Counts the columns of leading whitespace, tabs stopping at multiples of 4,
+ * and the bytes they take up.
+ * */
+static size_t leadingIndent(const char *line, size_t len, size_t *bytes) {
+    size_t columns = 0;
+    size_t i = 0;
+    while (i < len && isSpaceOrTab(line[i])) {
+        columns = line[i] == '\t' ? columns + 4 - columns % 4 : columns + 1;
+        i++;
+    }
+    *bytes = i;
+    return columns;
+}
+
+// bytes taken by up to columns of leading whitespace
+static size_t skipColumns(const char *line, size_t len, size_t columns) {
+    size_t seen = 0;
+    size_t i = 0;
+    while (i < len && seen < columns && isSpaceOrTab(line[i])) {
+        seen = line[i] == '\t' ? seen + 4 - seen % 4 : seen + 1;
+        i++;
+    }
+    return i;
+}
+
+/* *
+ * Finds the backtick run of exactly run ticks that closes a code span, or
+ * returns len if there is none.
+ * */
+static size_t findCodeSpanEnd(const char *text,
+                              size_t len,
+                              size_t start,
+                              size_t run) {
+    size_t i = start;
+    while (i < len) {
+        const char *tick = memchr(text + i, '`', len - i);
+        if (!tick) {
+            return len;
+        }
+        size_t at = (size_t)(tick - text);
+        size_t ticks = countRun(text, len, at, '`');
+        if (ticks == run) {
+            return at;
+        }
+        i = at + ticks;
+    }
+    return len;
+}
+
+/* *
+ * Finds the run of c that closes emphasis opened with k delimiters. A closer
+ * follows a non-space and, for _, isn't followed by a letter or digit. Runs of
+ * a different length only close when they can split, so *a **b** c* nests.
+ * */
+static size_t findEmphasisClose(const char *text,
+                                size_t len,
+                                size_t start,
+                                char c,
+                                size_t k) {
+    size_t i = start;
+    while (i < len) {
+        if (text[i] == '\\') {
+            i += 2;
+            continue;
+        }
+        if (text[i] == '`') {
+            size_t ticks = countRun(text, len, i, '`');
+            size_t end = findCodeSpanEnd(text, len, i + ticks, ticks);
+            i = end < len ? end + ticks : i + ticks;
+            continue;
+        }
+        if (text[i] != c) {
+            i++;
+            continue;
+        }
+
+        size_t run = countRun(text, len, i, c);
+        bool closes = i > start && !isspace((unsigned char)text[i - 1]) &&
+                      (c != '_' || i + run >= len ||
+                       !isalnum((unsigned char)text[i + run]));
+        if (closes && (run == k || (run >= 3 && run >= k))) {
+            return i;
+        }
+        i += run;
+    }
+    return len;
+}
+
+// position of the ] matching the [ before start, or len
+static size_t findBracketClose(const char *text, size_t len, size_t start) {
+    size_t depth = 1;
+    size_t i = start;
+    while (i < len) {
+        switch (text[i]) {
+        case '\\':
+            i++;
+            break;
+        case '`': {
+            size_t ticks = countRun(text, len, i, '`');
+            size_t end = findCodeSpanEnd(text, len, i + ticks, ticks);
+            i = (end < len ? end + ticks : i + ticks) - 1;
+            break;
+        }
+        case '[':
+            depth++;
+            break;
+        case ']':
+            if (--depth == 0) {
+                return i;
+            }
+            break;
+        }
+        i++;
+    }
+    return len;
+}
+
+/* *
+ * Parses the (destination "title") after a link's label. start is at the
+ * opening parenthesis. The title is accepted and dropped.
+ * */
+static bool parseLinkTarget(const char *text,
+                            size_t len,
+                            size_t start,
+                            size_t *destStart,
+                            size_t *destLen,
+                            size_t *end) {
+    size_t i = start + 1;
+    while (i < len && isSpaceOrTab(text[i])) {
+        i++;
+    }
+
+    if (i < len && text[i] == '<') {
+        const char *close = memchr(text + i + 1, '>', len - i - 1);
+        if (!close) {
+            return false;
+        }
+        *destStart = i + 1;
+        *destLen = (size_t)(close - text) - i - 1;
+        i = (size_t)(close - text) + 1;
+    } else {
+        size_t parens = 0;
+        *destStart = i;
+        while (i < len && !isSpaceOrTab(text[i])) {
+            if (text[i] == '\\' && i + 1 < len) {
+                i += 2;
+                continue;
+            }
+            if (text[i] == '(') {
+                parens++;
+            } else if (text[i] == ')') {
+                if (parens == 0) {
+                    break;
+                }
+                parens--;
+            }
+            i++;
+        }
+        *destLen = i - *destStart;
+    }
+
+    while (i < len && isSpaceOrTab(text[i])) {
+        i++;
+    }
+    if (i < len && (text[i] == '"' || text[i] == '\'' || text[i] == '(')) {
+        char closer = text[i] == '(' ? ')' : text[i];
+        const char *close = memchr(text + i + 1, closer, len - i - 1);
+        if (!close) {
+            return false;
+        }
+        i = (size_t)(close - text) + 1;
+        while (i < len && isSpaceOrTab(text[i])) {
+            i++;
+        }
+    }
+    if (i >= len || text[i] != ')') {
+        return false;
+    }
+
+    *end = i + 1;
+    return true;
+}
+
+// length of <scheme:...> at start, or 0 if it isn't an autolink
+static size_t autolinkLength(const char *text, size_t len, size_t start) {
+    size_t i = start + 1;
+    size_t schemeStart = i;
+    while (i < len && (isalnum((unsigned char)text[i]) || text[i] == '+' ||
+                       text[i] == '.' || text[i] == '-')) {
+        i++;
+    }
+    size_t schemeLen = i - schemeStart;
+    if (schemeLen < 2 || schemeLen > 32 ||
+        !isalpha((unsigned char)text[schemeStart]) || i >= len ||
+        text[i] != ':') {
+        return 0;
+    }
+
+    while (i < len && text[i] != '>') {
+        if (text[i] == '<' || isspace((unsigned char)text[i])) {
+            return 0;
+        }
+        i++;
+    }
+    return i < len ? i - start + 1 : 0;
+}
+
+// length of an entity or numeric character reference at start, or 0
+static size_t entityLength(const char *text, size_t len, size_t start) {
+    size_t i = start + 1;
+    size_t digits = 0;
+    if (i < len && text[i] == '#') {
+        i++;
+        bool hex = i < len && (text[i] == 'x' || text[i] == 'X');
+        i += hex;
+        while (i < len && digits < 8 &&
+               (hex ? isxdigit((unsigned char)text[i])
+                    : isdigit((unsigned char)text[i]))) {
+            i++;
+            digits++;
+        }
+    } else {
+        while (i < len && digits < 32 && isalnum((unsigned char)text[i])) {
+            i++;
+            digits++;
+        }
+    }
+    return digits > 0 && i < len && text[i] == ';' ? i - start + 1 : 0;
+}
+
+/* *
+ * Named references drafts commonly use, written out as numeric references.
+ * XML knows only the five it predefines, so EPUB chapters would not parse
+ * with the rest; numbers mean the same thing in either.
+ * */
+static const struct {
+    const char *name;
+    unsigned int codePoint;
+} NAMED_ENTITIES[] = {
+    {"nbsp", 0xa0},    {"iexcl", 0xa1},   {"cent", 0xa2},
+    {"pound", 0xa3},   {"euro", 0x20ac},  {"yen", 0xa5},
+    {"sect", 0xa7},    {"copy", 0xa9},    {"laquo", 0xab},
+    {"reg", 0xae},     {"deg", 0xb0},     {"plusmn", 0xb1},
+    {"para", 0xb6},    {"middot", 0xb7},  {"raquo", 0xbb},
+    {"frac14", 0xbc},  {"frac12", 0xbd},  {"frac34", 0xbe},
+    {"iquest", 0xbf},  {"agrave", 0xe0},  {"aacute", 0xe1},
+    {"acirc", 0xe2},   {"auml", 0xe4},    {"ccedil", 0xe7},
+    {"egrave", 0xe8},  {"eacute", 0xe9},  {"ecirc", 0xea},
+    {"euml", 0xeb},    {"iuml", 0xef},    {"ntilde", 0xf1},
+    {"ouml", 0xf6},    {"times", 0xd7},   {"divide", 0xf7},
+    {"uuml", 0xfc},    {"szlig", 0xdf},   {"Eacute", 0xc9},
+    {"ensp", 0x2002},  {"emsp", 0x2003},  {"thinsp", 0x2009},
+    {"ndash", 0x2013}, {"mdash", 0x2014}, {"lsquo", 0x2018},
+    {"rsquo", 0x2019}, {"sbquo", 0x201a}, {"ldquo", 0x201c},
+    {"rdquo", 0x201d}, {"bdquo", 0x201e}, {"dagger", 0x2020},
+    {"Dagger", 0x2021}, {"bull", 0x2022}, {"hellip", 0x2026},
+    {"prime", 0x2032}, {"Prime", 0x2033}, {"trade", 0x2122},
+    {"larr", 0x2190},  {"rarr", 0x2192},  {"hearts", 0x2665},
+};
+
+/* *
+ * Writes the reference of length at text[start]: numeric ones and the five
+ * XML predefines as they are, known names by number, and anything else with
+ * its & escaped.
+ * */
+static int appendEntity(struct HtmlBuffer *out,
+                        const char *text,
+                        size_t start,
+                        size_t length) {
+    const char *name = text + start + 1;
+    size_t nameLen = length - 2;
+    static const char *const XML_ENTITIES[] = {
+        "amp", "lt", "gt", "quot", "apos"};
+    if (name[0] == '#') {
+        return appendBytes(out, text + start, length);
+    }
+    for (size_t i = 0; i < sizeof(XML_ENTITIES) / sizeof(*XML_ENTITIES);
+         i++) {
+        if (strlen(XML_ENTITIES[i]) == nameLen &&
+            memcmp(XML_ENTITIES[i], name, nameLen) == 0) {
+            return appendBytes(out, text + start, length);
+        }
+    }
+    for (size_t i = 0; i < sizeof(NAMED_ENTITIES) / sizeof(*NAMED_ENTITIES);
+         i++) {
+        if (strlen(NAMED_ENTITIES[i].name) == nameLen &&
+            memcmp(NAMED_ENTITIES[i].name, name, nameLen) == 0) {
+            char number[16];
+            snprintf(number,
+                     sizeof(number),
+                     "&#%u;",
+                     NAMED_ENTITIES[i].codePoint);
+            return appendString(out, number);
+        }
+    }
+    return appendString(out, "&amp;") != 0 ||
+                   appendBytes(out, name, length - 1) != 0
+               ? -1
+               : 0;
+}
+
+static int renderInline(struct HtmlBuffer *out,
+                        const char *text,
+                        size_t len,
+                        unsigned int depth);
+
+static int renderEmphasis(struct HtmlBuffer *out,
+                          const char *text,
+                          size_t len,
+                          size_t *pos,
+                          unsigned int depth) {
+    size_t i = *pos;
+    char c = text[i];
+    size_t run = countRun(text, len, i, c);
+    bool opens = i + run < len && !isspace((unsigned char)text[i + run]) &&
+                 (c != '_' || i == 0 || !isalnum((unsigned char)text[i - 1]));
+    size_t k = run >= 3 ? 3 : run;
+    size_t close = opens && depth < MARKDOWN_MAX_NESTING
+                       ? findEmphasisClose(text, len, i + run, c, k)
+                       : len;
+    if (close == len) {
+        *pos = i + run;
+        return appendBytes(out, text + i, run);
+    }
+
+    static const char *OPEN[] = {"", "<em>", "<strong>", "<em><strong>"};
+    static const char *CLOSE[] = {"", "</em>", "</strong>", "</strong></em>"};
+    if (appendBytes(out, text + i, run - k) != 0 ||
+        appendString(out, OPEN[k]) != 0 ||
+        renderInline(out, text + i + run, close - i - run, depth + 1) != 0 ||
+        appendString(out, CLOSE[k]) != 0) {
+        return -1;
+    }
+    *pos = close + k;
+    return 0;
+}
+
+static int renderCodeSpan(struct HtmlBuffer *out,
+                          const char *text,
+                          size_t len,
+                          size_t *pos) {
+    size_t i = *pos;
+    size_t ticks = countRun(text, len, i, '`');
+    size_t close = findCodeSpanEnd(text, len, i + ticks, ticks);
+    if (close == len) {
+        *pos = i + ticks;
+        return appendBytes(out, text + i, ticks);
+    }
+
+    const char *code = text + i + ticks;
+    size_t codeLen = close - i - ticks;
+    if (codeLen >= 2 && code[0] == ' ' && code[codeLen - 1] == ' ' &&
+        !isBlank(code, codeLen)) {
+        code++;
+        codeLen -= 2;
+    }
+    *pos = close + ticks;
+    return appendString(out, "<code>") != 0 ||
+                   appendEscapedHtml(out, code, codeLen) != 0 ||
+                   appendString(out, "</code>") != 0
+               ? -1
+               : 0;
+}
+
+static int renderLink(struct HtmlBuffer *out,
+                      const char *text,
+                      size_t len,
+                      size_t *pos,
+                      unsigned int depth) {
+    size_t i = *pos;
+    bool image = text[i] == '!';
+    size_t labelStart = i + (image ? 2 : 1);
+    size_t labelEnd = findBracketClose(text, len, labelStart);
+    size_t destStart;
+    size_t destLen;
+    size_t end;
+    if (depth >= MARKDOWN_MAX_NESTING || labelEnd >= len - 1 ||
+        text[labelEnd + 1] != '(' ||
+        !parseLinkTarget(
+            text, len, labelEnd + 1, &destStart, &destLen, &end)) {
+        *pos = labelStart;
+        return appendBytes(out, text + i, labelStart - i);
+    }
+
+    const char *label = text + labelStart;
+    size_t labelLen = labelEnd - labelStart;
+    int status;
+    if (image) {
+        status = appendString(out, "<img src=\"") != 0 ||
+                         appendEscapedHtml(out, text + destStart, destLen) !=
+                             0 ||
+                         appendString(out, "\" alt=\"") != 0 ||
+                         appendEscapedHtml(out, label, labelLen) != 0 ||
+                         appendString(out, "\" />") != 0
+                     ? -1
+                     : 0;
+    } else {
+        status = appendString(out, "<a href=\"") != 0 ||
+                         appendEscapedHtml(out, text + destStart, destLen) !=
+                             0 ||
+                         appendString(out, "\">") != 0 ||
+                         renderInline(out, label, labelLen, depth + 1) != 0 ||
+                         appendString(out, "</a>") != 0
+                     ? -1
+                     : 0;
+    }
+    *pos = end;
+    return status;
+}
+
+static int renderInline(struct HtmlBuffer *out,
+                        const char *text,
+                        size_t len,
+                        unsigned int depth) {
+    size_t i = 0;
+    while (i < len) {
+        size_t run = i;
+        while (run < len && !INLINE_SPECIAL[(unsigned char)text[run]]) {
+            run++;
+        }
+        if (appendBytes(out, text + i, run - i) != 0) {
+            return -1;
+        }
+        i = run;
+        if (i >= len) {
+            break;
+        }
+
+        int status = 0;
+        size_t length;
+        switch (text[i]) {
+        case '\\':
+            if (i + 1 < len && ispunct((unsigned char)text[i + 1])) {
+                status = appendEscapedHtml(out, text + i + 1, 1);
+                i += 2;
+            } else {
+                status = appendBytes(out, "\\", 1);
+                i++;
+            }
+            break;
+        case '`':
+            status = renderCodeSpan(out, text, len, &i);
+            break;
+        case '*':
+        case '_':
+            status = renderEmphasis(out, text, len, &i, depth);
+            break;
+        case '!':
+            if (i + 1 < len && text[i + 1] == '[') {
+                status = renderLink(out, text, len, &i, depth);
+            } else {
+                status = appendBytes(out, "!", 1);
+                i++;
+            }
+            break;
+        case '[':
+            status = renderLink(out, text, len, &i, depth);
+            break;
+        case '<':
+            if ((length = autolinkLength(text, len, i)) > 0) {
+                status = appendString(out, "<a href=\"") != 0 ||
+                                 appendEscapedHtml(
+                                     out, text + i + 1, length - 2) != 0 ||
+                                 appendString(out, "\">") != 0 ||
+                                 appendEscapedHtml(
+                                     out, text + i + 1, length - 2) != 0 ||
+                                 appendString(out, "</a>") != 0
+                             ? -1
+                             : 0;
+                i += length;
+            } else {
+                status = appendString(out, "&lt;");
+                i++;
+            }
+            break;
+        case '&':
+            // references like &mdash; are kept, a lone & is escaped
+            if ((length = entityLength(text, len, i)) > 0) {
+                status = appendEntity(out, text, i, length);
+                i += length;
+            } else {
+                status = appendString(out, "&amp;");
+                i++;
+            }
+            break;
+        default: // > and "
+            status = appendEscapedHtml(out, text + i, 1);
+            i++;
+        }
+        if (status != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int storeBytes(char **buffer,
+                      size_t *used,
+                      size_t *capacity,
+                      const char *bytes,
+                      size_t len) {
+    if (len > SIZE_MAX - *used) {
+        return -1;
+    }
+    size_t needed = *used + len;
+    if (needed > *capacity) {
+        size_t grownCapacity = *capacity ? *capacity : 256;
+        while (grownCapacity < needed) {
+            grownCapacity =
+                grownCapacity > SIZE_MAX / 2 ? needed : grownCapacity * 2;
+        }
+        char *grown = realloc(*buffer, grownCapacity);
+        if (!grown) {
+            return -1;
+        }
+        *buffer = grown;
+        *capacity = grownCapacity;
+    }
+    if (len > 0) {
+        memcpy(*buffer + *used, bytes, len);
+    }
+    *used = needed;
+    return 0;
+}
+
+/* *
+ * Renders the held paragraph line. A line ending in two spaces or a backslash
+ * breaks, unless it is the last line of the paragraph.
+ * */
+static int flushPending(struct MarkdownRenderer *renderer,
+                        struct HtmlBuffer *out,
+                        bool last) {
+    if (!renderer->inParagraph) {
+        if (appendString(out, "<p>") != 0) {
+            return -1;
+        }
+        renderer->inParagraph = true;
+    }
+
+    const char *text = renderer->pending;
+    size_t len = trimTrailing(text, renderer->pendingLen);
+    bool hardBreak = false;
+    if (!last) {
+        if (renderer->pendingLen - len >= 2) {
+            hardBreak = true;
+        } else if (len > 0 && text[len - 1] == '\\') {
+            hardBreak = true;
+            len--;
+        }
+    }
+
+    renderer->hasPending = false;
+    if (renderInline(out, text, len, 0) != 0) {
+        return -1;
+    }
+    return last ? 0 : appendString(out, hardBreak ? "<br />\n" : "\n");
+}
+
+static int addParagraphLine(struct MarkdownRenderer *renderer,
+                            const char *text,
+                            size_t len,
+                            struct HtmlBuffer *out) {
+    if (renderer->hasPending && flushPending(renderer, out, false) != 0) {
+        return -1;
+    }
+
+    size_t indent;
+    leadingIndent(text, len, &indent);
+    renderer->pendingLen = 0;
+    if (storeBytes(&renderer->pending,
+                   &renderer->pendingLen,
+                   &renderer->pendingCapacity,
+                   text + indent,
+                   len - indent) != 0) {
+        return -1;
+    }
+    renderer->hasPending = true;
+    return 0;
+}
+
+static int closeParagraph(struct MarkdownRenderer *renderer,
+                          struct HtmlBuffer *out) {
+    if (renderer->hasPending && flushPending(renderer, out, true) != 0) {
+        return -1;
+    }
+    if (renderer->inParagraph) {
+        renderer->inParagraph = false;
+        return appendString(out, "</p>\n");
+    }
+    return 0;
+}
+
+static int closeQuote(struct MarkdownRenderer *renderer,
+                      struct HtmlBuffer *out) {
+    if (closeParagraph(renderer, out) != 0) {
+        return -1;
+    }
+    if (renderer->inQuote) {
+        renderer->inQuote = false;
+        return appendString(out, "</blockquote>\n");
+    }
+    return 0;
+}
+
+static int closeList(struct MarkdownRenderer *renderer,
+                     struct HtmlBuffer *out) {
+    if (renderer->list == MARKDOWN_LIST_NONE) {
+        return 0;
+    }
+    if (renderer->inItem && appendString(out, "</li>\n") != 0) {
+        return -1;
+    }
+    const char *close =
+        renderer->list == MARKDOWN_LIST_BULLET ? "</ul>\n" : "</ol>\n";
+    renderer->inItem = false;
+    renderer->list = MARKDOWN_LIST_NONE;
+    return appendString(out, close);
+}
+
+static int closeBlocks(struct MarkdownRenderer *renderer,
+                       struct HtmlBuffer *out) {
+    return closeQuote(renderer, out) != 0 || closeList(renderer, out) != 0
+               ? -1
+               : 0;
+}
+
+static unsigned int atxLevel(const char *text, size_t len) {
+    size_t hashes = countRun(text, len, 0, '#');
+    if (hashes < 1 || hashes > 6 ||
+        (hashes < len && !isSpaceOrTab(text[hashes]))) {
+        return 0;
+    }
+    return (unsigned int)hashes;
+}
+
+static int renderAtxHeading(const char *text,
+                            size_t len,
+                            unsigned int level,
+                            struct HtmlBuffer *out) {
+    size_t start = level;
+    while (start < len && isSpaceOrTab(text[start])) {
+        start++;
+    }
+    size_t end = trimTrailing(text, len);
+    // a closing run of # goes when a space sets it apart
+    size_t closing = end;
+    while (closing > start && text[closing - 1] == '#') {
+        closing--;
+    }
+    if (closing == start || isSpaceOrTab(text[closing - 1])) {
+        end = trimTrailing(text, closing);
+    }
+    if (end < start) {
+        end = start;
+    }
+
+    char open[] = "<h0>";
+    char close[] = "</h0>\n";
+    open[2] = (char)('0' + level);
+    close[3] = (char)('0' + level);
+    return appendString(out, open) != 0 ||
+                   renderInline(out, text + start, end - start, 0) != 0 ||
+                   appendString(out, close) != 0
+               ? -1
+               : 0;
+}
+
+// 1 for ===, 2 for ---, 0 if the line isn't a setext underline
+static unsigned int setextLevel(const char *text, size_t len) {
+    if (len == 0 || (text[0] != '=' && text[0] != '-')) {
+        return 0;
+    }
+    size_t run = countRun(text, len, 0, text[0]);
+    if (!isBlank(text + run, len - run)) {
+        return 0;
+    }
+    return text[0] == '=' ? 1 : 2;
+}
+
+static bool isThematicBreak(const char *text, size_t len) {
+    if (len == 0 || (text[0] != '*' && text[0] != '-' && text[0] != '_')) {
+        return false;
+    }
+    size_t marks = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == text[0]) {
+            marks++;
+        } else if (!isSpaceOrTab(text[i])) {
+            return false;
+        }
+    }
+    return marks >= 3;
+}
+
+static bool isFence(const char *text, size_t len, size_t *run) {
+    if (len == 0 || (text[0] != '`' && text[0] != '~')) {
+        return false;
+    }
+    *run = countRun(text, len, 0, text[0]);
+    // the info string of a backtick fence can't hold a backtick
+    return *run >= 3 &&
+           (text[0] == '~' || !memchr(text + *run, '`', len - *run));
+}
+
+/* *
+ * Recognises a list item marker: -, + or * followed by a space, or up to nine
+ * digits followed by . or ) and a space. offset is where the item's text
+ * starts.
+ * */
+static enum MarkdownList listItem(const char *text,
+                                  size_t len,
+                                  unsigned long *start,
+                                  size_t *offset) {
+    size_t i = 0;
+    enum MarkdownList kind = MARKDOWN_LIST_NONE;
+    if (len > 0 && (text[0] == '-' || text[0] == '+' || text[0] == '*')) {
+        kind = MARKDOWN_LIST_BULLET;
+        i = 1;
+    } else {
+        unsigned long number = 0;
+        while (i < len && i < 9 && isdigit((unsigned char)text[i])) {
+            number = number * 10 + (unsigned long)(text[i] - '0');
+            i++;
+        }
+        if (i == 0 || i >= len || (text[i] != '.' && text[i] != ')')) {
+            return MARKDOWN_LIST_NONE;
+        }
+        kind = MARKDOWN_LIST_ORDERED;
+        *start = number;
+        i++;
+    }
+
+    if (i < len && !isSpaceOrTab(text[i])) {
+        return MARKDOWN_LIST_NONE;
+    }
+    while (i < len && isSpaceOrTab(text[i])) {
+        i++;
+    }
+    *offset = i;
+    return kind;
+}
+
+static int renderListItem(struct MarkdownRenderer *renderer,
+                          enum MarkdownList kind,
+                          unsigned long start,
+                          const char *text,
+                          size_t len,
+                          struct HtmlBuffer *out) {
+    if (closeQuote(renderer, out) != 0) {
+        return -1;
+    }
+    if (renderer->list != kind && closeList(renderer, out) != 0) {
+        return -1;
+    }
+
+    if (renderer->list == MARKDOWN_LIST_NONE) {
+        char open[48] = "<ul>\n";
+        if (kind == MARKDOWN_LIST_ORDERED) {
+            // only a list that doesn't count from 1 says where it starts
+            if (start == 1) {
+                memcpy(open, "<ol>\n", sizeof("<ol>\n"));
+            } else {
+                char digits[24];
+                size_t count = 0;
+                do {
+                    digits[sizeof(digits) - 1 - count++] =
+                        (char)('0' + start % 10);
+                    start /= 10;
+                } while (start > 0);
+                memcpy(open, "<ol start=\"", 11);
+                memcpy(open + 11, digits + sizeof(digits) - count, count);
+                memcpy(open + 11 + count, "\">\n", sizeof("\">\n"));
+            }
+        }
+        if (appendString(out, open) != 0) {
+            return -1;
+        }
+        renderer->list = kind;
+    } else if (renderer->inItem && appendString(out, "</li>\n") != 0) {
+        return -1;
+    }
+
+    renderer->inItem = true;
+    return appendString(out, "<li>") != 0 ||
+                   renderInline(out, text, trimTrailing(text, len), 0) != 0
+               ? -1
+               : 0;
+}
+
+// a line that carries on the current list item
+static int continueItem(const char *text, size_t len, struct HtmlBuffer *out) {
+    size_t indent;
+    leadingIndent(text, len, &indent);
+    return appendBytes(out, "\n", 1) != 0 ||
+                   renderInline(out,
+                                text + indent,
+                                trimTrailing(text, len) - indent,
+                                0) != 0
+               ? -1
+               : 0;
+}
+
+static int renderFenceLine(struct MarkdownRenderer *renderer,
+                           const char *line,
+                           size_t len,
+                           struct HtmlBuffer *out) {
+    size_t indent;
+    size_t columns = leadingIndent(line, len, &indent);
+    if (columns < 4 && len > indent && line[indent] == renderer->fenceMarker) {
+        size_t run = countRun(line, len, indent, renderer->fenceMarker);
+        if (run >= renderer->fenceRun &&
+            isBlank(line + indent + run, len - indent - run)) {
+            renderer->inFence = false;
+            return appendString(out, "</code></pre>\n");
+        }
+    }
+
+    size_t skip = skipColumns(line, len, renderer->fenceIndent);
+    return appendEscapedHtml(out, line + skip, len - skip) != 0 ||
+                   appendBytes(out, "\n", 1) != 0
+               ? -1
+               : 0;
+}
+
+static int openFence(struct MarkdownRenderer *renderer,
+                     const char *text,
+                     size_t len,
+                     size_t run,
+                     size_t indent,
+                     struct HtmlBuffer *out) {
+    if (closeBlocks(renderer, out) != 0) {
+        return -1;
+    }
+    renderer->inFence = true;
+    renderer->fenceMarker = text[0];
+    renderer->fenceRun = run;
+    renderer->fenceIndent = indent;
+
+    // the first word of the info string names the language
+    size_t infoStart = run;
+    while (infoStart < len && isSpaceOrTab(text[infoStart])) {
+        infoStart++;
+    }
+    size_t infoEnd = infoStart;
+    while (infoEnd < len && !isSpaceOrTab(text[infoEnd])) {
+        infoEnd++;
+    }
+    if (infoEnd == infoStart) {
+        return appendString(out, "<pre><code>");
+    }
+    return appendString(out, "<pre><code class=\"language-") != 0 ||
+                   appendEscapedHtml(
+                       out, text + infoStart, infoEnd - infoStart) != 0 ||
+                   appendString(out, "\">") != 0
+               ? -1
+               : 0;
+}
+
+static int renderIndentedCode(const char *line,
+                              size_t len,
+                              struct HtmlBuffer *out) {
+    size_t skip = skipColumns(line, len, 4);
+    return appendEscapedHtml(out, line + skip, len - skip) != 0 ||
+                   appendBytes(out, "\n", 1) != 0
+               ? -1
+               : 0;
+}
+
+static int renderLine(struct MarkdownRenderer *renderer,
+                      const char *line,
+                      size_t len,
+                      struct HtmlBuffer *out) {
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    if (renderer->inFence) {
+        return renderFenceLine(renderer, line, len, out);
+    }
+
+    size_t indent;
+    size_t columns = leadingIndent(line, len, &indent);
+    bool blank = indent == len;
+    if (renderer->inIndentedCode) {
+        if (blank) {
+            renderer->blankCodeLines++;
+            return 0;
+        }
+        if (columns >= 4) {
+            for (; renderer->blankCodeLines > 0; renderer->blankCodeLines--) {
+                if (appendBytes(out, "\n", 1) != 0) {
+                    return -1;
+                }
+            }
+            return renderIndentedCode(line, len, out);
+        }
+        renderer->inIndentedCode = false;
+        renderer->blankCodeLines = 0;
+        if (appendString(out, "</code></pre>\n") != 0) {
+            return -1;
+        }
+    }
+
+    // a list carries on past a blank line if another item follows
+    if (blank) {
+        renderer->blankBefore = true;
+        return closeQuote(renderer, out);
+    }
+    bool blankBefore = renderer->blankBefore;
+    renderer->blankBefore = false;
+
+    bool inParagraph = renderer->hasPending || renderer->inParagraph;
+    if (columns >= 4) {
+        if (inParagraph) {
+            return addParagraphLine(renderer, line, len, out);
+        }
+        if (renderer->list != MARKDOWN_LIST_NONE) {
+            return continueItem(line, len, out);
+        }
+        if (closeQuote(renderer, out) != 0 ||
+            appendString(out, "<pre><code>") != 0) {
+            return -1;
+        }
+        renderer->inIndentedCode = true;
+        return renderIndentedCode(line, len, out);
+    }
+
+    const char *text = line + indent;
+    size_t textLen = len - indent;
+    size_t run;
+    unsigned int level;
+    unsigned long start = 1;
+    size_t offset;
+    enum MarkdownList kind;
+
+    if (text[0] == '>') {
+        size_t skip = textLen > 1 && isSpaceOrTab(text[1]) ? 2 : 1;
+        if (!renderer->inQuote) {
+            if (closeParagraph(renderer, out) != 0 ||
+                closeList(renderer, out) != 0 ||
+                appendString(out, "<blockquote>\n") != 0) {
+                return -1;
+            }
+            renderer->inQuote = true;
+        }
+        if (isBlank(text + skip, textLen - skip)) {
+            return closeParagraph(renderer, out);
+        }
+        return addParagraphLine(renderer, text + skip, textLen - skip, out);
+    }
+    if (isFence(text, textLen, &run)) {
+        return openFence(renderer, text, textLen, run, columns, out);
+    }
+    if ((level = atxLevel(text, textLen)) > 0) {
+        return closeBlocks(renderer, out) != 0 ||
+                       renderAtxHeading(text, textLen, level, out) != 0
+                   ? -1
+                   : 0;
+    }
+    if (renderer->hasPending && !renderer->inQuote &&
+        (level = setextLevel(text, textLen)) > 0) {
+        // the paragraph so far stays one; only its last line is underlined
+        renderer->hasPending = false;
+        if (renderer->inParagraph) {
+            renderer->inParagraph = false;
+            if (appendString(out, "</p>\n") != 0) {
+                return -1;
+            }
+        }
+        char open[] = "<h0>";
+        char close[] = "</h0>\n";
+        open[2] = (char)('0' + level);
+        close[3] = (char)('0' + level);
+        return appendString(out, open) != 0 ||
+                       renderInline(out,
+                                    renderer->pending,
+                                    trimTrailing(renderer->pending,
+                                                 renderer->pendingLen),
+                                    0) != 0 ||
+                       appendString(out, close) != 0
+                   ? -1
+                   : 0;
+    }
+    if (isThematicBreak(text, textLen)) {
+        return closeBlocks(renderer, out) != 0 ||
+                       appendString(out, "<hr />\n") != 0
+                   ? -1
+                   : 0;
+    }
+    if ((kind = listItem(text, textLen, &start, &offset)) !=
+        MARKDOWN_LIST_NONE) {
+        if (closeParagraph(renderer, out) != 0) {
+            return -1;
+        }
+        return renderListItem(
+            renderer, kind, start, text + offset, textLen - offset, out);
+    }
+    if (renderer->list != MARKDOWN_LIST_NONE) {
+        if (!blankBefore || columns >= 2) {
+            return continueItem(text, textLen, out);
+        }
+        if (closeList(renderer, out) != 0) {
+            return -1;
+        }
+    }
+    // an unmarked line carries on a quoted paragraph
+    if (renderer->inQuote && !inParagraph && closeQuote(renderer, out) != 0) {
+        return -1;
+    }
+    return addParagraphLine(renderer, text, textLen, out);
+}
+
+void markdownInit(struct MarkdownRenderer *renderer) {
+    memset(renderer, 0, sizeof(*renderer));
+}
+
+int markdownUpdate(struct MarkdownRenderer *renderer,
+                   const void *data,
+                   size_t len,
+                   struct HtmlBuffer *out) {
+    const char *bytes = data;
+    while (len > 0) {
+        const char *newline = memchr(bytes, '\n', len);
+        if (!newline) {
+            return storeBytes(&renderer->line,
+                              &renderer->lineLen,
+                              &renderer->lineCapacity,
+                              bytes,
+                              len);
+        }
+
+        // whole lines are rendered in place, only split ones are copied
+        size_t part = (size_t)(newline - bytes);
+        int status;
+        if (renderer->lineLen > 0) {
+            status = storeBytes(&renderer->line,
+                                &renderer->lineLen,
+                                &renderer->lineCapacity,
+                                bytes,
+                                part);
+            if (status == 0) {
+                status = renderLine(
+                    renderer, renderer->line, renderer->lineLen, out);
+            }
+            renderer->lineLen = 0;
+        } else {
+            status = renderLine(renderer, bytes, part, out);
+        }
+        if (status != 0) {
+            return -1;
+        }
+        bytes += part + 1;
+        len -= part + 1;
+    }
+    return 0;
+}
+
+int markdownFinish(struct MarkdownRenderer *renderer, struct HtmlBuffer *out) {
+    int status = 0;
+    if (renderer->lineLen > 0) {
+        status = renderLine(renderer, renderer->line, renderer->lineLen, out);
+        renderer->lineLen = 0;
+    }
+    if (status == 0 && (renderer->inFence || renderer->inIndentedCode)) {
+        status = appendString(out, "</code></pre>\n");
+    }
+    if (status == 0) {
+        status = closeBlocks(renderer, out);
+    }
+
+    // keep the buffers for the next source
+    renderer->hasPending = false;
+    renderer->inParagraph = false;
+    renderer->inQuote = false;
+    renderer->list = MARKDOWN_LIST_NONE;
+    renderer->inItem = false;
+    renderer->blankBefore = false;
+    renderer->inFence = false;
+    renderer->inIndentedCode = false;
+    renderer->blankCodeLines = 0;
+    return status;
+}
+
+void markdownFree(struct MarkdownRenderer *renderer) {
+    free(renderer->line);
+    free(renderer->pending);
+    markdownInit(renderer);
+}
+
+int appendHtml(struct HtmlBuffer *out, const char *text) {
+    return appendString(out, text);
+}
+
+void freeHtmlBuffer(struct HtmlBuffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->len = 0;
+    buffer->capacity = 0;
+}
@@ -0,0 +1,128 @@
+#ifndef MARKDOWN_H
+#define MARKDOWN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *
+ * Growable buffer the renderer appends HTML to.
+ * */
+struct HtmlBuffer {
+    char *data;
+    size_t len;
+    size_t capacity;
+};
+
+enum MarkdownList {
+    MARKDOWN_LIST_NONE,
+    MARKDOWN_LIST_BULLET,
+    MARKDOWN_LIST_ORDERED,
+};
+
+/* *
+ * Streaming renderer for the subset of CommonMark drafts use: ATX and setext
+ * headings, paragraphs with hard breaks, block quotes of paragraphs, tight
+ * bullet and ordered lists, fenced and indented code, thematic breaks, and
+ * inline emphasis, code spans, links, images and autolinks. Raw HTML is
+ * escaped rather than passed through. Void elements are self-closed and named
+ * references written by number, so the output is also well-formed XHTML.
+ *
+ * The source is fed in chunks of any size and rendered a line at a time. Only
+ * the current line and the last paragraph line are held, the one a setext
+ * underline can still turn into a heading, so memory doesn't grow with the
+ * file. An underline makes just that last line a heading; lines above it stay
+ * a paragraph.
+ * */
+struct MarkdownRenderer {
+    char *line; // current line when it spans chunks
+    size_t lineLen;
+    size_t lineCapacity;
+    char *pending; // last paragraph line, not yet rendered
+    size_t pendingLen;
+    size_t pendingCapacity;
+    bool hasPending;
+    bool inParagraph; // <p> written and not yet closed
+    bool inQuote;
+    enum MarkdownList list;
+    bool inItem;
+    bool blankBefore; // the previous line was blank
+    bool inFence;
+    char fenceMarker;
+    size_t fenceRun;
+    size_t fenceIndent;
+    bool inIndentedCode;
+    size_t blankCodeLines; // blank lines inside indented code, not yet written
+};
+
+/* *
+ * @param  renderer  Renderer to initialize; nothing is allocated yet
+ * */
+void markdownInit(struct MarkdownRenderer *renderer);
+
+/* *
+ * Renders every complete line in the next chunk of the source. A line cut off
+ * by the end of the chunk is kept until the rest of it arrives.
+ *
+ * @param   renderer  Renderer state
+ * @param   data      Next bytes of the source, UTF-8
+ * @param   len       Number of bytes in data
+ * @param   out       Buffer the HTML is appended to
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if memory could not be allocated
+ * */
+int markdownUpdate(struct MarkdownRenderer *renderer,
+                   const void *data,
+                   size_t len,
+                   struct HtmlBuffer *out);
+
+/* *
+ * Renders the last line, which may have no line feed, and closes every open
+ * block. The renderer is ready for the next source afterwards.
+ *
+ * @param   renderer  Renderer state
+ * @param   out       Buffer the HTML is appended to
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if memory could not be allocated
+ * */
+int markdownFinish(struct MarkdownRenderer *renderer, struct HtmlBuffer *out);
+
+/* *
+ * @param  renderer  Renderer to free
+ * */
+void markdownFree(struct MarkdownRenderer *renderer);
+
+/* *
+ * Appends text with &, <, > and " escaped.
+ *
+ * @param   out   Buffer to append to
+ * @param   text  Text to escape
+ * @param   len   Number of bytes in text
+ *
+ * @return  int
+ *          0     on success
+ *         -1     if the buffer could not be grown
+ * */
+int appendEscapedHtml(struct HtmlBuffer *out, const char *text, size_t len);
+
+/* *
+ * Appends markup as it is.
+ *
+ * @param   out   Buffer to append to
+ * @param   text  Markup, NUL-terminated
+ *
+ * @return  int
+ *          0     on success
+ *         -1     if the buffer could not be grown
+ * */
+int appendHtml(struct HtmlBuffer *out, const char *text);
+
+/* *
+ * @param  buffer  Buffer to free
+ * */
+void freeHtmlBuffer(struct HtmlBuffer *buffer);
+
+#endif
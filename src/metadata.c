@@ -0,0 +1,186 @@
+#include "metadata.h"
+#include "files.h"
+#include "reporting.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int parseMetaExclude(const char *arg, struct MetaExclude *exclude) {
+    if (!arg || !exclude) {
+        return -1;
+    }
+
+    const char *equals = strchr(arg, '=');
+    if (!equals || equals == arg) {
+        return -1;
+    }
+
+    exclude->key = arg;
+    exclude->keyLen = (size_t)(equals - arg);
+    exclude->value = equals + 1;
+
+    return 0;
+}
+
+bool isMetaExcluded(const struct MetaTable *table,
+                    const struct MetaField *fields,
+                    size_t fieldCount) {
+    for (size_t e = 0; e < table->excludeCount; e++) {
+        const struct MetaExclude *exclude = &table->excludes[e];
+        for (size_t f = 0; f < fieldCount; f++) {
+            if (strlen(fields[f].key) == exclude->keyLen &&
+                strncmp(fields[f].key, exclude->key, exclude->keyLen) == 0 &&
+                strcmp(fields[f].value, exclude->value) == 0) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int appendMetaRow(struct MetaTable *table,
+                  const char *path,
+                  struct MetaField *fields,
+                  size_t fieldCount) {
+    if (table->count == table->capacity) {
+        size_t newCapacity = table->capacity ? table->capacity * 2 : 64;
+        struct MetaRow *grown =
+            realloc(table->rows, newCapacity * sizeof(struct MetaRow));
+        if (!grown) {
+            freeMetaFields(fields, fieldCount);
+            return -1;
+        }
+        table->rows = grown;
+        table->capacity = newCapacity;
+    }
+
+    size_t pathLen = strlen(path) + 1;
+    char *pathCopy = malloc(pathLen);
+    if (!pathCopy) {
+        freeMetaFields(fields, fieldCount);
+        return -1;
+    }
+    memcpy(pathCopy, path, pathLen);
+
+    table->rows[table->count] = (struct MetaRow){
+        .path = pathCopy, .fields = fields, .fieldCount = fieldCount};
+    table->count++;
+
+    return 0;
+}
+
+static void writeCell(FILE *out, const char *value) {
+    for (const char *c = value; *c; c++) {
+        fputc((*c == '\t' || *c == '\n' || *c == '\r') ? ' ' : *c, out);
+    }
+}
+
+/* *
+ * Collects column names in order of first appearance. Tables are a row per
+ * scene with a handful of keys, so a linear search is plenty.
+ * */
+static const char **collectKeys(const struct MetaTable *table, size_t *keyCount) {
+    size_t capacity = 0;
+    for (size_t r = 0; r < table->count; r++) {
+        capacity += table->rows[r].fieldCount;
+    }
+
+    const char **keys = malloc((capacity ? capacity : 1) * sizeof(char *));
+    if (!keys) {
+        return NULL;
+    }
+
+    *keyCount = 0;
+    for (size_t r = 0; r < table->count; r++) {
+        for (size_t f = 0; f < table->rows[r].fieldCount; f++) {
+            const char *key = table->rows[r].fields[f].key;
+            size_t k = 0;
+            while (k < *keyCount && strcmp(keys[k], key) != 0) {
+                k++;
+            }
+            if (k == *keyCount) {
+                keys[*keyCount] = key;
+                (*keyCount)++;
+            }
+        }
+    }
+
+    return keys;
+}
+
+static const char *findValue(const struct MetaRow *row, const char *key) {
+    for (size_t f = 0; f < row->fieldCount; f++) {
+        if (strcmp(row->fields[f].key, key) == 0) {
+            return row->fields[f].value;
+        }
+    }
+    return "";
+}
+
+int writeMetaTable(const struct MetaTable *table,
+                   const char *outPath,
+                   const char *rootDir) {
+    size_t keyCount = 0;
+    const char **keys = collectKeys(table, &keyCount);
+    if (!keys) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_COLLATE, outPath, PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+
+    errno = 0;
+    FILE *out = fopen(outPath, "w");
+    if (!out) {
+        reportFileError(FILE_OP_OPEN, outPath);
+        free(keys);
+        return -1;
+    }
+
+    fputs("path", out);
+    for (size_t k = 0; k < keyCount; k++) {
+        fputc('\t', out);
+        writeCell(out, keys[k]);
+    }
+    fputc('\n', out);
+
+    for (size_t r = 0; r < table->count; r++) {
+        writeCell(out, relativePath(table->rows[r].path, rootDir));
+        for (size_t k = 0; k < keyCount; k++) {
+            fputc('\t', out);
+            writeCell(out, findValue(&table->rows[r], keys[k]));
+        }
+        fputc('\n', out);
+    }
+    free(keys);
+
+    int status = 0;
+    errno = 0;
+    if (ferror(out)) {
+        status = -1;
+    }
+    if (fclose(out) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        reportFileError(FILE_OP_WRITE, outPath);
+    }
+
+    return status;
+}
+
+void freeMetaTable(struct MetaTable *table) {
+    if (!table) {
+        return;
+    }
+
+    for (size_t r = 0; r < table->count; r++) {
+        free(table->rows[r].path);
+        freeMetaFields(table->rows[r].fields, table->rows[r].fieldCount);
+    }
+    free(table->rows);
+    table->rows = NULL;
+    table->count = 0;
+    table->capacity = 0;
+}
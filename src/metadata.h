@@ -0,0 +1,103 @@
+#ifndef METADATA_H
+#define METADATA_H
+
+#include "frontmatter.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *
+ * A KEY=VALUE rule from --exclude. Files whose front matter has a field with
+ * that key and value are left out of the draft and the metadata table. Both
+ * strings point into argv; key is not NUL terminated at keyLen.
+ * */
+struct MetaExclude {
+    const char *key;
+    size_t keyLen;
+    const char *value;
+};
+
+/* *
+ * One row of the metadata table: a collated file and its front matter fields.
+ * */
+struct MetaRow {
+    char *path;
+    struct MetaField *fields;
+    size_t fieldCount;
+};
+
+/* *
+ * Front matter of every collated file, in draft order.
+ * */
+struct MetaTable {
+    struct MetaRow *rows;
+    size_t count;
+    size_t capacity;
+    const struct MetaExclude *excludes;
+    size_t excludeCount;
+};
+
+/* *
+ * Parses a KEY=VALUE argument.
+ *
+ * @param   arg      Argument text, kept by reference
+ * @param   exclude  Receives the parsed rule
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if there is no '=' or the key is empty
+ * */
+int parseMetaExclude(const char *arg, struct MetaExclude *exclude);
+
+/* *
+ * @param   table       Table holding the exclude rules
+ * @param   fields      Front matter fields of a file
+ * @param   fieldCount  Number of fields
+ *
+ * @return  bool        true if any exclude rule matches a field
+ * */
+bool isMetaExcluded(const struct MetaTable *table,
+                    const struct MetaField *fields,
+                    size_t fieldCount);
+
+/* *
+ * Appends a row, taking ownership of fields (freed here on failure too).
+ *
+ * @param   table       Table to append to
+ * @param   path        Path of the collated file, copied
+ * @param   fields      Front matter fields, may be NULL
+ * @param   fieldCount  Number of fields
+ *
+ * @return  int
+ *          0           on success
+ *         -1           if memory could not be allocated
+ * */
+int appendMetaRow(struct MetaTable *table,
+                  const char *path,
+                  struct MetaField *fields,
+                  size_t fieldCount);
+
+/* *
+ * Writes the table as tab separated values: a header of "path" followed by
+ * every key in order of first appearance, then one row per file with paths
+ * relative to rootDir. Tabs and line breaks inside values become spaces.
+ *
+ * @param   table    Table to write
+ * @param   outPath  File to create or overwrite
+ * @param   rootDir  Project root, stripped from row paths
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if the file could not be written
+ * */
+int writeMetaTable(const struct MetaTable *table,
+                   const char *outPath,
+                   const char *rootDir);
+
+/* *
+ * Frees every row and resets the table to empty.
+ *
+ * @param  table  Table to free
+ * */
+void freeMetaTable(struct MetaTable *table);
+
+#endif
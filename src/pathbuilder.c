@@ -0,0 +1,138 @@
+#include "errors.h"
+#include "pathbuilder.h"
+#include "reporting.h"
+#include <errno.h>
+#include <string.h>
+
+int pathBuilderSet(struct PathBuilder *builder, const char *root) {
+    builder->len = 0;
+    builder->nameStart = 0;
+    builder->depth = 0;
+    builder->path[0] = '\0';
+
+    if (!root || root[0] == '\0') {
+        reportFileError(PATH_OP_VALIDATE, "path joining");
+        return -1;
+    }
+    size_t rootLen = strnlen(root, sizeof(builder->path));
+    if (rootLen > COLETTE_MAX_PATH_LEN) {
+        reportFileError(PATH_OP_BUFFER, root);
+        return -1;
+    }
+
+    memcpy(builder->path, root, rootLen + 1);
+    builder->len = rootLen;
+
+    // the last name, not counting a trailing slash
+    size_t end = rootLen - 1;
+    while (end > 0 && root[end - 1] != '/') {
+        end--;
+    }
+    builder->nameStart = end;
+    return 0;
+}
+
+// remembers where to pop back to; only called once a push is known to fit
+static void saveLevel(struct PathBuilder *builder) {
+    builder->lens[builder->depth] = builder->len;
+    builder->nameStarts[builder->depth] = builder->nameStart;
+    builder->depth++;
+}
+
+int pathBuilderPush(struct PathBuilder *builder, const char *component) {
+    if (!component) {
+        reportFileError(PATH_OP_VALIDATE, "path joining");
+        return -1;
+    }
+    if (builder->len == 0 || component[0] == '\0') {
+        reportFileError(PATH_OP_VALIDATE, "path joining");
+        return -1;
+    }
+    if (builder->depth == COLETTE_PATH_COMPONENTS) {
+        reportFileError(PATH_OP_BUFFER, builder->path);
+        return -1;
+    }
+
+    size_t componentLen = strnlen(component, sizeof(builder->path));
+    if (componentLen >= sizeof(builder->path)) {
+        // strnlen did not encounter null terminator
+        reportFileError(PATH_OP_VALIDATE, "path joining");
+        return -1;
+    }
+    if (component[0] == '/') {
+        reportFileError(PATH_OP_ABS_FILE, component);
+        return -1;
+    }
+    if (componentLen > COLETTE_NAME_BUF_SIZE) {
+        reportFileError(PATH_OP_COMPONENT, component);
+        return -1;
+    }
+
+    // slash and null terminator, as handlePathBufTrailingSlashPad() counts
+    size_t extraChars = builder->path[builder->len - 1] == '/' ? 1 : 2;
+    if (builder->len + componentLen + extraChars > COLETTE_MAX_PATH_LEN) {
+        reportFileError(PATH_OP_JOIN, "path joining");
+        return -1;
+    }
+
+    saveLevel(builder);
+    if (extraChars == 2) {
+        builder->path[builder->len++] = '/';
+    }
+    builder->nameStart = builder->len;
+    memcpy(builder->path + builder->len, component, componentLen + 1);
+    builder->len += componentLen;
+    return 0;
+}
+
+int pathBuilderPushExtension(struct PathBuilder *builder, const char *ext) {
+    if (!ext) {
+        errno = 0; // ideally we shouldn't be relying on errno for reporting
+        reportFileError(FILE_OP_JOIN, "extension joining");
+        return -1;
+    }
+    if (builder->len == 0 || ext[0] != '.') {
+        reportFileError(FILE_OP_ACCESS, "extension joining");
+        return -1;
+    }
+    if (builder->depth == COLETTE_PATH_COMPONENTS) {
+        reportFileError(PATH_OP_BUFFER, builder->path);
+        return -1;
+    }
+
+    size_t extLen = strnlen(ext, COLETTE_EXT_BUF_SIZE);
+    size_t nameLen = builder->len - builder->nameStart;
+    if (extLen >= COLETTE_EXT_BUF_SIZE ||
+        builder->len + extLen + 1 > COLETTE_MAX_PATH_LEN ||
+        nameLen + 1 + extLen > COLETTE_NAME_BUF_SIZE) {
+        reportFileError(FILE_OP_JOIN, "extension joining");
+        return -1;
+    }
+
+    saveLevel(builder);
+    memcpy(builder->path + builder->len, ext, extLen + 1);
+    builder->len += extLen;
+    return 0;
+}
+
+void pathBuilderPop(struct PathBuilder *builder) {
+    if (builder->depth == 0) {
+        return;
+    }
+
+    builder->depth--;
+    builder->len = builder->lens[builder->depth];
+    builder->nameStart = builder->nameStarts[builder->depth];
+    builder->path[builder->len] = '\0';
+}
+
+void pathBuilderPopTo(struct PathBuilder *builder, size_t depth) {
+    if (depth >= builder->depth) {
+        return;
+    }
+
+    builder->depth = depth;
+    builder->len = builder->lens[depth];
+    builder->nameStart = builder->nameStarts[depth];
+    builder->path[builder->len] = '\0';
+}
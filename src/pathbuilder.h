@@ -0,0 +1,80 @@
+#ifndef PATHBUILDER_H
+#define PATHBUILDER_H
+
+#include "constants.h"
+#include <stddef.h>
+
+/* *
+ * One path built up a component at a time in a single buffer, for walks that
+ * visit many entries of the same directory. Pushing a component copies only
+ * its own bytes and popping one just restores the previous length, where
+ * joinPath() would measure and copy the whole directory path again for every
+ * entry. Pushes apply the same checks joinPath() and joinExtension() do and
+ * report failures the same way.
+ *
+ * path is always null terminated and can be handed to anything taking a path.
+ * */
+struct PathBuilder {
+    char path[COLETTE_PATH_BUF_SIZE];
+    size_t len;
+    size_t nameStart; // offset of the last component, for extension checks
+    size_t depth;     // components pushed above the root
+    size_t lens[COLETTE_PATH_COMPONENTS];       // len before each push
+    size_t nameStarts[COLETTE_PATH_COMPONENTS]; // nameStart before each push
+};
+
+/* *
+ * Empties the builder and makes root its base, which can't be popped.
+ *
+ * @param   builder  Builder to reset
+ * @param   root     Path to build on; may end in a slash
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if root is empty or too long; the builder is left empty
+ * */
+int pathBuilderSet(struct PathBuilder *builder, const char *root);
+
+/* *
+ * Appends a slash, unless the path already ends in one, and component.
+ *
+ * @param   builder    Builder holding a root
+ * @param   component  Relative name to append; must not be absolute
+ *
+ * @return  int
+ *          0          on success
+ *         -1          if component is invalid or the result too long; the
+ *                     path is unchanged
+ * */
+int pathBuilderPush(struct PathBuilder *builder, const char *component);
+
+/* *
+ * Appends ext to the last component as a component of its own, so popping it
+ * restores the name without the extension.
+ *
+ * @param   builder  Builder holding a root
+ * @param   ext      Extension to append (must start with '.')
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if ext is invalid or the name too long; the path is
+ *                   unchanged
+ * */
+int pathBuilderPushExtension(struct PathBuilder *builder, const char *ext);
+
+/* *
+ * Removes the last component or extension pushed. Does nothing at the root.
+ *
+ * @param  builder  Builder to pop
+ * */
+void pathBuilderPop(struct PathBuilder *builder);
+
+/* *
+ * Pops components until depth are left.
+ *
+ * @param  builder  Builder to pop
+ * @param  depth    Components to keep above the root
+ * */
+void pathBuilderPopTo(struct PathBuilder *builder, size_t depth);
+
+#endif
@@ -0,0 +1,180 @@
+#include "pipeline.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int writeAll(int fd, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+static void *drainRing(void *pipelineArg) {
+    struct WritePipeline *pipeline = pipelineArg;
+
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;) {
+        while (pipeline->tail == pipeline->head && !pipeline->stopping) {
+            pthread_cond_wait(&pipeline->filled, &pipeline->lock);
+        }
+        if (pipeline->tail == pipeline->head) {
+            break; // stopping and nothing left
+        }
+
+        size_t slot = pipeline->tail % COLETTE_PIPELINE_SLOTS;
+        size_t len = pipeline->lengths[slot];
+        bool failed = pipeline->error != 0;
+        pthread_mutex_unlock(&pipeline->lock);
+
+        // after a failure the ring is still drained so the producer never
+        // waits on a writer that has given up
+        int writeErrno = 0;
+        if (!failed &&
+            writeAll(pipeline->fd,
+                     pipeline->buffers + slot * COLETTE_PIPELINE_BUF_SIZE,
+                     len) != 0) {
+            writeErrno = errno ? errno : EIO;
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        if (writeErrno) {
+            pipeline->error = writeErrno;
+        }
+        pipeline->tail++;
+        pthread_cond_signal(&pipeline->drained);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+int pipelineStart(struct WritePipeline *pipeline, int fd) {
+    *pipeline = (struct WritePipeline){.fd = fd};
+    pipeline->buffers =
+        malloc((size_t)COLETTE_PIPELINE_SLOTS * COLETTE_PIPELINE_BUF_SIZE);
+    if (!pipeline->buffers) {
+        return -1;
+    }
+    if (pthread_mutex_init(&pipeline->lock, NULL) != 0) {
+        free(pipeline->buffers);
+        return -1;
+    }
+    if (pthread_cond_init(&pipeline->filled, NULL) != 0) {
+        pthread_mutex_destroy(&pipeline->lock);
+        free(pipeline->buffers);
+        return -1;
+    }
+    if (pthread_cond_init(&pipeline->drained, NULL) != 0) {
+        pthread_cond_destroy(&pipeline->filled);
+        pthread_mutex_destroy(&pipeline->lock);
+        free(pipeline->buffers);
+        return -1;
+    }
+    if (pthread_create(&pipeline->writer, NULL, drainRing, pipeline) != 0) {
+        pthread_cond_destroy(&pipeline->drained);
+        pthread_cond_destroy(&pipeline->filled);
+        pthread_mutex_destroy(&pipeline->lock);
+        free(pipeline->buffers);
+        return -1;
+    }
+
+    pipeline->running = true;
+    return 0;
+}
+
+// hands the buffer being filled to the writer
+static void publishBuffer(struct WritePipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->lengths[pipeline->head % COLETTE_PIPELINE_SLOTS] =
+        pipeline->fill;
+    pipeline->head++;
+    pthread_cond_signal(&pipeline->filled);
+    pthread_mutex_unlock(&pipeline->lock);
+    pipeline->fill = 0;
+}
+
+// waits until the writer is at most `ahead` buffers behind
+static int waitForWriter(struct WritePipeline *pipeline, size_t ahead) {
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->head - pipeline->tail > ahead && !pipeline->error) {
+        pthread_cond_wait(&pipeline->drained, &pipeline->lock);
+    }
+    int error = pipeline->error;
+    pthread_mutex_unlock(&pipeline->lock);
+
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+int pipelineWrite(struct WritePipeline *pipeline,
+                  const void *data,
+                  size_t len) {
+    const unsigned char *bytes = data;
+    while (len > 0) {
+        // a fresh buffer is only taken once the writer has let go of it
+        if (pipeline->fill == 0 &&
+            waitForWriter(pipeline, COLETTE_PIPELINE_SLOTS - 1) != 0) {
+            return -1;
+        }
+
+        size_t slot = pipeline->head % COLETTE_PIPELINE_SLOTS;
+        size_t room = COLETTE_PIPELINE_BUF_SIZE - pipeline->fill;
+        size_t chunk = len < room ? len : room;
+        memcpy(pipeline->buffers + slot * COLETTE_PIPELINE_BUF_SIZE +
+                   pipeline->fill,
+               bytes,
+               chunk);
+        pipeline->fill += chunk;
+        bytes += chunk;
+        len -= chunk;
+
+        if (pipeline->fill == COLETTE_PIPELINE_BUF_SIZE) {
+            publishBuffer(pipeline);
+        }
+    }
+    return 0;
+}
+
+int pipelineFlush(struct WritePipeline *pipeline) {
+    if (pipeline->fill > 0) {
+        publishBuffer(pipeline);
+    }
+    return waitForWriter(pipeline, 0);
+}
+
+int pipelineStop(struct WritePipeline *pipeline) {
+    if (!pipeline || !pipeline->running) {
+        return 0;
+    }
+
+    int status = pipelineFlush(pipeline);
+    int savedErrno = errno;
+
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->stopping = true;
+    pthread_cond_signal(&pipeline->filled);
+    pthread_mutex_unlock(&pipeline->lock);
+    pthread_join(pipeline->writer, NULL);
+
+    pthread_cond_destroy(&pipeline->drained);
+    pthread_cond_destroy(&pipeline->filled);
+    pthread_mutex_destroy(&pipeline->lock);
+    free(pipeline->buffers);
+    pipeline->buffers = NULL;
+    pipeline->running = false;
+
+    errno = savedErrno;
+    return status;
+}
@@ -0,0 +1,87 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "constants.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *
+ * Hands draft bytes to a writer thread so reading and transforming the next
+ * file overlaps writing the last one. Bytes are copied into a ring of
+ * COLETTE_PIPELINE_SLOTS fixed buffers; the writer drains full buffers to the
+ * file descriptor in order, and a producer that gets a whole ring ahead waits
+ * for it, so memory stays constant however large the draft.
+ *
+ * Only one thread may call pipelineWrite and pipelineFlush. Nothing else may
+ * write to the descriptor until pipelineStop returns.
+ * */
+struct WritePipeline {
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;  // signalled when a buffer is ready or on stop
+    pthread_cond_t drained; // signalled when the writer frees a buffer
+    unsigned char *buffers; // COLETTE_PIPELINE_SLOTS buffers back to back
+    size_t lengths[COLETTE_PIPELINE_SLOTS];
+    size_t head;            // buffers handed to the writer so far
+    size_t tail;            // buffers the writer has finished with
+    size_t fill;            // bytes in the buffer being filled
+    int fd;
+    int error;              // errno of the first failed write, or 0
+    bool stopping;
+    bool running;
+};
+
+/* *
+ * Starts the writer thread.
+ *
+ * @param   pipeline  Pipeline to start
+ * @param   fd        Descriptor the writer writes to
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if memory or the thread could not be had; the caller
+ *                    should write directly instead
+ * */
+int pipelineStart(struct WritePipeline *pipeline, int fd);
+
+/* *
+ * Copies bytes into the ring, waiting for the writer when it is full.
+ *
+ * @param   pipeline  Running pipeline
+ * @param   data      Bytes to write
+ * @param   len       Number of bytes in data
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if an earlier write failed; errno is set to its error
+ * */
+int pipelineWrite(struct WritePipeline *pipeline,
+                  const void *data,
+                  size_t len);
+
+/* *
+ * Hands over the buffer being filled and waits until everything written so
+ * far is on the descriptor.
+ *
+ * @param   pipeline  Running pipeline
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if a write failed; errno is set to its error
+ * */
+int pipelineFlush(struct WritePipeline *pipeline);
+
+/* *
+ * Flushes, then stops the writer thread and frees the ring. Does nothing if
+ * the pipeline isn't running.
+ *
+ * @param   pipeline  Pipeline to stop
+ *
+ * @return  int
+ *          0         on success
+ *         -1         if a write failed; errno is set to its error
+ * */
+int pipelineStop(struct WritePipeline *pipeline);
+
+#endif
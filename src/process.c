@@ -1,10 +1,25 @@
+#include "analyze.h"
+#include "check.h"
 #include "constants.h"
+#include "diagnostics.h"
+#include "dupes.h"
+#include "encoding.h"
+#include "epub.h"
 #include "errors.h"
 #include "files.h"
+#include "grep.h"
+#include "html.h"
 #include "init.h"
+#include "metadata.h"
 #include "process.h"
 #include "reporting.h"
+#include "spell.h"
+#include "toc.h"
+#include "utf8.h"
+#include "wordindex.h"
+#include "workers.h"
 #include <errno.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,31 +36,63 @@ static void freeProcessContext(struct ProcessContext *context) {
         return;
     }
 
-    if (context->currentFilePath) {
-        free(context->currentFilePath);
-        context->currentFilePath = NULL;
-    }
+    context->currentFilePath = NULL; // the iterator's path builder
     if (context->outPath) {
         free(context->outPath);
         context->outPath = NULL;
     }
+    // the writer thread must be done with the draft before it is closed
+    pipelineStop(context->pipeline);
     if (context->outFile) {
         fclose(context->outFile);
     }
+    if (context->currentFd >= 0) {
+        close(context->currentFd);
+        context->currentFd = -1;
+    }
+    readaheadFree(context->readahead);
+    filterFree(&context->filter);
+    transcoderFree(&context->transcoder);
+    freeTemplateBuffer(&context->rendered);
+    frontMatterFree(&context->frontMatter);
+    freeMetaTable(context->metaTable);
 }
 
-static void freeIndexState(struct IndexState *indexState) {
-    if (!indexState) {
+static void freeIndexState(struct FileIterator *iter,
+                           struct IndexState *indexState) {
+    if (!iter || !indexState) {
         return;
     }
 
-    if (indexState->curIndexFileDir) {
-        free(indexState->curIndexFileDir);
-        indexState->curIndexFileDir = NULL;
-    }
     if (indexState->curIndexFile) {
         fclose(indexState->curIndexFile);
     }
+
+    traceEnd(indexState->parseSpan,
+             TRACE_INDEX_PARSE,
+             indexState->curIndexFileDir,
+             -1);
+
+    // the path and the buffer fclose just let go of
+    arenaRelease(&iter->arena, indexState->mark);
+    indexState->curIndexFileDir = NULL;
+}
+
+static struct IndexState *popIndexState(struct FileIterator *iter) {
+    if (!iter) {
+        return NULL;
+    }
+    if (!iter->stack) {
+        return NULL;
+    }
+    if (iter->stackSize < 1) {
+        return NULL;
+    }
+
+    struct IndexState *poppedItem = &iter->stack[iter->stackSize - 1];
+    iter->stackSize--;
+
+    return poppedItem;
 }
 
 static void freeProjectState(struct ProjectState *state) {
@@ -53,26 +100,36 @@ static void freeProjectState(struct ProjectState *state) {
         return;
     }
 
+    // levels still open when a run stops early; their buffers are in the arena
+    while (state->iter.stackSize > 0) {
+        freeIndexState(&state->iter, popIndexState(&state->iter));
+    }
     if (state->iter.stack != NULL) {
         free(state->iter.stack);
         state->iter.stack = NULL;
     }
+    freeArena(&state->iter.arena);
 
     freeProcessContext(&state->context);
 }
 
 static struct ProcessContext initProcessContext(void) {
-    struct ProcessContext context = {.currentFilePath =
-                                         malloc(COLETTE_PATH_BUF_SIZE),
+    struct ProcessContext context = {.currentFilePath = NULL,
                                      .outPath = malloc(COLETTE_PATH_BUF_SIZE),
                                      .outFile = NULL,
+                                     .currentFileBytes = 0,
+                                     .currentFileSize = -1,
+                                     .currentEncoding = ENCODING_DEFAULT,
+                                     .validateUtf8 = false,
+                                     .metaTable = NULL,
+                                     .currentStats = NULL,
+                                     .pipeline = NULL,
+                                     .readahead = NULL,
+                                     .currentFd = -1,
+                                     .manifest = NULL,
                                      .status = CTX_SUCCESS};
 
-    if (!context.currentFilePath || !context.outPath) {
-        free(context.currentFilePath);
-        free(context.outPath);
-        context.currentFilePath = NULL;
-        context.outPath = NULL;
+    if (!context.outPath) {
         context.currentFileType = FILE_TYPE_UNKNOWN;
         context.status = CTX_FAILURE;
     }
@@ -85,6 +142,8 @@ static struct FileIterator initFileIterator(void) {
     iter.status = ITER_SUCCESS;
     iter.stackSize = 0;
     iter.stackMax = COLETTE_PROJECT_DEPTH;
+    iter.entries = NULL;
+    arenaInit(&iter.arena, COLETTE_TRAVERSAL_ARENA_SIZE);
     iter.stack = malloc(sizeof(struct IndexState) * iter.stackMax);
     if (!iter.stack) {
         iter.status = ITER_FAILURE;
@@ -107,33 +166,27 @@ static struct ProjectState initProjectState(void) {
 }
 
 static int setCurrentFilePath(struct ProcessContext *context,
-                              const char *dirPath,
+                              struct FileIterator *iter,
                               const char *fileName) {
-    if (!context || !dirPath || !fileName) {
+    if (!context || !iter || iter->stackSize < 1 || !fileName) {
         reportProcessError(PROCESS_OP_CTX_PATH, NULL, PROC_ERR_INVALID_STATE);
         return -1;
     }
 
-    if (context->currentFilePath) {
-        free(context->currentFilePath);
-        context->currentFilePath = NULL;
-    }
+    // the previous entry comes off, leaving the directory being read
+    struct PathBuilder *path = &iter->path;
+    pathBuilderPopTo(path, iter->stackSize - 1);
+    const char *dirPath = iter->stack[iter->stackSize - 1].curIndexFileDir;
 
-    size_t dirPathLen = strlen(dirPath);
     size_t fileNameLen = strlen(fileName);
-    int extraChars = handlePathBufTrailingSlashPad(dirPath, dirPathLen);
-    size_t baseFilePathLen = dirPathLen + fileNameLen + extraChars;
+    int extraChars = handlePathBufTrailingSlashPad(path->path, path->len);
+    size_t baseFilePathLen = path->len + fileNameLen + extraChars;
     if (baseFilePathLen > COLETTE_MAX_PATH_LEN) {
         reportProcessError(
             PROCESS_OP_CTX_PATH, dirPath, PROC_ERR_PATH_TOO_LONG);
         return -1;
     }
 
-    char baseFilePath[baseFilePathLen];
-    if (joinPath(baseFilePath, baseFilePathLen, dirPath, fileName) != 0) {
-        return -1;
-    }
-
     size_t extensionLen = COLETTE_EXT_BUF_SIZE;
     size_t resolvedPathLen = baseFilePathLen + extensionLen;
     if (resolvedPathLen > COLETTE_MAX_PATH_LEN) {
@@ -142,53 +195,93 @@ static int setCurrentFilePath(struct ProcessContext *context,
         return -1;
     }
 
-    char *resolvedPath = malloc(resolvedPathLen);
-    if (!resolvedPath) {
-        reportProcessError(PROCESS_OP_CTX_PATH, dirPath, PROC_ERR_MEMORY_ALLOC);
+    if (pathBuilderPush(path, fileName) != 0) {
         return -1;
     }
 
-    enum ResolveStatus resolvedPathStatus =
-        resolveFile(resolvedPath, resolvedPathLen, baseFilePath);
+    if (context->currentFd >= 0) {
+        close(context->currentFd); // opened for a file never collated
+        context->currentFd = -1;
+    }
+
+    // entries the readahead walk reached were resolved on the way
+    struct TraceSpan resolveSpan = traceBegin();
+    enum ResolveStatus resolvedPathStatus;
+    enum FileType readaheadType;
+    if (context->readahead &&
+        readaheadTake(
+            context->readahead, path, &readaheadType, &context->currentFd) ==
+            0) {
+        resolvedPathStatus = readaheadType == FILE_TYPE_DIRECTORY
+                                 ? RESOLVE_DIR
+                                 : RESOLVE_FILE;
+        context->currentFileSize = -1;
+    } else {
+        resolvedPathStatus =
+            resolveBuilderPath(path, &context->currentFileSize);
+    }
+    traceEnd(resolveSpan, TRACE_RESOLVE, path->path, -1);
 
     switch (resolvedPathStatus) {
     case RESOLVE_DIR:
-        context->currentFilePath = resolvedPath;
+        context->currentFilePath = path->path;
         context->currentFileType = FILE_TYPE_DIRECTORY;
         return 0;
     case RESOLVE_EXACT:
     case RESOLVE_FILE:
-        context->currentFilePath = resolvedPath;
+        context->currentFilePath = path->path;
         context->currentFileType = FILE_TYPE_REGULAR;
         return 0;
+    default:
+        break;
+    }
+
+    // errors name the entry as written in the index, without an extension
+    pathBuilderPopTo(path, iter->stackSize);
+    const char *baseFilePath = path->path;
+    switch (resolvedPathStatus) {
     case RESOLVE_LINK:
         reportProcessError(
             PROCESS_OP_CTX_PATH, baseFilePath, PROC_ERR_INVALID_LINK);
-        free(resolvedPath);
         return -1;
     case RESOLVE_ERROR:
         reportProcessError(
             PROCESS_OP_CTX_PATH, baseFilePath, PROC_ERR_INVALID_PATH);
-        free(resolvedPath);
         return -1;
     case RESOLVE_NO_ACCESS:
         reportProcessError(
             PROCESS_OP_CTX_PATH, baseFilePath, PROC_ERR_ACCESS_DENIED);
-        free(resolvedPath);
         return -1;
     case RESOLVE_NOT_FOUND:
         reportProcessError(
             PROCESS_OP_CTX_PATH, baseFilePath, PROC_ERR_FILE_NOT_FOUND);
-        free(resolvedPath);
         return -1;
     default:
         reportProcessError(
             PROCESS_OP_CTX_PATH, baseFilePath, PROC_ERR_INVALID_STATE);
-        free(resolvedPath);
         return -1;
     }
 }
 
+/* *
+ * With --toc the body is written first, to a file that is unlinked as soon as
+ * it is open. Nothing is left behind if collation fails, and the previous
+ * draft stays in place until the table and body are put together.
+ * */
+static FILE *openDraftBody(const char *outPath) {
+    char bodyPath[COLETTE_PATH_BUF_SIZE];
+    int len = snprintf(bodyPath, sizeof(bodyPath), "%s.tmp", outPath);
+    if (len < 0 || (size_t)len >= sizeof(bodyPath)) {
+        return NULL;
+    }
+
+    FILE *body = fopen(bodyPath, "w+");
+    if (body) {
+        unlink(bodyPath);
+    }
+    return body;
+}
+
 static int setOutput(struct Arguments *args, struct ProjectState *state) {
     if (!args || !state) {
         reportProcessError(
@@ -196,7 +289,7 @@ static int setOutput(struct Arguments *args, struct ProjectState *state) {
         return -1;
     }
 
-    if (args->mode == MODE_CHECK) {
+    if (args->mode != MODE_COLLATE && args->mode != MODE_LIST) {
         return 0;
     }
 
@@ -268,12 +361,8 @@ static int setOutput(struct Arguments *args, struct ProjectState *state) {
             return -1;
         }
 
-        /* *
-         * TODO: users will probably want to pick the output format and file
-         * extension. For now we default to markdown because that's what I use.
-         * txt could be a more practical default in the future when output is
-         * configurable.
-         * */
+        // the collated draft is Markdown; --format html renders its own
+        // output in renderProjectHtml and never gets here
         if (joinExtension(outFilePath, outFilePathBufSize, outPath, ".md") !=
             0) {
             reportProcessError(PROCESS_OP_CTX_OUTPUT,
@@ -286,7 +375,8 @@ static int setOutput(struct Arguments *args, struct ProjectState *state) {
         state->context.outPath = outFilePath;
 
         errno = 0;
-        FILE *outFile = fopen(state->context.outPath, "w");
+        FILE *outFile = args->toc ? openDraftBody(state->context.outPath)
+                                  : fopen(state->context.outPath, "w");
         if (!outFile) {
             reportProcessError(PROCESS_OP_CTX_OUTPUT,
                                args->directory,
@@ -310,16 +400,62 @@ static int setOutput(struct Arguments *args, struct ProjectState *state) {
     return 0;
 }
 
-static FILE *openIndexFile(const char *indexFileDir) {
-    char indexFilePath[COLETTE_PATH_BUF_SIZE];
-    int joinStatus;
-    if ((joinStatus = joinPath(
-             indexFilePath, sizeof(indexFilePath), indexFileDir, ".index")) !=
-        0) {
+/* *
+ * Writes the table of contents to the draft, followed by the body. The body
+ * is copied by the kernel, or shared outright on file systems with reflinks,
+ * so it is never read back through the process.
+ * */
+static int assembleDraft(struct ProcessContext *context) {
+    if (tocFinish(context->toc) != 0) {
+        reportProcessError(
+            PROCESS_OP_CTX_OUTPUT, context->outPath, PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+    if (fflush(context->outFile) != 0) {
+        reportFileError(FILE_OP_WRITE, context->outPath);
+        return -1;
+    }
+    int bodyFd = fileno(context->outFile);
+    struct stat bodyStat;
+    if (fstat(bodyFd, &bodyStat) != 0) {
+        reportFileError(FILE_OP_READ, context->outPath);
+        return -1;
+    }
+
+    errno = 0;
+    FILE *draft = fopen(context->outPath, "w");
+    if (!draft) {
+        reportProcessError(
+            PROCESS_OP_CTX_OUTPUT, context->outPath, PROC_ERR_INVALID_OUTPUT);
+        return -1;
+    }
+
+    int status = 0;
+    if (writeTableOfContents(context->toc, bodyFd, draft) != 0) {
+        reportFileError(FILE_OP_READ, context->outPath);
+        status = -1;
+    } else if (fflush(draft) != 0 ||
+               appendFileContents(
+                   fileno(draft), bodyFd, (size_t)bodyStat.st_size) != 0) {
+        reportFileError(FILE_OP_WRITE, context->outPath);
+        status = -1;
+    }
+    if (fclose(draft) != 0 && status == 0) {
+        reportFileError(FILE_OP_WRITE, context->outPath);
+        status = -1;
+    }
+    return status;
+}
+
+static FILE *openIndexFile(struct PathBuilder *path) {
+    if (pathBuilderPush(path, ".index") != 0) {
         return NULL;
     }
 
-    FILE *indexFile = fopen(indexFilePath, "r");
+    struct TraceSpan openSpan = traceBegin();
+    FILE *indexFile = fopen(path->path, "r");
+    traceEnd(openSpan, TRACE_INDEX_OPEN, path->path, -1);
+    pathBuilderPop(path);
     if (!indexFile) {
         return NULL;
     }
@@ -327,13 +463,18 @@ static FILE *openIndexFile(const char *indexFileDir) {
     return indexFile;
 }
 
-static int appendIndexState(struct FileIterator *iter, const char *indexFileDir) {
-    if (!iter || !indexFileDir) {
+/* *
+ * Pushes the directory the iterator's path builder holds: the root once it is
+ * set, then each directory entry as getNextFile() resolves it.
+ * */
+static int appendIndexState(struct FileIterator *iter) {
+    if (!iter || iter->path.len == 0) {
         reportProcessError(PROCESS_OP_ITER_PUSH, NULL, PROC_ERR_INVALID_STATE);
         return -1;
     }
 
-    size_t pathLen = strlen(indexFileDir) + 1;
+    const char *indexFileDir = iter->path.path;
+    size_t pathLen = iter->path.len + 1;
     if (pathLen >= COLETTE_PATH_BUF_SIZE) {
         reportProcessError(
             PROCESS_OP_ITER_PUSH, indexFileDir, PROC_ERR_PATH_TOO_LONG);
@@ -379,24 +520,38 @@ static int appendIndexState(struct FileIterator *iter, const char *indexFileDir)
         iter->stackMax = newMax;
     }
 
-    char *pathCopy = malloc(pathLen);
-    if (!pathCopy) {
+    // everything this level needs comes off the arena and goes back at pop
+    struct ArenaMark mark = arenaMark(&iter->arena);
+    char *pathCopy = arenaAlloc(&iter->arena, pathLen);
+    char *indexBuffer = arenaAlloc(&iter->arena, COLETTE_INDEX_BUF_SIZE);
+    if (!pathCopy || !indexBuffer) {
+        arenaRelease(&iter->arena, mark);
         reportProcessError(
             PROCESS_OP_ITER_PUSH, indexFileDir, PROC_ERR_MEMORY_ALLOC);
         return -1;
     }
     memcpy(pathCopy, indexFileDir, pathLen);
 
-    FILE *indexFile = openIndexFile(pathCopy);
+    struct TraceSpan parseSpan = traceBegin();
+    FILE *indexFile = openIndexFile(&iter->path);
     if (!indexFile) {
+        arenaRelease(&iter->arena, mark);
         reportProcessError(
             PROCESS_OP_ITER_PUSH, indexFileDir, PROC_ERR_INDEX_MISSING);
-        free(pathCopy);
         return -1;
     }
+    setvbuf(indexFile, indexBuffer, _IOFBF, COLETTE_INDEX_BUF_SIZE);
 
+    // subdirectories read their files the way their parent does until their
+    // own index says otherwise
+    enum TextEncoding encoding = iter->stackSize
+                                     ? iter->stack[iter->stackSize - 1].encoding
+                                     : ENCODING_DEFAULT;
     struct IndexState newState = {.curIndexFileDir = pathCopy,
-                                  .curIndexFile = indexFile};
+                                  .curIndexFile = indexFile,
+                                  .encoding = encoding,
+                                  .parseSpan = parseSpan,
+                                  .mark = mark};
 
     iter->stack[iter->stackSize] = newState;
     iter->stackSize++;
@@ -404,23 +559,6 @@ static int appendIndexState(struct FileIterator *iter, const char *indexFileDir)
     return 0;
 }
 
-static struct IndexState *popIndexState(struct FileIterator *iter) {
-    if (!iter) {
-        return NULL;
-    }
-    if (!iter->stack) {
-        return NULL;
-    }
-    if (iter->stackSize < 1) {
-        return NULL;
-    }
-
-    struct IndexState *poppedItem = &iter->stack[iter->stackSize - 1];
-    iter->stackSize--;
-
-    return poppedItem;
-}
-
 static enum FileIteratorStatus getNextFile(struct FileIterator *iter,
                                     struct ProcessContext *context) {
     if (!iter || !context) {
@@ -437,14 +575,51 @@ static enum FileIteratorStatus getNextFile(struct FileIterator *iter,
     char curFileName[COLETTE_NAME_BUF_SIZE];
     if (fgets(curFileName, sizeof(curFileName), curIndexState.curIndexFile)) {
         curFileName[strcspn(curFileName, "\n")] = '\0';
+        const char *encodingName;
+        if (isEncodingLine(curFileName, &encodingName)) {
+            // applies to the entries below it in this index
+            if (parseEncodingName(
+                    encodingName,
+                    &iter->stack[iter->stackSize - 1].encoding) != 0) {
+                reportProcessError(PROCESS_OP_ITER_NEXT,
+                                   curIndexState.curIndexFileDir,
+                                   PROC_ERR_UNKNOWN_ENCODING);
+                return ITER_FAILURE;
+            }
+            return getNextFile(iter, context);
+        }
         if (isName(curFileName) && isIncluded(curFileName)) {
-            if (setCurrentFilePath(
-                    context, curIndexState.curIndexFileDir, curFileName) != 0) {
+            if (iter->stackSize == 1) {
+                context->topEntry++;
+            }
+            context->templateVars.depth = iter->stackSize;
+            if (setCurrentFilePath(context, iter, curFileName) != 0) {
+                return ITER_FAILURE;
+            }
+            context->currentEncoding = curIndexState.encoding;
+            if (iter->entries && appendFileEntry(iter->entries,
+                                                 context->currentFilePath,
+                                                 context->currentFileType,
+                                                 iter->stackSize) != 0) {
+                reportProcessError(PROCESS_OP_ITER_NEXT,
+                                   context->currentFilePath,
+                                   PROC_ERR_MEMORY_ALLOC);
                 return ITER_FAILURE;
             }
+            if (iter->entries) {
+                // everything a handler needs to take the entry up later
+                struct FileEntry *entry =
+                    &iter->entries->entries[iter->entries->count - 1];
+                entry->encoding = curIndexState.encoding;
+                entry->size = context->currentFileSize;
+                entry->topEntry = context->topEntry;
+                entry->nameOffset = iter->path.nameStart;
+                entry->fd = context->currentFd;
+                context->currentFd = -1;
+            }
 
             if (context->currentFileType == FILE_TYPE_DIRECTORY) {
-                if (appendIndexState(iter, context->currentFilePath) != 0) {
+                if (appendIndexState(iter) != 0) {
                     return ITER_FAILURE;
                 }
 
@@ -456,7 +631,7 @@ static enum FileIteratorStatus getNextFile(struct FileIterator *iter,
 
     } else {
         struct IndexState *poppedIndex = popIndexState(iter);
-        freeIndexState(poppedIndex);
+        freeIndexState(iter, poppedIndex);
 
         if (iter->stackSize) {
             return getNextFile(iter, context);
@@ -468,30 +643,150 @@ static enum FileIteratorStatus getNextFile(struct FileIterator *iter,
     return ITER_SUCCESS;
 }
 
-static enum FileHandlerStatus handleCheck(struct ProcessContext *context) {
-    if (!context) {
-        return HANDLER_FAILURE;
+/* *
+ * Writes to the draft, through the writer thread when there is one.
+ * */
+static int writeDraft(struct ProcessContext *context,
+                      const void *data,
+                      size_t len) {
+    int status = 0;
+    if (context->pipeline) {
+        status = pipelineWrite(context->pipeline, data, len);
+    } else if (len > 0 && fwrite(data, 1, len, context->outFile) != len) {
+        status = -1;
     }
 
-    errno = 0;
-    FILE *file = fopen(context->currentFilePath, "r");
-    if (!file) {
-        if (errno == EACCES) { // we don't have permission -- unexpected
-            reportProcessError(PROCESS_OP_HANDLE_CHECK,
-                               context->currentFilePath,
-                               PROC_ERR_ACCESS_DENIED);
-            return HANDLER_FAILURE;
-        }
+    if (status != 0) {
+        reportFileError(FILE_OP_WRITE, context->currentFilePath);
+    }
+    return status;
+}
 
-        reportProcessError(PROCESS_OP_HANDLE_CHECK,
+/* *
+ * Writes body bytes of the current file to the draft, through the text
+ * filters when any are enabled.
+ * */
+static int emitCollatedBytes(struct ProcessContext *context,
+                             const unsigned char *data,
+                             size_t len) {
+    // counted here, in the same pass, so stats match the draft exactly
+    if (context->currentStats) {
+        statsUpdate(&context->statsCounter, context->currentStats, data, len);
+    }
+    if (context->toc && tocUpdate(context->toc, data, len) != 0) {
+        reportProcessError(PROCESS_OP_HANDLE_COLLATE,
                            context->currentFilePath,
-                           PROC_ERR_OPEN_FILE);
-        return HANDLER_FAILURE;
+                           PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+    if (writeDraft(context, data, len) != 0) {
+        return -1;
+    }
+    if (context->manifest) {
+        xxh3Update(&context->draftHash, data, len);
     }
 
-    fclose(file);
+    return 0;
+}
 
-    return HANDLER_SUCCESS;
+static int writeCollatedBytes(struct ProcessContext *context,
+                              const unsigned char *data,
+                              size_t len) {
+    const unsigned char *outBuffer = data;
+    size_t outLen = len;
+    if (filterActive(&context->filter) &&
+        filterUpdate(&context->filter, data, len, &outBuffer, &outLen) != 0) {
+        reportProcessError(PROCESS_OP_HANDLE_COLLATE,
+                           context->currentFilePath,
+                           PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+
+    return emitCollatedBytes(context, outBuffer, outLen);
+}
+
+/* *
+ * Renders a header or separator template for the current file and writes it
+ * to the draft in one piece.
+ * */
+static int writeTemplate(struct ProcessContext *context,
+                         const struct Template *tmpl) {
+    if (templateIsEmpty(tmpl)) {
+        return 0;
+    }
+    if (renderTemplate(tmpl, &context->templateVars, &context->rendered) !=
+        0) {
+        reportProcessError(PROCESS_OP_HANDLE_COLLATE,
+                           context->currentFilePath,
+                           PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+
+    size_t len = context->rendered.len;
+    if (context->toc &&
+        tocUpdate(context->toc, context->rendered.data, len) != 0) {
+        reportProcessError(PROCESS_OP_HANDLE_COLLATE,
+                           context->currentFilePath,
+                           PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+    if (writeDraft(context, context->rendered.data, len) != 0) {
+        return -1;
+    }
+    if (context->manifest) {
+        xxh3Update(&context->draftHash, context->rendered.data, len);
+    }
+    return 0;
+}
+
+/* *
+ * Called once the current file is known to go in the draft. Chapters and
+ * scenes are numbered over the files that make it in, so a file left out by
+ * --exclude leaves no gap.
+ * */
+static int beginCollatedFile(struct ProcessContext *context) {
+    struct TemplateVars *vars = &context->templateVars;
+    if (context->topEntry != context->chapterEntry) {
+        context->chapterEntry = context->topEntry;
+        vars->chapter++;
+        vars->scene = 0;
+    }
+    vars->scene++;
+    vars->path = context->currentFilePath + context->rootLen;
+    if (context->toc) {
+        context->toc->depth = vars->depth;
+    }
+
+    return writeTemplate(context, context->header);
+}
+
+/* *
+ * Called once the front matter of the current file has been read, before any
+ * of its body is written. Records the file in the metadata table unless an
+ * --exclude rule drops it from the draft.
+ *
+ * @return  bool  true if the file is excluded
+ * */
+static bool recordMetadata(struct ProcessContext *context, int *status) {
+    size_t fieldCount;
+    struct MetaField *fields =
+        frontMatterTakeFields(&context->frontMatter, &fieldCount);
+    if (isMetaExcluded(context->metaTable, fields, fieldCount)) {
+        freeMetaFields(fields, fieldCount);
+        return true;
+    }
+
+    if (appendMetaRow(context->metaTable,
+                      context->currentFilePath,
+                      fields,
+                      fieldCount) != 0) {
+        reportProcessError(PROCESS_OP_HANDLE_COLLATE,
+                           context->currentFilePath,
+                           PROC_ERR_MEMORY_ALLOC);
+        *status = -1;
+    }
+
+    return false;
 }
 
 static enum FileHandlerStatus handleCollate(struct ProcessContext *context) {
@@ -503,9 +798,20 @@ static enum FileHandlerStatus handleCollate(struct ProcessContext *context) {
     }
 
     errno = 0;
-    char inBuffer[COLETTE_FILE_BUF_SIZE];
+    unsigned char inBuffer[COLETTE_FILE_BUF_SIZE];
     size_t bytesRead;
-    FILE *file = fopen(context->currentFilePath, "r");
+    FILE *file;
+    if (context->currentFd >= 0) {
+        file = fdopen(context->currentFd, "r");
+        if (!file) {
+            int savedErrno = errno;
+            close(context->currentFd);
+            errno = savedErrno;
+        }
+        context->currentFd = -1;
+    } else {
+        file = fopen(context->currentFilePath, "r");
+    }
     if (!file) {
         if (errno == EACCES) { // we don't have permission -- unexpected
             reportProcessError(PROCESS_OP_HANDLE_CHECK,
@@ -520,38 +826,328 @@ static enum FileHandlerStatus handleCollate(struct ProcessContext *context) {
         return HANDLER_FAILURE;
     }
 
+    // only whole-buffer freads below, so stdio needn't allocate a buffer of
+    // its own for every file
+    setvbuf(file, NULL, _IONBF, 0);
+    if (context->readahead) {
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    struct Utf8Validator validator;
+    utf8Init(&validator);
+
+    if (filterActive(&context->filter)) {
+        filterReset(&context->filter);
+    }
+
+    statsCounterReset(&context->statsCounter);
+    if (context->manifest) {
+        xxh3Reset(&context->sourceHash);
+    }
+
+    // with --metadata, front matter is split off before anything is written
+    bool splitting = context->metaTable != NULL;
+    bool excluded = false;
+    int status = 0;
+    if (splitting) {
+        frontMatterReset(&context->frontMatter);
+    } else if (beginCollatedFile(context) != 0) {
+        status = -1;
+    }
+
+    // UTF-8 sources, the usual case, are copied without being transcoded
+    bool transcoding = false;
+    bool firstBlock = true;
+
     errno = 0;
-    while ((bytesRead = fread(inBuffer, 1, sizeof(inBuffer), file)) > 0) {
-        size_t bytesWritten = fwrite(inBuffer, 1, bytesRead, context->outFile);
-        if (bytesWritten != bytesRead) {
-            reportFileError(FILE_OP_WRITE, context->currentFilePath);
-            fclose(file);
-            return HANDLER_FAILURE;
+    while (status == 0 &&
+           (bytesRead = fread(inBuffer, 1, sizeof(inBuffer), file)) > 0) {
+        context->currentFileBytes += bytesRead;
+        // the source as it is on disk, so --verify needn't collate again
+        if (context->manifest) {
+            xxh3Update(&context->sourceHash, inBuffer, bytesRead);
+        }
+
+        const unsigned char *text = inBuffer;
+        size_t textLen = bytesRead;
+        if (firstBlock) {
+            enum TextEncoding encoding =
+                detectEncoding(context->currentEncoding, inBuffer, bytesRead);
+            transcoding = encoding != ENCODING_UTF8;
+            if (transcoding) {
+                transcoderReset(&context->transcoder, encoding);
+            }
+            firstBlock = false;
         }
+        if (transcoding && transcoderUpdate(&context->transcoder,
+                                            inBuffer,
+                                            bytesRead,
+                                            &text,
+                                            &textLen) != 0) {
+            reportProcessError(PROCESS_OP_HANDLE_COLLATE,
+                               context->currentFilePath,
+                               PROC_ERR_MEMORY_ALLOC);
+            status = -1;
+            break;
+        }
+
+        if (context->validateUtf8 && !utf8Update(&validator, text, textLen)) {
+            break;
+        }
+
+        const unsigned char *body = text;
+        size_t bodyLen = textLen;
+        if (splitting) {
+            if (frontMatterUpdate(&context->frontMatter,
+                                  text,
+                                  textLen,
+                                  &body,
+                                  &bodyLen) != 0) {
+                reportProcessError(PROCESS_OP_HANDLE_COLLATE,
+                                   context->currentFilePath,
+                                   PROC_ERR_MEMORY_ALLOC);
+                status = -1;
+                break;
+            }
+            if (context->frontMatter.state != FRONT_MATTER_BODY) {
+                continue;
+            }
+            splitting = false;
+            excluded = recordMetadata(context, &status);
+            if (excluded) {
+                break; // nothing of this file goes in the draft
+            }
+            if (status == 0 && beginCollatedFile(context) != 0) {
+                status = -1;
+            }
+        }
+
+        if (status == 0 && writeCollatedBytes(context, body, bodyLen) != 0) {
+            status = -1;
+        }
+    }
+
+    // an excluded file still shapes the draft, so all of it is hashed
+    while (status == 0 && excluded && context->manifest &&
+           (bytesRead = fread(inBuffer, 1, sizeof(inBuffer), file)) > 0) {
+        context->currentFileBytes += bytesRead;
+        xxh3Update(&context->sourceHash, inBuffer, bytesRead);
     }
 
-    if (ferror(file)) {
+    if (status == 0 && ferror(file)) {
         reportFileError(FILE_OP_READ, context->currentFilePath);
-        fclose(file);
-        return HANDLER_FAILURE;
+        status = -1;
     }
 
-    /* *
-     * TODO: User should be able to configure the separator between files. This
-     * could be a really useful feature for clearly delimiting chapters with 
-     * multiple newlines or a horizontal line or even using the file name as a
-     * header. 
-     * */
-    if (fprintf(context->outFile, "\n") != 1) {
-        reportFileError(FILE_OP_WRITE, context->currentFilePath);
-        fclose(file);
-        return HANDLER_FAILURE;
+    if (status == 0 && context->validateUtf8 && !excluded &&
+        !utf8Finish(&validator)) {
+        reportEncodingError(PROCESS_OP_HANDLE_COLLATE,
+                            context->currentFilePath,
+                            validator.errorOffset,
+                            validator.errorLine);
+        status = -1;
     }
 
+    // front matter that never closed is ordinary text
+    if (status == 0 && splitting) {
+        const unsigned char *body;
+        size_t bodyLen;
+        frontMatterFinish(&context->frontMatter, &body, &bodyLen);
+        excluded = recordMetadata(context, &status);
+        if (status == 0 && !excluded &&
+            (beginCollatedFile(context) != 0 ||
+             writeCollatedBytes(context, body, bodyLen) != 0)) {
+            status = -1;
+        }
+    }
+
+    // a UTF-16 unit or surrogate cut off by the end of the file
+    if (status == 0 && !excluded && transcoding) {
+        const unsigned char *tail;
+        size_t tailLen;
+        transcoderFinish(&context->transcoder, &tail, &tailLen);
+        if (writeCollatedBytes(context, tail, tailLen) != 0) {
+            status = -1;
+        }
+    }
+
+    if (status == 0 && !excluded && filterActive(&context->filter)) {
+        const unsigned char *outBuffer;
+        size_t outLen;
+        if (filterFinish(&context->filter, &outBuffer, &outLen) != 0) {
+            reportProcessError(PROCESS_OP_HANDLE_COLLATE,
+                               context->currentFilePath,
+                               PROC_ERR_MEMORY_ALLOC);
+            status = -1;
+        } else if (emitCollatedBytes(context, outBuffer, outLen) != 0) {
+            status = -1;
+        }
+    }
+
+    if (status == 0 && !excluded &&
+        writeTemplate(context, context->separator) != 0) {
+        status = -1;
+    }
+
+    if (status == 0 && context->manifest &&
+        appendManifestEntry(context->manifest,
+                            context->currentFilePath,
+                            xxh3Digest(&context->sourceHash)) != 0) {
+        reportProcessError(PROCESS_OP_HANDLE_COLLATE,
+                           context->currentFilePath,
+                           PROC_ERR_MEMORY_ALLOC);
+        status = -1;
+    }
+
+    if (context->readahead &&
+        context->currentFileBytes >= COLETTE_READAHEAD_DROP_SIZE) {
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_DONTNEED);
+    }
     fclose(file);
+    return status == 0 ? HANDLER_SUCCESS : HANDLER_FAILURE;
+}
+
+/* *
+ * The metadata table sits next to the draft: _draft_.md gets
+ * _draft_.meta.tsv.
+ * */
+static int writeMetaSidecar(const struct MetaTable *table,
+                            const char *draftPath,
+                            const char *rootDir) {
+    size_t stemLen = strlen(draftPath);
+    if (stemLen >= 3 && strcmp(draftPath + stemLen - 3, ".md") == 0) {
+        stemLen -= 3;
+    }
+
+    char sidecarPath[COLETTE_PATH_BUF_SIZE];
+    int len = snprintf(sidecarPath,
+                       sizeof(sidecarPath),
+                       "%.*s.meta.tsv",
+                       (int)stemLen,
+                       draftPath);
+    if (len < 0 || (size_t)len >= sizeof(sidecarPath)) {
+        reportProcessError(
+            PROCESS_OP_CTX_OUTPUT, draftPath, PROC_ERR_PATH_TOO_LONG);
+        return -1;
+    }
+
+    return writeMetaTable(table, sidecarPath, rootDir);
+}
+
+// makes entry the current file, as getNextFile() left it when it was resolved
+static void takeEntry(struct ProcessContext *context,
+                      struct FileEntry *entry,
+                      bool countStats) {
+    context->currentFilePath = entry->path;
+    context->currentFileType = entry->type;
+    context->currentFileSize = entry->size;
+    context->currentEncoding = entry->encoding;
+    context->templateVars.depth = entry->depth;
+    context->topEntry = entry->topEntry;
+    context->currentFd = entry->fd; // the handler closes it
+    entry->fd = -1;
+    context->currentFileBytes = 0;
+    context->currentStats = countStats ? &entry->stats : NULL;
+}
+
+static enum FileHandlerStatus runFileHandler(struct ProjectState *state,
+                                             struct FileEntry *entry) {
+    takeEntry(&state->context, entry, state->countStats);
+    struct TraceSpan handlerSpan = traceBegin();
+    enum FileHandlerStatus handlerStatus =
+        state->handlerFunction(&state->context);
+    traceEnd(handlerSpan,
+             TRACE_HANDLER,
+             state->context.currentFilePath,
+             (long long)state->context.currentFileBytes);
+    return handlerStatus;
+}
+
+/* *
+ * Batch adapter for per-file handlers: calls handlerFunction for each regular
+ * file in the span, in order. Directories never reach per-file handlers.
+ * */
+static enum FileHandlerStatus handleEachFile(struct ProjectState *state,
+                                             struct FileSpan span) {
+    enum FileHandlerStatus status = HANDLER_SUCCESS;
+    for (size_t i = 0; i < span.count; i++) {
+        if (span.entries[i].type != FILE_TYPE_REGULAR) {
+            continue;
+        }
+        if (runFileHandler(state, &span.entries[i]) == HANDLER_FAILURE) {
+            status = HANDLER_FAILURE;
+            if (!state->continueOnError) {
+                break;
+            }
+        }
+    }
+    return status;
+}
+
+/* *
+ * Collates a span. Directories are added to the table of contents here rather
+ * than when they are resolved, so they stay in order with the headings of the
+ * files before them.
+ * */
+static enum FileHandlerStatus handleCollateSpan(struct ProjectState *state,
+                                                struct FileSpan span) {
+    for (size_t i = 0; i < span.count; i++) {
+        struct FileEntry *entry = &span.entries[i];
+        if (entry->type == FILE_TYPE_DIRECTORY) {
+            // the project root is collected with --stats but has no heading
+            if (state->context.toc && entry->depth > 0 &&
+                tocAddDirectory(state->context.toc,
+                                entry->path + entry->nameOffset,
+                                entry->depth) != 0) {
+                reportProcessError(
+                    PROCESS_OP_ITER_NEXT, entry->path, PROC_ERR_MEMORY_ALLOC);
+                return HANDLER_FAILURE;
+            }
+            continue;
+        }
+        if (runFileHandler(state, entry) == HANDLER_FAILURE) {
+            return HANDLER_FAILURE;
+        }
+    }
     return HANDLER_SUCCESS;
 }
 
+// check takes the whole project at once: orphans and duplicate references can
+// only be found against every entry
+static enum FileHandlerStatus handleCheckSpan(struct ProjectState *state,
+                                              struct FileSpan span) {
+    struct FileList project = {.entries = span.entries,
+                               .count = span.count,
+                               .capacity = span.count};
+    return validateProjectFiles(&project, state->jobs, state->countStats) == 0
+               ? HANDLER_SUCCESS
+               : HANDLER_FAILURE;
+}
+
+/* *
+ * Hands the entries collected since the last span to the batch handler.
+ * Unless the entries are kept for after traversal, the list is then emptied
+ * for the next span.
+ * */
+static enum FileHandlerStatus handleSpan(struct ProjectState *state,
+                                         struct FileList *entries,
+                                         size_t *spanStart,
+                                         bool keepEntries) {
+    struct FileSpan span = {.entries = entries->entries + *spanStart,
+                            .count = entries->count - *spanStart};
+    enum FileHandlerStatus status = HANDLER_SUCCESS;
+    if (state->batchHandler && span.count > 0) {
+        status = state->batchHandler(state, span);
+    }
+
+    if (keepEntries) {
+        *spanStart = entries->count;
+    } else {
+        resetFileList(entries);
+    }
+    return status;
+}
+
 static int setHandlerFunction(struct Arguments *args,
                               struct ProjectState *state) {
     if (!args || !state) {
@@ -563,23 +1159,56 @@ static int setHandlerFunction(struct Arguments *args,
     switch (args->mode) {
     case MODE_COLLATE:
         state->handlerFunction = handleCollate;
+        state->batchHandler = handleCollateSpan;
+        state->spanSize = COLETTE_BATCH_ENTRIES;
         break;
         // case MODE_LIST:
         //     state->handlerFunction = handleList;
         //     break;
     case MODE_CHECK:
-        state->handlerFunction = handleCheck;
+        // files are collected and validated in bulk by validateProjectFiles
+        state->handlerFunction = NULL;
+        state->batchHandler = handleCheckSpan;
+        state->spanSize = 0;
+        break;
+    case MODE_ANALYZE:
+    case MODE_HTML:
+    case MODE_VERIFY:
+    case MODE_GREP:
+    case MODE_INDEX:
+    case MODE_LOOKUP:
+    case MODE_DUPES:
+    case MODE_SPELL:
+        // likewise rendered, hashed, searched, indexed, compared or checked in bulk
+        // once traversal is done
+        state->handlerFunction = NULL;
         break;
     default:
         reportProcessError(
             PROCESS_OP_STATE_MODE, args->directory, PROC_ERR_INVALID_MODE);
         return -1;
     }
+    if (state->handlerFunction && !state->batchHandler) {
+        state->batchHandler = handleEachFile;
+        state->spanSize = COLETTE_BATCH_ENTRIES;
+    }
 
     return 0;
 }
 
-int processProject(struct Arguments *args) {
+/* *
+ * Prints reports collected while they were held back, in the order they were
+ * made, and empties the list for the next span.
+ * */
+static void flushHeldReports(struct DiagnosticList *held) {
+    for (size_t i = 0; i < held->count; i++) {
+        fputs(held->items[i].message, stderr);
+        fputc('\n', stderr);
+    }
+    freeDiagnostics(held);
+}
+
+static int runProject(struct Arguments *args) {
     struct ProjectState state = initProjectState();
     if (state.status != STATE_SUCCESS) {
         reportProcessError(
@@ -601,7 +1230,8 @@ int processProject(struct Arguments *args) {
             return -1;
         }
     }
-    if (appendIndexState(&state.iter, args->directory) != 0) {
+    if (pathBuilderSet(&state.iter.path, args->directory) != 0 ||
+        appendIndexState(&state.iter) != 0) {
         freeProjectState(&state);
         return -1;
     }
@@ -613,28 +1243,255 @@ int processProject(struct Arguments *args) {
         freeProjectState(&state);
         return -1;
     }
+    state.continueOnError = args->mode == MODE_CHECK;
+    state.context.validateUtf8 = args->validateUtf8;
+    transcoderInit(&state.context.transcoder);
+    state.context.header = &args->header;
+    state.context.separator = &args->separator;
+    const char *rootName = strrchr(args->directory, '/');
+    state.context.templateVars.rootName =
+        rootName ? rootName + 1 : args->directory;
+    state.context.templateVars.padding = args->prefixPadding;
+    state.context.rootLen = strlen(args->directory);
+    if (state.context.rootLen > 0 &&
+        args->directory[state.context.rootLen - 1] != '/') {
+        state.context.rootLen++; // and the slash after it
+    }
+    filterInit(&state.context.filter, args->filters);
+    frontMatterInit(&state.context.frontMatter);
+    struct MetaTable metaTable = {.excludes = args->excludes,
+                                  .excludeCount = args->excludeCount};
+    if (args->metadata && args->mode == MODE_COLLATE) {
+        state.context.metaTable = &metaTable;
+    }
+    struct Manifest manifest = {0};
+    if (args->manifest && args->mode == MODE_COLLATE) {
+        state.context.manifest = &manifest;
+        xxh3Reset(&state.context.draftHash);
+    }
+    struct TocScanner toc;
+    tocInit(&toc);
+    if (args->toc && args->mode == MODE_COLLATE) {
+        state.context.toc = &toc;
+    }
+    unsigned int jobs = args->jobs ? args->jobs : defaultJobCount();
+    // given a second thread, the draft is written while the next file is read
+    struct WritePipeline pipeline;
+    if (state.context.outFile && jobs > 1 &&
+        pipelineStart(&pipeline, fileno(state.context.outFile)) == 0) {
+        state.context.pipeline = &pipeline;
+    }
+    struct Readahead readahead;
+    if (state.context.outFile && args->readahead > 0 &&
+        readaheadInit(&readahead, args->directory, args->readahead) == 0) {
+        state.context.readahead = &readahead;
+    }
+    int failures = 0;
+
+    // every mode but collate works on the collected entries once traversal
+    // is done; stats are rolled up over them. Collation only needs each span
+    // until it has been written.
+    struct FileList entries = {0};
+    bool keepEntries = args->mode != MODE_COLLATE || args->statsFile;
+    if (keepEntries) {
+        if (appendFileEntry(
+                &entries, args->directory, FILE_TYPE_DIRECTORY, 0) != 0) {
+            reportProcessError(
+                PROCESS_OP_HANDLE_CHECK, args->directory, PROC_ERR_MEMORY_ALLOC);
+            freeProjectState(&state);
+            return -1;
+        }
+    }
+    state.iter.entries = &entries;
+    state.jobs = jobs;
+    state.countStats = args->statsFile != NULL;
     if (args->initMode) {
         handleInit(args->directory);
     }
 
-    while ((state.iter.status = getNextFile(&state.iter, &state.context)) !=
-           ITER_END) {
+    size_t spanStart = 0;
+    enum FileHandlerStatus spanStatus = HANDLER_SUCCESS;
+    // reports from resolving entries wait for the span before them to be
+    // handled and are dropped if it fails, keeping the order of handling one
+    // file at a time
+    struct DiagnosticList heldReports = {0};
+    bool holdReports = state.spanSize > 0 && !state.continueOnError;
+    while (true) {
+        if (holdReports) {
+            setDiagnosticSink(&heldReports);
+        }
+        state.iter.status = getNextFile(&state.iter, &state.context);
+        if (holdReports) {
+            setDiagnosticSink(NULL);
+        }
+        if (state.iter.status == ITER_END) {
+            break;
+        }
         if (state.iter.status == ITER_FAILURE) {
+            if (state.continueOnError) {
+                failures++;
+                continue;
+            }
+            if (state.spanSize > 0 &&
+                handleSpan(&state, &entries, &spanStart, keepEntries) ==
+                    HANDLER_SUCCESS) {
+                flushHeldReports(&heldReports);
+            }
+            freeDiagnostics(&heldReports);
+            freeFileList(&entries);
+            freeManifest(&manifest);
+            freeToc(&toc);
             freeProjectState(&state);
             return -1;
         }
 
-        if (state.handlerFunction) {
-            enum FileHandlerStatus handlerStatus =
-                state.handlerFunction(&state.context);
-            if (handlerStatus == HANDLER_FAILURE) {
-                freeProjectState(&state);
-                return -1;
+        if (state.spanSize > 0 &&
+            entries.count - spanStart >= state.spanSize) {
+            spanStatus = handleSpan(&state, &entries, &spanStart, keepEntries);
+            if (spanStatus == HANDLER_SUCCESS) {
+                flushHeldReports(&heldReports);
             }
         }
+        if (spanStatus == HANDLER_FAILURE) {
+            if (state.continueOnError) {
+                failures++;
+                spanStatus = HANDLER_SUCCESS;
+                continue;
+            }
+            break;
+        }
+    }
+    // the last partial span, or all of it for handlers taking the project
+    // at once
+    if (spanStatus == HANDLER_SUCCESS) {
+        spanStatus = handleSpan(&state, &entries, &spanStart, keepEntries);
+    }
+    if (spanStatus == HANDLER_SUCCESS) {
+        flushHeldReports(&heldReports);
+    }
+    freeDiagnostics(&heldReports);
+    if (spanStatus == HANDLER_FAILURE) {
+        if (!state.continueOnError) {
+            freeFileList(&entries);
+            freeManifest(&manifest);
+            freeToc(&toc);
+            freeProjectState(&state);
+            return -1;
+        }
+        failures++;
+    }
+    if (state.context.pipeline && pipelineStop(state.context.pipeline) != 0) {
+        reportFileError(FILE_OP_WRITE, state.context.outPath);
+        failures++;
+    }
+    if (args->mode == MODE_ANALYZE &&
+        analyzeProject(&entries, jobs, args->directory, stdout) != 0) {
+        failures++;
     }
+    if (args->mode == MODE_HTML && args->format == FORMAT_EPUB &&
+        writeProjectEpub(&entries, jobs, args->directory, args->title) != 0) {
+        failures++;
+    }
+    if (args->mode == MODE_HTML && args->format != FORMAT_EPUB &&
+        renderProjectHtml(&entries,
+                          jobs,
+                          args->directory,
+                          args->title,
+                          args->prefixPadding,
+                          args->format == FORMAT_HTML_CHAPTERS) != 0) {
+        failures++;
+    }
+    if (args->mode == MODE_VERIFY &&
+        verifyDraft(
+            &entries, jobs, args->directory, args->verifyDraft, stdout) != 0) {
+        failures++;
+    }
+    if (args->mode == MODE_GREP &&
+        searchProjectFiles(
+            &entries, args->pattern, jobs, args->directory, stdout) != 0) {
+        failures++;
+    }
+    if (args->mode == MODE_DUPES &&
+        findDuplicatePassages(
+            &entries, args->minLength, jobs, args->directory, stdout) != 0) {
+        failures++;
+    }
+    if (args->mode == MODE_SPELL &&
+        spellCheckProject(
+            &entries, args->directory, args->dictionary, jobs, stdout) != 0) {
+        failures++;
+    }
+    if (args->mode == MODE_INDEX || args->mode == MODE_LOOKUP) {
+        // lookups refresh the index first so results are never stale
+        char indexPath[COLETTE_PATH_BUF_SIZE];
+        if (joinPath(indexPath,
+                     sizeof(indexPath),
+                     args->directory,
+                     COLETTE_WORD_INDEX_NAME) != 0 ||
+            updateWordIndex(&entries, args->directory, indexPath, jobs) != 0) {
+            failures++;
+        } else if (args->mode == MODE_LOOKUP &&
+                   lookupWordIndex(indexPath, args->pattern, stdout) != 0) {
+            failures++;
+        }
+    }
+    if (args->statsFile) {
+        rollUpStats(&entries);
+        if (writeStatsReport(&entries, args->statsFile, args->directory) != 0) {
+            failures++;
+        }
+    }
+    freeFileList(&entries);
+    if (state.context.metaTable &&
+        writeMetaSidecar(&metaTable, state.context.outPath, args->directory) !=
+            0) {
+        failures++;
+    }
+    if (state.context.toc && failures == 0 &&
+        assembleDraft(&state.context) != 0) {
+        failures++;
+    }
+    if (state.context.manifest && failures == 0) {
+        char path[COLETTE_PATH_BUF_SIZE];
+        manifest.draftHash = xxh3Digest(&state.context.draftHash);
+        if (manifestPath(path, sizeof(path), state.context.outPath) != 0 ||
+            writeManifest(&manifest,
+                          path,
+                          state.context.outPath,
+                          args->directory) != 0) {
+            failures++;
+        }
+    }
+    freeManifest(&manifest);
+    freeToc(&toc);
+
     // DON'T FORGET TO FREE STATE
     freeProjectState(&state);
 
-    return 0;
+    return failures > 0 ? -1 : 0;
+}
+
+int processProject(struct Arguments *args) {
+    if (args->mode != MODE_CHECK) {
+        return runProject(args);
+    }
+
+    struct DiagnosticList diagnostics = {0};
+    setDiagnosticSink(&diagnostics);
+    int status = runProject(args);
+    setDiagnosticSink(NULL);
+
+    sortDiagnostics(&diagnostics);
+    FILE *reportOut = args->reportFormat == REPORT_JSON ? stdout : stderr;
+    if (writeDiagnostics(&diagnostics, args->reportFormat, reportOut) != 0) {
+        reportFileError(FILE_OP_WRITE, "check report");
+        status = -1;
+    }
+    // warnings are reported but don't fail the check
+    if (countDiagnosticErrors(&diagnostics) > 0) {
+        status = -1;
+    }
+    freeDiagnostics(&diagnostics);
+
+    return status;
 }
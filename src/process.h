@@ -1,20 +1,38 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
+#include "arena.h"
 #include "args.h"
+#include "encoding.h"
 #include "errors.h"
+#include "filelist.h"
+#include "filter.h"
+#include "frontmatter.h"
+#include "manifest.h"
+#include "pipeline.h"
+#include "readahead.h"
+#include "metadata.h"
+#include "pathbuilder.h"
+#include "template.h"
+#include "toc.h"
+#include "trace.h"
+#include "xxh3.h"
+#include <stdbool.h>
 #include <stdio.h>
 
-enum FileType { FILE_TYPE_UNKNOWN, FILE_TYPE_DIRECTORY, FILE_TYPE_REGULAR };
-
 /* *
  * Index state stores the path to an index file as well as a file pointer to
  * the open index file. It is used with FileIterator to keep track of and read
- * index files while traversing a project.
+ * index files while traversing a project. encoding starts as the parent
+ * directory's and changes at an encoding line in the index. The directory path
+ * and the index's read buffer live in the iterator's arena above mark.
  * */
 struct IndexState {
     char *curIndexFileDir;
     FILE *curIndexFile;
+    enum TextEncoding encoding;
+    struct TraceSpan parseSpan;
+    struct ArenaMark mark; // released when the level is popped
 };
 
 /* *
@@ -28,8 +46,11 @@ struct IndexState {
  * */
 struct FileIterator {
     struct IndexState *stack; // pointer == array
+    struct Arena arena;       // strings and buffers for the levels on stack
+    struct PathBuilder path;  // directory being read, then its current entry
     size_t stackSize;
     size_t stackMax;
+    struct FileList *entries; // if set, receives every resolved entry
     enum FileIteratorStatus status;
 };
 
@@ -41,10 +62,34 @@ struct FileIterator {
  * the user, otherwise it will default to _draft_.
  * */
 struct ProcessContext {
-    char *currentFilePath;
+    char *currentFilePath; // the iterator's path, valid until the next entry
     char *outPath;
     FILE *outFile;
     enum FileType currentFileType;
+    size_t currentFileBytes; // bytes the handler read from the current file
+    long long currentFileSize; // found while resolving the file, or -1
+    enum TextEncoding currentEncoding; // declared for the current file's dir
+    bool validateUtf8;       // collate: fail on invalid UTF-8 input
+    struct Transcoder transcoder; // collate: non-UTF-8 sources to UTF-8
+    struct TextFilter filter; // collate: transforms applied while copying
+    struct FrontMatter frontMatter; // collate --metadata: front matter splitter
+    struct MetaTable *metaTable;    // collate --metadata: rows in draft order
+    struct TocScanner *toc;         // collate --toc: headings found so far
+    const struct Template *header;    // collate: rendered before each file
+    const struct Template *separator; // collate: rendered after each file
+    struct TemplateBuffer rendered;   // collate: reused for every render
+    struct TemplateVars templateVars; // collate: values for the current file
+    size_t rootLen;                   // collate: stripped from template paths
+    size_t topEntry;     // root .index entries read so far
+    size_t chapterEntry; // topEntry of the last file written to the draft
+    struct TextStats *currentStats; // --stats: counts for the current file
+    struct StatsCounter statsCounter;
+    struct WritePipeline *pipeline; // writer thread for the draft, if any
+    struct Readahead *readahead;    // collate: files opened ahead, if any
+    int currentFd; // currentFilePath as readahead opened it, or -1
+    struct Manifest *manifest;      // --manifest: source hashes so far
+    struct Xxh3State sourceHash;    // --manifest: bytes read from the file
+    struct Xxh3State draftHash;     // --manifest: bytes written to the draft
     enum ProcessContextStatus status;
 };
 
@@ -55,18 +100,30 @@ struct ProcessContext {
  * handler function that is determined based on the processing mode chosen by
  * the user as well as a status to identify if any errors occur during 
  * processing. 
+ *
+ * Resolved entries are handed to batchHandler in spans of spanSize, so a
+ * handler can work on many files at once. A spanSize of 0 hands it the whole
+ * project once traversal is done. Modes with a per-file handlerFunction get
+ * an adapter that calls it for each file in the span.
  * */
 struct ProjectState {
     struct ProcessContext context;
     struct FileIterator iter;
     enum FileHandlerStatus (*handlerFunction)(struct ProcessContext *context);
+    enum FileHandlerStatus (*batchHandler)(struct ProjectState *state,
+                                           struct FileSpan span);
+    size_t spanSize;      // entries per span, or 0 for the whole project
+    unsigned int jobs;    // worker threads a batch handler may use
+    bool countStats;      // --stats: handlers fill in each entry's stats
+    bool continueOnError; // check mode: record problems and keep traversing
     enum ProjectStateStatus status;
 };
 
 /* *
  * Initializes state based on arguments passed by the user. Iterates through 
  * index files, processing project files in the order they appear in
- * the index files.
+ * the index files. In check mode every problem is collected and the walk
+ * continues, ending with a single sorted report in the requested format.
  *
  * @param   args  Command line arguments included when the program is executed.
  *
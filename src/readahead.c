@@ -0,0 +1,271 @@
+#include "constants.h"
+#include "files.h"
+#include "readahead.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* *
+ * Joins the way joinPath does, but quietly: anything joinPath would reject is
+ * left for the iterator to find and report.
+ * */
+static int joinQuietly(char *buffer,
+                       size_t size,
+                       const char *dir,
+                       const char *file) {
+    size_t dirLen = strlen(dir);
+    if (dirLen == 0 || file[0] == '/') {
+        return -1;
+    }
+    const char *slash = dir[dirLen - 1] == '/' ? "" : "/";
+    int len = snprintf(buffer, size, "%s%s%s", dir, slash, file);
+    return len < 0 || (size_t)len >= size ? -1 : 0;
+}
+
+static char *copyString(const char *text) {
+    size_t len = strlen(text) + 1;
+    char *copy = malloc(len);
+    if (copy) {
+        memcpy(copy, text, len);
+    }
+    return copy;
+}
+
+static char *readIndexQuietly(const char *path, size_t *len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    size_t capacity = COLETTE_FILE_BUF_SIZE;
+    size_t used = 0;
+    char *text = malloc(capacity);
+    while (text) {
+        if (used == capacity) {
+            char *grown = realloc(text, capacity * 2);
+            if (!grown) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = grown;
+            capacity *= 2;
+        }
+        size_t wanted = capacity - used;
+        ssize_t bytesRead = read(fd, text + used, wanted);
+        if (bytesRead < 0 && errno != EINTR) {
+            free(text);
+            text = NULL;
+        } else if (bytesRead >= 0) {
+            used += (size_t)bytesRead;
+            // a short read of a regular file is its end; the walk is only a
+            // hint, so one that stops early costs nothing but prefetching
+            if ((size_t)bytesRead < wanted) {
+                break;
+            }
+        }
+    }
+    close(fd);
+
+    *len = used;
+    return text;
+}
+
+static int pushDir(struct Readahead *readahead, const char *dirPath) {
+    char indexPath[COLETTE_PATH_BUF_SIZE];
+    if (joinQuietly(indexPath, sizeof(indexPath), dirPath, ".index") != 0) {
+        return -1;
+    }
+    if (readahead->stackSize == readahead->stackMax) {
+        size_t stackMax =
+            readahead->stackMax ? readahead->stackMax * 2 : COLETTE_PROJECT_DEPTH;
+        struct ReadaheadDir *grown = realloc(
+            readahead->stack, stackMax * sizeof(struct ReadaheadDir));
+        if (!grown) {
+            return -1;
+        }
+        readahead->stack = grown;
+        readahead->stackMax = stackMax;
+    }
+
+    struct ReadaheadDir dir = {.path = copyString(dirPath)};
+    if (dir.path) {
+        dir.index = readIndexQuietly(indexPath, &dir.indexLen);
+    }
+    if (!dir.index) {
+        free(dir.path);
+        return -1;
+    }
+    readahead->stack[readahead->stackSize++] = dir;
+    return 0;
+}
+
+static void popDir(struct Readahead *readahead) {
+    struct ReadaheadDir *dir = &readahead->stack[--readahead->stackSize];
+    free(dir->index);
+    free(dir->path);
+}
+
+/* *
+ * Takes the next .index line in the pieces fgets would return into a buffer
+ * of COLETTE_NAME_BUF_SIZE, which is how the iterator reads it.
+ * */
+static bool nextLine(struct ReadaheadDir *dir, char *line) {
+    if (dir->pos >= dir->indexLen) {
+        return false;
+    }
+
+    size_t len = 0;
+    while (len < COLETTE_NAME_BUF_SIZE - 1 && dir->pos < dir->indexLen) {
+        char c = dir->index[dir->pos++];
+        line[len++] = c;
+        if (c == '\n') {
+            break;
+        }
+    }
+    line[len] = '\0';
+    return true;
+}
+
+static void dropEntry(struct ReadaheadEntry *entry) {
+    if (entry->fd >= 0) {
+        close(entry->fd);
+    }
+}
+
+/* *
+ * Resolves one .index line and queues it, opening regular files. Directories
+ * are walked into.
+ * */
+static void visitEntry(struct Readahead *readahead,
+                       const char *dirPath,
+                       const char *fileName) {
+    // resolved in place in the next free slot, which is only counted as
+    // queued once it holds an entry
+    size_t slot = (readahead->head + readahead->count) % readahead->depth;
+    struct ReadaheadEntry *entry = &readahead->ring[slot];
+    if (joinQuietly(entry->basePath,
+                    COLETTE_PATH_BUF_SIZE - COLETTE_EXT_BUF_SIZE,
+                    dirPath,
+                    fileName) != 0) {
+        return;
+    }
+
+    entry->fd = -1;
+    switch (resolveFile(entry->path, sizeof(entry->path), entry->basePath)) {
+    case RESOLVE_DIR:
+        entry->type = FILE_TYPE_DIRECTORY;
+        break;
+    case RESOLVE_EXACT:
+    case RESOLVE_FILE:
+        entry->type = FILE_TYPE_REGULAR;
+        entry->fd = open(entry->path, O_RDONLY | O_CLOEXEC);
+        if (entry->fd < 0) {
+            return;
+        }
+        posix_fadvise(entry->fd, 0, 0, POSIX_FADV_WILLNEED);
+        break;
+    default:
+        return;
+    }
+    readahead->count++;
+
+    if (entry->type == FILE_TYPE_DIRECTORY) {
+        pushDir(readahead, entry->path);
+    }
+}
+
+// walks on until depth entries are queued or the project runs out
+static void fillRing(struct Readahead *readahead) {
+    char fileName[COLETTE_NAME_BUF_SIZE];
+    while (readahead->count < readahead->depth && readahead->stackSize > 0) {
+        struct ReadaheadDir *dir = &readahead->stack[readahead->stackSize - 1];
+        if (!nextLine(dir, fileName)) {
+            popDir(readahead);
+            continue;
+        }
+        fileName[strcspn(fileName, "\n")] = '\0';
+        if (isIncluded(fileName)) {
+            visitEntry(readahead, dir->path, fileName);
+        }
+    }
+}
+
+static void dropHead(struct Readahead *readahead) {
+    dropEntry(&readahead->ring[readahead->head]);
+    readahead->head = (readahead->head + 1) % readahead->depth;
+    readahead->count--;
+}
+
+int readaheadInit(struct Readahead *readahead,
+                  const char *rootDir,
+                  size_t depth) {
+    *readahead = (struct Readahead){.depth = depth ? depth : 1};
+    readahead->ring = malloc(readahead->depth * sizeof(struct ReadaheadEntry));
+    if (!readahead->ring) {
+        return -1;
+    }
+
+    // a root the walk can't read is the iterator's to report
+    pushDir(readahead, rootDir);
+    fillRing(readahead);
+    return 0;
+}
+
+int readaheadTake(struct Readahead *readahead,
+                  struct PathBuilder *path,
+                  enum FileType *type,
+                  int *fd) {
+    size_t found = 0;
+    while (found < readahead->count &&
+           strcmp(readahead->ring[(readahead->head + found) % readahead->depth]
+                      .basePath,
+                  path->path) != 0) {
+        found++;
+    }
+    if (found == readahead->count) {
+        return -1;
+    }
+
+    // anything before it was passed over
+    for (size_t i = 0; i < found; i++) {
+        dropHead(readahead);
+    }
+
+    // the resolved path is the base path plus whatever extension it took
+    struct ReadaheadEntry *entry = &readahead->ring[readahead->head];
+    const char *extension = entry->path + path->len;
+    int status = -1;
+    if (extension[0] == '\0' ||
+        pathBuilderPushExtension(path, extension) == 0) {
+        *type = entry->type;
+        *fd = entry->fd;
+        entry->fd = -1;
+        status = 0;
+    }
+    dropHead(readahead);
+
+    fillRing(readahead);
+    return status;
+}
+
+void readaheadFree(struct Readahead *readahead) {
+    if (!readahead) {
+        return;
+    }
+
+    while (readahead->count > 0) {
+        dropHead(readahead);
+    }
+    while (readahead->stackSize > 0) {
+        popDir(readahead);
+    }
+    free(readahead->ring);
+    free(readahead->stack);
+    readahead->ring = NULL;
+    readahead->stack = NULL;
+}
@@ -0,0 +1,93 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include "constants.h"
+#include "filelist.h"
+#include "pathbuilder.h"
+#include <stddef.h>
+
+/* *
+ * A project entry resolved ahead of the iterator. Regular files are open, with
+ * the kernel already asked to read them in. The paths are held in the ring
+ * slot itself so queueing an entry allocates nothing.
+ * */
+struct ReadaheadEntry {
+    char basePath[COLETTE_PATH_BUF_SIZE]; // directory joined with the .index
+                                          // line, as the iterator joins it
+    char path[COLETTE_PATH_BUF_SIZE];     // resolved path
+    enum FileType type;
+    int fd;         // regular files only, -1 for directories
+};
+
+/* *
+ * A directory being walked. Its .index is read whole, so walking it costs
+ * no more calls however many lines it has.
+ * */
+struct ReadaheadDir {
+    char *path;
+    char *index;
+    size_t indexLen;
+    size_t pos;
+};
+
+/* *
+ * Walks the project's .index files on its own, up to depth entries ahead of
+ * the collating iterator, resolving each entry and opening each file with a
+ * POSIX_FADV_WILLNEED hint, so its pages are on their way in before the
+ * iterator gets there. On cold caches the disk then works while the previous file is
+ * copied.
+ *
+ * The walk is only a hint. Entries it can't resolve or open are skipped
+ * without a report; the iterator resolves them again and reports them.
+ * */
+struct Readahead {
+    struct ReadaheadEntry *ring; // depth slots, oldest at head
+    size_t depth;
+    size_t head;
+    size_t count;
+    struct ReadaheadDir *stack; // directories being walked, innermost last
+    size_t stackSize;
+    size_t stackMax;
+};
+
+/* *
+ * Starts the walk at the project root and resolves the first depth entries.
+ *
+ * @param   readahead  Walk to start
+ * @param   rootDir    Project root, as the iterator was given it
+ * @param   depth      Entries to keep ahead of the iterator, at least 1
+ *
+ * @return  int
+ *          0          on success
+ *         -1          if memory could not be allocated; nothing to free
+ * */
+int readaheadInit(struct Readahead *readahead,
+                  const char *rootDir,
+                  size_t depth);
+
+/* *
+ * Hands over the entry the iterator has reached, if the walk resolved it, and
+ * walks on. Entries before it that the iterator passed over are dropped.
+ *
+ * @param   readahead  Running walk
+ * @param   path       Directory joined with the .index line; the extension
+ *                     the walk resolved it with, if any, is pushed onto it
+ * @param   type       Receives the entry's type
+ * @param   fd         Receives the open file, which the caller now owns, or
+ *                     -1 for a directory
+ *
+ * @return  int
+ *          0          if the walk had the entry
+ *         -1          if it didn't; resolve it as usual
+ * */
+int readaheadTake(struct Readahead *readahead,
+                  struct PathBuilder *path,
+                  enum FileType *type,
+                  int *fd);
+
+/* *
+ * @param  readahead  Walk to stop; open files are closed
+ * */
+void readaheadFree(struct Readahead *readahead);
+
+#endif
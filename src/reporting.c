@@ -1,3 +1,4 @@
+#include "constants.h"
 #include "reporting.h"
 #include <errno.h>
 #include <stdbool.h>
@@ -56,6 +57,8 @@ static const char *processErrorStr(enum ProcessErrorDetail detail) {
         return "Invalid path";
     case PROC_ERR_INVALID_LINK:
         return "Symbolic links not permitted";
+    case PROC_ERR_NOT_REGULAR:
+        return "Not a regular file";
 
     // Structure errors
     case PROC_ERR_INDEX_MISSING:
@@ -86,6 +89,10 @@ static const char *processErrorStr(enum ProcessErrorDetail detail) {
         return "Internal buffer overflow";
     case PROC_ERR_DATA_CORRUPT:
         return "Data corruption detected";
+    case PROC_ERR_INVALID_UTF8:
+        return "Invalid UTF-8 sequence";
+    case PROC_ERR_UNKNOWN_ENCODING:
+        return "Unknown encoding in .index file";
 
     // Project structure errors
     case PROC_ERR_TOO_DEEP:
@@ -94,6 +101,10 @@ static const char *processErrorStr(enum ProcessErrorDetail detail) {
         return "Project contains too many files";
     case PROC_ERR_INVALID_STRUCTURE:
         return "Invalid project structure detected";
+    case PROC_ERR_DUPLICATE_REF:
+        return "Referenced more than once in index files";
+    case PROC_ERR_ORPHANED_FILE:
+        return "Not listed in any index file";
 
     // Other
     case PROC_ERR_OPEN_FILE:
@@ -141,37 +152,126 @@ static const char *processOpStr(enum ProcessOperation op) {
         return "creating file listing";
     case PROCESS_OP_HANDLE_COLLATE:
         return "combining files";
+    case PROCESS_OP_HANDLE_GREP:
+        return "searching project";
+    case PROCESS_OP_HANDLE_INDEX:
+        return "indexing project";
+    case PROCESS_OP_HANDLE_DUPES:
+        return "comparing files";
+    case PROCESS_OP_HANDLE_ANALYZE:
+        return "analysing project";
+    case PROCESS_OP_HANDLE_SPELL:
+        return "checking spelling";
+    case PROCESS_OP_HANDLE_HTML:
+        return "rendering HTML";
+    case PROCESS_OP_HANDLE_EPUB:
+        return "writing EPUB";
+    case PROCESS_OP_HANDLE_VERIFY:
+        return "verifying draft";
 
     default:
         return "unknown operation";
     }
 }
 
-void reportProcessError(enum ProcessOperation op,
-                        const char *path,
-                        enum ProcessErrorDetail detail) {
-    fprintf(stderr, "Error %s", processOpStr(op));
+/* *
+ * When set, reports are collected here instead of being printed. Check mode
+ * uses this to keep traversing after errors and report everything at once.
+ * */
+static struct DiagnosticList *diagnosticSink = NULL;
 
-    if (path) {
-        fprintf(stderr, " for %s", path);
-    }
+void setDiagnosticSink(struct DiagnosticList *sink) {
+    diagnosticSink = sink;
+}
 
-    const char *detailStr = processErrorStr(detail);
-    if (detailStr) {
-        fprintf(stderr, ": %s", detailStr);
+static void emitReport(enum DiagnosticSeverity severity,
+                       const char *path,
+                       const char *operation,
+                       const char *detail,
+                       const char *systemError,
+                       const char *message) {
+    if (diagnosticSink &&
+        addDiagnostic(diagnosticSink,
+                      severity,
+                      path,
+                      operation,
+                      detail,
+                      systemError,
+                      message) == 0) {
+        return;
     }
 
-    if (errno != 0) {
-        fprintf(stderr, " (%s)", strerror(errno));
+    // not collecting, or out of memory while collecting: print immediately
+    fputs(message, stderr);
+    fputc('\n', stderr);
+}
+
+static void formatProcessReport(enum DiagnosticSeverity severity,
+                                enum ProcessOperation op,
+                                const char *path,
+                                const char *detailStr) {
+    const char *systemError = errno != 0 ? strerror(errno) : NULL;
+    const char *opStr = processOpStr(op);
+    char message[COLETTE_REPORT_BUF_SIZE];
+
+    int len = snprintf(message,
+                       sizeof(message),
+                       "%s %s",
+                       severity == DIAG_ERROR ? "Error" : "Warning",
+                       opStr);
+    if (path && len >= 0 && (size_t)len < sizeof(message)) {
+        len += snprintf(
+            message + len, sizeof(message) - len, " for %s", path);
+    }
+    if (detailStr && len >= 0 && (size_t)len < sizeof(message)) {
+        len += snprintf(
+            message + len, sizeof(message) - len, ": %s", detailStr);
     }
+    if (systemError && len >= 0 && (size_t)len < sizeof(message)) {
+        snprintf(message + len, sizeof(message) - len, " (%s)", systemError);
+    }
+
+    emitReport(severity, path, opStr, detailStr, systemError, message);
+}
+
+void reportProcessError(enum ProcessOperation op,
+                        const char *path,
+                        enum ProcessErrorDetail detail) {
+    formatProcessReport(DIAG_ERROR, op, path, processErrorStr(detail));
+}
 
-    fprintf(stderr, "\n");
+void reportProcessWarning(enum ProcessOperation op,
+                          const char *path,
+                          enum ProcessErrorDetail detail) {
+    formatProcessReport(DIAG_WARNING, op, path, processErrorStr(detail));
+}
+
+void reportEncodingError(enum ProcessOperation op,
+                         const char *path,
+                         size_t byteOffset,
+                         size_t line) {
+    char detail[128];
+    snprintf(detail,
+             sizeof(detail),
+             "%s at byte offset %zu, line %zu",
+             processErrorStr(PROC_ERR_INVALID_UTF8),
+             byteOffset,
+             line);
+
+    errno = 0; // the file was read fine, strerror() would only mislead
+    formatProcessReport(DIAG_ERROR, op, path, detail);
 }
 
 void reportFileError(enum FileOperation op, const char *path) {
-    fprintf(stderr, "Error %s %s", fileOpStr(op), path ? path : "path");
-    if (errno != 0) {
-        fprintf(stderr, ": %s", strerror(errno));
+    const char *systemError = errno != 0 ? strerror(errno) : NULL;
+    const char *opStr = fileOpStr(op);
+    char message[COLETTE_REPORT_BUF_SIZE];
+
+    int len = snprintf(
+        message, sizeof(message), "Error %s %s", opStr, path ? path : "path");
+    if (systemError && len >= 0 && (size_t)len < sizeof(message)) {
+        snprintf(message + len, sizeof(message) - len, ": %s", systemError);
     }
-    fprintf(stderr, "\n");
+
+    emitReport(DIAG_ERROR, path, opStr, NULL, systemError, message);
 }
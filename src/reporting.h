@@ -1,7 +1,9 @@
 #ifndef REPORTING_H
 #define REPORTING_H
 
+#include "diagnostics.h"
 #include "errors.h"
+#include <stddef.h>
 
 /* *
  * Reports errors specific to file operations to stderr. Includes system errno
@@ -25,4 +27,37 @@ void reportProcessError(enum ProcessOperation op,
                         const char *path,
                         enum ProcessErrorDetail details);
 
+/* *
+ * Reports a non-fatal problem. Formatted like reportProcessError() but with a
+ * "Warning" prefix, and never fails a check on its own.
+ *
+ * @param  op       Type of process operation that raised the warning
+ * @param  path     Path related to the warning, or NULL if no path involved
+ * @param  details  Specific detail code describing the problem
+ * */
+void reportProcessWarning(enum ProcessOperation op,
+                          const char *path,
+                          enum ProcessErrorDetail details);
+
+/* *
+ * Reports the first invalid UTF-8 sequence in a file.
+ *
+ * @param  op          Type of process operation that found the problem
+ * @param  path        File containing the invalid sequence
+ * @param  byteOffset  Zero-based offset of the first byte of the sequence
+ * @param  line        One-based line the sequence starts on
+ * */
+void reportEncodingError(enum ProcessOperation op,
+                         const char *path,
+                         size_t byteOffset,
+                         size_t line);
+
+/* *
+ * Redirects reports into a diagnostics list instead of stderr. Pass NULL to
+ * resume printing immediately.
+ *
+ * @param  sink  List to collect reports into, or NULL
+ * */
+void setDiagnosticSink(struct DiagnosticList *sink);
+
 #endif
@@ -0,0 +1,688 @@
+#include "spell.h"
+#include "arena.h"
+#include "constants.h"
+#include "dafsa.h"
+#include "errors.h"
+#include "files.h"
+#include "reporting.h"
+#include "workers.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SPELL_CACHE_MAGIC "COLDAFS"
+#define SPELL_CACHE_VERSION 1u
+#define SPELL_CACHE_BYTE_ORDER 0x01020304u
+#define SOURCE_COUNT 2
+
+/* *
+ * Identifies one word list as it was when the cache was built. A list that
+ * didn't exist is recorded with present set to 0.
+ * */
+struct SourceSignature {
+    uint64_t present;
+    uint64_t size;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    uint64_t inode;
+    uint64_t device;
+};
+
+/* *
+ * Cache layout: this header, then the states, then the edges, all 8-byte
+ * records so the arrays can be used straight from the mapping.
+ * */
+struct SpellCacheHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    struct SourceSignature sources[SOURCE_COUNT]; // system, project
+    uint64_t stateCount;
+    uint64_t edgeCount;
+    uint64_t root;
+};
+
+/* *
+ * The dictionary in use: either mapped from the cache or, when the cache
+ * can't be written, the builder's own arrays.
+ * */
+struct SpellDictionary {
+    struct Dafsa dafsa;
+    void *base;
+    size_t size;
+    struct DafsaBuilder builder;
+    bool built;
+};
+
+struct WordList {
+    char *text; // folded words, each followed by '\0'
+    size_t size;
+    size_t capacity;
+    size_t *offsets;
+    size_t count;
+    size_t offsetCapacity;
+};
+
+struct Misspelling {
+    size_t offset;
+    size_t line;
+    const char *word; // as written, in the result's arena
+};
+
+struct SpellResult {
+    struct ReadFailure failure;
+    size_t size;
+    size_t newlines;
+    struct Misspelling *misspellings;
+    size_t count;
+    size_t capacity;
+    struct Arena arena;
+};
+
+struct SpellJob {
+    const struct FileList *entries;
+    const struct Dafsa *dafsa;
+    struct SpellResult *results;
+};
+
+static unsigned char foldCase(unsigned char byte) {
+    return (byte >= 'A' && byte <= 'Z') ? (unsigned char)(byte + 32) : byte;
+}
+
+static bool isLetterByte(unsigned char byte) {
+    return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') ||
+           byte >= 0x80;
+}
+
+static bool isDigitByte(unsigned char byte) {
+    return byte >= '0' && byte <= '9';
+}
+
+static bool isRightQuote(const unsigned char *data, size_t i, size_t size) {
+    return i + 2 < size && data[i] == 0xE2 && data[i + 1] == 0x80 &&
+           data[i + 2] == 0x99;
+}
+
+/* *
+ * Bytes in U+2000..U+203F (dashes, quotes, ellipsis) are punctuation even
+ * though they are not ASCII.
+ * */
+static bool isGeneralPunctuation(const unsigned char *data,
+                                 size_t i,
+                                 size_t size) {
+    return i + 2 < size && data[i] == 0xE2 && data[i + 1] == 0x80;
+}
+
+/* *
+ * U+FEFF, the byte order mark collation keeps at the start of a file.
+ * */
+static bool isByteOrderMark(const unsigned char *data, size_t i, size_t size) {
+    return i + 2 < size && data[i] == 0xEF && data[i + 1] == 0xBB &&
+           data[i + 2] == 0xBF;
+}
+
+static void setSignature(struct SourceSignature *signature,
+                         const char *path) {
+    struct stat info;
+    memset(signature, 0, sizeof(*signature));
+    if (stat(path, &info) != 0) {
+        return;
+    }
+    *signature = (struct SourceSignature){
+        .present = 1,
+        .size = (uint64_t)info.st_size,
+        .mtimeSec = (int64_t)info.st_mtim.tv_sec,
+        .mtimeNsec = (int64_t)info.st_mtim.tv_nsec,
+        .inode = (uint64_t)info.st_ino,
+        .device = (uint64_t)info.st_dev};
+}
+
+static void unmapDictionary(struct SpellDictionary *dictionary) {
+    if (dictionary->base) {
+        munmap(dictionary->base, dictionary->size);
+    }
+    if (dictionary->built) {
+        freeDafsaBuilder(&dictionary->builder);
+    }
+    memset(dictionary, 0, sizeof(*dictionary));
+}
+
+/* *
+ * Maps the cache if it was built from lists with these signatures. Every
+ * state's edges and every edge's target are checked, so lookups can trust
+ * the arrays.
+ *
+ * @return  0 on success, -1 if the cache is missing, stale or damaged
+ * */
+static int mapCache(const char *path,
+                    const struct SourceSignature *sources,
+                    struct SpellDictionary *dictionary) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        (uintmax_t)info.st_size < sizeof(struct SpellCacheHeader) ||
+        (uintmax_t)info.st_size > SIZE_MAX) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    const struct SpellCacheHeader *header = base;
+    size_t records = (size - sizeof(*header)) / sizeof(struct DafsaState);
+    bool valid =
+        memcmp(header->magic, SPELL_CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+        header->byteOrder == SPELL_CACHE_BYTE_ORDER &&
+        header->version == SPELL_CACHE_VERSION &&
+        memcmp(header->sources, sources, sizeof(header->sources)) == 0 &&
+        header->stateCount <= records && header->edgeCount <= records &&
+        header->stateCount + header->edgeCount == records &&
+        (size - sizeof(*header)) % sizeof(struct DafsaState) == 0 &&
+        header->root < header->stateCount;
+    if (!valid) {
+        munmap(base, size);
+        return -1;
+    }
+
+    const char *bytes = base;
+    const struct DafsaState *states =
+        (const struct DafsaState *)(bytes + sizeof(*header));
+    const struct DafsaEdge *edges =
+        (const struct DafsaEdge *)(states + header->stateCount);
+    for (uint64_t s = 0; valid && s < header->stateCount; s++) {
+        valid = states[s].firstEdge <= header->edgeCount &&
+                states[s].edgeCount <=
+                    header->edgeCount - states[s].firstEdge;
+    }
+    for (uint64_t e = 0; valid && e < header->edgeCount; e++) {
+        valid = edges[e].target < header->stateCount;
+    }
+    if (!valid) {
+        munmap(base, size);
+        return -1;
+    }
+
+    dictionary->base = base;
+    dictionary->size = size;
+    dictionary->dafsa = (struct Dafsa){.states = states,
+                                       .edges = edges,
+                                       .stateCount = header->stateCount,
+                                       .edgeCount = header->edgeCount,
+                                       .root = (uint32_t)header->root};
+    return 0;
+}
+
+static int appendWord(struct WordList *list, const char *word, size_t len) {
+    if (list->size + len + 1 > list->capacity) {
+        size_t capacity = list->capacity ? list->capacity : 65536;
+        while (capacity < list->size + len + 1) {
+            capacity *= 2;
+        }
+        char *grown = realloc(list->text, capacity);
+        if (!grown) {
+            return -1;
+        }
+        list->text = grown;
+        list->capacity = capacity;
+    }
+    if (list->count == list->offsetCapacity) {
+        size_t capacity = list->offsetCapacity ? list->offsetCapacity * 2 : 4096;
+        size_t *grown = realloc(list->offsets, capacity * sizeof(size_t));
+        if (!grown) {
+            return -1;
+        }
+        list->offsets = grown;
+        list->offsetCapacity = capacity;
+    }
+
+    list->offsets[list->count++] = list->size;
+    memcpy(list->text + list->size, word, len);
+    list->size += len;
+    list->text[list->size++] = '\0';
+    return 0;
+}
+
+/* *
+ * Adds every word of a list, one per line. Blank lines and lines starting
+ * with '#' are skipped, and hunspell-style "/FLAGS" suffixes are dropped.
+ * */
+static int readWordList(const char *path, struct WordList *list) {
+    errno = 0;
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        reportFileError(FILE_OP_OPEN, path);
+        return -1;
+    }
+
+    int status = 0;
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t lineLen;
+    while ((lineLen = getline(&line, &lineCapacity, in)) != -1) {
+        const unsigned char *bytes = (const unsigned char *)line;
+        size_t start = 0;
+        size_t end = (size_t)lineLen;
+        while (start < end && (bytes[start] == ' ' || bytes[start] == '\t')) {
+            start++;
+        }
+        const char *slash = memchr(line + start, '/', end - start);
+        if (slash) {
+            end = (size_t)(slash - line);
+        }
+        while (end > start && (bytes[end - 1] == '\n' || bytes[end - 1] == '\r' ||
+                               bytes[end - 1] == ' ' || bytes[end - 1] == '\t')) {
+            end--;
+        }
+        if (start == end || bytes[start] == '#') {
+            continue;
+        }
+
+        // fold the way text is folded, curly apostrophes included
+        char word[COLETTE_MAX_TERM_LEN];
+        size_t len = 0;
+        bool fits = true;
+        for (size_t i = start; i < end && fits; i++) {
+            unsigned char byte = bytes[i];
+            if (isRightQuote(bytes, i, end)) {
+                byte = '\'';
+                i += 2;
+            }
+            fits = len < sizeof(word);
+            if (fits) {
+                word[len++] = (char)foldCase(byte);
+            }
+        }
+        if (fits && appendWord(list, word, len) != 0) {
+            reportProcessError(
+                PROCESS_OP_HANDLE_SPELL, path, PROC_ERR_MEMORY_ALLOC);
+            status = -1;
+            break;
+        }
+    }
+
+    if (status == 0 && ferror(in)) {
+        reportFileError(FILE_OP_READ, path);
+        status = -1;
+    }
+    free(line);
+    fclose(in);
+    return status;
+}
+
+static int compareWords(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static bool writeSection(FILE *out, const void *data, size_t size,
+                         size_t count) {
+    return count == 0 || fwrite(data, size, count, out) == count;
+}
+
+/* *
+ * Writes the cache beside a temporary name and renames it into place, so a
+ * concurrent run never maps half a cache.
+ * */
+static int writeCache(const char *path,
+                      const struct SourceSignature *sources,
+                      const struct Dafsa *dafsa) {
+    struct SpellCacheHeader header = {.byteOrder = SPELL_CACHE_BYTE_ORDER,
+                                      .version = SPELL_CACHE_VERSION,
+                                      .stateCount = dafsa->stateCount,
+                                      .edgeCount = dafsa->edgeCount,
+                                      .root = dafsa->root};
+    memcpy(header.magic, SPELL_CACHE_MAGIC, sizeof(header.magic));
+    memcpy(header.sources, sources, sizeof(header.sources));
+
+    char tempPath[COLETTE_PATH_BUF_SIZE];
+    int len = snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    if (len < 0 || (size_t)len >= sizeof(tempPath)) {
+        return -1;
+    }
+    FILE *out = fopen(tempPath, "wb");
+    if (!out) {
+        return -1;
+    }
+
+    bool written = writeSection(out, &header, sizeof(header), 1) &&
+                   writeSection(out,
+                                dafsa->states,
+                                sizeof(struct DafsaState),
+                                dafsa->stateCount) &&
+                   writeSection(out,
+                                dafsa->edges,
+                                sizeof(struct DafsaEdge),
+                                dafsa->edgeCount);
+    if (fclose(out) != 0) {
+        written = false;
+    }
+    if (!written || rename(tempPath, path) != 0) {
+        unlink(tempPath);
+        return -1;
+    }
+    return 0;
+}
+
+/* *
+ * Compiles both word lists into a DAFSA and caches it. A cache that can't be
+ * written, e.g. in a read-only project, only costs a warning; the automaton
+ * is then used from memory.
+ * */
+static int buildDictionary(const char *const *paths,
+                           const struct SourceSignature *sources,
+                           const char *cachePath,
+                           struct SpellDictionary *dictionary) {
+    struct WordList list = {0};
+    int status = 0;
+    for (size_t s = 0; s < SOURCE_COUNT && status == 0; s++) {
+        if (sources[s].present) {
+            status = readWordList(paths[s], &list);
+        }
+    }
+    if (status != 0) {
+        free(list.text);
+        free(list.offsets);
+        return -1;
+    }
+
+    // the text no longer moves, so words can be sorted by address
+    const char **words = malloc((list.count ? list.count : 1) * sizeof(char *));
+    for (size_t w = 0; words && w < list.count; w++) {
+        words[w] = list.text + list.offsets[w];
+    }
+    if (words && list.count > 1) {
+        qsort(words, list.count, sizeof(char *), compareWords);
+    }
+
+    struct DafsaBuilder *builder = &dictionary->builder;
+    bool built = words && dafsaBuilderInit(builder) == 0;
+    for (size_t w = 0; built && w < list.count; w++) {
+        built = dafsaBuilderAdd(builder, words[w], strlen(words[w])) == 0;
+    }
+    built = built && dafsaBuilderFinish(builder, &dictionary->dafsa) == 0;
+    free(words);
+    free(list.text);
+    free(list.offsets);
+    dictionary->built = true;
+    if (!built) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_SPELL, cachePath, PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+
+    errno = 0;
+    if (writeCache(cachePath, sources, &dictionary->dafsa) != 0) {
+        reportProcessWarning(
+            PROCESS_OP_HANDLE_SPELL, cachePath, PROC_ERR_INVALID_OUTPUT);
+    }
+    return 0;
+}
+
+static int loadDictionary(const char *rootDir,
+                          const char *systemDictionary,
+                          struct SpellDictionary *dictionary) {
+    memset(dictionary, 0, sizeof(*dictionary));
+    char projectPath[COLETTE_PATH_BUF_SIZE];
+    char cachePath[COLETTE_PATH_BUF_SIZE];
+    if (joinPath(projectPath,
+                 sizeof(projectPath),
+                 rootDir,
+                 COLETTE_PROJECT_DICTIONARY_NAME) != 0 ||
+        joinPath(cachePath, sizeof(cachePath), rootDir, COLETTE_SPELL_CACHE_NAME) !=
+            0) {
+        return -1;
+    }
+
+    const char *paths[SOURCE_COUNT] = {
+        systemDictionary ? systemDictionary : COLETTE_SYSTEM_DICTIONARY,
+        projectPath};
+    struct SourceSignature sources[SOURCE_COUNT];
+    for (size_t s = 0; s < SOURCE_COUNT; s++) {
+        setSignature(&sources[s], paths[s]);
+    }
+    if (!sources[0].present) {
+        // a list the user named must exist; the default one may not
+        if (systemDictionary) {
+            errno = ENOENT;
+            reportFileError(FILE_OP_OPEN, systemDictionary);
+            return -1;
+        }
+        errno = 0;
+        reportProcessWarning(
+            PROCESS_OP_HANDLE_SPELL, paths[0], PROC_ERR_FILE_NOT_FOUND);
+    }
+
+    if (mapCache(cachePath, sources, dictionary) == 0) {
+        return 0;
+    }
+    return buildDictionary(paths, sources, cachePath, dictionary);
+}
+
+static int addMisspelling(struct SpellResult *result,
+                          const unsigned char *text,
+                          size_t len,
+                          size_t offset,
+                          size_t line) {
+    if (result->count == result->capacity) {
+        size_t capacity = result->capacity ? result->capacity * 2 : 16;
+        struct Misspelling *grown = realloc(
+            result->misspellings, capacity * sizeof(struct Misspelling));
+        if (!grown) {
+            return -1;
+        }
+        result->misspellings = grown;
+        result->capacity = capacity;
+    }
+
+    char *word = arenaAlloc(&result->arena, len + 1);
+    if (!word) {
+        return -1;
+    }
+    memcpy(word, text, len);
+    word[len] = '\0';
+    result->misspellings[result->count++] =
+        (struct Misspelling){.offset = offset, .line = line, .word = word};
+    return 0;
+}
+
+static bool isKnownWord(const struct Dafsa *dafsa,
+                        const char *word,
+                        size_t len) {
+    if (dafsaContains(dafsa, word, len)) {
+        return true;
+    }
+    return len > 2 && word[len - 2] == '\'' && word[len - 1] == 's' &&
+           dafsaContains(dafsa, word, len - 2);
+}
+
+/* *
+ * Checks the word at data[start, end). folded holds it folded, or is NULL
+ * if the word was too long to fold or contains digits; those are skipped.
+ * */
+static int checkWord(const struct SpellJob *job,
+                     struct SpellResult *result,
+                     const unsigned char *data,
+                     size_t start,
+                     size_t end,
+                     const char *folded,
+                     size_t foldedLen,
+                     size_t line) {
+    if (!folded || isKnownWord(job->dafsa, folded, foldedLen)) {
+        return 0;
+    }
+    return addMisspelling(result, data + start, end - start, start, line);
+}
+
+static void checkText(const struct SpellJob *job,
+                      struct SpellResult *result,
+                      const unsigned char *data,
+                      size_t size) {
+    char folded[COLETTE_MAX_TERM_LEN];
+    size_t foldedLen = 0;
+    bool skip = false; // too long or contains digits
+    bool inWord = false;
+    size_t start = 0;
+    size_t line = 1;
+    size_t newlines = 0;
+
+    for (size_t i = 0; i <= size; i++) {
+        unsigned char byte = i < size ? data[i] : ' ';
+        size_t width = 1;
+        bool wordByte = false;
+        if (i < size && isRightQuote(data, i, size) && inWord &&
+            i + 3 < size && isLetterByte(data[i + 3]) &&
+            !isGeneralPunctuation(data, i + 3, size)) {
+            byte = '\'';
+            width = 3;
+            wordByte = true;
+        } else if (i < size && (isGeneralPunctuation(data, i, size) ||
+                                isByteOrderMark(data, i, size))) {
+            width = 3;
+        } else if (byte == '\'') {
+            wordByte = inWord && i + 1 < size && isLetterByte(data[i + 1]);
+        } else {
+            wordByte = isLetterByte(byte) || isDigitByte(byte);
+        }
+
+        if (wordByte) {
+            if (!inWord) {
+                inWord = true;
+                start = i;
+                foldedLen = 0;
+                skip = false;
+            }
+            if (isDigitByte(byte) || foldedLen == sizeof(folded)) {
+                skip = true;
+            } else {
+                folded[foldedLen++] = (char)foldCase(byte);
+            }
+        } else if (inWord) {
+            inWord = false;
+            if (checkWord(job,
+                          result,
+                          data,
+                          start,
+                          i,
+                          skip ? NULL : folded,
+                          foldedLen,
+                          line) != 0) {
+                setReadFailure(&result->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+                return;
+            }
+        }
+
+        if (byte == '\n' && i < size) {
+            line++;
+            newlines++;
+        }
+        i += width - 1;
+    }
+
+    result->size = size;
+    result->newlines = newlines;
+}
+
+static void spellEntry(size_t index, void *arg) {
+    struct SpellJob *job = arg;
+    const struct FileEntry *entry = &job->entries->entries[index];
+    struct SpellResult *result = &job->results[index];
+    if (entry->type != FILE_TYPE_REGULAR) {
+        return;
+    }
+
+    size_t size = 0;
+    unsigned char *data = readWholeFile(
+        entry->path, entry->encoding, &size, NULL, &result->failure);
+    if (!data) {
+        return;
+    }
+    checkText(job, result, data, size);
+    free(data);
+}
+
+int spellCheckProject(const struct FileList *entries,
+                      const char *rootDir,
+                      const char *systemDictionary,
+                      unsigned int jobs,
+                      FILE *out) {
+    if (!entries) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_SPELL, rootDir, PROC_ERR_INVALID_STATE);
+        return -1;
+    }
+
+    struct SpellDictionary dictionary;
+    if (loadDictionary(rootDir, systemDictionary, &dictionary) != 0) {
+        unmapDictionary(&dictionary);
+        return -1;
+    }
+
+    struct SpellJob job = {.entries = entries, .dafsa = &dictionary.dafsa};
+    job.results = calloc(entries->count ? entries->count : 1,
+                         sizeof(struct SpellResult));
+    if (!job.results) {
+        unmapDictionary(&dictionary);
+        reportProcessError(
+            PROCESS_OP_HANDLE_SPELL, rootDir, PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+    for (size_t i = 0; i < entries->count; i++) {
+        arenaInit(&job.results[i].arena, 4096);
+    }
+
+    runParallel(entries->count, jobs, spellEntry, &job);
+
+    // draft positions as in searchProjectFiles()
+    int status = 0;
+    uint64_t draftOffset = 0;
+    uint64_t draftLine = 1;
+    for (size_t i = 0; i < entries->count; i++) {
+        struct SpellResult *result = &job.results[i];
+        const char *path = entries->entries[i].path;
+        if (reportReadFailure(
+                &result->failure, PROCESS_OP_HANDLE_SPELL, path)) {
+            status = -1;
+        }
+
+        for (size_t m = 0; m < result->count; m++) {
+            const struct Misspelling *misspelling = &result->misspellings[m];
+            fprintf(out,
+                    "%s:%zu:%llu:%llu:%s\n",
+                    relativePath(path, rootDir),
+                    misspelling->line,
+                    (unsigned long long)(draftLine + misspelling->line - 1),
+                    (unsigned long long)(draftOffset + misspelling->offset),
+                    misspelling->word);
+        }
+
+        if (entries->entries[i].type == FILE_TYPE_REGULAR) {
+            draftOffset += result->size + 1;
+            draftLine += result->newlines + 1;
+        }
+        free(result->misspellings);
+        freeArena(&result->arena);
+    }
+    free(job.results);
+    unmapDictionary(&dictionary);
+
+    errno = 0;
+    if (fflush(out) != 0 || ferror(out)) {
+        reportFileError(FILE_OP_WRITE, "spelling report");
+        status = -1;
+    }
+
+    return status;
+}
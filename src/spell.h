@@ -0,0 +1,44 @@
+#ifndef SPELL_H
+#define SPELL_H
+
+#include "filelist.h"
+#include <stdio.h>
+
+/* *
+ * Checks every word of a resolved project against the system word list and
+ * the project's own COLETTE_PROJECT_DICTIONARY_NAME, one word per line.
+ * Words are runs of letters with inner apostrophes, folded to lower case;
+ * words containing digits are skipped and a possessive "'s" is accepted
+ * wherever the word without it is.
+ *
+ * The two lists are compiled into a DAFSA cached as COLETTE_SPELL_CACHE_NAME
+ * in the project root. The cache records the size, modification time and
+ * inode of both lists and is mapped as is while they are unchanged, so only
+ * the first run after a list changes pays for building it. Files are then
+ * read and checked in parallel, and every unknown word is written to out in
+ * draft order as
+ *
+ *     path:line:draft-line:draft-offset:word
+ *
+ * with the same positions as `colette grep`.
+ *
+ * @param   entries           Resolved entries in traversal order
+ * @param   rootDir           Project root, holds the project dictionary and
+ *                            the cache
+ * @param   systemDictionary  System word list, or NULL for
+ *                            COLETTE_SYSTEM_DICTIONARY, which may be missing
+ * @param   jobs              Maximum number of worker threads
+ * @param   out               Stream the unknown words are written to
+ *
+ * @return  int
+ *          0                 if every file was checked, misspelled or not
+ *         -1                 if a word list or file could not be read, or
+ *                            output failed
+ * */
+int spellCheckProject(const struct FileList *entries,
+                      const char *rootDir,
+                      const char *systemDictionary,
+                      unsigned int jobs,
+                      FILE *out);
+
+#endif
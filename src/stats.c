@@ -0,0 +1,160 @@
+#include "constants.h"
+#include "filelist.h"
+#include "files.h"
+#include "reporting.h"
+#include "stats.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static bool isSpaceByte(unsigned char byte) {
+    return byte == ' ' || (byte >= '\t' && byte <= '\r');
+}
+
+void statsCounterReset(struct StatsCounter *counter) {
+    counter->inWord = false;
+}
+
+void statsUpdate(struct StatsCounter *counter,
+                 struct TextStats *stats,
+                 const void *data,
+                 size_t len) {
+    const unsigned char *bytes = data;
+    uint64_t words = 0;
+    uint64_t chars = 0;
+    uint64_t lines = 0;
+    bool inWord = counter->inWord;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    /* *
+     * Classify 16 bytes at a time into bitmasks. A word starts at every
+     * non-space byte whose predecessor is a space, so shifting the space mask
+     * left by one (carrying in the previous block's last byte) lines each byte
+     * up with its predecessor. Continuation bytes 0x80..0xBF are the signed
+     * bytes below -64 and are the only ones that don't start a code point.
+     * */
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i belowTab = _mm_set1_epi8('\t' - 1);
+    const __m128i aboveCR = _mm_set1_epi8('\r' + 1);
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i continuation = _mm_set1_epi8(-64);
+
+    while (len - i >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+        __m128i controlSpace = _mm_and_si128(_mm_cmpgt_epi8(chunk, belowTab),
+                                             _mm_cmplt_epi8(chunk, aboveCR));
+        __m128i isSpace =
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space), controlSpace);
+
+        unsigned int spaceMask = (unsigned int)_mm_movemask_epi8(isSpace);
+        unsigned int wordMask = ~spaceMask & 0xFFFFu;
+        unsigned int afterSpace = ((spaceMask << 1) | (inWord ? 0u : 1u)) & 0xFFFFu;
+        unsigned int contMask = (unsigned int)_mm_movemask_epi8(
+            _mm_cmplt_epi8(chunk, continuation));
+        unsigned int lineMask =
+            (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+
+        words += (uint64_t)__builtin_popcount(wordMask & afterSpace);
+        chars += 16 - (uint64_t)__builtin_popcount(contMask);
+        lines += (uint64_t)__builtin_popcount(lineMask);
+        inWord = (wordMask >> 15) != 0;
+        i += 16;
+    }
+#endif
+
+    for (; i < len; i++) {
+        unsigned char byte = bytes[i];
+        if (isSpaceByte(byte)) {
+            inWord = false;
+            if (byte == '\n') {
+                lines++;
+            }
+        } else if (!inWord) {
+            inWord = true;
+            words++;
+        }
+        if ((byte & 0xC0) != 0x80) {
+            chars++;
+        }
+    }
+
+    counter->inWord = inWord;
+    stats->words += words;
+    stats->chars += chars;
+    stats->lines += lines;
+}
+
+void rollUpStats(struct FileList *entries) {
+    // index of the open directory at each depth on the way down
+    size_t ancestors[COLETTE_PROJECT_DEPTH + 2];
+
+    for (size_t i = 0; i < entries->count; i++) {
+        struct FileEntry *entry = &entries->entries[i];
+        if (entry->depth >= sizeof(ancestors) / sizeof(ancestors[0])) {
+            continue;
+        }
+
+        if (entry->type == FILE_TYPE_DIRECTORY) {
+            ancestors[entry->depth] = i;
+            memset(&entry->stats, 0, sizeof(entry->stats));
+            continue;
+        }
+
+        for (size_t depth = 0; depth < entry->depth; depth++) {
+            struct TextStats *total = &entries->entries[ancestors[depth]].stats;
+            total->words += entry->stats.words;
+            total->chars += entry->stats.chars;
+            total->lines += entry->stats.lines;
+        }
+    }
+}
+
+int writeStatsReport(const struct FileList *entries,
+                     const char *outPath,
+                     const char *rootDir) {
+    bool toStdout = strcmp(outPath, "-") == 0;
+
+    errno = 0;
+    FILE *out = toStdout ? stdout : fopen(outPath, "w");
+    if (!out) {
+        reportFileError(FILE_OP_OPEN, outPath);
+        return -1;
+    }
+
+    fputs("type\tpath\twords\tchars\tlines\n", out);
+
+    for (size_t i = 0; i < entries->count; i++) {
+        const struct FileEntry *entry = &entries->entries[i];
+        const char *path =
+            entry->depth == 0 ? "." : relativePath(entry->path, rootDir);
+
+        fprintf(out,
+                "%s\t%s\t%llu\t%llu\t%llu\n",
+                entry->type == FILE_TYPE_DIRECTORY ? "dir" : "file",
+                path,
+                (unsigned long long)entry->stats.words,
+                (unsigned long long)entry->stats.chars,
+                (unsigned long long)entry->stats.lines);
+    }
+
+    int status = 0;
+    errno = 0;
+    if (ferror(out)) {
+        status = -1;
+    }
+    if (toStdout) {
+        fflush(out);
+    } else if (fclose(out) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        reportFileError(FILE_OP_WRITE, outPath);
+    }
+
+    return status;
+}
@@ -0,0 +1,72 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct FileList;
+
+/* *
+ * Word, character and line counts for a file or, once rolled up, everything
+ * below a directory. Words are runs of non-whitespace, characters are UTF-8
+ * code points and lines are LF characters, the same as `wc -wml`.
+ * */
+struct TextStats {
+    uint64_t words;
+    uint64_t chars;
+    uint64_t lines;
+};
+
+/* *
+ * State carried between chunks of one file, so a word split across two reads
+ * is only counted once.
+ * */
+struct StatsCounter {
+    bool inWord;
+};
+
+/* *
+ * @param  counter  Counter to reset before the first chunk of a file
+ * */
+void statsCounterReset(struct StatsCounter *counter);
+
+/* *
+ * Adds the counts for the next chunk of a file.
+ *
+ * @param  counter  Per-file counter state
+ * @param  stats    Totals to add to
+ * @param  data     Next bytes of the file
+ * @param  len      Number of bytes in data
+ * */
+void statsUpdate(struct StatsCounter *counter,
+                 struct TextStats *stats,
+                 const void *data,
+                 size_t len);
+
+/* *
+ * Sets every directory entry's stats to the sum of the files below it.
+ * Entries must be in traversal order with the root first, as getNextFile()
+ * produces them.
+ *
+ * @param  entries  Entries whose file stats are already filled in
+ * */
+void rollUpStats(struct FileList *entries);
+
+/* *
+ * Writes per-file and per-directory counts as tab separated values in draft
+ * order. The root directory row (".") holds the project totals.
+ *
+ * @param   entries  Entries with rolled up stats
+ * @param   outPath  File to write, or "-" for stdout
+ * @param   rootDir  Project root, stripped from paths
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if the report could not be written
+ * */
+int writeStatsReport(const struct FileList *entries,
+                     const char *outPath,
+                     const char *rootDir);
+
+#endif
@@ -0,0 +1,250 @@
+#include "template.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char SCENE_BREAK[] = "* * *";
+
+struct TemplateVariable {
+    const char *name;
+    enum TemplateField field;
+};
+
+static const struct TemplateVariable VARIABLES[] = {
+    {"name", TEMPLATE_NAME},
+    {"stem", TEMPLATE_STEM},
+    {"dir", TEMPLATE_DIR},
+    {"path", TEMPLATE_PATH},
+    {"depth", TEMPLATE_DEPTH},
+    {"chapter", TEMPLATE_CHAPTER},
+    {"scene", TEMPLATE_SCENE},
+};
+
+/* *
+ * Appends literal bytes to the template, extending the previous op when it is
+ * a literal too so each run of text is copied with one memcpy.
+ * */
+static void addLiteral(struct Template *tmpl,
+                       size_t *textLen,
+                       const char *bytes,
+                       size_t len) {
+    if (len == 0) {
+        return;
+    }
+    memcpy(tmpl->text + *textLen, bytes, len);
+
+    struct TemplateOp *last =
+        tmpl->opCount ? &tmpl->ops[tmpl->opCount - 1] : NULL;
+    if (last && last->field == TEMPLATE_LITERAL &&
+        last->offset + last->length == *textLen) {
+        last->length += len;
+    } else {
+        struct TemplateOp op = {
+            .field = TEMPLATE_LITERAL, .offset = *textLen, .length = len};
+        tmpl->ops[tmpl->opCount++] = op;
+    }
+    *textLen += len;
+}
+
+static int addVariable(struct Template *tmpl,
+                       size_t *textLen,
+                       const char *name,
+                       size_t nameLen) {
+    if (nameLen == 4 && strncmp(name, "rule", 4) == 0) {
+        addLiteral(tmpl, textLen, SCENE_BREAK, sizeof(SCENE_BREAK) - 1);
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(VARIABLES) / sizeof(VARIABLES[0]); i++) {
+        if (strlen(VARIABLES[i].name) == nameLen &&
+            strncmp(VARIABLES[i].name, name, nameLen) == 0) {
+            struct TemplateOp op = {
+                .field = VARIABLES[i].field, .offset = 0, .length = 0};
+            tmpl->ops[tmpl->opCount++] = op;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+int compileTemplate(const char *source, struct Template *tmpl) {
+    if (!source || !tmpl) {
+        return -1;
+    }
+
+    // every op and every literal byte comes from at least one source byte,
+    // and {rule} is longer than the break it stands for
+    size_t sourceLen = strlen(source);
+    tmpl->opCount = 0;
+    tmpl->ops = malloc((sourceLen + 1) * sizeof(struct TemplateOp));
+    tmpl->text = malloc(sourceLen + 1);
+    if (!tmpl->ops || !tmpl->text) {
+        freeTemplate(tmpl);
+        return -1;
+    }
+
+    size_t textLen = 0;
+    size_t i = 0;
+    while (i < sourceLen) {
+        size_t run = strcspn(source + i, "{}\\");
+        addLiteral(tmpl, &textLen, source + i, run);
+        i += run;
+        if (i >= sourceLen) {
+            break;
+        }
+
+        char c = source[i];
+        char next = source[i + 1];
+        if (c == '\\' && (next == 'n' || next == 't' || next == '\\')) {
+            char escaped = next == 'n' ? '\n' : next == 't' ? '\t' : '\\';
+            addLiteral(tmpl, &textLen, &escaped, 1);
+            i += 2;
+        } else if (c == '\\') {
+            addLiteral(tmpl, &textLen, &c, 1); // not an escape
+            i++;
+        } else if (c == next) {
+            addLiteral(tmpl, &textLen, &c, 1); // {{ or }}
+            i += 2;
+        } else if (c == '{') {
+            const char *close = strchr(source + i + 1, '}');
+            if (!close ||
+                addVariable(tmpl,
+                            &textLen,
+                            source + i + 1,
+                            (size_t)(close - source - i - 1)) != 0) {
+                freeTemplate(tmpl);
+                return -1;
+            }
+            i = (size_t)(close - source) + 1;
+        } else {
+            freeTemplate(tmpl); // a lone }
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+bool templateIsEmpty(const struct Template *tmpl) {
+    return tmpl->opCount == 0;
+}
+
+static int reserve(struct TemplateBuffer *out, size_t extra) {
+    if (extra > SIZE_MAX - out->len) {
+        return -1;
+    }
+    size_t needed = out->len + extra;
+    if (needed <= out->capacity) {
+        return 0;
+    }
+
+    size_t capacity = out->capacity ? out->capacity : 128;
+    while (capacity < needed) {
+        capacity = capacity > SIZE_MAX / 2 ? needed : capacity * 2;
+    }
+    char *grown = realloc(out->data, capacity);
+    if (!grown) {
+        return -1;
+    }
+    out->data = grown;
+    out->capacity = capacity;
+    return 0;
+}
+
+static int appendBytes(struct TemplateBuffer *out,
+                       const char *bytes,
+                       size_t len) {
+    if (reserve(out, len) != 0) {
+        return -1;
+    }
+    memcpy(out->data + out->len, bytes, len);
+    out->len += len;
+    return 0;
+}
+
+static int appendNumber(struct TemplateBuffer *out,
+                        size_t value,
+                        unsigned int padding) {
+    char digits[24];
+    size_t count = 0;
+    do {
+        digits[sizeof(digits) - 1 - count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (count < padding && count < sizeof(digits)) {
+        digits[sizeof(digits) - 1 - count++] = '0';
+    }
+
+    return appendBytes(out, digits + sizeof(digits) - count, count);
+}
+
+int renderTemplate(const struct Template *tmpl,
+                   const struct TemplateVars *vars,
+                   struct TemplateBuffer *out) {
+    out->len = 0;
+
+    // file and directory names are cut from the path once, not per op
+    const char *name = strrchr(vars->path, '/');
+    name = name ? name + 1 : vars->path;
+    const char *dot = strrchr(name, '.');
+    size_t stemLen = dot && dot != name ? (size_t)(dot - name) : strlen(name);
+    const char *dir = vars->rootName;
+    size_t dirLen = strlen(vars->rootName);
+    if (name != vars->path) {
+        const char *dirEnd = name - 1;
+        dir = dirEnd;
+        while (dir > vars->path && dir[-1] != '/') {
+            dir--;
+        }
+        dirLen = (size_t)(dirEnd - dir);
+    }
+
+    int status = 0;
+    for (size_t i = 0; status == 0 && i < tmpl->opCount; i++) {
+        const struct TemplateOp *op = &tmpl->ops[i];
+        switch (op->field) {
+        case TEMPLATE_LITERAL:
+            status = appendBytes(out, tmpl->text + op->offset, op->length);
+            break;
+        case TEMPLATE_NAME:
+            status = appendBytes(out, name, strlen(name));
+            break;
+        case TEMPLATE_STEM:
+            status = appendBytes(out, name, stemLen);
+            break;
+        case TEMPLATE_DIR:
+            status = appendBytes(out, dir, dirLen);
+            break;
+        case TEMPLATE_PATH:
+            status = appendBytes(out, vars->path, strlen(vars->path));
+            break;
+        case TEMPLATE_DEPTH:
+            status = appendNumber(out, vars->depth, 0);
+            break;
+        case TEMPLATE_CHAPTER:
+            status = appendNumber(out, vars->chapter, vars->padding);
+            break;
+        case TEMPLATE_SCENE:
+            status = appendNumber(out, vars->scene, vars->padding);
+            break;
+        }
+    }
+
+    return status;
+}
+
+void freeTemplate(struct Template *tmpl) {
+    free(tmpl->ops);
+    free(tmpl->text);
+    tmpl->ops = NULL;
+    tmpl->text = NULL;
+    tmpl->opCount = 0;
+}
+
+void freeTemplateBuffer(struct TemplateBuffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->len = 0;
+    buffer->capacity = 0;
+}
@@ -0,0 +1,110 @@
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *
+ * What a compiled template op produces. TEMPLATE_LITERAL copies text stored
+ * in the template; the rest are filled in for each file.
+ * */
+enum TemplateField {
+    TEMPLATE_LITERAL,
+    TEMPLATE_NAME,    // {name}: file name
+    TEMPLATE_STEM,    // {stem}: file name without its extension
+    TEMPLATE_DIR,     // {dir}: name of the directory holding the file
+    TEMPLATE_PATH,    // {path}: path from the project root
+    TEMPLATE_DEPTH,   // {depth}: 1 for files listed in the root .index
+    TEMPLATE_CHAPTER, // {chapter}: running number of the top-level entry
+    TEMPLATE_SCENE,   // {scene}: running number of the file in its chapter
+};
+
+struct TemplateOp {
+    enum TemplateField field;
+    size_t offset; // literal: start in the template's text
+    size_t length; // literal: number of bytes
+};
+
+/* *
+ * A separator or header template compiled into a list of ops, so nothing is
+ * parsed while collating. Literal text, with escapes already resolved, is
+ * stored back to back in text.
+ * */
+struct Template {
+    struct TemplateOp *ops;
+    size_t opCount;
+    char *text;
+};
+
+/* *
+ * Values for one file. path is relative to the project root; rootName names
+ * the root for files listed directly in its .index. Numbers are zero padded
+ * to padding digits.
+ * */
+struct TemplateVars {
+    const char *path;
+    const char *rootName;
+    size_t depth;
+    unsigned int chapter;
+    unsigned int scene;
+    unsigned int padding;
+};
+
+/* *
+ * Reusable output buffer for rendered templates.
+ * */
+struct TemplateBuffer {
+    char *data;
+    size_t len;
+    size_t capacity;
+};
+
+/* *
+ * Compiles a template. Variables are written in braces ({stem}, {dir},
+ * {chapter}, ...) and {rule} is a scene break, "* * *". "{{" and "}}" are
+ * literal braces and \n, \t and \\ the usual escapes; any other text is
+ * copied as it is.
+ *
+ * @param   source  Template as given on the command line
+ * @param   tmpl    Receives the compiled template
+ *
+ * @return  int
+ *          0       on success
+ *         -1       if a brace is unmatched or names no known variable, or
+ *                  memory could not be allocated
+ * */
+int compileTemplate(const char *source, struct Template *tmpl);
+
+/* *
+ * @param   tmpl  Compiled template
+ *
+ * @return  bool  true if the template renders nothing for every file
+ * */
+bool templateIsEmpty(const struct Template *tmpl);
+
+/* *
+ * Renders a template for one file, replacing the buffer's contents.
+ *
+ * @param   tmpl  Compiled template
+ * @param   vars  Values for the current file
+ * @param   out   Buffer to render into, grown as needed
+ *
+ * @return  int
+ *          0     on success
+ *         -1     if the buffer could not be grown
+ * */
+int renderTemplate(const struct Template *tmpl,
+                   const struct TemplateVars *vars,
+                   struct TemplateBuffer *out);
+
+/* *
+ * @param  tmpl  Template to free
+ * */
+void freeTemplate(struct Template *tmpl);
+
+/* *
+ * @param  buffer  Buffer to free
+ * */
+void freeTemplateBuffer(struct TemplateBuffer *buffer);
+
+#endif
@@ -0,0 +1,460 @@
+#include "toc.h"
+#include "constants.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void tocInit(struct TocScanner *toc) {
+    memset(toc, 0, sizeof(*toc));
+    toc->depth = 1;
+    toc->inHead = true;
+    toc->kind = TOC_LINE_BLANK;
+    toc->prevKind = TOC_LINE_BLANK;
+}
+
+static int addEntry(struct TocScanner *toc, struct TocEntry entry) {
+    if (toc->count == toc->capacity) {
+        size_t capacity = toc->capacity ? toc->capacity * 2 : 64;
+        if (capacity > SIZE_MAX / sizeof(struct TocEntry)) {
+            return -1;
+        }
+        struct TocEntry *grown =
+            realloc(toc->entries, capacity * sizeof(struct TocEntry));
+        if (!grown) {
+            return -1;
+        }
+        toc->entries = grown;
+        toc->capacity = capacity;
+    }
+
+    toc->entries[toc->count++] = entry;
+    return 0;
+}
+
+static int addHeading(struct TocScanner *toc,
+                      unsigned int level,
+                      size_t offset,
+                      size_t length,
+                      bool atx) {
+    struct TocEntry entry = {.name = NULL,
+                             .offset = offset,
+                             .length = length,
+                             .depth = toc->depth,
+                             .level = level,
+                             .atx = atx};
+    return addEntry(toc, entry);
+}
+
+static void startLine(struct TocScanner *toc, size_t offset) {
+    toc->lineStart = offset;
+    toc->inHead = true;
+    toc->kind = TOC_LINE_BLANK;
+    toc->marker = 0;
+    toc->run = 0;
+    toc->indent = 0;
+    toc->afterRun = false;
+    toc->spaceAfterRun = false;
+}
+
+/* *
+ * Settles the kind of a line that ended while its start was still being
+ * classified, i.e. one made only of its marker run and spaces.
+ * */
+static enum TocLineKind headKind(const struct TocScanner *toc) {
+    switch (toc->marker) {
+    case 0:
+        return TOC_LINE_BLANK;
+    case '#':
+        return toc->run <= 6 ? TOC_LINE_ATX : TOC_LINE_TEXT;
+    case '=':
+        return TOC_LINE_SETEXT_EQ;
+    case '-':
+        return TOC_LINE_SETEXT_DASH;
+    case '`':
+    case '~':
+        return toc->run >= 3 ? TOC_LINE_FENCE : TOC_LINE_TEXT;
+    default:
+        return TOC_LINE_OTHER; // *** and a lone + or *
+    }
+}
+
+static int endLine(struct TocScanner *toc, size_t end) {
+    enum TocLineKind kind = toc->inHead ? headKind(toc) : toc->kind;
+    size_t length = end - toc->lineStart;
+
+    if (toc->inFence) {
+        if (kind == TOC_LINE_FENCE && toc->marker == toc->fenceMarker &&
+            toc->run >= toc->fenceRun && !toc->afterRun) {
+            toc->inFence = false;
+        }
+        toc->prevKind = TOC_LINE_OTHER;
+        return 0;
+    }
+
+    int status = 0;
+    switch (kind) {
+    case TOC_LINE_FENCE:
+        toc->inFence = true;
+        toc->fenceMarker = toc->marker;
+        toc->fenceRun = toc->run;
+        kind = TOC_LINE_OTHER;
+        break;
+    case TOC_LINE_ATX:
+        status = addHeading(toc, toc->run, toc->lineStart, length, true);
+        kind = TOC_LINE_OTHER;
+        break;
+    case TOC_LINE_SETEXT_EQ:
+    case TOC_LINE_SETEXT_DASH:
+        if (toc->prevKind == TOC_LINE_TEXT) {
+            status = addHeading(toc,
+                                kind == TOC_LINE_SETEXT_EQ ? 1 : 2,
+                                toc->prevStart,
+                                toc->prevLength,
+                                false);
+            kind = TOC_LINE_OTHER;
+        } else {
+            // === on its own is text, --- a thematic break
+            kind = kind == TOC_LINE_SETEXT_EQ ? TOC_LINE_TEXT : TOC_LINE_OTHER;
+        }
+        break;
+    default:
+        break;
+    }
+
+    toc->prevKind = kind;
+    toc->prevStart = toc->lineStart;
+    toc->prevLength = length;
+    return status;
+}
+
+/* *
+ * Classifies the current line from its next leading byte. Returns with
+ * inHead cleared once the rest of the line can't change its kind.
+ * */
+static void headByte(struct TocScanner *toc, unsigned char c) {
+    if (c == '\r') {
+        return; // only ever seen before the line feed
+    }
+
+    if (toc->marker == 0) {
+        if (c == ' ' || c == '\t') {
+            toc->indent += c == '\t' ? 4 : 1;
+            if (toc->indent >= 4) {
+                // indented code, or a paragraph running on
+                toc->kind = toc->prevKind == TOC_LINE_TEXT && !toc->inFence
+                                ? TOC_LINE_TEXT
+                                : TOC_LINE_OTHER;
+                toc->inHead = false;
+            }
+            return;
+        }
+        toc->marker = c;
+        toc->run = 1;
+        if (!strchr("#=-`~*+", c)) {
+            toc->kind = c == '>' ? TOC_LINE_OTHER : TOC_LINE_TEXT;
+            toc->inHead = false;
+        }
+        return;
+    }
+
+    if (!toc->afterRun && c == toc->marker) {
+        toc->run++;
+        return;
+    }
+    bool space = c == ' ' || c == '\t';
+    toc->afterRun = true;
+
+    switch (toc->marker) {
+    case '#':
+        toc->kind = toc->run <= 6 && space ? TOC_LINE_ATX : TOC_LINE_TEXT;
+        toc->inHead = false;
+        break;
+    case '=':
+        if (!space) {
+            toc->kind = TOC_LINE_TEXT;
+            toc->inHead = false;
+        }
+        break;
+    case '-':
+        if (space) {
+            toc->spaceAfterRun = true;
+        } else {
+            // "- item" is a list, "-- and then" is prose
+            toc->kind = toc->run == 1 && toc->spaceAfterRun ? TOC_LINE_OTHER
+                                                            : TOC_LINE_TEXT;
+            toc->inHead = false;
+        }
+        break;
+    case '`':
+    case '~':
+        toc->kind = toc->run >= 3 ? TOC_LINE_FENCE : TOC_LINE_TEXT;
+        toc->inHead = false;
+        break;
+    default: // * and +
+        toc->kind = space ? TOC_LINE_OTHER : TOC_LINE_TEXT;
+        toc->inHead = false;
+        break;
+    }
+}
+
+int tocUpdate(struct TocScanner *toc, const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    size_t i = 0;
+
+    while (i < len) {
+        if (!toc->inHead) {
+            // the rest of the line can't matter, skip to its end
+            const unsigned char *lineEnd = memchr(bytes + i, '\n', len - i);
+            if (!lineEnd) {
+                break;
+            }
+            i = (size_t)(lineEnd - bytes);
+        }
+
+        if (bytes[i] == '\n') {
+            if (endLine(toc, toc->offset + i) != 0) {
+                return -1;
+            }
+            i++;
+            startLine(toc, toc->offset + i);
+            continue;
+        }
+        headByte(toc, bytes[i]);
+        i++;
+    }
+
+    toc->offset += len;
+    return 0;
+}
+
+int tocAddDirectory(struct TocScanner *toc, const char *name, size_t depth) {
+    size_t nameLen = strlen(name) + 1;
+    char *nameCopy = malloc(nameLen);
+    if (!nameCopy) {
+        return -1;
+    }
+    memcpy(nameCopy, name, nameLen);
+
+    struct TocEntry entry = {.name = nameCopy,
+                             .offset = toc->offset,
+                             .length = 0,
+                             .depth = depth,
+                             .level = 0,
+                             .atx = false};
+    if (addEntry(toc, entry) != 0) {
+        free(nameCopy);
+        return -1;
+    }
+
+    toc->prevKind = TOC_LINE_BLANK;
+    return 0;
+}
+
+int tocFinish(struct TocScanner *toc) {
+    if (toc->lineStart == toc->offset) {
+        return 0; // the draft ended with a line feed
+    }
+    int status = endLine(toc, toc->offset);
+    startLine(toc, toc->offset);
+    return status;
+}
+
+/* *
+ * Cuts the title out of a heading line: the #s and an optional closing run
+ * of them for ATX headings, surrounding whitespace for both kinds.
+ * */
+static void headingTitle(char *line,
+                         size_t *len,
+                         const struct TocEntry *entry,
+                         char **title) {
+    char *start = line;
+    char *end = line + *len;
+    while (start < end && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    if (entry->atx) {
+        while (start < end && *start == '#') {
+            start++;
+        }
+    }
+    while (start < end && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    while (end > start && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    if (entry->atx) {
+        char *closing = end;
+        while (closing > start && closing[-1] == '#') {
+            closing--;
+        }
+        if (closing == start ||
+            closing[-1] == ' ' || closing[-1] == '\t') {
+            end = closing;
+            while (end > start && isspace((unsigned char)end[-1])) {
+                end--;
+            }
+        }
+    }
+
+    *title = start;
+    *len = (size_t)(end - start);
+}
+
+/* *
+ * Anchor for a heading the way GitHub makes them: lower case, spaces to
+ * hyphens, punctuation dropped. Curly quotes, dashes and ellipses (U+2000 to
+ * U+206F) count as punctuation; other non-ASCII text is kept.
+ * */
+static size_t headingSlug(const char *title, size_t len, char *slug) {
+    const unsigned char *bytes = (const unsigned char *)title;
+    size_t o = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = bytes[i];
+        if (c == 0xE2 && i + 2 < len &&
+            (bytes[i + 1] == 0x80 || bytes[i + 1] == 0x81)) {
+            i += 2;
+        } else if (c >= 0x80 || isalnum(c) || c == '-' || c == '_') {
+            slug[o++] = (char)tolower(c);
+        } else if (c == ' ') {
+            slug[o++] = '-';
+        }
+    }
+    slug[o] = '\0';
+    return o;
+}
+
+struct SlugSet {
+    char **slots;
+    size_t capacity; // power of two
+};
+
+static uint64_t hashSlug(const char *slug) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *slug; slug++) {
+        hash = (hash ^ (unsigned char)*slug) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* *
+ * Adds slug to the set unless it is already there.
+ *
+ * @return  int  1 if added, 0 if already present, -1 on allocation failure
+ * */
+static int addSlug(struct SlugSet *set, const char *slug) {
+    size_t mask = set->capacity - 1;
+    size_t i = (size_t)hashSlug(slug) & mask;
+    while (set->slots[i]) {
+        if (strcmp(set->slots[i], slug) == 0) {
+            return 0;
+        }
+        i = (i + 1) & mask;
+    }
+
+    size_t slugLen = strlen(slug) + 1;
+    set->slots[i] = malloc(slugLen);
+    if (!set->slots[i]) {
+        return -1;
+    }
+    memcpy(set->slots[i], slug, slugLen);
+    return 1;
+}
+
+/* *
+ * Makes slug unique the way GitHub does, with -1, -2, ... on repeats.
+ * slug must have room for COLETTE_TOC_LINE_MAX + 24 bytes.
+ * */
+static int uniqueSlug(struct SlugSet *set, char *slug, size_t slugLen) {
+    int added = addSlug(set, slug);
+    for (unsigned long n = 1; added == 0; n++) {
+        snprintf(slug + slugLen, 24, "-%lu", n);
+        added = addSlug(set, slug);
+    }
+    return added < 0 ? -1 : 0;
+}
+
+static void writeIndent(FILE *out, size_t levels) {
+    for (size_t i = 0; i < levels; i++) {
+        fputs("  ", out);
+    }
+}
+
+static void writeLinkText(FILE *out, const char *title, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (title[i] == '[' || title[i] == ']' || title[i] == '\\') {
+            fputc('\\', out);
+        }
+        fputc(title[i], out);
+    }
+}
+
+int writeTableOfContents(const struct TocScanner *toc, int bodyFd, FILE *out) {
+    // every heading adds at most one slug, and the table's own heading one
+    struct SlugSet set = {.slots = NULL, .capacity = 16};
+    while (set.capacity < (toc->count + 1) * 2) {
+        set.capacity *= 2;
+    }
+    set.slots = calloc(set.capacity, sizeof(char *));
+    if (!set.slots) {
+        return -1;
+    }
+
+    char line[COLETTE_TOC_LINE_MAX];
+    char slug[COLETTE_TOC_LINE_MAX + 24];
+    size_t titleSlugLen = headingSlug(
+        COLETTE_TOC_TITLE, strlen(COLETTE_TOC_TITLE), slug);
+    int status = uniqueSlug(&set, slug, titleSlugLen);
+
+    fprintf(out, "# %s\n\n", COLETTE_TOC_TITLE);
+    for (size_t i = 0; status == 0 && i < toc->count; i++) {
+        const struct TocEntry *entry = &toc->entries[i];
+        if (entry->name) {
+            writeIndent(out, entry->depth - 1);
+            fprintf(out, "- %s\n", entry->name);
+            continue;
+        }
+
+        size_t len = entry->length < sizeof(line) ? entry->length
+                                                  : sizeof(line);
+        ssize_t bytesRead = pread(bodyFd, line, len, (off_t)entry->offset);
+        if (bytesRead < 0 || (size_t)bytesRead != len) {
+            status = -1;
+            break;
+        }
+        char *title;
+        headingTitle(line, &len, entry, &title);
+        if (len == 0) {
+            continue; // an empty heading has nothing to link to
+        }
+
+        size_t slugLen = headingSlug(title, len, slug);
+        if (uniqueSlug(&set, slug, slugLen) != 0) {
+            status = -1;
+            break;
+        }
+        writeIndent(out, entry->depth - 1 + entry->level - 1);
+        fputs("- [", out);
+        writeLinkText(out, title, len);
+        fprintf(out, "](#%s)\n", slug);
+    }
+    fputc('\n', out);
+
+    for (size_t i = 0; i < set.capacity; i++) {
+        free(set.slots[i]);
+    }
+    free(set.slots);
+    return status;
+}
+
+void freeToc(struct TocScanner *toc) {
+    for (size_t i = 0; i < toc->count; i++) {
+        free(toc->entries[i].name);
+    }
+    free(toc->entries);
+    toc->entries = NULL;
+    toc->count = 0;
+    toc->capacity = 0;
+}
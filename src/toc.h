@@ -0,0 +1,123 @@
+#ifndef TOC_H
+#define TOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* *
+ * A table of contents entry: a directory, or a heading found in the draft.
+ * Headings only record where their title line is; the text is read back from
+ * the draft when the table is written, so scanning copies nothing.
+ * */
+struct TocEntry {
+    char *name;       // directory name, NULL for headings
+    size_t offset;    // heading: draft offset of the title line
+    size_t length;    // heading: length of the title line
+    size_t depth;     // 1 for entries listed in the root .index
+    unsigned int level; // heading level, 1-6; 0 for directories
+    bool atx;         // heading: # style rather than underlined
+};
+
+enum TocLineKind {
+    TOC_LINE_BLANK,
+    TOC_LINE_TEXT,  // paragraph text, may be underlined into a heading
+    TOC_LINE_OTHER, // lists, quotes, breaks and code
+    TOC_LINE_ATX,
+    TOC_LINE_SETEXT_EQ,   // ===
+    TOC_LINE_SETEXT_DASH, // ---
+    TOC_LINE_FENCE,       // ``` or ~~~
+};
+
+/* *
+ * Streaming Markdown heading scanner. It is fed every byte written to the
+ * draft, in chunks of any size. Only the start of each line is looked at; the
+ * rest is skipped with memchr. ATX (#) and setext (underlined) headings are
+ * recognised, and nothing inside fenced code blocks counts.
+ * */
+struct TocScanner {
+    size_t offset;      // draft offset of the next byte fed
+    size_t depth;       // depth of the file being fed
+    size_t lineStart;   // draft offset of the current line
+    bool inHead;        // still classifying the current line
+    enum TocLineKind kind;
+    unsigned char marker; // first non-space byte of the line, 0 if none yet
+    unsigned int run;     // how many times marker repeats at the start
+    unsigned int indent;
+    bool afterRun;        // a byte other than marker followed the run
+    bool spaceAfterRun;
+    enum TocLineKind prevKind;
+    size_t prevStart;
+    size_t prevLength;
+    bool inFence;
+    unsigned char fenceMarker;
+    unsigned int fenceRun;
+    struct TocEntry *entries;
+    size_t count;
+    size_t capacity;
+};
+
+/* *
+ * @param  toc  Scanner to initialize at the start of the draft
+ * */
+void tocInit(struct TocScanner *toc);
+
+/* *
+ * Scans the next bytes written to the draft.
+ *
+ * @param   toc   Scanner state
+ * @param   data  Bytes as written to the draft
+ * @param   len   Number of bytes in data
+ *
+ * @return  int
+ *          0     on success
+ *         -1     if an entry could not be stored
+ * */
+int tocUpdate(struct TocScanner *toc, const void *data, size_t len);
+
+/* *
+ * Adds a directory entry at the current position. A heading is never
+ * underlined across a directory boundary.
+ *
+ * @param   toc    Scanner state
+ * @param   name   Directory name as listed in its parent's .index
+ * @param   depth  Nesting level of the directory
+ *
+ * @return  int
+ *          0      on success
+ *         -1      if memory could not be allocated
+ * */
+int tocAddDirectory(struct TocScanner *toc, const char *name, size_t depth);
+
+/* *
+ * Ends the last line of the draft, which may have no line feed.
+ *
+ * @param   toc  Scanner state
+ *
+ * @return  int
+ *          0    on success
+ *         -1    if an entry could not be stored
+ * */
+int tocFinish(struct TocScanner *toc);
+
+/* *
+ * Writes the table as a nested Markdown list, headings linked by the anchors
+ * GitHub-style renderers give them. Directories nest by depth and headings
+ * beneath them by level.
+ *
+ * @param   toc     Finished scanner
+ * @param   bodyFd  Draft body, read for heading titles
+ * @param   out     Stream the table is written to
+ *
+ * @return  int
+ *          0       on success
+ *         -1       if the body could not be read or memory allocated
+ * */
+int writeTableOfContents(const struct TocScanner *toc, int bodyFd, FILE *out);
+
+/* *
+ * @param  toc  Scanner to free
+ * */
+void freeToc(struct TocScanner *toc);
+
+#endif
@@ -0,0 +1,212 @@
+#include "constants.h"
+#include "json.h"
+#include "trace.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct TraceRecord {
+    uint64_t start;
+    uint64_t duration;
+    long long bytes;
+    enum TraceEvent event;
+    char path[COLETTE_TRACE_PATH_SIZE];
+};
+
+/* *
+ * Tracing is process-wide so resolveFile() and friends don't need a handle
+ * threaded through every call. The ring buffer is allocated once up front.
+ * */
+struct Tracer {
+    struct TraceRecord *events;
+    size_t head;      // next slot to write
+    size_t count;     // valid events in the ring
+    size_t dropped;   // events overwritten after the ring filled up
+    uint64_t origin;  // timestamp of traceOpen(), exported as ts 0
+    char *outPath;
+};
+
+static struct Tracer tracer = {0};
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static const char *traceEventName(enum TraceEvent event) {
+    switch (event) {
+    case TRACE_INDEX_OPEN:
+        return "openIndexFile";
+    case TRACE_INDEX_PARSE:
+        return "parseIndex";
+    case TRACE_RESOLVE:
+        return "resolveFile";
+    case TRACE_HANDLER:
+        return "handler";
+    default:
+        return "unknown";
+    }
+}
+
+static const char *traceEventCategory(enum TraceEvent event) {
+    switch (event) {
+    case TRACE_INDEX_OPEN:
+    case TRACE_INDEX_PARSE:
+        return "index";
+    case TRACE_RESOLVE:
+        return "resolve";
+    case TRACE_HANDLER:
+        return "handler";
+    default:
+        return "unknown";
+    }
+}
+
+bool traceEnabled(void) {
+    return tracer.events != NULL;
+}
+
+int traceOpen(const char *outPath) {
+    if (!outPath || outPath[0] == '\0' || tracer.events) {
+        return -1;
+    }
+
+    size_t pathLen = strlen(outPath) + 1;
+    tracer.outPath = malloc(pathLen);
+    tracer.events =
+        calloc(COLETTE_TRACE_BUF_EVENTS, sizeof(struct TraceRecord));
+    if (!tracer.outPath || !tracer.events) {
+        free(tracer.outPath);
+        free(tracer.events);
+        tracer.outPath = NULL;
+        tracer.events = NULL;
+        return -1;
+    }
+    memcpy(tracer.outPath, outPath, pathLen);
+
+    tracer.head = 0;
+    tracer.count = 0;
+    tracer.dropped = 0;
+    tracer.origin = nowNs();
+
+    return 0;
+}
+
+struct TraceSpan traceBegin(void) {
+    struct TraceSpan span = {0};
+    if (tracer.events) {
+        span.start = nowNs();
+    }
+    return span;
+}
+
+void traceEnd(struct TraceSpan span,
+              enum TraceEvent event,
+              const char *path,
+              long long bytes) {
+    traceEndAt(span, traceBegin(), event, path, bytes);
+}
+
+void traceEndAt(struct TraceSpan span,
+                struct TraceSpan end,
+                enum TraceEvent event,
+                const char *path,
+                long long bytes) {
+    if (!tracer.events || span.start == 0 || end.start < span.start) {
+        return;
+    }
+
+    struct TraceRecord *record = &tracer.events[tracer.head];
+    record->start = span.start;
+    record->duration = end.start - span.start;
+    record->bytes = bytes;
+    record->event = event;
+    record->path[0] = '\0';
+    if (path) {
+        size_t pathLen = strlen(path);
+        if (pathLen >= COLETTE_TRACE_PATH_SIZE) {
+            // keep the tail, it names the file
+            path += pathLen - (COLETTE_TRACE_PATH_SIZE - 1);
+            pathLen = COLETTE_TRACE_PATH_SIZE - 1;
+        }
+        memcpy(record->path, path, pathLen + 1);
+    }
+
+    tracer.head = (tracer.head + 1) % COLETTE_TRACE_BUF_EVENTS;
+    if (tracer.count < COLETTE_TRACE_BUF_EVENTS) {
+        tracer.count++;
+    } else {
+        tracer.dropped++;
+    }
+}
+
+int traceClose(void) {
+    if (!tracer.events) {
+        return 0;
+    }
+
+    int status = 0;
+    errno = 0;
+    FILE *out = fopen(tracer.outPath, "w");
+    if (!out) {
+        fprintf(stderr,
+                "Error opening trace file %s: %s\n",
+                tracer.outPath,
+                strerror(errno));
+        status = -1;
+    } else {
+        fprintf(out, "{\"traceEvents\":[\n");
+        fprintf(out,
+                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+                "\"args\":{\"name\":\"colette\"}}");
+
+        // oldest event sits at head once the ring has wrapped
+        size_t first = tracer.count < COLETTE_TRACE_BUF_EVENTS ? 0 : tracer.head;
+        for (size_t i = 0; i < tracer.count; i++) {
+            const struct TraceRecord *record =
+                &tracer.events[(first + i) % COLETTE_TRACE_BUF_EVENTS];
+            uint64_t ts = record->start - tracer.origin;
+
+            fprintf(out,
+                    ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                    "\"pid\":1,\"tid\":1,\"ts\":%llu.%03u,\"dur\":%llu.%03u,"
+                    "\"args\":{\"path\":",
+                    traceEventName(record->event),
+                    traceEventCategory(record->event),
+                    (unsigned long long)(ts / 1000),
+                    (unsigned int)(ts % 1000),
+                    (unsigned long long)(record->duration / 1000),
+                    (unsigned int)(record->duration % 1000));
+            writeJsonString(out, record->path);
+            if (record->bytes >= 0) {
+                fprintf(out, ",\"bytes\":%lld", record->bytes);
+            }
+            fprintf(out, "}}");
+        }
+
+        fprintf(out,
+                "\n],\"displayTimeUnit\":\"ms\","
+                "\"otherData\":{\"droppedEvents\":%zu}}\n",
+                tracer.dropped);
+
+        if (ferror(out)) {
+            status = -1;
+        }
+        if (fclose(out) != 0) {
+            status = -1;
+        }
+        if (status != 0) {
+            fprintf(stderr, "Error writing trace file %s\n", tracer.outPath);
+        }
+    }
+
+    free(tracer.events);
+    free(tracer.outPath);
+    tracer.events = NULL;
+    tracer.outPath = NULL;
+
+    return status;
+}
@@ -0,0 +1,92 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* *
+ * Kinds of spans recorded while tracing. Each maps to an event name in the
+ * exported trace.
+ * */
+enum TraceEvent {
+    TRACE_INDEX_OPEN,  // fopen() of a .index file
+    TRACE_INDEX_PARSE, // lifetime of an .index file on the iterator stack
+    TRACE_RESOLVE,     // resolveFile() for one index entry
+    TRACE_HANDLER,     // handler invocation or check for one project file
+};
+
+/* *
+ * Start timestamp of a span. Zero when tracing is disabled so callers can
+ * begin and end spans unconditionally.
+ * */
+struct TraceSpan {
+    uint64_t start;
+};
+
+/* *
+ * Enables tracing. Preallocates the in-memory ring buffer so recording an
+ * event never allocates or touches the filesystem. Events are written to
+ * outPath as Chrome trace-event JSON by traceClose().
+ *
+ * @param   outPath  Path of the trace file to write on close
+ *
+ * @return  int
+ *          0        on success
+ *         -1        if the ring buffer could not be allocated
+ * */
+int traceOpen(const char *outPath);
+
+/* *
+ * Writes all buffered events to the trace file and releases the ring buffer.
+ * Safe to call when tracing was never enabled.
+ *
+ * @return  int
+ *          0        on success or if tracing is disabled
+ *         -1        if the trace file could not be written
+ * */
+int traceClose(void);
+
+/* *
+ * @return  bool  true if traceOpen() succeeded and tracing is active
+ * */
+bool traceEnabled(void);
+
+/* *
+ * Marks the start of a span.
+ *
+ * @return  TraceSpan  timestamp to pass to traceEnd()
+ * */
+struct TraceSpan traceBegin(void);
+
+/* *
+ * Records a completed span in the ring buffer. When the buffer is full the
+ * oldest event is overwritten and counted as dropped.
+ *
+ * @param  span   Span returned by traceBegin()
+ * @param  event  Kind of span
+ * @param  path   File or directory the span applies to, may be NULL
+ * @param  bytes  Bytes processed during the span, or -1 if not applicable
+ * */
+void traceEnd(struct TraceSpan span,
+              enum TraceEvent event,
+              const char *path,
+              long long bytes);
+
+/* *
+ * Records a span that ended earlier. The ring buffer belongs to one thread,
+ * so worker threads time their spans with traceBegin() and the thread that
+ * collects their results records them.
+ *
+ * @param  span   Span returned by traceBegin() when it started
+ * @param  end    Span returned by traceBegin() when it finished
+ * @param  event  Kind of span
+ * @param  path   File or directory the span applies to, may be NULL
+ * @param  bytes  Bytes processed during the span, or -1 if not applicable
+ * */
+void traceEndAt(struct TraceSpan span,
+                struct TraceSpan end,
+                enum TraceEvent event,
+                const char *path,
+                long long bytes);
+
+#endif
@@ -0,0 +1,131 @@
+#include "utf8.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void utf8Init(struct Utf8Validator *validator) {
+    validator->offset = 0;
+    validator->line = 1;
+    validator->sequenceOffset = 0;
+    validator->remaining = 0;
+    validator->low = 0x80;
+    validator->high = 0xBF;
+    validator->valid = true;
+    validator->errorOffset = 0;
+    validator->errorLine = 0;
+}
+
+/* *
+ * Sets up the continuation byte count and the allowed range of the first
+ * continuation byte for a lead byte. The narrowed ranges after E0, ED, F0 and
+ * F4 are what rule out overlong forms, surrogates and values past U+10FFFF.
+ * */
+static bool startSequence(struct Utf8Validator *validator, unsigned char lead) {
+    validator->low = 0x80;
+    validator->high = 0xBF;
+
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        validator->remaining = 1;
+    } else if (lead == 0xE0) {
+        validator->remaining = 2;
+        validator->low = 0xA0;
+    } else if (lead == 0xED) {
+        validator->remaining = 2;
+        validator->high = 0x9F;
+    } else if (lead >= 0xE1 && lead <= 0xEF) {
+        validator->remaining = 2;
+    } else if (lead == 0xF0) {
+        validator->remaining = 3;
+        validator->low = 0x90;
+    } else if (lead >= 0xF1 && lead <= 0xF3) {
+        validator->remaining = 3;
+    } else if (lead == 0xF4) {
+        validator->remaining = 3;
+        validator->high = 0x8F;
+    } else {
+        return false; // stray continuation byte, C0/C1 or F5..FF
+    }
+
+    return true;
+}
+
+static void fail(struct Utf8Validator *validator, size_t offset, size_t line) {
+    validator->valid = false;
+    validator->errorOffset = offset;
+    validator->errorLine = line;
+}
+
+bool utf8Update(struct Utf8Validator *validator, const void *data, size_t len) {
+    if (!validator->valid) {
+        return false;
+    }
+
+    const unsigned char *bytes = data;
+    size_t line = validator->line;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+#endif
+
+    while (i < len) {
+        if (validator->remaining == 0) {
+#if defined(__SSE2__)
+            // prose is mostly ASCII: skip 16 bytes at a time while no byte has
+            // its high bit set, counting newlines from the same load
+            while (len - i >= 16) {
+                __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+                if (_mm_movemask_epi8(chunk) != 0) {
+                    break;
+                }
+                line += (size_t)__builtin_popcount(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+                i += 16;
+            }
+            if (i >= len) {
+                break;
+            }
+#endif
+            unsigned char c = bytes[i];
+            if (c < 0x80) {
+                if (c == '\n') {
+                    line++;
+                }
+                i++;
+                continue;
+            }
+
+            validator->sequenceOffset = validator->offset + i;
+            if (!startSequence(validator, c)) {
+                fail(validator, validator->sequenceOffset, line);
+                return false;
+            }
+            i++;
+            continue;
+        }
+
+        unsigned char c = bytes[i];
+        if (c < validator->low || c > validator->high) {
+            fail(validator, validator->sequenceOffset, line);
+            return false;
+        }
+        validator->low = 0x80;
+        validator->high = 0xBF;
+        validator->remaining--;
+        i++;
+    }
+
+    validator->offset += len;
+    validator->line = line;
+
+    return true;
+}
+
+bool utf8Finish(struct Utf8Validator *validator) {
+    if (validator->valid && validator->remaining > 0) {
+        fail(validator, validator->sequenceOffset, validator->line);
+    }
+
+    return validator->valid;
+}
@@ -0,0 +1,59 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *
+ * Streaming UTF-8 validator. Feed a file through utf8Update() in chunks of any
+ * size; sequences may be split across chunks. Newlines are counted in the same
+ * pass so the first invalid sequence can be reported by byte and line without
+ * reading the file again.
+ *
+ * Follows RFC 3629: overlong forms, UTF-16 surrogates and code points above
+ * U+10FFFF are all invalid.
+ * */
+struct Utf8Validator {
+    size_t offset;          // bytes consumed by previous updates
+    size_t line;            // 1-based line at offset
+    size_t sequenceOffset;  // start of the multi-byte sequence being decoded
+    unsigned int remaining; // continuation bytes still expected
+    unsigned char low;      // allowed range for the next continuation byte
+    unsigned char high;
+    bool valid;
+    size_t errorOffset; // byte offset of the first invalid sequence
+    size_t errorLine;   // line of the first invalid sequence
+};
+
+/* *
+ * @param  validator  Validator to reset to the start of a file
+ * */
+void utf8Init(struct Utf8Validator *validator);
+
+/* *
+ * Validates the next chunk of a file. Once a problem is found further updates
+ * are ignored and errorOffset/errorLine keep pointing at the first one.
+ *
+ * @param   validator  Validator state
+ * @param   data       Next bytes of the file
+ * @param   len        Number of bytes in data
+ *
+ * @return  bool
+ *          true       if everything seen so far is valid
+ *          false      if an invalid sequence was found
+ * */
+bool utf8Update(struct Utf8Validator *validator, const void *data, size_t len);
+
+/* *
+ * Ends validation. A multi-byte sequence cut off by the end of the file is
+ * invalid.
+ *
+ * @param   validator  Validator state
+ *
+ * @return  bool
+ *          true       if the whole file is valid UTF-8
+ *          false      otherwise
+ * */
+bool utf8Finish(struct Utf8Validator *validator);
+
+#endif
@@ -0,0 +1,1076 @@
+#include "wordindex.h"
+#include "constants.h"
+#include "errors.h"
+#include "files.h"
+#include "reporting.h"
+#include "workers.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WORD_INDEX_MAGIC "COLWIDX"
+#define WORD_INDEX_VERSION 3u
+#define WORD_INDEX_BYTE_ORDER 0x01020304u
+
+/* *
+ * On-disk records. Every record is a multiple of 8 bytes so each section
+ * stays aligned for direct access through the mapping.
+ * */
+struct IndexHeader {
+    char magic[8];
+    uint32_t byteOrder; // reads back differently on another byte order
+    uint32_t version;
+    uint64_t fileCount;
+    uint64_t termCount;
+    uint64_t postingCount;
+    uint64_t stringsSize;
+};
+
+struct IndexFileRecord {
+    uint64_t size;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    uint64_t inode;
+    uint64_t encoding; // declared for its directory, read with the signature
+    uint64_t textSize; // UTF-8 bytes it adds to the draft
+    uint64_t newlines;
+    uint64_t draftOffset; // where the file starts in the draft
+    uint64_t draftLine;
+    uint64_t pathOffset; // into strings
+    uint64_t pathLen;
+};
+
+struct IndexTermRecord {
+    uint64_t textOffset; // into strings
+    uint64_t textLen;
+    uint64_t firstPosting;
+    uint64_t postingCount;
+};
+
+struct IndexPosting {
+    uint32_t file;
+    uint32_t line;
+    uint64_t offset;
+};
+
+struct MappedIndex {
+    void *base;
+    size_t size;
+    const struct IndexHeader *header;
+    const struct IndexFileRecord *files;
+    const struct IndexTermRecord *terms;
+    const struct IndexPosting *postings;
+    const char *strings;
+};
+
+/* *
+ * A word found while reading a file, already folded to lower case in the
+ * file buffer.
+ * */
+struct Token {
+    uint64_t offset;
+    uint32_t len;
+    uint32_t line;
+    uint32_t hash;
+};
+
+/* *
+ * Per-file work for the update. Workers fill in one slot each: unchanged
+ * files point at their old record, changed ones carry their tokens.
+ * */
+struct FileScan {
+    const char *path; // relative to the project root
+    struct stat info;
+    enum TextEncoding encoding;
+    long oldFile;     // record in the old index to reuse, or -1
+    unsigned char *data;
+    size_t size;
+    size_t newlines;
+    struct Token *tokens;
+    size_t tokenCount;
+    struct ReadFailure failure;
+};
+
+struct OldPath {
+    const char *path;
+    size_t len;
+    size_t file;
+};
+
+struct UpdateJob {
+    const struct FileList *entries;
+    size_t *regular; // entry index of each regular file
+    struct FileScan *scans;
+    const struct MappedIndex *old; // NULL when rebuilding
+    struct OldPath *oldPaths;      // sorted by path
+    size_t oldPathCount;
+};
+
+/* *
+ * Interned words for the index being built. slots is an open addressing hash
+ * table of term id + 1, with 0 marking an empty slot.
+ * */
+struct TermTable {
+    uint32_t *slots;
+    size_t slotCount;
+    struct IndexTermRecord *terms; // postings counted in postingCount
+    uint32_t *hashes;
+    size_t termCount;
+    size_t termCapacity;
+};
+
+struct BuildPosting {
+    uint32_t term;
+    uint32_t file;
+    uint32_t line;
+    uint64_t offset;
+};
+
+struct IndexBuilder {
+    struct TermTable table;
+    struct BuildPosting *postings;
+    size_t postingCount;
+    size_t postingCapacity;
+    char *strings;
+    size_t stringsSize;
+    size_t stringsCapacity;
+    struct IndexFileRecord *files;
+    size_t fileCount;
+};
+
+static bool isWordByte(unsigned char byte) {
+    return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') ||
+           (byte >= '0' && byte <= '9') || byte >= 0x80;
+}
+
+/* *
+ * The General Punctuation block, U+2000..U+206F (spaces, dashes, curly quotes,
+ * ellipsis), splits words even though its bytes are not ASCII. So does U+FEFF,
+ * the byte order mark collation keeps at the start of a file.
+ * */
+static bool isWordBreakMark(const unsigned char *data, size_t i, size_t size) {
+    if (i + 2 >= size) {
+        return false;
+    }
+    if (data[i] == 0xEF) {
+        return data[i + 1] == 0xBB && data[i + 2] == 0xBF;
+    }
+    return data[i] == 0xE2 && (data[i + 1] == 0x80 ||
+                               (data[i + 1] == 0x81 && data[i + 2] <= 0xAF));
+}
+
+/* *
+ * Returns how many bytes at data[i] belong to a word, or 0 if none do. A
+ * right single quote inside a word is its apostrophe and stays part of it.
+ * */
+static size_t wordBytesAt(const unsigned char *data, size_t i, size_t size,
+                          bool inWord) {
+    if (isWordBreakMark(data, i, size)) {
+        bool apostrophe = inWord && data[i + 2] == 0x99 && i + 3 < size &&
+                          isWordByte(data[i + 3]) &&
+                          !isWordBreakMark(data, i + 3, size);
+        return apostrophe ? 3 : 0;
+    }
+    return isWordByte(data[i]) ? 1 : 0;
+}
+
+static unsigned char foldCase(unsigned char byte) {
+    return (byte >= 'A' && byte <= 'Z') ? (unsigned char)(byte + 32) : byte;
+}
+
+static uint32_t hashTerm(const unsigned char *text, size_t len) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void unmapIndex(struct MappedIndex *index) {
+    if (index->base) {
+        munmap(index->base, index->size);
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+static bool sectionFits(uint64_t count,
+                        size_t recordSize,
+                        size_t *offset,
+                        size_t total) {
+    if (count > (total - *offset) / recordSize) {
+        return false;
+    }
+    *offset += (size_t)count * recordSize;
+    return true;
+}
+
+/* *
+ * Maps an index and checks every section lies within the file. Term and path
+ * ranges are checked here too, so lookups can trust the records.
+ *
+ * @return  0 on success, -1 if the file is missing, unreadable or not an
+ *          index from this build of colette (errno is 0 in that last case)
+ * */
+static int mapIndex(const char *path, struct MappedIndex *index) {
+    memset(index, 0, sizeof(*index));
+
+    errno = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        (uintmax_t)info.st_size < sizeof(struct IndexHeader) ||
+        (uintmax_t)info.st_size > SIZE_MAX) {
+        close(fd);
+        errno = 0;
+        return -1;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    index->base = base;
+    index->size = size;
+
+    const struct IndexHeader *header = base;
+    size_t offset = sizeof(struct IndexHeader);
+    size_t filesAt = offset;
+    bool valid =
+        memcmp(header->magic, WORD_INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+        header->byteOrder == WORD_INDEX_BYTE_ORDER &&
+        header->version == WORD_INDEX_VERSION &&
+        header->fileCount < UINT32_MAX &&
+        sectionFits(header->fileCount,
+                    sizeof(struct IndexFileRecord),
+                    &offset,
+                    size);
+    size_t termsAt = offset;
+    valid = valid && sectionFits(header->termCount,
+                                 sizeof(struct IndexTermRecord),
+                                 &offset,
+                                 size);
+    size_t postingsAt = offset;
+    valid = valid && sectionFits(header->postingCount,
+                                 sizeof(struct IndexPosting),
+                                 &offset,
+                                 size);
+    valid = valid && header->stringsSize == size - offset;
+    if (!valid) {
+        unmapIndex(index);
+        errno = 0;
+        return -1;
+    }
+
+    const char *bytes = base;
+    index->header = header;
+    index->files = (const struct IndexFileRecord *)(bytes + filesAt);
+    index->terms = (const struct IndexTermRecord *)(bytes + termsAt);
+    index->postings = (const struct IndexPosting *)(bytes + postingsAt);
+    index->strings = bytes + offset;
+
+    for (uint64_t f = 0; valid && f < header->fileCount; f++) {
+        const struct IndexFileRecord *file = &index->files[f];
+        valid = file->pathOffset <= header->stringsSize &&
+                file->pathLen <= header->stringsSize - file->pathOffset;
+    }
+    for (uint64_t t = 0; valid && t < header->termCount; t++) {
+        const struct IndexTermRecord *term = &index->terms[t];
+        valid = term->textOffset <= header->stringsSize &&
+                term->textLen <= header->stringsSize - term->textOffset &&
+                term->firstPosting <= header->postingCount &&
+                term->postingCount <=
+                    header->postingCount - term->firstPosting;
+    }
+    if (!valid) {
+        unmapIndex(index);
+        errno = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int compareOldPaths(const void *a, const void *b) {
+    const struct OldPath *left = a;
+    const struct OldPath *right = b;
+    size_t len = left->len < right->len ? left->len : right->len;
+    int order = memcmp(left->path, right->path, len);
+    if (order != 0) {
+        return order;
+    }
+    return (left->len > right->len) - (left->len < right->len);
+}
+
+static long findOldFile(const struct UpdateJob *job, const char *path) {
+    struct OldPath key = {.path = path, .len = strlen(path)};
+    const struct OldPath *found = bsearch(&key,
+                                          job->oldPaths,
+                                          job->oldPathCount,
+                                          sizeof(struct OldPath),
+                                          compareOldPaths);
+    return found ? (long)found->file : -1;
+}
+
+static bool sameSignature(const struct IndexFileRecord *record,
+                          const struct stat *info,
+                          enum TextEncoding encoding) {
+    return record->encoding == (uint64_t)encoding &&
+           record->size == (uint64_t)info->st_size &&
+           record->mtimeSec == (int64_t)info->st_mtim.tv_sec &&
+           record->mtimeNsec == (int64_t)info->st_mtim.tv_nsec &&
+           record->inode == (uint64_t)info->st_ino;
+}
+
+/* *
+ * Folds the file to lower case in place and records every word in it. Offsets
+ * are unaffected because folding only changes ASCII letters.
+ * */
+static int tokenize(struct FileScan *scan) {
+    size_t capacity = 0;
+    uint32_t line = 1;
+    size_t i = 0;
+    while (i < scan->size) {
+        if (wordBytesAt(scan->data, i, scan->size, false) == 0) {
+            if (scan->data[i] == '\n') {
+                line++;
+            }
+            i += isWordBreakMark(scan->data, i, scan->size) ? 3 : 1;
+            continue;
+        }
+
+        size_t start = i;
+        size_t width;
+        while (i < scan->size &&
+               (width = wordBytesAt(scan->data, i, scan->size, true)) > 0) {
+            scan->data[i] = foldCase(scan->data[i]);
+            i += width;
+        }
+        size_t len = i - start;
+        if (len > COLETTE_MAX_TERM_LEN) {
+            continue;
+        }
+
+        if (scan->tokenCount == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            struct Token *grown =
+                realloc(scan->tokens, capacity * sizeof(struct Token));
+            if (!grown) {
+                setReadFailure(&scan->failure, PROC_ERR_MEMORY_ALLOC, ENOMEM);
+                return -1;
+            }
+            scan->tokens = grown;
+        }
+        scan->tokens[scan->tokenCount] =
+            (struct Token){.offset = start,
+                           .len = (uint32_t)len,
+                           .line = line,
+                           .hash = hashTerm(scan->data + start, len)};
+        scan->tokenCount++;
+    }
+    scan->newlines = line - 1;
+
+    return 0;
+}
+
+static void scanFile(size_t index, void *arg) {
+    struct UpdateJob *job = arg;
+    struct FileScan *scan = &job->scans[index];
+    const struct FileEntry *entry =
+        &job->entries->entries[job->regular[index]];
+    scan->encoding = entry->encoding;
+
+    // an unchanged file keeps its postings without even being opened, which
+    // makes checking a current index one lstat() per file
+    long oldFile = job->old ? findOldFile(job, scan->path) : -1;
+    if (oldFile >= 0 && lstat(entry->path, &scan->info) == 0 &&
+        S_ISREG(scan->info.st_mode) &&
+        sameSignature(
+            &job->old->files[oldFile], &scan->info, scan->encoding)) {
+        scan->oldFile = oldFile;
+        return;
+    }
+
+    scan->data = readWholeFile(entry->path,
+                               entry->encoding,
+                               &scan->size,
+                               &scan->info,
+                               &scan->failure);
+    if (scan->data) {
+        tokenize(scan);
+    }
+}
+
+static int reserveStrings(struct IndexBuilder *builder, size_t extra) {
+    if (extra <= builder->stringsCapacity - builder->stringsSize) {
+        return 0;
+    }
+    size_t capacity =
+        builder->stringsCapacity ? builder->stringsCapacity : 4096;
+    while (capacity - builder->stringsSize < extra) {
+        capacity *= 2;
+    }
+    char *grown = realloc(builder->strings, capacity);
+    if (!grown) {
+        return -1;
+    }
+    builder->strings = grown;
+    builder->stringsCapacity = capacity;
+    return 0;
+}
+
+static int appendString(struct IndexBuilder *builder,
+                        const void *text,
+                        size_t len,
+                        uint64_t *offset) {
+    if (reserveStrings(builder, len) != 0) {
+        return -1;
+    }
+    if (len > 0) {
+        memcpy(builder->strings + builder->stringsSize, text, len);
+    }
+    *offset = builder->stringsSize;
+    builder->stringsSize += len;
+    return 0;
+}
+
+static int growTermSlots(struct TermTable *table) {
+    size_t slotCount = table->slotCount ? table->slotCount * 2 : 4096;
+    uint32_t *slots = calloc(slotCount, sizeof(uint32_t));
+    if (!slots) {
+        return -1;
+    }
+    for (size_t t = 0; t < table->termCount; t++) {
+        size_t slot = table->hashes[t] & (slotCount - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = (uint32_t)t + 1;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slotCount = slotCount;
+    return 0;
+}
+
+static int internTerm(struct IndexBuilder *builder,
+                      const void *text,
+                      size_t len,
+                      uint32_t hash,
+                      uint32_t *termId) {
+    struct TermTable *table = &builder->table;
+    // keep the table at most 70% full
+    if ((table->termCount + 1) * 10 > table->slotCount * 7 &&
+        growTermSlots(table) != 0) {
+        return -1;
+    }
+
+    size_t slot = hash & (table->slotCount - 1);
+    while (table->slots[slot] != 0) {
+        uint32_t id = table->slots[slot] - 1;
+        const struct IndexTermRecord *term = &table->terms[id];
+        if (table->hashes[id] == hash && term->textLen == len &&
+            memcmp(builder->strings + term->textOffset, text, len) == 0) {
+            *termId = id;
+            return 0;
+        }
+        slot = (slot + 1) & (table->slotCount - 1);
+    }
+
+    if (table->termCount == table->termCapacity) {
+        size_t capacity = table->termCapacity ? table->termCapacity * 2 : 1024;
+        struct IndexTermRecord *terms =
+            realloc(table->terms, capacity * sizeof(struct IndexTermRecord));
+        if (!terms) {
+            return -1;
+        }
+        table->terms = terms;
+        uint32_t *hashes = realloc(table->hashes, capacity * sizeof(uint32_t));
+        if (!hashes) {
+            return -1;
+        }
+        table->hashes = hashes;
+        table->termCapacity = capacity;
+    }
+
+    uint64_t textOffset;
+    if (appendString(builder, text, len, &textOffset) != 0) {
+        return -1;
+    }
+    size_t id = table->termCount;
+    table->terms[id] = (struct IndexTermRecord){.textOffset = textOffset,
+                                                .textLen = len,
+                                                .firstPosting = 0,
+                                                .postingCount = 0};
+    table->hashes[id] = hash;
+    table->slots[slot] = (uint32_t)id + 1;
+    table->termCount++;
+
+    *termId = (uint32_t)id;
+    return 0;
+}
+
+static int addPosting(struct IndexBuilder *builder,
+                      uint32_t term,
+                      uint32_t file,
+                      uint32_t line,
+                      uint64_t offset) {
+    if (builder->postingCount == builder->postingCapacity) {
+        size_t capacity =
+            builder->postingCapacity ? builder->postingCapacity * 2 : 4096;
+        struct BuildPosting *grown =
+            realloc(builder->postings, capacity * sizeof(struct BuildPosting));
+        if (!grown) {
+            return -1;
+        }
+        builder->postings = grown;
+        builder->postingCapacity = capacity;
+    }
+
+    builder->postings[builder->postingCount] = (struct BuildPosting){
+        .term = term, .file = file, .line = line, .offset = offset};
+    builder->postingCount++;
+    builder->table.terms[term].postingCount++;
+    return 0;
+}
+
+static void freeIndexBuilder(struct IndexBuilder *builder) {
+    free(builder->table.slots);
+    free(builder->table.terms);
+    free(builder->table.hashes);
+    free(builder->postings);
+    free(builder->strings);
+    free(builder->files);
+}
+
+/* *
+ * Old postings grouped by the file they belong to, so an unchanged file's
+ * postings can be copied without walking the whole index for each one.
+ * Within a file they stay ordered by term, then offset.
+ * */
+struct OldPostings {
+    size_t *first;       // fileCount + 1 bucket starts
+    uint64_t *positions; // posting index, bucketed by file
+    uint64_t *termOf;    // term index of each posting
+    uint32_t *newTerm;   // old term index to new term id, UINT32_MAX if unset
+};
+
+static void freeOldPostings(struct OldPostings *old) {
+    free(old->first);
+    free(old->positions);
+    free(old->termOf);
+    free(old->newTerm);
+}
+
+static int bucketOldPostings(const struct MappedIndex *index,
+                             struct OldPostings *old) {
+    const struct IndexHeader *header = index->header;
+    size_t fileCount = (size_t)header->fileCount;
+    size_t postingCount = (size_t)header->postingCount;
+    size_t termCount = (size_t)header->termCount;
+    old->first = calloc(fileCount + 1, sizeof(size_t));
+    size_t postingSlots = postingCount ? postingCount : 1;
+    old->positions = malloc(postingSlots * sizeof(uint64_t));
+    old->termOf = malloc(postingSlots * sizeof(uint64_t));
+    old->newTerm = malloc((termCount ? termCount : 1) * sizeof(uint32_t));
+    if (!old->first || !old->positions || !old->termOf || !old->newTerm) {
+        return -1;
+    }
+
+    for (size_t t = 0; t < termCount; t++) {
+        old->newTerm[t] = UINT32_MAX;
+        const struct IndexTermRecord *term = &index->terms[t];
+        for (uint64_t p = term->firstPosting;
+             p < term->firstPosting + term->postingCount;
+             p++) {
+            old->termOf[p] = t;
+            if (index->postings[p].file >= fileCount) {
+                return -1;
+            }
+            old->first[index->postings[p].file + 1]++;
+        }
+    }
+    for (size_t f = 0; f < fileCount; f++) {
+        old->first[f + 1] += old->first[f];
+    }
+
+    size_t *fill = malloc((fileCount ? fileCount : 1) * sizeof(size_t));
+    if (!fill) {
+        return -1;
+    }
+    memcpy(fill, old->first, fileCount * sizeof(size_t));
+    for (size_t p = 0; p < postingCount; p++) {
+        old->positions[fill[index->postings[p].file]++] = p;
+    }
+    free(fill);
+
+    return 0;
+}
+
+static int addOldFile(struct IndexBuilder *builder,
+                      const struct MappedIndex *index,
+                      struct OldPostings *old,
+                      size_t oldFile,
+                      uint32_t newFile) {
+    for (size_t i = old->first[oldFile]; i < old->first[oldFile + 1]; i++) {
+        uint64_t p = old->positions[i];
+        uint64_t t = old->termOf[p];
+        if (old->newTerm[t] == UINT32_MAX) {
+            const struct IndexTermRecord *term = &index->terms[t];
+            const char *text = index->strings + term->textOffset;
+            if (internTerm(builder,
+                           text,
+                           (size_t)term->textLen,
+                           hashTerm((const unsigned char *)text,
+                                    (size_t)term->textLen),
+                           &old->newTerm[t]) != 0) {
+                return -1;
+            }
+        }
+        const struct IndexPosting *posting = &index->postings[p];
+        if (addPosting(builder,
+                       old->newTerm[t],
+                       newFile,
+                       posting->line,
+                       posting->offset) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int addScannedFile(struct IndexBuilder *builder,
+                          const struct FileScan *scan,
+                          uint32_t newFile) {
+    for (size_t k = 0; k < scan->tokenCount; k++) {
+        const struct Token *token = &scan->tokens[k];
+        uint32_t term;
+        if (internTerm(builder,
+                       scan->data + token->offset,
+                       token->len,
+                       token->hash,
+                       &term) != 0 ||
+            addPosting(builder, term, newFile, token->line, token->offset) !=
+                0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+struct SortedTerm {
+    const char *text;
+    size_t len;
+    uint32_t id;
+};
+
+static int compareSortedTerms(const void *a, const void *b) {
+    const struct SortedTerm *left = a;
+    const struct SortedTerm *right = b;
+    size_t len = left->len < right->len ? left->len : right->len;
+    int order = memcmp(left->text, right->text, len);
+    if (order != 0) {
+        return order;
+    }
+    return (left->len > right->len) - (left->len < right->len);
+}
+
+static bool
+writeSection(FILE *out, const void *data, size_t size, size_t count) {
+    return count == 0 || fwrite(data, size, count, out) == count;
+}
+
+/* *
+ * Sorts the terms, groups postings by term with a stable counting sort (so
+ * each term's postings stay in draft order) and writes the file.
+ * */
+static int writeIndex(struct IndexBuilder *builder, const char *path) {
+    struct TermTable *table = &builder->table;
+    size_t termCount = table->termCount;
+    struct SortedTerm *sorted =
+        malloc((termCount ? termCount : 1) * sizeof(struct SortedTerm));
+    uint32_t *rank = malloc((termCount ? termCount : 1) * sizeof(uint32_t));
+    struct IndexTermRecord *terms =
+        malloc((termCount ? termCount : 1) * sizeof(struct IndexTermRecord));
+    struct IndexPosting *postings = malloc(
+        (builder->postingCount ? builder->postingCount : 1) *
+        sizeof(struct IndexPosting));
+    if (!sorted || !rank || !terms || !postings) {
+        free(sorted);
+        free(rank);
+        free(terms);
+        free(postings);
+        reportProcessError(
+            PROCESS_OP_HANDLE_INDEX, path, PROC_ERR_MEMORY_ALLOC);
+        return -1;
+    }
+
+    for (size_t t = 0; t < termCount; t++) {
+        sorted[t] = (struct SortedTerm){
+            .text = builder->strings + table->terms[t].textOffset,
+            .len = (size_t)table->terms[t].textLen,
+            .id = (uint32_t)t};
+    }
+    if (termCount > 1) {
+        qsort(sorted, termCount, sizeof(struct SortedTerm), compareSortedTerms);
+    }
+
+    uint64_t next = 0;
+    for (size_t r = 0; r < termCount; r++) {
+        rank[sorted[r].id] = (uint32_t)r;
+        terms[r] = table->terms[sorted[r].id];
+        terms[r].firstPosting = next;
+        next += terms[r].postingCount;
+        terms[r].postingCount = 0; // counts back up as postings are placed
+    }
+    for (size_t p = 0; p < builder->postingCount; p++) {
+        const struct BuildPosting *posting = &builder->postings[p];
+        struct IndexTermRecord *term = &terms[rank[posting->term]];
+        postings[term->firstPosting + term->postingCount] =
+            (struct IndexPosting){.file = posting->file,
+                                  .line = posting->line,
+                                  .offset = posting->offset};
+        term->postingCount++;
+    }
+    free(sorted);
+    free(rank);
+
+    struct IndexHeader header = {.byteOrder = WORD_INDEX_BYTE_ORDER,
+                                 .version = WORD_INDEX_VERSION,
+                                 .fileCount = builder->fileCount,
+                                 .termCount = termCount,
+                                 .postingCount = builder->postingCount,
+                                 .stringsSize = builder->stringsSize};
+    memcpy(header.magic, WORD_INDEX_MAGIC, sizeof(header.magic));
+
+    char tempPath[COLETTE_PATH_BUF_SIZE];
+    int len = snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    if (len < 0 || (size_t)len >= sizeof(tempPath)) {
+        free(terms);
+        free(postings);
+        reportProcessError(
+            PROCESS_OP_HANDLE_INDEX, path, PROC_ERR_PATH_TOO_LONG);
+        return -1;
+    }
+
+    errno = 0;
+    FILE *out = fopen(tempPath, "wb");
+    if (!out) {
+        free(terms);
+        free(postings);
+        reportFileError(FILE_OP_OPEN, tempPath);
+        return -1;
+    }
+
+    bool written =
+        writeSection(out, &header, sizeof(header), 1) &&
+        writeSection(out,
+                     builder->files,
+                     sizeof(struct IndexFileRecord),
+                     builder->fileCount) &&
+        writeSection(out, terms, sizeof(struct IndexTermRecord), termCount) &&
+        writeSection(out,
+                     postings,
+                     sizeof(struct IndexPosting),
+                     builder->postingCount) &&
+        writeSection(out, builder->strings, 1, builder->stringsSize);
+    free(terms);
+    free(postings);
+
+    errno = 0;
+    if (fclose(out) != 0) {
+        written = false;
+    }
+    if (!written || rename(tempPath, path) != 0) {
+        reportFileError(FILE_OP_WRITE, path);
+        unlink(tempPath);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void freeScans(struct FileScan *scans, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(scans[i].data);
+        free(scans[i].tokens);
+    }
+    free(scans);
+}
+
+static bool isUnchanged(const struct UpdateJob *job, size_t fileCount) {
+    if (!job->old || job->old->header->fileCount != fileCount) {
+        return false;
+    }
+    for (size_t i = 0; i < fileCount; i++) {
+        // a file moved in an index changes every draft position after it
+        if (job->scans[i].oldFile != (long)i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int buildIndex(struct UpdateJob *job,
+                      size_t fileCount,
+                      const char *indexPath) {
+    struct IndexBuilder builder = {0};
+    struct OldPostings old = {0};
+    int status = 0;
+
+    builder.files =
+        calloc(fileCount ? fileCount : 1, sizeof(struct IndexFileRecord));
+    if (!builder.files ||
+        (job->old && bucketOldPostings(job->old, &old) != 0)) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_INDEX, indexPath, PROC_ERR_MEMORY_ALLOC);
+        freeOldPostings(&old);
+        freeIndexBuilder(&builder);
+        return -1;
+    }
+
+    uint64_t draftOffset = 0;
+    uint64_t draftLine = 1;
+    for (size_t i = 0; status == 0 && i < fileCount; i++) {
+        struct FileScan *scan = &job->scans[i];
+        struct IndexFileRecord *record = &builder.files[i];
+        record->size = (uint64_t)scan->info.st_size;
+        record->mtimeSec = (int64_t)scan->info.st_mtim.tv_sec;
+        record->mtimeNsec = (int64_t)scan->info.st_mtim.tv_nsec;
+        record->inode = (uint64_t)scan->info.st_ino;
+        record->encoding = (uint64_t)scan->encoding;
+        record->draftOffset = draftOffset;
+        record->draftLine = draftLine;
+
+        if (scan->oldFile >= 0) {
+            record->textSize = job->old->files[scan->oldFile].textSize;
+            record->newlines = job->old->files[scan->oldFile].newlines;
+            status = addOldFile(
+                &builder, job->old, &old, (size_t)scan->oldFile, (uint32_t)i);
+        } else {
+            record->textSize = scan->size;
+            record->newlines = scan->newlines;
+            status = addScannedFile(&builder, scan, (uint32_t)i);
+            // keep peak memory near one copy of the postings
+            free(scan->data);
+            free(scan->tokens);
+            scan->data = NULL;
+            scan->tokens = NULL;
+        }
+        if (status == 0) {
+            status = appendString(&builder,
+                                  scan->path,
+                                  strlen(scan->path),
+                                  &record->pathOffset);
+            record->pathLen = strlen(scan->path);
+        }
+
+        // collation follows every file with a line feed
+        draftOffset += record->textSize + 1;
+        draftLine += record->newlines + 1;
+        builder.fileCount++;
+    }
+    freeOldPostings(&old);
+
+    if (status != 0) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_INDEX, indexPath, PROC_ERR_MEMORY_ALLOC);
+    } else {
+        status = writeIndex(&builder, indexPath);
+    }
+    freeIndexBuilder(&builder);
+
+    return status;
+}
+
+int updateWordIndex(const struct FileList *entries,
+                    const char *rootDir,
+                    const char *indexPath,
+                    unsigned int jobs) {
+    struct UpdateJob job = {.entries = entries};
+    struct MappedIndex old;
+    if (mapIndex(indexPath, &old) == 0) {
+        job.old = &old;
+    }
+
+    size_t fileCount = 0;
+    for (size_t i = 0; i < entries->count; i++) {
+        fileCount += entries->entries[i].type == FILE_TYPE_REGULAR;
+    }
+    if (fileCount >= UINT32_MAX) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_INDEX, rootDir, PROC_ERR_INVALID_STATE);
+        unmapIndex(&old);
+        return -1;
+    }
+
+    job.regular = malloc((fileCount ? fileCount : 1) * sizeof(size_t));
+    job.scans = calloc(fileCount ? fileCount : 1, sizeof(struct FileScan));
+    if (job.old) {
+        job.oldPathCount = (size_t)old.header->fileCount;
+        job.oldPaths = malloc((job.oldPathCount ? job.oldPathCount : 1) *
+                              sizeof(struct OldPath));
+    }
+    if (!job.regular || !job.scans || (job.old && !job.oldPaths)) {
+        reportProcessError(
+            PROCESS_OP_HANDLE_INDEX, rootDir, PROC_ERR_MEMORY_ALLOC);
+        free(job.regular);
+        free(job.scans);
+        free(job.oldPaths);
+        unmapIndex(&old);
+        return -1;
+    }
+
+    for (size_t i = 0, f = 0; i < entries->count; i++) {
+        if (entries->entries[i].type == FILE_TYPE_REGULAR) {
+            job.regular[f] = i;
+            job.scans[f].path = relativePath(entries->entries[i].path, rootDir);
+            job.scans[f].oldFile = -1;
+            f++;
+        }
+    }
+    for (size_t f = 0; f < job.oldPathCount; f++) {
+        job.oldPaths[f] =
+            (struct OldPath){.path = old.strings + old.files[f].pathOffset,
+                             .len = (size_t)old.files[f].pathLen,
+                             .file = f};
+    }
+    if (job.oldPathCount > 1) {
+        qsort(job.oldPaths,
+              job.oldPathCount,
+              sizeof(struct OldPath),
+              compareOldPaths);
+    }
+
+    runParallel(fileCount, jobs, scanFile, &job);
+
+    int status = 0;
+    for (size_t f = 0; f < fileCount; f++) {
+        struct FileScan *scan = &job.scans[f];
+        const char *path = entries->entries[job.regular[f]].path;
+        if (reportReadFailure(&scan->failure, PROCESS_OP_HANDLE_INDEX, path)) {
+            status = -1;
+        }
+    }
+
+    if (status == 0 && !isUnchanged(&job, fileCount)) {
+        status = buildIndex(&job, fileCount, indexPath);
+    }
+
+    freeScans(job.scans, fileCount);
+    free(job.regular);
+    free(job.oldPaths);
+    unmapIndex(&old);
+
+    return status;
+}
+
+static int compareTermText(const struct MappedIndex *index,
+                           const struct IndexTermRecord *term,
+                           const unsigned char *word,
+                           size_t len) {
+    size_t termLen = (size_t)term->textLen;
+    size_t common = termLen < len ? termLen : len;
+    int order = memcmp(index->strings + term->textOffset, word, common);
+    if (order != 0) {
+        return order;
+    }
+    return (termLen > len) - (termLen < len);
+}
+
+bool isIndexWord(const char *word) {
+    const unsigned char *data = (const unsigned char *)word;
+    size_t size = strlen(word);
+    if (size == 0) {
+        return false;
+    }
+    size_t i = 0;
+    while (i < size) {
+        size_t width = wordBytesAt(data, i, size, i > 0);
+        if (width == 0) {
+            return false;
+        }
+        i += width;
+    }
+    return true;
+}
+
+int lookupWordIndex(const char *indexPath, const char *word, FILE *out) {
+    struct MappedIndex index;
+    if (mapIndex(indexPath, &index) != 0) {
+        reportFileError(FILE_OP_READ, indexPath);
+        return -1;
+    }
+
+    // words are stored folded, and nothing longer than the limit is stored
+    unsigned char folded[COLETTE_MAX_TERM_LEN];
+    size_t len = strlen(word);
+    if (len == 0 || len > sizeof(folded)) {
+        unmapIndex(&index);
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        folded[i] = foldCase((unsigned char)word[i]);
+    }
+
+    size_t low = 0;
+    size_t high = (size_t)index.header->termCount;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (compareTermText(&index, &index.terms[mid], folded, len) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    bool corrupt = false;
+    if (low < index.header->termCount &&
+        compareTermText(&index, &index.terms[low], folded, len) == 0) {
+        const struct IndexTermRecord *term = &index.terms[low];
+        for (uint64_t p = term->firstPosting;
+             p < term->firstPosting + term->postingCount;
+             p++) {
+            const struct IndexPosting *posting = &index.postings[p];
+            if (posting->file >= index.header->fileCount) {
+                corrupt = true;
+                continue;
+            }
+            const struct IndexFileRecord *file = &index.files[posting->file];
+            fprintf(out,
+                    "%.*s:%lu:%llu:%llu\n",
+                    (int)file->pathLen,
+                    index.strings + file->pathOffset,
+                    (unsigned long)posting->line,
+                    (unsigned long long)(file->draftLine + posting->line - 1),
+                    (unsigned long long)(file->draftOffset + posting->offset));
+        }
+    }
+    unmapIndex(&index);
+
+    int status = 0;
+    if (corrupt) {
+        errno = 0;
+        reportFileError(FILE_OP_READ, indexPath);
+        status = -1;
+    }
+    errno = 0;
+    if (fflush(out) != 0 || ferror(out)) {
+        reportFileError(FILE_OP_WRITE, "lookup results");
+        status = -1;
+    }
+
+    return status;
+}
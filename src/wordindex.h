@@ -0,0 +1,76 @@
+#ifndef WORDINDEX_H
+#define WORDINDEX_H
+
+#include "filelist.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/* *
+ * On-disk inverted index from every word in a project to the places it occurs.
+ * Words are runs of ASCII letters and digits or non-ASCII UTF-8 bytes, folded
+ * to lower case, so "Café" and "cafe's" index as "café" and "cafe" + "s".
+ * Dashes and quotes from U+2000..U+206F and a byte order mark split words
+ * like ASCII punctuation, except a right single quote inside a word, so
+ * "don’t" stays one word.
+ *
+ * The file holds, in order and native byte order:
+ *
+ *     header
+ *     file records   draft order, with stat signature and draft position
+ *     term records   sorted by word
+ *     postings       file id, line and offset; per term in draft order
+ *     strings        words and project-relative paths
+ *
+ * Lookups map the file and binary search the term records, so nothing is
+ * parsed or allocated per query.
+ * */
+
+/* *
+ * Brings the index at indexPath up to date with the project. Files whose
+ * size, modification time, inode and declared encoding match their record
+ * keep their postings; only new and changed files are read again, in
+ * parallel, and converted to UTF-8 as collation converts them. The file is
+ * left untouched when nothing changed, otherwise it is rewritten to a
+ * temporary file and renamed over the old one so a lookup never sees half an
+ * index. A missing or unreadable index is rebuilt from scratch.
+ *
+ * @param   entries    Resolved entries in traversal order
+ * @param   rootDir    Project root, stripped from stored paths
+ * @param   indexPath  Index file to update
+ * @param   jobs       Maximum number of worker threads
+ *
+ * @return  int
+ *          0          if the index is current
+ *         -1          if a file could not be read or the index written
+ * */
+int updateWordIndex(const struct FileList *entries,
+                    const char *rootDir,
+                    const char *indexPath,
+                    unsigned int jobs);
+
+/* *
+ * @param   word  Text to check
+ *
+ * @return  bool  true if word is a single word as the index stores them, not
+ *                empty and with nothing the tokenizer splits on
+ * */
+bool isIndexWord(const char *word);
+
+/* *
+ * Writes every occurrence of word to out in draft order, one per line as
+ *
+ *     path:line:draft-line:draft-offset
+ *
+ * with the same meaning as `colette grep` output.
+ *
+ * @param   indexPath  Index written by updateWordIndex()
+ * @param   word       Word to look up, case-insensitive
+ * @param   out        Stream the occurrences are written to
+ *
+ * @return  int
+ *          0          on success, including when the word never occurs
+ *         -1          if the index can't be read or output failed
+ * */
+int lookupWordIndex(const char *indexPath, const char *word, FILE *out);
+
+#endif
@@ -0,0 +1,89 @@
+#include "constants.h"
+#include "workers.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct WorkQueue {
+    pthread_mutex_t lock;
+    size_t next;
+    size_t count;
+    void (*work)(size_t index, void *arg);
+    void *arg;
+};
+
+static void *drainQueue(void *queueArg) {
+    struct WorkQueue *queue = queueArg;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        size_t index = queue->next;
+        if (index < queue->count) {
+            queue->next++;
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        if (index >= queue->count) {
+            return NULL;
+        }
+        queue->work(index, queue->arg);
+    }
+}
+
+unsigned int defaultJobCount(void) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online < 1) {
+        return 1;
+    }
+    if (online > COLETTE_MAX_JOBS) {
+        return COLETTE_MAX_JOBS;
+    }
+    return (unsigned int)online;
+}
+
+void runParallel(size_t count,
+                 unsigned int jobs,
+                 void (*work)(size_t index, void *arg),
+                 void *arg) {
+    if (!work || count == 0) {
+        return;
+    }
+
+    if (jobs > COLETTE_MAX_JOBS) {
+        jobs = COLETTE_MAX_JOBS;
+    }
+    if (jobs > count) {
+        jobs = (unsigned int)count;
+    }
+    if (jobs <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            work(i, arg);
+        }
+        return;
+    }
+
+    struct WorkQueue queue = {
+        .next = 0, .count = count, .work = work, .arg = arg};
+    if (pthread_mutex_init(&queue.lock, NULL) != 0) {
+        for (size_t i = 0; i < count; i++) {
+            work(i, arg);
+        }
+        return;
+    }
+
+    pthread_t threads[COLETTE_MAX_JOBS];
+    unsigned int started = 0;
+    for (unsigned int i = 1; i < jobs; i++) {
+        if (pthread_create(&threads[started], NULL, drainQueue, &queue) != 0) {
+            break; // carry on with the threads we have
+        }
+        started++;
+    }
+
+    drainQueue(&queue);
+
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+}
@@ -0,0 +1,31 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stddef.h>
+
+/* *
+ * Number of worker threads to use when the user doesn't pick one: the number
+ * of online processors, clamped to [1, COLETTE_MAX_JOBS].
+ *
+ * @return  unsigned int  default job count
+ * */
+unsigned int defaultJobCount(void);
+
+/* *
+ * Calls work(index, arg) once for every index in [0, count) using up to jobs
+ * threads. Items are claimed dynamically so slow items don't stall a whole
+ * partition. work must only touch the state for its own index (or protect
+ * shared state itself). The calling thread participates, and if threads can't
+ * be created the remaining work simply runs on fewer of them.
+ *
+ * @param   count  Number of work items
+ * @param   jobs   Maximum number of threads, including the caller
+ * @param   work   Function to run for each item
+ * @param   arg    Passed through to work
+ * */
+void runParallel(size_t count,
+                 unsigned int jobs,
+                 void (*work)(size_t index, void *arg),
+                 void *arg);
+
+#endif
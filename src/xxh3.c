@@ -0,0 +1,347 @@
+#include "xxh3.h"
+#include <string.h>
+
+// the data is little-endian and x86-64 always has SSE2
+#if defined(__SSE2__) && defined(__x86_64__)
+#define XXH3_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define XXH3_STRIPE_LEN 64
+#define XXH3_SECRET_SIZE 192
+#define XXH3_SECRET_CONSUME_RATE 8
+#define XXH3_ACC_NB 8
+#define XXH3_STRIPES_PER_BLOCK                                                 \
+    ((XXH3_SECRET_SIZE - XXH3_STRIPE_LEN) / XXH3_SECRET_CONSUME_RATE)
+#define XXH3_BLOCK_LEN (XXH3_STRIPE_LEN * XXH3_STRIPES_PER_BLOCK)
+#define XXH3_SECRET_SIZE_MIN 136
+#define XXH3_MIDSIZE_MAX 240
+
+static const uint32_t PRIME32_1 = 0x9E3779B1u;
+static const uint32_t PRIME32_2 = 0x85EBCA77u;
+static const uint32_t PRIME32_3 = 0xC2B2AE3Du;
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ull;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ull;
+
+static const unsigned char SECRET[XXH3_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static uint32_t read32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+           (uint32_t)p[3] << 24;
+}
+
+static uint64_t read64(const unsigned char *p) {
+    return (uint64_t)read32(p) | (uint64_t)read32(p + 4) << 32;
+}
+
+static uint64_t rotl64(uint64_t x, unsigned int r) {
+    return x << r | x >> (64 - r);
+}
+
+static uint64_t swap64(uint64_t x) {
+    return ((x << 56) & 0xff00000000000000ull) |
+           ((x << 40) & 0x00ff000000000000ull) |
+           ((x << 24) & 0x0000ff0000000000ull) |
+           ((x << 8) & 0x000000ff00000000ull) |
+           ((x >> 8) & 0x00000000ff000000ull) |
+           ((x >> 24) & 0x0000000000ff0000ull) |
+           ((x >> 40) & 0x000000000000ff00ull) |
+           ((x >> 56) & 0x00000000000000ffull);
+}
+
+// 64x64 to 128-bit product, high and low halves xored together
+static uint64_t mulFold64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 product = (unsigned __int128)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    uint64_t loLo = (a & 0xffffffff) * (b & 0xffffffff);
+    uint64_t hiLo = (a >> 32) * (b & 0xffffffff);
+    uint64_t loHi = (a & 0xffffffff) * (b >> 32);
+    uint64_t hiHi = (a >> 32) * (b >> 32);
+    uint64_t cross = (loLo >> 32) + (hiLo & 0xffffffff) + loHi;
+    uint64_t upper = (hiLo >> 32) + (cross >> 32) + hiHi;
+    uint64_t lower = (cross << 32) | (loLo & 0xffffffff);
+    return lower ^ upper;
+#endif
+}
+
+static uint64_t xxh64Avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+static uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    return h ^ (h >> 32);
+}
+
+static uint64_t rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static uint64_t mix16(const unsigned char *p, const unsigned char *secret) {
+    return mulFold64(read64(p) ^ read64(secret),
+                     read64(p + 8) ^ read64(secret + 8));
+}
+
+static uint64_t hash0To16(const unsigned char *p, size_t len) {
+    if (len > 8) {
+        uint64_t lo = read64(p) ^ (read64(SECRET + 24) ^ read64(SECRET + 32));
+        uint64_t hi = read64(p + len - 8) ^
+                      (read64(SECRET + 40) ^ read64(SECRET + 48));
+        uint64_t acc = len + swap64(lo) + hi + mulFold64(lo, hi);
+        return avalanche(acc);
+    }
+    if (len >= 4) {
+        uint64_t in = read32(p + len - 4) + ((uint64_t)read32(p) << 32);
+        return rrmxmx(in ^ (read64(SECRET + 8) ^ read64(SECRET + 16)), len);
+    }
+    if (len > 0) {
+        uint32_t combined = (uint32_t)p[0] << 16 | (uint32_t)p[len >> 1] << 24 |
+                            (uint32_t)p[len - 1] | (uint32_t)len << 8;
+        return xxh64Avalanche(combined ^
+                              (uint64_t)(read32(SECRET) ^ read32(SECRET + 4)));
+    }
+    return xxh64Avalanche(read64(SECRET + 56) ^ read64(SECRET + 64));
+}
+
+static uint64_t hash17To128(const unsigned char *p, size_t len) {
+    uint64_t acc = len * PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += mix16(p + 48, SECRET + 96);
+                acc += mix16(p + len - 64, SECRET + 112);
+            }
+            acc += mix16(p + 32, SECRET + 64);
+            acc += mix16(p + len - 48, SECRET + 80);
+        }
+        acc += mix16(p + 16, SECRET + 32);
+        acc += mix16(p + len - 32, SECRET + 48);
+    }
+    acc += mix16(p, SECRET);
+    acc += mix16(p + len - 16, SECRET + 16);
+    return avalanche(acc);
+}
+
+static uint64_t hash129To240(const unsigned char *p, size_t len) {
+    uint64_t acc = len * PRIME64_1;
+    size_t rounds = len / 16;
+    for (size_t i = 0; i < 8; i++) {
+        acc += mix16(p + 16 * i, SECRET + 16 * i);
+    }
+    acc = avalanche(acc);
+    for (size_t i = 8; i < rounds; i++) {
+        acc += mix16(p + 16 * i, SECRET + 16 * (i - 8) + 3);
+    }
+    acc += mix16(p + len - 16, SECRET + XXH3_SECRET_SIZE_MIN - 17);
+    return avalanche(acc);
+}
+
+static uint64_t hashShort(const unsigned char *p, size_t len) {
+    if (len <= 16) {
+        return hash0To16(p, len);
+    }
+    if (len <= 128) {
+        return hash17To128(p, len);
+    }
+    return hash129To240(p, len);
+}
+
+static void accumulateStripe(uint64_t *acc,
+                             const unsigned char *p,
+                             const unsigned char *secret) {
+#if defined(XXH3_SSE2)
+    // two lanes per register; the low halves of key and key >> 32 multiply
+    for (size_t i = 0; i < XXH3_ACC_NB / 2; i++) {
+        __m128i lanes = _mm_loadu_si128((const __m128i *)(const void *)acc + i);
+        __m128i value =
+            _mm_loadu_si128((const __m128i *)(const void *)p + i);
+        __m128i key = _mm_xor_si128(
+            value, _mm_loadu_si128((const __m128i *)(const void *)secret + i));
+        __m128i product =
+            _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+        lanes = _mm_add_epi64(product, _mm_add_epi64(lanes, swapped));
+        _mm_storeu_si128((__m128i *)(void *)acc + i, lanes);
+    }
+#else
+    for (size_t i = 0; i < XXH3_ACC_NB; i++) {
+        uint64_t value = read64(p + 8 * i);
+        uint64_t key = value ^ read64(secret + 8 * i);
+        acc[i ^ 1] += value;
+        acc[i] += (key & 0xffffffff) * (key >> 32);
+    }
+#endif
+}
+
+static void scramble(uint64_t *acc) {
+    const unsigned char *secret = SECRET + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN;
+    for (size_t i = 0; i < XXH3_ACC_NB; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(secret + 8 * i);
+        acc[i] = a * PRIME32_1;
+    }
+}
+
+/* *
+ * Accumulates whole stripes, scrambling the accumulators each time a block's
+ * worth of secret has been used.
+ * */
+static void consumeStripes(uint64_t *acc,
+                           size_t *stripesSoFar,
+                           const unsigned char *p,
+                           size_t stripes) {
+    while (stripes > 0) {
+        size_t room = XXH3_STRIPES_PER_BLOCK - *stripesSoFar;
+        size_t take = stripes < room ? stripes : room;
+        for (size_t i = 0; i < take; i++) {
+            accumulateStripe(acc,
+                             p + i * XXH3_STRIPE_LEN,
+                             SECRET + (*stripesSoFar + i) *
+                                          XXH3_SECRET_CONSUME_RATE);
+        }
+        p += take * XXH3_STRIPE_LEN;
+        stripes -= take;
+        *stripesSoFar += take;
+        if (*stripesSoFar == XXH3_STRIPES_PER_BLOCK) {
+            scramble(acc);
+            *stripesSoFar = 0;
+        }
+    }
+}
+
+static uint64_t mergeAccumulators(const uint64_t *acc, uint64_t start) {
+    const unsigned char *secret = SECRET + 11;
+    uint64_t result = start;
+    for (size_t i = 0; i < 4; i++) {
+        result += mulFold64(acc[2 * i] ^ read64(secret + 16 * i),
+                            acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+    }
+    return avalanche(result);
+}
+
+void xxh3Reset(struct Xxh3State *state) {
+    state->acc[0] = PRIME32_3;
+    state->acc[1] = PRIME64_1;
+    state->acc[2] = PRIME64_2;
+    state->acc[3] = PRIME64_3;
+    state->acc[4] = PRIME64_4;
+    state->acc[5] = PRIME32_2;
+    state->acc[6] = PRIME64_5;
+    state->acc[7] = PRIME32_1;
+    state->bufferedSize = 0;
+    state->stripesSoFar = 0;
+    state->totalLen = 0;
+}
+
+/* *
+ * At least one byte is always left buffered: the digest must be able to tell
+ * the last stripe from those already accumulated, as the one-shot hash does.
+ * */
+void xxh3Update(struct Xxh3State *state, const void *data, size_t len) {
+    const unsigned char *p = data;
+    const unsigned char *end = p + len;
+    state->totalLen += len;
+
+    if (len <= XXH3_BUFFER_SIZE - state->bufferedSize) {
+        if (len > 0) {
+            memcpy(state->buffer + state->bufferedSize, p, len);
+        }
+        state->bufferedSize += len;
+        return;
+    }
+
+    const size_t bufferStripes = XXH3_BUFFER_SIZE / XXH3_STRIPE_LEN;
+    if (state->bufferedSize > 0) {
+        size_t fill = XXH3_BUFFER_SIZE - state->bufferedSize;
+        memcpy(state->buffer + state->bufferedSize, p, fill);
+        p += fill;
+        consumeStripes(
+            state->acc, &state->stripesSoFar, state->buffer, bufferStripes);
+        state->bufferedSize = 0;
+    }
+
+    if ((size_t)(end - p) > XXH3_BUFFER_SIZE) {
+        do {
+            consumeStripes(state->acc, &state->stripesSoFar, p, bufferStripes);
+            p += XXH3_BUFFER_SIZE;
+        } while ((size_t)(end - p) > XXH3_BUFFER_SIZE);
+        // the digest may need the stripe before what is left
+        memcpy(state->buffer + XXH3_BUFFER_SIZE - XXH3_STRIPE_LEN,
+               p - XXH3_STRIPE_LEN,
+               XXH3_STRIPE_LEN);
+    }
+
+    memcpy(state->buffer, p, (size_t)(end - p));
+    state->bufferedSize = (size_t)(end - p);
+}
+
+uint64_t xxh3Digest(const struct Xxh3State *state) {
+    if (state->totalLen <= XXH3_MIDSIZE_MAX) {
+        return hashShort(state->buffer, (size_t)state->totalLen);
+    }
+
+    uint64_t acc[XXH3_ACC_NB];
+    memcpy(acc, state->acc, sizeof(acc));
+    size_t stripesSoFar = state->stripesSoFar;
+    unsigned char lastStripe[XXH3_STRIPE_LEN];
+    const unsigned char *last;
+    if (state->bufferedSize >= XXH3_STRIPE_LEN) {
+        size_t stripes = (state->bufferedSize - 1) / XXH3_STRIPE_LEN;
+        consumeStripes(acc, &stripesSoFar, state->buffer, stripes);
+        last = state->buffer + state->bufferedSize - XXH3_STRIPE_LEN;
+    } else {
+        size_t catchup = XXH3_STRIPE_LEN - state->bufferedSize;
+        memcpy(lastStripe,
+               state->buffer + XXH3_BUFFER_SIZE - catchup,
+               catchup);
+        memcpy(lastStripe + catchup, state->buffer, state->bufferedSize);
+        last = lastStripe;
+    }
+    accumulateStripe(
+        acc, last, SECRET + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN - 7);
+    return mergeAccumulators(acc, state->totalLen * PRIME64_1);
+}
+
+uint64_t xxh3Hash(const void *data, size_t len) {
+    if (len <= XXH3_MIDSIZE_MAX) {
+        return hashShort(data, len);
+    }
+    struct Xxh3State state;
+    xxh3Reset(&state);
+    xxh3Update(&state, data, len);
+    return xxh3Digest(&state);
+}
@@ -0,0 +1,56 @@
+#ifndef XXH3_H
+#define XXH3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define XXH3_BUFFER_SIZE 256
+
+/* *
+ * Streaming XXH3 64-bit hash with the default secret and seed 0, giving the
+ * same values as the reference XXH3_64bits(). Input is fed in chunks of any
+ * size; up to XXH3_BUFFER_SIZE bytes are held back so the last stripe can be
+ * hashed the way the one-shot function hashes it.
+ *
+ * XXH3 is not cryptographic. It tells a changed file from an unchanged one,
+ * not a forged file from a genuine one.
+ * */
+struct Xxh3State {
+    uint64_t acc[8];
+    unsigned char buffer[XXH3_BUFFER_SIZE];
+    size_t bufferedSize;
+    size_t stripesSoFar; // stripes accumulated in the current block
+    uint64_t totalLen;
+};
+
+/* *
+ * @param  state  Hash to start
+ * */
+void xxh3Reset(struct Xxh3State *state);
+
+/* *
+ * @param  state  Hash state
+ * @param  data   Next bytes of the input
+ * @param  len    Number of bytes in data
+ * */
+void xxh3Update(struct Xxh3State *state, const void *data, size_t len);
+
+/* *
+ * Hash of everything fed so far. The state is left as it was, so more input
+ * can follow.
+ *
+ * @param   state     Hash state
+ *
+ * @return  uint64_t  XXH3 64-bit hash
+ * */
+uint64_t xxh3Digest(const struct Xxh3State *state);
+
+/* *
+ * @param   data      Input
+ * @param   len       Number of bytes in data
+ *
+ * @return  uint64_t  XXH3 64-bit hash of data
+ * */
+uint64_t xxh3Hash(const void *data, size_t len);
+
+#endif
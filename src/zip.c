@@ -0,0 +1,294 @@
+#include "zip.h"
+#include "crc32.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ZIP_LOCAL_HEADER 0x04034b50u
+#define ZIP_DATA_DESCRIPTOR 0x08074b50u
+#define ZIP_CENTRAL_HEADER 0x02014b50u
+#define ZIP_END_OF_DIRECTORY 0x06054b50u
+
+#define ZIP_FLAG_DESCRIPTOR 0x0008 // sizes and CRC follow the data
+#define ZIP_FLAG_UTF8 0x0800       // the name is UTF-8
+
+static const uint16_t ZIP_VERSION = 20;          // 2.0: deflate, descriptors
+static const uint16_t ZIP_MADE_BY = 0x0300 | 20; // on Unix
+static const uint32_t ZIP_FILE_MODE = 0100644u;  // regular file, rw-r--r--
+
+static void put16(unsigned char *p, uint16_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+static void put32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static int writeBytes(struct ZipWriter *zip, const void *data, size_t len) {
+    if (len > UINT32_MAX || zip->offset + len > UINT32_MAX) {
+        errno = EFBIG;
+        return -1;
+    }
+    if (len > 0 && fwrite(data, 1, len, zip->out) != len) {
+        return -1;
+    }
+    zip->offset += len;
+    return 0;
+}
+
+static uint16_t nameFlags(const char *name) {
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        if (*p >= 0x80) {
+            return ZIP_FLAG_UTF8;
+        }
+    }
+    return 0;
+}
+
+static struct ZipRecord *addRecord(struct ZipWriter *zip,
+                                   const char *name,
+                                   enum ZipMethod method,
+                                   uint16_t flags) {
+    size_t nameLen = strlen(name);
+    if (nameLen == 0 || nameLen > UINT16_MAX) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    if (zip->count == zip->capacity) {
+        size_t capacity = zip->capacity ? zip->capacity * 2 : 16;
+        struct ZipRecord *grown =
+            realloc(zip->records, capacity * sizeof(struct ZipRecord));
+        if (!grown) {
+            return NULL;
+        }
+        zip->records = grown;
+        zip->capacity = capacity;
+    }
+
+    char *copy = malloc(nameLen + 1);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, name, nameLen + 1);
+
+    struct ZipRecord *record = &zip->records[zip->count++];
+    *record = (struct ZipRecord){.name = copy,
+                                 .method = method,
+                                 .flags = (uint16_t)(flags | nameFlags(name)),
+                                 .offset = (uint32_t)zip->offset};
+    return record;
+}
+
+static int writeLocalHeader(struct ZipWriter *zip,
+                            const struct ZipRecord *record) {
+    unsigned char header[30];
+    size_t nameLen = strlen(record->name);
+    put32(header, ZIP_LOCAL_HEADER);
+    put16(header + 4, ZIP_VERSION);
+    put16(header + 6, record->flags);
+    put16(header + 8, (uint16_t)record->method);
+    put16(header + 10, zip->dosTime);
+    put16(header + 12, zip->dosDate);
+    put32(header + 14, record->crc);
+    put32(header + 18, record->compressedSize);
+    put32(header + 22, record->size);
+    put16(header + 26, (uint16_t)nameLen);
+    put16(header + 28, 0); // no extra field
+    return writeBytes(zip, header, sizeof(header)) != 0 ||
+                   writeBytes(zip, record->name, nameLen) != 0
+               ? -1
+               : 0;
+}
+
+int zipOpen(struct ZipWriter *zip, const char *path) {
+    memset(zip, 0, sizeof(*zip));
+    if (deflaterInit(&zip->deflater) != 0) {
+        return -1;
+    }
+    zip->out = fopen(path, "wb");
+    if (!zip->out) {
+        deflaterFree(&zip->deflater);
+        return -1;
+    }
+
+    // DOS time has two second resolution and starts in 1980
+    time_t now = time(NULL);
+    struct tm local;
+    if (localtime_r(&now, &local) && local.tm_year >= 80) {
+        zip->dosTime = (uint16_t)(local.tm_hour << 11 | local.tm_min << 5 |
+                                  local.tm_sec / 2);
+        zip->dosDate = (uint16_t)((local.tm_year - 80) << 9 |
+                                  (local.tm_mon + 1) << 5 | local.tm_mday);
+    } else {
+        zip->dosDate = 1 << 5 | 1; // 1980-01-01
+    }
+    return 0;
+}
+
+int zipAddEntry(struct ZipWriter *zip,
+                const char *name,
+                const void *data,
+                size_t len,
+                enum ZipMethod method) {
+    // compressed sizes aren't known until the data has been through
+    if (method == ZIP_DEFLATED) {
+        return zipBeginEntry(zip, name, method) != 0 ||
+                       zipWriteEntry(zip, data, len) != 0 ||
+                       zipEndEntry(zip) != 0
+                   ? -1
+                   : 0;
+    }
+
+    if (len > UINT32_MAX) {
+        errno = EFBIG;
+        return -1;
+    }
+    struct ZipRecord *record = addRecord(zip, name, ZIP_STORED, 0);
+    if (!record) {
+        return -1;
+    }
+    record->crc = crc32Update(0, data, len);
+    record->size = (uint32_t)len;
+    record->compressedSize = (uint32_t)len;
+    return writeLocalHeader(zip, record) != 0 ||
+                   writeBytes(zip, data, len) != 0
+               ? -1
+               : 0;
+}
+
+int zipBeginEntry(struct ZipWriter *zip,
+                  const char *name,
+                  enum ZipMethod method) {
+    struct ZipRecord *record =
+        addRecord(zip, name, method, ZIP_FLAG_DESCRIPTOR);
+    if (!record || writeLocalHeader(zip, record) != 0) {
+        return -1;
+    }
+    if (method == ZIP_DEFLATED) {
+        deflaterReset(&zip->deflater);
+    }
+    zip->inEntry = true;
+    zip->entrySize = 0;
+    zip->entryCompressedSize = 0;
+    return 0;
+}
+
+int zipWriteEntry(struct ZipWriter *zip, const void *data, size_t len) {
+    struct ZipRecord *record = &zip->records[zip->count - 1];
+    record->crc = crc32Update(record->crc, data, len);
+    zip->entrySize += len;
+
+    const unsigned char *out = data;
+    size_t outLen = len;
+    if (record->method == ZIP_DEFLATED &&
+        deflaterUpdate(&zip->deflater, data, len, &out, &outLen) != 0) {
+        return -1;
+    }
+    zip->entryCompressedSize += outLen;
+    return writeBytes(zip, out, outLen);
+}
+
+int zipEndEntry(struct ZipWriter *zip) {
+    struct ZipRecord *record = &zip->records[zip->count - 1];
+    if (record->method == ZIP_DEFLATED) {
+        const unsigned char *out;
+        size_t outLen;
+        if (deflaterFinish(&zip->deflater, &out, &outLen) != 0 ||
+            writeBytes(zip, out, outLen) != 0) {
+            return -1;
+        }
+        zip->entryCompressedSize += outLen;
+    }
+    zip->inEntry = false;
+    if (zip->entrySize > UINT32_MAX) {
+        errno = EFBIG;
+        return -1;
+    }
+    record->size = (uint32_t)zip->entrySize;
+    record->compressedSize = (uint32_t)zip->entryCompressedSize;
+
+    unsigned char descriptor[16];
+    put32(descriptor, ZIP_DATA_DESCRIPTOR);
+    put32(descriptor + 4, record->crc);
+    put32(descriptor + 8, record->compressedSize);
+    put32(descriptor + 12, record->size);
+    return writeBytes(zip, descriptor, sizeof(descriptor));
+}
+
+static void freeZipWriter(struct ZipWriter *zip) {
+    for (size_t i = 0; i < zip->count; i++) {
+        free(zip->records[i].name);
+    }
+    free(zip->records);
+    deflaterFree(&zip->deflater);
+    zip->records = NULL;
+    zip->count = 0;
+    zip->capacity = 0;
+    zip->out = NULL;
+}
+
+int zipClose(struct ZipWriter *zip) {
+    int status = 0;
+    uint64_t directoryStart = zip->offset;
+    for (size_t i = 0; status == 0 && i < zip->count; i++) {
+        const struct ZipRecord *record = &zip->records[i];
+        size_t nameLen = strlen(record->name);
+        unsigned char header[46];
+        put32(header, ZIP_CENTRAL_HEADER);
+        put16(header + 4, ZIP_MADE_BY);
+        put16(header + 6, ZIP_VERSION);
+        put16(header + 8, record->flags);
+        put16(header + 10, (uint16_t)record->method);
+        put16(header + 12, zip->dosTime);
+        put16(header + 14, zip->dosDate);
+        put32(header + 16, record->crc);
+        put32(header + 20, record->compressedSize);
+        put32(header + 24, record->size);
+        put16(header + 28, (uint16_t)nameLen);
+        put16(header + 30, 0); // extra field
+        put16(header + 32, 0); // comment
+        put16(header + 34, 0); // disk
+        put16(header + 36, 0); // internal attributes
+        put32(header + 38, ZIP_FILE_MODE << 16);
+        put32(header + 42, record->offset);
+        if (writeBytes(zip, header, sizeof(header)) != 0 ||
+            writeBytes(zip, record->name, nameLen) != 0) {
+            status = -1;
+        }
+    }
+
+    if (status == 0 && zip->count > UINT16_MAX) {
+        errno = EFBIG;
+        status = -1;
+    }
+    if (status == 0) {
+        unsigned char end[22];
+        put32(end, ZIP_END_OF_DIRECTORY);
+        put16(end + 4, 0); // this disk
+        put16(end + 6, 0); // disk the directory starts on
+        put16(end + 8, (uint16_t)zip->count);
+        put16(end + 10, (uint16_t)zip->count);
+        put32(end + 12, (uint32_t)(zip->offset - directoryStart));
+        put32(end + 16, (uint32_t)directoryStart);
+        put16(end + 20, 0); // comment
+        status = writeBytes(zip, end, sizeof(end));
+    }
+
+    if (fclose(zip->out) != 0) {
+        status = -1;
+    }
+    freeZipWriter(zip);
+    return status;
+}
+
+void zipAbort(struct ZipWriter *zip) {
+    if (zip->out) {
+        fclose(zip->out);
+    }
+    freeZipWriter(zip);
+}
@@ -0,0 +1,138 @@
+#ifndef ZIP_H
+#define ZIP_H
+
+#include "deflate.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum ZipMethod {
+    ZIP_STORED = 0,
+    ZIP_DEFLATED = 8,
+};
+
+/* *
+ * What the central directory needs to know about a written entry.
+ * */
+struct ZipRecord {
+    char *name;
+    enum ZipMethod method;
+    uint16_t flags;
+    uint32_t crc;
+    uint32_t compressedSize;
+    uint32_t size;
+    uint32_t offset; // of the local header
+};
+
+/* *
+ * Writes a ZIP archive front to back in one pass. Entries given whole have
+ * their sizes and CRC in the local header; streamed entries are compressed
+ * and checksummed as they are written and followed by a data descriptor, so
+ * the output is never seeked or read back. Offsets and sizes are tracked in
+ * memory for the central directory written at the end. Archives are limited
+ * to 4 GiB (no ZIP64).
+ * */
+struct ZipWriter {
+    FILE *out;
+    uint64_t offset; // bytes written so far
+    uint16_t dosTime;
+    uint16_t dosDate;
+    struct ZipRecord *records;
+    size_t count;
+    size_t capacity;
+    bool inEntry;
+    uint64_t entrySize;           // streamed entry: bytes before compression
+    uint64_t entryCompressedSize; // and after
+    struct Deflater deflater;
+};
+
+/* *
+ * Creates the archive. Entries are stamped with the current local time.
+ *
+ * @param   zip   Writer to initialize
+ * @param   path  File to create or truncate
+ *
+ * @return  int
+ *          0     on success
+ *         -1     if the file could not be created or memory allocated
+ * */
+int zipOpen(struct ZipWriter *zip, const char *path);
+
+/* *
+ * Writes an entry whose contents are all at hand.
+ *
+ * @param   zip     Writer state
+ * @param   name    Path inside the archive
+ * @param   data    Contents of the entry
+ * @param   len     Number of bytes in data
+ * @param   method  ZIP_STORED or ZIP_DEFLATED
+ *
+ * @return  int
+ *          0       on success
+ *         -1       if writing failed or the archive would pass 4 GiB
+ * */
+int zipAddEntry(struct ZipWriter *zip,
+                const char *name,
+                const void *data,
+                size_t len,
+                enum ZipMethod method);
+
+/* *
+ * Starts an entry whose contents follow in zipWriteEntry() calls.
+ *
+ * @param   zip     Writer state
+ * @param   name    Path inside the archive
+ * @param   method  ZIP_STORED or ZIP_DEFLATED
+ *
+ * @return  int
+ *          0       on success
+ *         -1       if writing failed or memory could not be allocated
+ * */
+int zipBeginEntry(struct ZipWriter *zip,
+                  const char *name,
+                  enum ZipMethod method);
+
+/* *
+ * @param   zip   Writer state, inside zipBeginEntry()
+ * @param   data  Next bytes of the entry
+ * @param   len   Number of bytes in data
+ *
+ * @return  int
+ *          0     on success
+ *         -1     if writing failed or the archive would pass 4 GiB
+ * */
+int zipWriteEntry(struct ZipWriter *zip, const void *data, size_t len);
+
+/* *
+ * Ends the streamed entry with its data descriptor.
+ *
+ * @param   zip   Writer state
+ *
+ * @return  int
+ *          0     on success
+ *         -1     if writing failed or the archive would pass 4 GiB
+ * */
+int zipEndEntry(struct ZipWriter *zip);
+
+/* *
+ * Writes the central directory and closes the file. The writer is freed
+ * whether or not this succeeds.
+ *
+ * @param   zip   Writer state
+ *
+ * @return  int
+ *          0     on success
+ *         -1     if writing or closing failed
+ * */
+int zipClose(struct ZipWriter *zip);
+
+/* *
+ * Closes the file and frees the writer after a failure, leaving an
+ * incomplete archive.
+ *
+ * @param  zip  Writer state
+ * */
+void zipAbort(struct ZipWriter *zip);
+
+#endif
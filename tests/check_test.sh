@@ -15,12 +15,13 @@ test_check_mode() {
     local expected_status="$2"
     local expected_output="$3"
     local test_name="$4"
+    shift 4 # any remaining arguments are passed through to colette
     
     TESTS_RUN=$((TESTS_RUN + 1))
     echo -e "\n${YELLOW}Test $TESTS_RUN: $test_name${NC}"
     
     # Run colette in check mode and capture both output and status
-    output=$($COLETTE --check "$project_dir" 2>&1)
+    output=$($COLETTE --check "$@" "$project_dir" 2>&1)
     status=$?
     # Verify the exit status matches what we expect
     if [ $status -eq $expected_status ]; then
@@ -351,8 +352,132 @@ test_check_mode "$TEST_DATA/depth_cases/max_depth" 0 "Success" \
 test_check_mode "$TEST_DATA/depth_cases/exceeded_depth" 1 "Project hierarchy exceeds maximum depth" \
     "Project exceeding maximum depth"
 
+# Projects with several problems are reported in one pass
+setup_multiple_error_cases() {
+    local dir="$TEST_DATA/multiple_errors"
+    mkdir -p "$dir/chapter1"
+
+    cat > "$dir/.index" << EOL
+missing1.md
+valid.md
+chapter1
+missing1.md
+EOL
+    echo "missing2.md" > "$dir/chapter1/.index"
+    echo "Valid content" > "$dir/valid.md"
+}
+
+setup_multiple_error_cases
+
+test_check_mode "$TEST_DATA/multiple_errors" 1 "2 problems found" \
+    "All problems reported in a single pass (duplicates merged)"
+
+test_check_mode "$TEST_DATA/multiple_errors" 1 "chapter1/missing2.md: File not found" \
+    "Problems in nested directories reported after earlier failures"
+
+# JSON report is written to stdout
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: JSON check report${NC}"
+json_output=$($COLETTE --check --report json "$TEST_DATA/multiple_errors" 2>/dev/null)
+if [[ "$json_output" == "{\"problems\":["* ]] &&
+    [[ "$json_output" == *"\"count\":2,\"errors\":2}" ]]; then
+    echo -e "${GREEN}✓ JSON report matches expected${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Unexpected JSON report:${NC}\n$json_output"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+# Files present on disk but missing from every index are warnings
+setup_orphan_cases() {
+    local dir="$TEST_DATA/orphaned_files"
+    mkdir -p "$dir/chapter1"
+
+    printf "listed.md\nchapter1\n" > "$dir/.index"
+    echo "listed.md" > "$dir/chapter1/.index"
+    echo "Listed" > "$dir/listed.md"
+    echo "Listed" > "$dir/chapter1/listed.md"
+    echo "Forgotten" > "$dir/chapter1/forgotten.md"
+    echo "Ignored" > "$dir/_ignored.md"
+}
+
+setup_orphan_cases
+
+test_check_mode "$TEST_DATA/orphaned_files" 0 "chapter1/forgotten.md: Not listed in any index file" \
+    "Orphaned file reported as a warning"
+
+test_check_mode "$TEST_DATA/multiple_errors" 1 "chapter1/missing2.md: File not found" \
+    "Single worker reports the same problems" --jobs 1
+
+test_check_mode "$TEST_DATA/minimal_valid" 1 "Jobs must be a value from 1 to 256" \
+    "Invalid job count rejected" --jobs 0
+
+# Every file's encoding is validated, and the first bad sequence is located
+setup_encoding_cases() {
+    local base_dir="$TEST_DATA/encoding_cases"
+
+    mkdir -p "$base_dir/valid"
+    echo "scene.md" > "$base_dir/valid/.index"
+    # long ASCII runs around multi-byte characters, including a 4-byte emoji
+    printf 'Plain ASCII prose that runs well past sixteen bytes.\n' > "$base_dir/valid/scene.md"
+    printf 'Caf\xc3\xa9 \xe2\x80\x9cquoted\xe2\x80\x9d \xf0\x9f\x93\x96 and more ASCII after it.\n' >> "$base_dir/valid/scene.md"
+
+    mkdir -p "$base_dir/cp1252"
+    echo "scene.md" > "$base_dir/cp1252/.index"
+    printf 'First line\nSecond line\nHe said \x93hello\x94\n' > "$base_dir/cp1252/scene.md"
+
+    mkdir -p "$base_dir/truncated"
+    echo "scene.md" > "$base_dir/truncated/.index"
+    printf 'Ends mid-character \xe2\x80' > "$base_dir/truncated/scene.md"
+
+    mkdir -p "$base_dir/overlong"
+    echo "scene.md" > "$base_dir/overlong/.index"
+    printf 'Overlong slash \xc0\xaf' > "$base_dir/overlong/scene.md"
+
+    mkdir -p "$base_dir/surrogate"
+    echo "scene.md" > "$base_dir/surrogate/.index"
+    printf 'Surrogate \xed\xa0\x80 half' > "$base_dir/surrogate/scene.md"
+}
+
+setup_encoding_cases
+
+test_check_mode "$TEST_DATA/encoding_cases/valid" 0 "Success" \
+    "Valid multi-byte UTF-8 accepted"
+
+test_check_mode "$TEST_DATA/encoding_cases/cp1252" 1 "Invalid UTF-8 sequence at byte offset 31, line 3" \
+    "Windows-1252 quote located by byte and line"
+
+test_check_mode "$TEST_DATA/encoding_cases/truncated" 1 "Invalid UTF-8 sequence at byte offset 19, line 1" \
+    "Sequence cut off at end of file rejected"
+
+test_check_mode "$TEST_DATA/encoding_cases/overlong" 1 "Invalid UTF-8 sequence at byte offset 15, line 1" \
+    "Overlong encoding rejected"
+
+test_check_mode "$TEST_DATA/encoding_cases/surrogate" 1 "Invalid UTF-8 sequence at byte offset 10, line 1" \
+    "UTF-16 surrogate rejected"
+
+# Stats are counted on the raw files while they are validated
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: --stats report written by check${NC}"
+printf 'Caf\xc3\xa9 au lait\n' > "$TEST_DATA/nested_valid/chapter1/scene1.md"
+stats_file="$TEST_DATA/check_stats.tsv"
+$COLETTE --check --stats "$stats_file" "$TEST_DATA/nested_valid" > /dev/null 2>&1
+if grep -q "$(printf 'file\tchapter1/scene1.md\t3\t13\t1')" "$stats_file" 2>/dev/null &&
+    grep -q "$(printf 'dir\tchapter1\t3\t13\t1')" "$stats_file"; then
+    echo -e "${GREEN}✓ File and directory counts correct${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Unexpected report${NC}"
+    cat "$stats_file" 2>/dev/null
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+rm -f "$stats_file"
+
 # Clean up test files
 cleanup_test_projects() {
+    rm -rf "$TEST_DATA/encoding_cases"
+    rm -rf "$TEST_DATA/orphaned_files"
+    rm -rf "$TEST_DATA/multiple_errors"
     rm -rf "$TEST_DATA/minimal_valid"
     rm -rf "$TEST_DATA/nested_valid"
     rm -rf "$TEST_DATA/no_index"
@@ -24,12 +24,13 @@ test_collate() {
     local expected_status="${2:-0}"  # Default to 0 if not provided
     local expected_content="$3"
     local test_name="$4"
+    shift 4 # any remaining arguments are passed through to colette
     
     TESTS_RUN=$((TESTS_RUN + 1))
     echo -e "\n${YELLOW}Test $TESTS_RUN: $test_name${NC}"
     
     # Run colette in collate mode
-    output=$($COLETTE "$project_dir" 2>&1)
+    output=$($COLETTE "$@" "$project_dir" 2>&1)
     status=$?
     
     # First check if the status matches expected
@@ -210,6 +211,27 @@ test_collate "$TEST_DATA/nested_project" 0 \
 Scene 2 content" \
     "Nested project collation"
 
+# entries named without an extension are resolved by trying each supported
+# one, so siblings push and pop extensions on the same path
+setup_extension_project() {
+    local dir="$TEST_DATA/extension_project"
+    mkdir -p "$dir/part1"
+    printf "part1\nafterword\n" > "$dir/.index"
+    printf "notes\nscene\n" > "$dir/part1/.index"
+    echo "Notes content" > "$dir/part1/notes.txt"
+    echo "Scene content" > "$dir/part1/scene.md"
+    echo "Afterword content" > "$dir/afterword.txt"
+}
+
+setup_extension_project
+test_collate "$TEST_DATA/extension_project/" 0 \
+    "Notes content
+
+Scene content
+
+Afterword content" \
+    "Entries resolved by extension under a root with a trailing slash"
+
 setup_large_file_project
 test_collate_length "$TEST_DATA/large_file_project" "Large file size test"
 
@@ -229,16 +251,460 @@ test_collate "$TEST_DATA/error_cases/missing_file" 1 \
     "Valid content" \
     "Missing file error handling"
 
+# entries are collated in batches; those resolved before a failure still are
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: Files before a missing entry are collated${NC}"
+$COLETTE "$TEST_DATA/error_cases/missing_file" > /dev/null 2>&1
+if [ "$(cat "$TEST_DATA/error_cases/missing_file/_draft_.md" 2>/dev/null)" = \
+    "Valid content" ]; then
+    echo -e "${GREEN}✓ Partial draft written${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Partial draft missing${NC}"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
 # Test permission error
 test_collate "$TEST_DATA/error_cases/no_permission" 1 \
     "Valid content" \
     "Permission error handling"
 
+# Encoding is only validated during collation when asked for
+setup_encoding_project() {
+    mkdir -p "$TEST_DATA/encoding_project"
+    echo "scene.md" > "$TEST_DATA/encoding_project/.index"
+    printf 'Fine\nStray \x93byte\n' > "$TEST_DATA/encoding_project/scene.md"
+}
+
+setup_encoding_project
+
+test_collate "$TEST_DATA/encoding_project" 0 \
+    "$(printf 'Fine\nStray \x93byte')" \
+    "Invalid UTF-8 copied as-is by default"
+
+test_collate "$TEST_DATA/encoding_project" 1 \
+    "" \
+    "Invalid UTF-8 rejected with --validate-utf8" --validate-utf8
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: Encoding error names file, byte and line${NC}"
+output=$($COLETTE -u "$TEST_DATA/encoding_project" 2>&1)
+if [[ "$output" == *"encoding_project/scene.md: Invalid UTF-8 sequence at byte offset 11, line 2"* ]]; then
+    echo -e "${GREEN}✓ Output matches expected${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Unexpected output:${NC}\n$output"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+# a failing file stops collation before a later missing entry is reported,
+# however the entries are batched
+printf 'scene.md\nmissing.md\n' > "$TEST_DATA/encoding_project/.index"
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: Bad file, then missing entry reports only the bad file${NC}"
+output=$($COLETTE -u "$TEST_DATA/encoding_project" 2>&1 > /dev/null)
+expected="Error combining files for $TEST_DATA/encoding_project/scene.md: Invalid UTF-8 sequence at byte offset 11, line 2"
+if [ "$output" = "$expected" ]; then
+    echo -e "${GREEN}✓ Output matches expected${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Unexpected output:${NC}\n$output"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+# UTF-16 is recognised by its byte order mark; 8-bit encodings are declared
+# in the .index and hold for the directories below it
+setup_transcode_project() {
+    local dir="$TEST_DATA/transcode_project"
+    mkdir -p "$dir/old"
+    printf "one.md\nold\n" > "$dir/.index"
+    printf '# encoding: windows-1252\ntwo.md\n' > "$dir/old/.index"
+    printf '\xff\xfeH\x00i\x00 \x00\xe9\x00\n\x00' > "$dir/one.md"
+    printf 'He said \x93hi\x94 for \x805\n' > "$dir/old/two.md"
+}
+
+setup_transcode_project
+
+test_collate "$TEST_DATA/transcode_project" 0 \
+    "$(printf 'Hi \xc3\xa9\n\nHe said \xe2\x80\x9chi\xe2\x80\x9d for \xe2\x82\xac5')" \
+    "UTF-16 and Windows-1252 sources transcoded to UTF-8" --filter bom --validate-utf8
+
+printf '# encoding: klingon\ntwo.md\n' > "$TEST_DATA/transcode_project/old/.index"
+test_collate "$TEST_DATA/transcode_project" 1 \
+    "" \
+    "Unknown encoding in .index rejected"
+
+# Header and separator templates are rendered for every file
+setup_template_project() {
+    local dir="$TEST_DATA/template_project"
+    mkdir -p "$dir/ch1"
+    printf "prologue.md\nch1\n" > "$dir/.index"
+    printf "a.md\nb.md\n" > "$dir/ch1/.index"
+    printf 'Pro\n' > "$dir/prologue.md"
+    printf 'A\n' > "$dir/ch1/a.md"
+    printf 'B\n' > "$dir/ch1/b.md"
+}
+
+setup_template_project
+
+test_collate "$TEST_DATA/template_project" 0 \
+    "$(printf '# 01.01 prologue\nPro\n\n* * *\n# 02.01 a\nA\n\n* * *\n# 02.02 b\nB\n\n* * *')" \
+    "Header and separator templates rendered per file" \
+    -p 2 -H '# {chapter}.{scene} {stem}\n' -s '\n{rule}\n'
+
+test_collate "$TEST_DATA/template_project" 1 \
+    "" \
+    "Unknown template variable rejected" --separator '{title}'
+
+# The table of contents is gathered while collating and put in front
+setup_toc_project() {
+    local dir="$TEST_DATA/toc_project"
+    mkdir -p "$dir/ch1"
+    printf "intro.md\nch1\n" > "$dir/.index"
+    printf "a.md\n" > "$dir/ch1/.index"
+    printf '# Intro\n\n```\n# not a heading\n```\n' > "$dir/intro.md"
+    printf 'The Storm\n=========\n\n## It Rains!\n' > "$dir/ch1/a.md"
+}
+
+setup_toc_project
+
+test_collate "$TEST_DATA/toc_project" 0 \
+    "$(printf '# Contents\n\n- [Intro](#intro)\n- ch1\n  - [The Storm](#the-storm)\n    - [It Rains!](#it-rains)\n\n# Intro\n\n```\n# not a heading\n```\n\nThe Storm\n=========\n\n## It Rains!')" \
+    "Table of contents built from headings and directories" --toc
+
+# Sources are hashed as they are copied; --verify hashes them again
+setup_manifest_project() {
+    local dir="$TEST_DATA/manifest_project"
+    mkdir -p "$dir/ch1"
+    printf "intro.md\nch1\n" > "$dir/.index"
+    printf "a.md\n" > "$dir/ch1/.index"
+    printf 'Intro\n' > "$dir/intro.md"
+    printf 'Scene\n' > "$dir/ch1/a.md"
+}
+
+setup_manifest_project
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: --verify passes until a source changes${NC}"
+dir="$TEST_DATA/manifest_project"
+$COLETTE --manifest "$dir" > /dev/null 2>&1
+rows=$(cut -f 2 "$dir/_draft_.manifest.tsv" 2>/dev/null | tr '\n' ' ')
+$COLETTE --verify "$dir/_draft_.md" "$dir" > /dev/null 2>&1
+clean_status=$?
+printf 'Scene, revised\n' > "$dir/ch1/a.md"
+changes=$($COLETTE --verify "$dir/_draft_.md" "$dir" 2>&1)
+changed_status=$?
+if [ "$rows" = "path _draft_.md intro.md ch1/a.md " ] &&
+    [ $clean_status -eq 0 ] && [ $changed_status -eq 1 ] &&
+    [ "$changes" = "$(printf 'changed\tch1/a.md')" ]; then
+    echo -e "${GREEN}✓ Changed source reported${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Unexpected verification${NC}\n$rows\n$clean_status $changed_status\n$changes"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+test_collate "$TEST_DATA/manifest_project" 1 \
+    "Conflicting options" \
+    "Manifest and table of contents together rejected" --manifest --toc
+
+# each level's path and index buffer come off one arena; long names make the
+# levels span several blocks, which sibling branches then reuse
+setup_deep_project() {
+    local dir="$TEST_DATA/deep_project"
+    local long
+    long=$(printf 'n%.0s' {1..200})
+    mkdir -p "$dir"
+    printf "one\ntwo\n" > "$dir/.index"
+    for branch in one two; do
+        local path="$dir/$branch"
+        for level in 1 2 3; do
+            mkdir -p "$path/$long$level"
+            printf "%s\n" "$long$level" > "$path/.index"
+            path="$path/$long$level"
+        done
+        printf "leaf.md\n" > "$path/.index"
+        printf '%s\n' "$branch" > "$path/leaf.md"
+    done
+}
+
+setup_deep_project
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: Deep sibling directories collate in order${NC}"
+$COLETTE "$TEST_DATA/deep_project" > /dev/null 2>&1
+if [ "$(grep -v '^$' "$TEST_DATA/deep_project/_draft_.md" 2>/dev/null |
+    tr '\n' ' ')" = "one two " ]; then
+    echo -e "${GREEN}✓ Both branches collated${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Unexpected draft${NC}"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+# HTML is rendered per file and stitched in index order
+setup_html_project() {
+    local dir="$TEST_DATA/html_project"
+    mkdir -p "$dir/ch1"
+    printf "intro.md\nch1\n" > "$dir/.index"
+    printf "a.md\nb.md\n" > "$dir/ch1/.index"
+    printf -- '---\npov: Ann\n---\n# Intro & *More*\n\nSome **bold** `<code>`,  \nthen a [link](http://x.org).\n\n> Quoted\n' \
+        > "$dir/intro.md"
+    printf 'The Storm\n=========\n\n- one\n- two\n\n```c\nx < 1;\n```\n' > "$dir/ch1/a.md"
+    printf '* * *\n\n3. three\n' > "$dir/ch1/b.md"
+}
+
+setup_html_project
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: --format html renders one document${NC}"
+expected_html=$(printf '%s\n' \
+    '<!DOCTYPE html>' '<html>' '<head>' '<meta charset="utf-8">' \
+    '<title>draft</title>' '</head>' '<body>' \
+    '<h1>Intro &amp; <em>More</em></h1>' \
+    '<p>Some <strong>bold</strong> <code>&lt;code&gt;</code>,<br />' \
+    'then a <a href="http://x.org">link</a>.</p>' \
+    '<blockquote>' '<p>Quoted</p>' '</blockquote>' \
+    '<h1>The Storm</h1>' '<ul>' '<li>one</li>' '<li>two</li>' '</ul>' \
+    '<pre><code class="language-c">x &lt; 1;' '</code></pre>' \
+    '<hr />' '<ol start="3">' '<li>three</li>' '</ol>' \
+    '</body>' '</html>')
+$COLETTE --format html -j 2 "$TEST_DATA/html_project" > /dev/null 2>&1
+html=$(cat "$TEST_DATA/html_project/_draft_.html" 2>/dev/null)
+if [ "$html" = "$expected_html" ]; then
+    echo -e "${GREEN}✓ Document matches expected${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Document mismatch${NC}\n$html"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: --format html-chapters writes a document per chapter${NC}"
+$COLETTE --format html-chapters -p 2 "$TEST_DATA/html_project" > /dev/null 2>&1
+chapters=$(cd "$TEST_DATA/html_project/_draft_" 2>/dev/null && ls)
+if [ "$chapters" = "$(printf '01_intro.html\n02_ch1.html')" ] &&
+    grep -q '<title>ch1</title>' "$TEST_DATA/html_project/_draft_/02_ch1.html" &&
+    ! grep -q 'Intro' "$TEST_DATA/html_project/_draft_/02_ch1.html"; then
+    echo -e "${GREEN}✓ Chapters split at top-level entries${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Unexpected chapter files${NC}\n$chapters"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: --format epub writes a book with a chapter per entry${NC}"
+$COLETTE --format epub -j 2 "$TEST_DATA/html_project" > /dev/null 2>&1
+book="$TEST_DATA/html_project/_draft_.epub"
+# the stored mimetype entry must come first, at a fixed offset
+mimetype=$(head -c 58 "$book" 2>/dev/null | tail -c 28)
+members=""
+if command -v python3 > /dev/null 2>&1; then
+    members=$(python3 -c '
+import sys, zipfile
+z = zipfile.ZipFile(sys.argv[1])
+assert z.testzip() is None
+print(" ".join(z.namelist()))
+assert "<title>ch1</title>" in z.read("OEBPS/chapter-002.xhtml").decode()
+assert z.read("OEBPS/content.opf").decode().count("<itemref") == 2
+' "$book" 2>/dev/null)
+else
+    members="skipped"
+fi
+if [ "$mimetype" = "mimetypeapplication/epub+zip" ] &&
+    { [ "$members" = "skipped" ] ||
+        [ "$members" = "mimetype META-INF/container.xml OEBPS/chapter-001.xhtml OEBPS/chapter-002.xhtml OEBPS/nav.xhtml OEBPS/content.opf" ]; }; then
+    echo -e "${GREEN}✓ Book holds the chapters in index order${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Unexpected book contents${NC}\n$mimetype\n$members"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+test_collate "$TEST_DATA/html_project" 1 \
+    "" \
+    "Markdown-only options rejected with --format html" --format html --toc
+
+# Text filters transform files in the same pass that copies them
+setup_filter_project() {
+    mkdir -p "$TEST_DATA/filter_project"
+    echo "scene.md" > "$TEST_DATA/filter_project/.index"
+    printf '\xef\xbb\xbfShe said "it\x27s late."  \r\n\r\n\r\n\r\nThe end.\t\r\n' \
+        > "$TEST_DATA/filter_project/scene.md"
+}
+
+setup_filter_project
+
+test_collate "$TEST_DATA/filter_project" 0 \
+    "$(printf 'She said \xe2\x80\x9cit\xe2\x80\x99s late.\xe2\x80\x9d\n\nThe end.')" \
+    "All text filters applied in one pass" --filter all
+
+test_collate "$TEST_DATA/filter_project" 0 \
+    "$(printf '\xef\xbb\xbfShe said "it\x27s late."  \n\n\n\nThe end.\t')" \
+    "Only the selected filter is applied" --filter crlf
+
+test_collate "$TEST_DATA/filter_project" 1 \
+    "" \
+    "Unknown filter name rejected" --filter crlf,nonsense
+
+# Front matter is split off while streaming and collected into a table
+setup_metadata_project() {
+    local dir="$TEST_DATA/metadata_project"
+    mkdir -p "$dir"
+    printf "one.md\ntwo.md\nthree.md\n" > "$dir/.index"
+    printf -- '---\npov: Ann\nstatus: draft\n---\nScene one.\n' > "$dir/one.md"
+    printf -- '---\nstatus: cut\ntarget: "1500"\n---\nScene two.\n' > "$dir/two.md"
+    printf 'Scene three.\n' > "$dir/three.md"
+}
+
+setup_metadata_project
+
+test_collate "$TEST_DATA/metadata_project" 0 \
+    "$(printf 'Scene one.\n\nScene two.\n\nScene three.')" \
+    "Front matter stripped with --metadata" --metadata
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: Metadata table written in draft order${NC}"
+expected_table=$(printf 'path\tpov\tstatus\ttarget\none.md\tAnn\tdraft\t\ntwo.md\t\tcut\t1500\nthree.md\t\t\t')
+table=$(cat "$TEST_DATA/metadata_project/_draft_.meta.tsv" 2>/dev/null)
+if [ "$table" = "$expected_table" ]; then
+    echo -e "${GREEN}✓ Table matches expected${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Table mismatch${NC}\n$table"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+test_collate "$TEST_DATA/metadata_project" 0 \
+    "$(printf 'Scene one.\n\nScene three.')" \
+    "Files matching --exclude left out of the draft" --exclude status=cut
+
+test_collate "$TEST_DATA/metadata_project" 1 \
+    "" \
+    "Exclude rule without a value separator rejected" --exclude status
+
+setup_stats_project() {
+    local dir="$TEST_DATA/stats_project"
+    mkdir -p "$dir/part"
+    printf "intro.md\npart\n" > "$dir/.index"
+    printf "one.md\ntwo.md\n" > "$dir/part/.index"
+    printf 'Two  words\n' > "$dir/intro.md"
+    printf 'Caf\xc3\xa9 au lait\nsecond line\n' > "$dir/part/one.md"
+    printf '\tthree\nsplit words' > "$dir/part/two.md"
+}
+
+setup_stats_project
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: --stats counts files and rolls up directories${NC}"
+expected_stats=$(printf 'type\tpath\twords\tchars\tlines\ndir\t.\t10\t54\t4\nfile\tintro.md\t2\t11\t1\ndir\tpart\t8\t43\t3\nfile\tpart/one.md\t5\t25\t2\nfile\tpart/two.md\t3\t18\t1')
+stats=$($COLETTE --stats - "$TEST_DATA/stats_project" 2>&1)
+if [ "$stats" = "$expected_stats" ]; then
+    echo -e "${GREEN}✓ Report matches expected${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Report mismatch${NC}\n$stats"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+setup_analyze_project() {
+    local dir="$TEST_DATA/analyze_project"
+    mkdir -p "$dir/ch1"
+    printf "intro.md\nch1\n" > "$dir/.index"
+    printf "s1.md\ns2.md\n" > "$dir/ch1/.index"
+    printf '# Intro\n\nThe old lighthouse stood alone. It was dark.\n' > "$dir/intro.md"
+    printf '"Where is the lighthouse?" she asked. He didn'"'"'t know.\n\nThe old lighthouse keeper slept.\n' \
+        > "$dir/ch1/s1.md"
+    # curly quotes, ellipsis and apostrophe
+    printf '\xe2\x80\x9cThe old lighthouse keeper,\xe2\x80\x9d she said\xe2\x80\xa6 Nobody\xe2\x80\x99s home!\n' \
+        > "$dir/ch1/s2.md"
+}
+
+setup_analyze_project
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: --analyze reports scenes and merges chapters${NC}"
+expected_analysis=$(printf '%s\n' \
+    $'type\tpath\twords\tsentences\tmean-sentence\tdialogue\tlengths\ttop-words\ttop-phrases' \
+    $'dir\t.\t31\t9\t3.4\t25%\t8/1/0/0/0\tlighthouse:4,old:3,keeper:2,alone:1,asked:1,dark:1,didn\'t:1,home:1,intro:1,know:1\tthe old lighthouse:3,old lighthouse keeper:2' \
+    $'file\tintro.md\t9\t3\t3.0\t0%\t3/0/0/0/0\talone:1,dark:1,intro:1,lighthouse:1,old:1,stood:1\t-' \
+    $'dir\tch1\t22\t6\t3.7\t36%\t5/1/0/0/0\tlighthouse:3,keeper:2,old:2,asked:1,didn\'t:1,home:1,know:1,nobody\'s:1,said:1,slept:1\told lighthouse keeper:2,the old lighthouse:2' \
+    $'file\tch1/s1.md\t14\t4\t3.5\t28%\t4/0/0/0/0\tlighthouse:2,asked:1,didn\'t:1,keeper:1,know:1,old:1,slept:1,where:1\t-' \
+    $'file\tch1/s2.md\t8\t2\t4.0\t50%\t1/1/0/0/0\thome:1,keeper:1,lighthouse:1,nobody\'s:1,old:1,said:1\t-')
+analysis=$($COLETTE --analyze "$TEST_DATA/analyze_project" 2>&1)
+if [ "$analysis" = "$expected_analysis" ]; then
+    echo -e "${GREEN}✓ Report matches expected${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Report mismatch${NC}\n$analysis"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+test_collate "$TEST_DATA/analyze_project" 1 \
+    "Conflicting options" \
+    "Analysis and stats reports together rejected" --analyze --stats -
+
+# Drafts written by the writer thread, from files opened ahead, match the
+# single-threaded path
+test_pipelined_draft() {
+    local project="$1"
+    local test_name="$2"
+    shift 2
+
+    TESTS_RUN=$((TESTS_RUN + 1))
+    echo -e "\n${YELLOW}Test $TESTS_RUN: $test_name${NC}"
+    $COLETTE -j 1 "$@" --readahead 0 "$project" > /dev/null 2>&1
+    cp "$project/_draft_.md" "$TEST_DATA/serial_draft.md" 2>/dev/null
+    $COLETTE -j 4 "$@" "$project" > /dev/null 2>&1
+    if [ -s "$TEST_DATA/serial_draft.md" ] &&
+        cmp -s "$project/_draft_.md" "$TEST_DATA/serial_draft.md"; then
+        echo -e "${GREEN}✓ Drafts are byte-identical${NC}"
+        TESTS_PASSED=$((TESTS_PASSED + 1))
+    else
+        echo -e "${RED}✗ Drafts differ${NC}"
+        TESTS_FAILED=$((TESTS_FAILED + 1))
+    fi
+    rm -f "$TEST_DATA/serial_draft.md"
+}
+
+GEN_PROJECT="$PROJECT_ROOT/bin/gen_project"
+if [ ! -x "$GEN_PROJECT" ]; then
+    echo -e "${YELLOW}Skipping pipeline tests (needs 'make tools')${NC}"
+else
+    # a few megabytes, so the writer's buffer ring wraps many times
+    "$GEN_PROJECT" --seed 3 --depth 2 --fanout 3 --files 6 --size 40000 \
+        --dist pareto "$TEST_DATA/pipeline_project" > /dev/null
+    test_pipelined_draft "$TEST_DATA/pipeline_project" \
+        "Pipelined draft matches the serial draft"
+    test_pipelined_draft "$TEST_DATA/pipeline_project" \
+        "Pipelined draft matches with filters, headers and contents" \
+        --filter all --header '# {stem}\n' --toc
+    test_pipelined_draft "$TEST_DATA/pipeline_project" \
+        "Draft matches with a readahead of one file" --readahead 1
+    test_collate "$TEST_DATA/pipeline_project" 1 \
+        "Readahead must be" \
+        "Readahead beyond the limit rejected" --readahead 257
+    rm -rf "$TEST_DATA/pipeline_project"
+fi
+
 # Clean up
 cleanup_test_projects() {
+    rm -rf "$TEST_DATA/stats_project"
+    rm -rf "$TEST_DATA/analyze_project"
+    rm -rf "$TEST_DATA/metadata_project"
+    rm -rf "$TEST_DATA/filter_project"
+    rm -rf "$TEST_DATA/encoding_project"
+    rm -rf "$TEST_DATA/transcode_project"
+    rm -rf "$TEST_DATA/template_project"
+    rm -rf "$TEST_DATA/toc_project"
+    rm -rf "$TEST_DATA/manifest_project"
+    rm -rf "$TEST_DATA/deep_project"
+    rm -rf "$TEST_DATA/html_project"
     chmod 666 "$TEST_DATA/error_cases/no_permission/file.md"
     rm -rf "$TEST_DATA/simple_project"
     rm -rf "$TEST_DATA/nested_project"
+    rm -rf "$TEST_DATA/extension_project"
     rm -rf "$TEST_DATA/edge_cases"
     rm -rf "$TEST_DATA/error_cases"
 }
@@ -0,0 +1,51 @@
+/* *
+ * evict_cache -- drops a directory tree's files from the page cache.
+ *
+ * Every regular file under each argument is synced and then hinted
+ * POSIX_FADV_DONTNEED, so the next read of it goes to the disk. Lets the
+ * benchmark time cold-cache runs without root or drop_caches. The kernel may
+ * keep pages it can't drop (mapped, or on file systems without a page cache),
+ * so cold numbers are a best effort.
+ *
+ * Usage: evict_cache DIR...
+ * */
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static int evictFile(const char *path,
+                     const struct stat *statBuf,
+                     int type,
+                     struct FTW *ftw) {
+    (void)statBuf;
+    (void)ftw;
+    if (type != FTW_F) {
+        return 0;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0; // nothing cached that we could drop either
+    }
+    fdatasync(fd); // dirty pages can't be dropped
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: evict_cache DIR...\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        if (nftw(argv[i], evictFile, 16, FTW_PHYS) != 0) {
+            perror(argv[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
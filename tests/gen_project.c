@@ -0,0 +1,380 @@
+/* *
+ * gen_project -- deterministic synthetic writing project generator.
+ *
+ * Builds a tree of directories, project files and .index files that colette
+ * can initialize, check and collate. Output depends only on the options and
+ * the seed, so the same invocation always produces byte-identical projects on
+ * every platform. Used by the benchmark suite and the syscall budget tests.
+ * */
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define GEN_PATH_BUF_SIZE 4096
+
+enum SizeDistribution {
+    SIZE_FIXED,   // every file is exactly avgSize bytes
+    SIZE_UNIFORM, // uniform in [avgSize / 2, avgSize * 3 / 2]
+    SIZE_PARETO,  // heavy tailed: most files small, a few very large
+};
+
+struct GenOptions {
+    const char *outDir;
+    uint64_t seed;
+    unsigned int depth;          // levels of nested directories below root
+    unsigned int fanout;         // subdirectories per directory
+    unsigned int filesPerDir;    // project files per directory
+    size_t avgSize;              // average file size in bytes
+    enum SizeDistribution dist;  // file size distribution
+    double commentDensity;       // chance of a comment/blank line per entry
+    double extensionlessRatio;   // chance an index entry omits its extension
+    bool writeIndex;             // write .index files (off to bench --init)
+};
+
+struct GenTotals {
+    unsigned long dirs;
+    unsigned long files;
+    unsigned long long bytes;
+};
+
+static const char *USAGE_STRING =
+    "Usage: gen_project [OPTIONS] OUTPUT_DIR\n"
+    "\n"
+    "Options:\n"
+    "  -s, --seed NUMBER        PRNG seed (default: 1)\n"
+    "  -d, --depth NUMBER       Directory nesting below root (default: 2)\n"
+    "  -f, --fanout NUMBER      Subdirectories per directory (default: 3)\n"
+    "  -n, --files NUMBER       Project files per directory (default: 5)\n"
+    "  -b, --size BYTES         Average file size (default: 4096)\n"
+    "  -D, --dist NAME          fixed, uniform or pareto (default: uniform)\n"
+    "  -c, --comments RATIO     Comment density in .index files (default: 0.1)\n"
+    "  -e, --extensionless RATIO\n"
+    "                           Share of extensionless entries (default: 0.2)\n"
+    "  -I, --no-index           Do not write .index files\n";
+
+static struct option longOpts[] = {
+    {"seed", required_argument, NULL, 's'},
+    {"depth", required_argument, NULL, 'd'},
+    {"fanout", required_argument, NULL, 'f'},
+    {"files", required_argument, NULL, 'n'},
+    {"size", required_argument, NULL, 'b'},
+    {"dist", required_argument, NULL, 'D'},
+    {"comments", required_argument, NULL, 'c'},
+    {"extensionless", required_argument, NULL, 'e'},
+    {"no-index", no_argument, NULL, 'I'},
+    {0, 0, 0, 0}};
+
+static const char *WORDS[] = {
+    "the",     "and",     "she",     "he",      "said",    "was",
+    "that",    "her",     "his",     "in",      "of",      "to",
+    "a",       "light",   "window",  "river",   "letter",  "quiet",
+    "morning", "never",   "because", "almost",  "remembered", "door",
+    "across",  "voice",   "garden",  "winter",  "through", "small",
+    "already", "station", "hands",   "breath",  "coffee",  "shadow",
+    "careful", "city",    "stairs",  "waiting", "tomorrow", "café",
+    "naïve",   "over",    "under",   "between", "without", "before",
+};
+
+#define WORD_COUNT (sizeof(WORDS) / sizeof(WORDS[0]))
+
+/* *
+ * xorshift64* -- small, fast and identical on every platform, unlike rand().
+ * */
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+static double nextUnit(uint64_t *state) {
+    return (double)(nextRandom(state) >> 11) / (double)(1ULL << 53);
+}
+
+static size_t pickSize(const struct GenOptions *opts, uint64_t *rng) {
+    size_t avg = opts->avgSize;
+    switch (opts->dist) {
+    case SIZE_FIXED:
+        return avg;
+    case SIZE_UNIFORM:
+        return avg / 2 + (size_t)(nextUnit(rng) * (double)avg);
+    case SIZE_PARETO: {
+        // alpha = 2 gives a mean of 2 * xm, so xm = avg / 2
+        double u = 1.0 - nextUnit(rng);
+        double size = (double)(avg / 2) / sqrt(u);
+        if (size > (double)avg * 64) {
+            size = (double)avg * 64;
+        }
+        return (size_t)size;
+    }
+    }
+    return avg;
+}
+
+static int writeProse(FILE *file, size_t size, uint64_t *rng) {
+    size_t written = 0;
+    size_t lineLen = 0;
+    bool sentenceStart = true;
+
+    while (written < size) {
+        const char *word = WORDS[nextRandom(rng) % WORD_COUNT];
+        size_t wordLen = strlen(word);
+
+        if (lineLen > 0) {
+            if (lineLen + wordLen > 72) {
+                // blank line between paragraphs every so often
+                const char *breakStr = (nextRandom(rng) % 6 == 0) ? "\n\n" : "\n";
+                fputs(breakStr, file);
+                written += strlen(breakStr);
+                lineLen = 0;
+            } else {
+                fputc(' ', file);
+                written++;
+                lineLen++;
+            }
+        }
+
+        if (sentenceStart && word[0] >= 'a' && word[0] <= 'z') {
+            fputc(word[0] - 'a' + 'A', file);
+            fputs(word + 1, file);
+        } else {
+            fputs(word, file);
+        }
+        written += wordLen;
+        lineLen += wordLen;
+
+        sentenceStart = (nextRandom(rng) % 9 == 0);
+        if (sentenceStart) {
+            fputc('.', file);
+            written++;
+            lineLen++;
+        }
+    }
+
+    fputc('\n', file);
+    return ferror(file) ? -1 : 0;
+}
+
+static int joinGenPath(char *buffer, const char *dir, const char *name) {
+    int len = snprintf(buffer, GEN_PATH_BUF_SIZE, "%s/%s", dir, name);
+    if (len < 0 || len >= GEN_PATH_BUF_SIZE) {
+        fprintf(stderr, "gen_project: path too long under %s\n", dir);
+        return -1;
+    }
+    return 0;
+}
+
+static void writeIndexNoise(FILE *indexFile,
+                            const struct GenOptions *opts,
+                            uint64_t *rng) {
+    if (!indexFile || nextUnit(rng) >= opts->commentDensity) {
+        return;
+    }
+    if (nextRandom(rng) % 2 == 0) {
+        fputs("\n", indexFile);
+    } else {
+        fputs("# TODO revisit this section\n", indexFile);
+    }
+}
+
+static int generateDir(const char *dir,
+                       unsigned int level,
+                       const struct GenOptions *opts,
+                       uint64_t *rng,
+                       struct GenTotals *totals) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "gen_project: mkdir %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    totals->dirs++;
+
+    char path[GEN_PATH_BUF_SIZE];
+    FILE *indexFile = NULL;
+    if (opts->writeIndex) {
+        if (joinGenPath(path, dir, ".index") != 0) {
+            return -1;
+        }
+        indexFile = fopen(path, "w");
+        if (!indexFile) {
+            fprintf(stderr, "gen_project: open %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+    }
+
+    for (unsigned int i = 0; i < opts->filesPerDir; i++) {
+        char name[64];
+        char stem[32];
+        snprintf(stem, sizeof(stem), "scene-%03u", i + 1);
+        snprintf(name, sizeof(name), "%s.md", stem);
+        if (joinGenPath(path, dir, name) != 0) {
+            goto fail;
+        }
+
+        FILE *file = fopen(path, "w");
+        if (!file) {
+            fprintf(stderr, "gen_project: open %s: %s\n", path, strerror(errno));
+            goto fail;
+        }
+        size_t size = pickSize(opts, rng);
+        int status = writeProse(file, size, rng);
+        long fileBytes = ftell(file);
+        fclose(file);
+        if (status != 0) {
+            fprintf(stderr, "gen_project: write %s failed\n", path);
+            goto fail;
+        }
+        totals->files++;
+        totals->bytes += fileBytes > 0 ? (unsigned long long)fileBytes : 0;
+
+        writeIndexNoise(indexFile, opts, rng);
+        if (indexFile) {
+            bool bare = nextUnit(rng) < opts->extensionlessRatio;
+            fprintf(indexFile, "%s\n", bare ? stem : name);
+        }
+    }
+
+    if (level < opts->depth) {
+        for (unsigned int i = 0; i < opts->fanout; i++) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s-%02u", level == 0 ? "part" : "chapter", i + 1);
+            if (joinGenPath(path, dir, name) != 0) {
+                goto fail;
+            }
+            writeIndexNoise(indexFile, opts, rng);
+            if (indexFile) {
+                fprintf(indexFile, "%s\n", name);
+            }
+            if (generateDir(path, level + 1, opts, rng, totals) != 0) {
+                goto fail;
+            }
+        }
+    }
+
+    if (indexFile && fclose(indexFile) != 0) {
+        return -1;
+    }
+    return 0;
+
+fail:
+    if (indexFile) {
+        fclose(indexFile);
+    }
+    return -1;
+}
+
+static bool parseUnsigned(const char *str, unsigned long long *out) {
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(str, &end, 10);
+    if (errno != 0 || end == str || *end != '\0') {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+static bool parseRatio(const char *str, double *out) {
+    char *end;
+    errno = 0;
+    double value = strtod(str, &end);
+    if (errno != 0 || end == str || *end != '\0' || value < 0.0 || value > 1.0) {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    struct GenOptions opts = {.outDir = NULL,
+                              .seed = 1,
+                              .depth = 2,
+                              .fanout = 3,
+                              .filesPerDir = 5,
+                              .avgSize = 4096,
+                              .dist = SIZE_UNIFORM,
+                              .commentDensity = 0.1,
+                              .extensionlessRatio = 0.2,
+                              .writeIndex = true};
+
+    int opt;
+    unsigned long long value;
+    bool valid = true;
+    while ((opt = getopt_long(argc, argv, "s:d:f:n:b:D:c:e:I", longOpts, NULL)) !=
+           -1) {
+        switch (opt) {
+        case 's':
+            valid = parseUnsigned(optarg, &value);
+            opts.seed = value ? value : 1; // xorshift state must be nonzero
+            break;
+        case 'd':
+            valid = parseUnsigned(optarg, &value) && value <= 16;
+            opts.depth = (unsigned int)value;
+            break;
+        case 'f':
+            valid = parseUnsigned(optarg, &value) && value <= 1000;
+            opts.fanout = (unsigned int)value;
+            break;
+        case 'n':
+            valid = parseUnsigned(optarg, &value) && value <= 100000;
+            opts.filesPerDir = (unsigned int)value;
+            break;
+        case 'b':
+            valid = parseUnsigned(optarg, &value) && value > 0;
+            opts.avgSize = (size_t)value;
+            break;
+        case 'D':
+            if (strcmp(optarg, "fixed") == 0) {
+                opts.dist = SIZE_FIXED;
+            } else if (strcmp(optarg, "uniform") == 0) {
+                opts.dist = SIZE_UNIFORM;
+            } else if (strcmp(optarg, "pareto") == 0) {
+                opts.dist = SIZE_PARETO;
+            } else {
+                valid = false;
+            }
+            break;
+        case 'c':
+            valid = parseRatio(optarg, &opts.commentDensity);
+            break;
+        case 'e':
+            valid = parseRatio(optarg, &opts.extensionlessRatio);
+            break;
+        case 'I':
+            opts.writeIndex = false;
+            break;
+        default:
+            valid = false;
+        }
+
+        if (!valid) {
+            fprintf(stderr, "%s", USAGE_STRING);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "%s", USAGE_STRING);
+        return EXIT_FAILURE;
+    }
+    opts.outDir = argv[optind];
+
+    uint64_t rng = opts.seed;
+    struct GenTotals totals = {0};
+    if (generateDir(opts.outDir, 0, &opts, &rng, &totals) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    printf("dirs=%lu files=%lu bytes=%llu\n",
+           totals.dirs,
+           totals.files,
+           totals.bytes);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+#!/bin/bash
+
+# Initialize test counters (required by run_tests.sh)
+TESTS_RUN=0
+TESTS_PASSED=0
+TESTS_FAILED=0
+
+# Test helper that runs a search subcommand (grep or lookup) and compares
+# stdout with the expected matches
+test_search() {
+    local subcommand="$1"
+    local project_dir="$2"
+    local expected_status="$3"
+    local expected_output="$4"
+    local test_name="$5"
+    shift 5 # remaining arguments go to the subcommand before the directory
+
+    TESTS_RUN=$((TESTS_RUN + 1))
+    echo -e "\n${YELLOW}Test $TESTS_RUN: $test_name${NC}"
+
+    local output
+    output=$($COLETTE "$subcommand" "$@" "$project_dir" 2> /dev/null)
+    local status=$?
+
+    if [ $status -eq "$expected_status" ] && [ "$output" = "$expected_output" ]; then
+        echo -e "${GREEN}✓ Status $status and matches correct${NC}"
+        TESTS_PASSED=$((TESTS_PASSED + 1))
+    else
+        echo -e "${RED}✗ Expected status $expected_status with:${NC}\n$expected_output"
+        echo -e "${RED}Got status $status with:${NC}\n$output"
+        TESTS_FAILED=$((TESTS_FAILED + 1))
+    fi
+}
+
+setup_grep_project() {
+    local dir="$TEST_DATA/grep_project"
+    mkdir -p "$dir/chapter1"
+
+    printf "intro.md\nchapter1\n" > "$dir/.index"
+    printf "scene2.md\nscene1.md\n" > "$dir/chapter1/.index"
+
+    printf 'The lighthouse\nkeeper slept.\n' > "$dir/intro.md"
+    printf 'No light here.\n' > "$dir/chapter1/scene1.md"
+    printf 'A light, a light!\nDark.\nlight' > "$dir/chapter1/scene2.md"
+    # on disk but in no index, so never searched
+    printf 'light\n' > "$dir/chapter1/orphan.md"
+}
+
+setup_grep_project
+
+# Each file is followed by a line feed in the draft: intro.md (29 bytes,
+# 2 lines) starts at 0, scene2.md (29 bytes, 2 lines) at 30 and scene1.md at 60
+test_search grep "$TEST_DATA/grep_project" 0 \
+    "$(printf 'intro.md:1:1:4:The lighthouse\nchapter1/scene2.md:1:4:32:A light, a light!\nchapter1/scene2.md:3:6:54:light\nchapter1/scene1.md:1:7:63:No light here.')" \
+    "Matches reported in index order with draft positions" light
+
+test_search grep "$TEST_DATA/grep_project" 0 \
+    "$(printf 'intro.md:2:2:19:keeper slept.')" \
+    "Pattern spanning words" "er sl"
+
+test_search grep "$TEST_DATA/grep_project" 0 "" \
+    "No matches prints nothing" "lamp"
+
+test_search grep "$TEST_DATA/grep_project" 1 "" \
+    "Empty pattern rejected" ""
+
+# positions are in the plain draft, so options that change it don't apply
+test_search grep "$TEST_DATA/grep_project" 1 "" \
+    "Header template rejected" -H '# {name}\n' light
+
+test_search grep "$TEST_DATA/grep_project" 1 "" \
+    "Collation filters rejected" --filter trim light
+
+# Word index: whole words only, case-insensitive, kept current on lookup
+test_search lookup "$TEST_DATA/grep_project" 0 \
+    "$(printf 'chapter1/scene2.md:1:4:32\nchapter1/scene2.md:1:4:41\nchapter1/scene2.md:3:6:54\nchapter1/scene1.md:1:7:63')" \
+    "Lookup builds the index and returns words in draft order" LIGHT
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: Index written to the project root${NC}"
+if [ -s "$TEST_DATA/grep_project/_search_.idx" ]; then
+    echo -e "${GREEN}✓ _search_.idx exists${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ _search_.idx missing${NC}"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+# change one file and move another; lookups follow without a rebuild
+printf "scene1.md\nscene2.md\n" > "$TEST_DATA/grep_project/chapter1/.index"
+printf 'Light!\n' > "$TEST_DATA/grep_project/chapter1/scene1.md"
+$COLETTE index "$TEST_DATA/grep_project" > /dev/null 2>&1
+
+test_search lookup "$TEST_DATA/grep_project" 0 \
+    "$(printf 'chapter1/scene1.md:1:4:30\nchapter1/scene2.md:1:6:40\nchapter1/scene2.md:1:6:49\nchapter1/scene2.md:3:8:62')" \
+    "Index updated after files change and move" light
+
+test_search lookup "$TEST_DATA/grep_project" 1 "" \
+    "Lookup of a phrase rejected" "light here"
+
+test_search lookup "$TEST_DATA/grep_project" 1 "" \
+    "Lookup of a word with punctuation rejected" "light!"
+
+printf 'garbage' > "$TEST_DATA/grep_project/_search_.idx"
+test_search lookup "$TEST_DATA/grep_project" 0 \
+    "$(printf 'chapter1/scene1.md:1:4:30\nchapter1/scene2.md:1:6:40\nchapter1/scene2.md:1:6:49\nchapter1/scene2.md:3:8:62')" \
+    "Unreadable index rebuilt" light
+
+setup_quotes_project() {
+    local dir="$TEST_DATA/quotes_project"
+    mkdir -p "$dir"
+    printf "dialogue.md\n" > "$dir/.index"
+    printf '“Hello,” she said—quietly. Don’t. Hello again.\n' > "$dir/dialogue.md"
+}
+
+setup_quotes_project
+
+test_search lookup "$TEST_DATA/quotes_project" 0 \
+    "$(printf 'dialogue.md:1:1:3\ndialogue.md:1:1:42')" \
+    "Curly quotes split words" hello
+
+test_search lookup "$TEST_DATA/quotes_project" 0 \
+    "$(printf 'dialogue.md:1:1:24')" \
+    "Dashes split words" quietly
+
+test_search lookup "$TEST_DATA/quotes_project" 0 \
+    "$(printf 'dialogue.md:1:1:33')" \
+    "Apostrophe inside a word kept" "don’t"
+
+setup_utf16_project() {
+    local dir="$TEST_DATA/utf16_project"
+    mkdir -p "$dir"
+    printf "a.md\nb.md\n" > "$dir/.index"
+    # collated as a UTF-8 byte order mark and 12 bytes of text
+    printf '\xff\xfeh\0e\0l\0l\0o\0 \0w\0o\0r\0l\0d\0\n\0' > "$dir/a.md"
+    printf 'say hello\n' > "$dir/b.md"
+}
+
+setup_utf16_project
+
+test_search grep "$TEST_DATA/utf16_project" 0 \
+    "$(printf 'a.md:1:1:3:\xef\xbb\xbfhello world\nb.md:1:3:20:say hello')" \
+    "UTF-16 file searched as collated" hello
+
+test_search lookup "$TEST_DATA/utf16_project" 0 \
+    "$(printf 'a.md:1:1:3\nb.md:1:3:20')" \
+    "UTF-16 file indexed as collated" hello
+
+setup_dupes_project() {
+    local dir="$TEST_DATA/dupes_project"
+    mkdir -p "$dir/notes"
+
+    printf "a.md\nnotes\n" > "$dir/.index"
+    printf "b.md\n" > "$dir/notes/.index"
+
+    local passage="It was the best of times, it was the worst of times, it was the age of wisdom, it was the age of foolishness, it was the epoch of belief, it was the epoch of incredulity, it was the season of Light, it was the season of Darkness, it was the spring of hope, it was the winter of despair."
+    printf 'Opening line.\nSomething about whales and ships.\n%s\nMore about gardens.\n' \
+        "$passage" > "$dir/a.md"
+    # the same passage re-wrapped, one word re-cased
+    printf 'Different start about mountains.\n\n%s\n\nThe end.\n' \
+        "$(echo "$passage" | sed 's/, /,\n/g; s/Light/LIGHT/')" > "$dir/notes/b.md"
+}
+
+setup_dupes_project
+
+# the passage is 217 letters and digits long: from byte 48 of a.md (line 3)
+# and byte 34 of b.md (line 3), 285 bytes in each
+test_search dupes "$TEST_DATA/dupes_project" 0 \
+    "$(printf 'a.md:3:48-333\tnotes/b.md:3:34-319\t217')" \
+    "Copied passage found despite re-wrapping"
+
+test_search dupes "$TEST_DATA/dupes_project" 0 "" \
+    "Passages shorter than the minimum not reported" -L 300
+
+test_search dupes "$TEST_DATA/dupes_project" 1 "" \
+    "Minimum below the guaranteed length rejected" -L 50
+
+setup_spell_project() {
+    local dir="$TEST_DATA/spell_project"
+    mkdir -p "$dir/ch"
+
+    printf "intro.md\nch\n" > "$dir/.index"
+    printf "s1.md\n" > "$dir/ch/.index"
+    # stands in for the system word list
+    printf 'the\nold\nlighthouse\nkeeper\nslept\nshe\nsaid\nnobody\nhome\ndon'"'"'t\nit\nwas\ndark\n' \
+        > "$TEST_DATA/spell_words.txt"
+    printf '# character names\nAnnelise\n' > "$dir/_dictionary.txt"
+
+    printf 'The old lighthuose keeper slept.\nAnnelise said it was 3rd dark.\n' > "$dir/intro.md"
+    printf '\xe2\x80\x9cNobody\xe2\x80\x99s home,\xe2\x80\x9d she sayd. Don\xe2\x80\x99t.\n' > "$dir/ch/s1.md"
+}
+
+setup_spell_project
+
+# intro.md is 64 bytes, so s1.md starts at draft offset 65; the curly quote
+# before Nobody is 3 bytes
+test_search spell "$TEST_DATA/spell_project" 0 \
+    "$(printf 'intro.md:1:1:8:lighthuose\nch/s1.md:1:4:92:sayd')" \
+    "Unknown words reported in draft order" -D "$TEST_DATA/spell_words.txt"
+
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: Compiled dictionary cached in the project root${NC}"
+if [ -s "$TEST_DATA/spell_project/_spell_.dict" ]; then
+    echo -e "${GREEN}✓ _spell_.dict exists${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ _spell_.dict missing${NC}"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+printf 'sayd\n' >> "$TEST_DATA/spell_project/_dictionary.txt"
+test_search spell "$TEST_DATA/spell_project" 0 \
+    "$(printf 'intro.md:1:1:8:lighthuose')" \
+    "Cache rebuilt when the project dictionary changes" \
+    -D "$TEST_DATA/spell_words.txt"
+
+test_search spell "$TEST_DATA/spell_project" 1 "" \
+    "Missing word list rejected" -D "$TEST_DATA/no_such_words.txt"
+
+cleanup_grep_project() {
+    rm -rf "$TEST_DATA/grep_project" "$TEST_DATA/dupes_project"
+    rm -rf "$TEST_DATA/spell_project" "$TEST_DATA/spell_words.txt"
+}
+
+cleanup_grep_project
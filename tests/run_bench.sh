@@ -0,0 +1,171 @@
+#!/bin/bash
+
+# Benchmark suite: times --init, --check and collate on generated projects.
+# collate-cold evicts the project from the page cache before every run, and
+# collate-cold-noahead does the same with --readahead 0, so the two give the
+# cold-cache speedup of prefetching upcoming files.
+#
+# Environment overrides:
+#   BENCH_PRESETS  space separated presets to run (default: "small medium huge")
+#   BENCH_REPS     timed repetitions per operation (default: 5)
+#   BENCH_OUT      output file prefix (default: $PROJECT_ROOT/bench_results)
+#   BENCH_DATA     scratch directory for generated projects
+#   COLETTE        binary under test (default: $PROJECT_ROOT/bin/colette)
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+COLETTE="${COLETTE:-$PROJECT_ROOT/bin/colette}"
+GEN_PROJECT="${GEN_PROJECT:-$PROJECT_ROOT/bin/gen_project}"
+EVICT_CACHE="${EVICT_CACHE:-$PROJECT_ROOT/bin/evict_cache}"
+BENCH_PRESETS="${BENCH_PRESETS:-small medium huge}"
+BENCH_REPS="${BENCH_REPS:-5}"
+BENCH_OUT="${BENCH_OUT:-$PROJECT_ROOT/bench_results}"
+BENCH_DATA="${BENCH_DATA:-$SCRIPT_DIR/benchdata}"
+
+export LC_ALL=C LANG=C
+
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+# Generator arguments for each preset. Seeds are fixed so every run measures
+# byte-identical projects.
+preset_args() {
+    case "$1" in
+    small)  echo "--seed 1 --depth 2 --fanout 3 --files 5 --size 2048" ;;
+    medium) echo "--seed 2 --depth 3 --fanout 4 --files 10 --size 8192 --dist pareto" ;;
+    huge)   echo "--seed 3 --depth 4 --fanout 5 --files 16 --size 16384 --dist pareto" ;;
+    *)      return 1 ;;
+    esac
+}
+
+# Microsecond wall clock. Prefers bash 5's EPOCHREALTIME, falls back to perl.
+now_us() {
+    if [ -n "$EPOCHREALTIME" ]; then
+        local t="${EPOCHREALTIME/[.,]/}"
+        echo "$t"
+    else
+        perl -MTime::HiRes=time -e 'printf("%d\n", time() * 1000000)'
+    fi
+}
+
+# Prints "min median p90 max" (in microseconds) for samples on stdin.
+summarize() {
+    sort -n | awk '
+        { v[NR] = $1 }
+        END {
+            if (NR == 0) { print "0 0 0 0"; exit }
+            mid = (NR % 2) ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2
+            p = int(0.9 * NR + 0.999999); if (p < 1) p = 1
+            printf "%d %d %d %d\n", v[1], mid, v[p], v[NR]
+        }'
+}
+
+remove_index_files() {
+    find "$1" -name .index -type f -exec rm -f {} +
+}
+
+# Runs one timed operation BENCH_REPS times after a warm-up run.
+# Usage: time_op <mode> <project_dir>
+time_op() {
+    local mode="$1"
+    local dir="$2"
+    local samples=""
+    local rep start end
+
+    for rep in $(seq 0 "$BENCH_REPS"); do
+        if [ "$mode" = "init" ]; then
+            remove_index_files "$dir"
+        fi
+        case "$mode" in
+        collate-cold*) "$EVICT_CACHE" "$dir" ;;
+        esac
+
+        start=$(now_us)
+        case "$mode" in
+        init)    "$COLETTE" --init --check "$dir" > /dev/null 2>&1 ;;
+        check)   "$COLETTE" --check "$dir" > /dev/null 2>&1 ;;
+        collate | collate-cold) "$COLETTE" "$dir" > /dev/null 2>&1 ;;
+        collate-cold-noahead)
+            "$COLETTE" --readahead 0 "$dir" > /dev/null 2>&1 ;;
+        esac
+        local status=$?
+        end=$(now_us)
+
+        if [ $status -ne 0 ]; then
+            echo -e "${RED}$mode failed on $dir (status $status)${NC}" >&2
+            return 1
+        fi
+        # rep 0 is a warm-up so every timed run sees the same cache state
+        if [ "$rep" -gt 0 ]; then
+            samples="$samples$((end - start))"$'\n'
+        fi
+    done
+
+    printf "%s" "$samples" | summarize
+}
+
+if [ ! -x "$COLETTE" ] || [ ! -x "$GEN_PROJECT" ] || [ ! -x "$EVICT_CACHE" ]; then
+    echo -e "${RED}Missing $COLETTE, $GEN_PROJECT or $EVICT_CACHE; run 'make bench'${NC}" >&2
+    exit 1
+fi
+
+rm -rf "$BENCH_DATA"
+mkdir -p "$BENCH_DATA"
+
+csv="$BENCH_OUT.csv"
+json="$BENCH_OUT.json"
+echo "preset,mode,files,bytes,reps,min_us,median_us,p90_us,max_us,mb_per_s" > "$csv"
+json_rows=""
+exit_status=0
+
+for preset in $BENCH_PRESETS; do
+    args=$(preset_args "$preset")
+    if [ $? -ne 0 ]; then
+        echo -e "${RED}Unknown preset: $preset${NC}" >&2
+        exit_status=1
+        continue
+    fi
+
+    dir="$BENCH_DATA/$preset"
+    echo -e "\n${YELLOW}Generating $preset project...${NC}"
+    # shellcheck disable=SC2086
+    totals=$("$GEN_PROJECT" $args "$dir") || { exit_status=1; continue; }
+    files=$(echo "$totals" | sed 's/.*files=\([0-9]*\).*/\1/')
+    bytes=$(echo "$totals" | sed 's/.*bytes=\([0-9]*\).*/\1/')
+    echo "$totals"
+
+    cold_ahead=0
+    cold_noahead=0
+    for mode in init check collate collate-cold collate-cold-noahead; do
+        stats=$(time_op "$mode" "$dir") || { exit_status=1; continue; }
+        read -r min median p90 max <<< "$stats"
+        mbps=$(awk -v b="$bytes" -v us="$median" \
+            'BEGIN { if (us > 0) printf "%.1f", b / us; else print "0" }')
+
+        printf "  %-20s median %10d us   p90 %10d us   %8s MB/s\n" \
+            "$mode" "$median" "$p90" "$mbps"
+        case "$mode" in
+        collate-cold) cold_ahead=$median ;;
+        collate-cold-noahead) cold_noahead=$median ;;
+        esac
+        echo "$preset,$mode,$files,$bytes,$BENCH_REPS,$min,$median,$p90,$max,$mbps" >> "$csv"
+
+        row="{\"preset\":\"$preset\",\"mode\":\"$mode\",\"files\":$files,"
+        row="$row\"bytes\":$bytes,\"reps\":$BENCH_REPS,\"min_us\":$min,"
+        row="$row\"median_us\":$median,\"p90_us\":$p90,\"max_us\":$max,"
+        row="$row\"mb_per_s\":$mbps}"
+        json_rows="${json_rows:+$json_rows,
+}  $row"
+    done
+    if [ "$cold_ahead" -gt 0 ] && [ "$cold_noahead" -gt 0 ]; then
+        awk -v a="$cold_ahead" -v n="$cold_noahead" \
+            'BEGIN { printf "  cold-cache readahead speedup: %.2fx\n", n / a }'
+    fi
+done
+
+printf "[\n%s\n]\n" "$json_rows" > "$json"
+rm -rf "$BENCH_DATA"
+
+echo -e "\n${YELLOW}Results written to $csv and $json${NC}"
+exit $exit_status
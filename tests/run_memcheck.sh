@@ -31,8 +31,16 @@ $COLETTE --check "$TEST_DATA/memcheck/valid"
 echo -e "\nTesting collate mode..."
 $COLETTE "$TEST_DATA/memcheck/valid"
 
-# echo -e "\nTesting init mode..."
-# $COLETTE --init "$TEST_DATA/memcheck/nested"
+# nested directories push and pop arena scopes in the iterator
+echo -e "\nTesting nested collate mode..."
+$COLETTE "$TEST_DATA/memcheck/nested"
+
+echo -e "\nTesting nested collate mode with a missing entry..."
+echo "missing.md" >> "$TEST_DATA/memcheck/nested/chapter1/.index"
+$COLETTE "$TEST_DATA/memcheck/nested"
+
+echo -e "\nTesting init mode..."
+$COLETTE --init "$TEST_DATA/memcheck/nested"
 
 # Clean up
 echo -e "\nCleaning up..."
@@ -0,0 +1,287 @@
+/* *
+ * libsyscount -- test-only LD_PRELOAD shim that counts file I/O calls.
+ *
+ * Interposes the libc entry points colette uses to touch the filesystem and
+ * tallies them into five categories: open, stat, read, write and seek. Calls
+ * are counted at the libc boundary (fopen, fread, lstat, ...) rather than at
+ * the kernel, which keeps counts deterministic regardless of stdio buffering
+ * or machine load. On exit the totals are appended to the file named by
+ * COLETTE_SYSCOUNT_OUT as "category count" lines.
+ *
+ * Linux/glibc only. Build with: cc -shared -fPIC syscount.c -ldl
+ * */
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+enum CallCategory {
+    CALL_OPEN,
+    CALL_STAT,
+    CALL_READ,
+    CALL_WRITE,
+    CALL_SEEK,
+    CALL_CATEGORY_COUNT,
+};
+
+static const char *CATEGORY_NAMES[CALL_CATEGORY_COUNT] = {
+    "open", "stat", "read", "write", "seek"};
+
+static unsigned long counts[CALL_CATEGORY_COUNT];
+static int reporting = 0; // stop counting while writing the report
+
+static void countCall(enum CallCategory category) {
+    if (!reporting) {
+        __atomic_fetch_add(&counts[category], 1, __ATOMIC_RELAXED);
+    }
+}
+
+#define REAL(name)                                                            \
+    static __typeof__(&name) real_##name = NULL;                              \
+    if (!real_##name) {                                                       \
+        *(void **)(&real_##name) = dlsym(RTLD_NEXT, #name);                   \
+    }
+
+/* glibc < 2.33 routes stat() family calls through these */
+int __xstat(int ver, const char *path, struct stat *buf);
+int __lxstat(int ver, const char *path, struct stat *buf);
+int __fxstat(int ver, int fd, struct stat *buf);
+
+/* open */
+
+int open(const char *path, int flags, ...) {
+    REAL(open);
+    countCall(CALL_OPEN);
+    mode_t mode = 0;
+    if (flags & O_CREAT) {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+    return real_open(path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...) {
+    REAL(openat);
+    countCall(CALL_OPEN);
+    mode_t mode = 0;
+    if (flags & O_CREAT) {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+    return real_openat(dirfd, path, flags, mode);
+}
+
+FILE *fopen(const char *path, const char *mode) {
+    REAL(fopen);
+    countCall(CALL_OPEN);
+    return real_fopen(path, mode);
+}
+
+FILE *fopen64(const char *path, const char *mode) {
+    REAL(fopen64);
+    countCall(CALL_OPEN);
+    return real_fopen64(path, mode);
+}
+
+DIR *opendir(const char *path) {
+    REAL(opendir);
+    countCall(CALL_OPEN);
+    return real_opendir(path);
+}
+
+int scandir(const char *dir,
+            struct dirent ***nameList,
+            int (*filter)(const struct dirent *),
+            int (*compar)(const struct dirent **, const struct dirent **)) {
+    REAL(scandir);
+    countCall(CALL_OPEN);
+    return real_scandir(dir, nameList, filter, compar);
+}
+
+/* stat */
+
+int stat(const char *path, struct stat *buf) {
+    REAL(stat);
+    countCall(CALL_STAT);
+    return real_stat(path, buf);
+}
+
+int lstat(const char *path, struct stat *buf) {
+    REAL(lstat);
+    countCall(CALL_STAT);
+    return real_lstat(path, buf);
+}
+
+int fstat(int fd, struct stat *buf) {
+    REAL(fstat);
+    countCall(CALL_STAT);
+    return real_fstat(fd, buf);
+}
+
+int fstatat(int dirfd, const char *path, struct stat *buf, int flags) {
+    REAL(fstatat);
+    countCall(CALL_STAT);
+    return real_fstatat(dirfd, path, buf, flags);
+}
+
+int __xstat(int ver, const char *path, struct stat *buf) {
+    REAL(__xstat);
+    countCall(CALL_STAT);
+    return real___xstat(ver, path, buf);
+}
+
+int __lxstat(int ver, const char *path, struct stat *buf) {
+    REAL(__lxstat);
+    countCall(CALL_STAT);
+    return real___lxstat(ver, path, buf);
+}
+
+int __fxstat(int ver, int fd, struct stat *buf) {
+    REAL(__fxstat);
+    countCall(CALL_STAT);
+    return real___fxstat(ver, fd, buf);
+}
+
+/* read */
+
+ssize_t read(int fd, void *buf, size_t count) {
+    REAL(read);
+    countCall(CALL_READ);
+    return real_read(fd, buf, count);
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+    REAL(pread);
+    countCall(CALL_READ);
+    return real_pread(fd, buf, count, offset);
+}
+
+size_t fread(void *buf, size_t size, size_t count, FILE *file) {
+    REAL(fread);
+    countCall(CALL_READ);
+    return real_fread(buf, size, count, file);
+}
+
+char *fgets(char *buf, int size, FILE *file) {
+    REAL(fgets);
+    countCall(CALL_READ);
+    return real_fgets(buf, size, file);
+}
+
+/* write */
+
+ssize_t write(int fd, const void *buf, size_t count) {
+    REAL(write);
+    countCall(CALL_WRITE);
+    return real_write(fd, buf, count);
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
+    REAL(writev);
+    countCall(CALL_WRITE);
+    return real_writev(fd, iov, iovcnt);
+}
+
+size_t fwrite(const void *buf, size_t size, size_t count, FILE *file) {
+    REAL(fwrite);
+    countCall(CALL_WRITE);
+    return real_fwrite(buf, size, count, file);
+}
+
+int fputs(const char *str, FILE *file) {
+    REAL(fputs);
+    countCall(CALL_WRITE);
+    return real_fputs(str, file);
+}
+
+int fputc(int c, FILE *file) {
+    REAL(fputc);
+    countCall(CALL_WRITE);
+    return real_fputc(c, file);
+}
+
+int putc(int c, FILE *file) {
+    REAL(putc);
+    countCall(CALL_WRITE);
+    return real_putc(c, file);
+}
+
+int fprintf(FILE *file, const char *format, ...) {
+    REAL(vfprintf);
+    countCall(CALL_WRITE);
+    va_list args;
+    va_start(args, format);
+    int result = real_vfprintf(file, format, args);
+    va_end(args);
+    return result;
+}
+
+int vfprintf(FILE *file, const char *format, va_list args) {
+    REAL(vfprintf);
+    countCall(CALL_WRITE);
+    return real_vfprintf(file, format, args);
+}
+
+/* seek */
+
+off_t lseek(int fd, off_t offset, int whence) {
+    REAL(lseek);
+    countCall(CALL_SEEK);
+    return real_lseek(fd, offset, whence);
+}
+
+int fseek(FILE *file, long offset, int whence) {
+    REAL(fseek);
+    countCall(CALL_SEEK);
+    return real_fseek(file, offset, whence);
+}
+
+int fseeko(FILE *file, off_t offset, int whence) {
+    REAL(fseeko);
+    countCall(CALL_SEEK);
+    return real_fseeko(file, offset, whence);
+}
+
+long ftell(FILE *file) {
+    REAL(ftell);
+    countCall(CALL_SEEK);
+    return real_ftell(file);
+}
+
+off_t ftello(FILE *file) {
+    REAL(ftello);
+    countCall(CALL_SEEK);
+    return real_ftello(file);
+}
+
+void rewind(FILE *file) {
+    REAL(rewind);
+    countCall(CALL_SEEK);
+    real_rewind(file);
+}
+
+__attribute__((destructor)) static void reportCounts(void) {
+    const char *outPath = getenv("COLETTE_SYSCOUNT_OUT");
+    if (!outPath || outPath[0] == '\0') {
+        return;
+    }
+
+    reporting = 1;
+    FILE *out = fopen(outPath, "a");
+    if (!out) {
+        return;
+    }
+    for (int i = 0; i < CALL_CATEGORY_COUNT; i++) {
+        fprintf(out, "%s %lu\n", CATEGORY_NAMES[i], counts[i]);
+    }
+    fclose(out);
+}
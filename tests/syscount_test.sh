@@ -0,0 +1,98 @@
+#!/bin/bash
+
+# Initialize test counters (required by run_tests.sh)
+TESTS_RUN=0
+TESTS_PASSED=0
+TESTS_FAILED=0
+
+SYSCOUNT_LIB="$PROJECT_ROOT/bin/libsyscount.so"
+GEN_PROJECT="$PROJECT_ROOT/bin/gen_project"
+SYSCOUNT_BUDGET="$SCRIPT_DIR/syscount_budget.txt"
+
+# Runs colette under the LD_PRELOAD shim. Sets call_status to colette's exit
+# status and call_counts to the "category count" lines the shim wrote.
+count_calls() {
+    local counts_file="$TEST_DATA/syscount.out"
+    rm -f "$counts_file"
+    COLETTE_SYSCOUNT_OUT="$counts_file" LD_PRELOAD="$SYSCOUNT_LIB" \
+        "$COLETTE" "$@" > /dev/null 2>&1
+    call_status=$?
+    call_counts=$(cat "$counts_file" 2>/dev/null)
+}
+
+# Compares per-file call counts for one mode against the checked-in budget.
+# A failed run, a budgeted category the shim didn't count, and a counted
+# category without a budget all fail.
+test_call_budget() {
+    local mode="$1"
+    local files="$2"
+
+    TESTS_RUN=$((TESTS_RUN + 1))
+    echo -e "\n${YELLOW}Test $TESTS_RUN: $mode runs under the shim${NC}"
+    if [ "$call_status" -eq 0 ]; then
+        echo -e "${GREEN}✓ Exited with status 0${NC}"
+        TESTS_PASSED=$((TESTS_PASSED + 1))
+    else
+        echo -e "${RED}✗ Exited with status $call_status${NC}"
+        TESTS_FAILED=$((TESTS_FAILED + 1))
+    fi
+
+    local category budget
+    while read -r category budget; do
+        TESTS_RUN=$((TESTS_RUN + 1))
+        echo -e "\n${YELLOW}Test $TESTS_RUN: $mode $category calls counted${NC}"
+        if awk -v c="$category" '$1 == c { found = 1 } END { exit !found }' \
+            <<< "$call_counts"; then
+            echo -e "${GREEN}✓ Found $category in the shim's counts${NC}"
+            TESTS_PASSED=$((TESTS_PASSED + 1))
+        else
+            echo -e "${RED}✗ No $category count from the shim${NC}"
+            TESTS_FAILED=$((TESTS_FAILED + 1))
+        fi
+    done < <(awk -v m="$mode" '$1 == m { print $2, $3 }' "$SYSCOUNT_BUDGET")
+
+    local count
+    while read -r category count; do
+        [ -z "$category" ] && continue
+        budget=$(awk -v m="$mode" -v c="$category" \
+            '$1 == m && $2 == c { print $3 }' "$SYSCOUNT_BUDGET")
+
+        TESTS_RUN=$((TESTS_RUN + 1))
+        echo -e "\n${YELLOW}Test $TESTS_RUN: $mode $category calls per file within budget${NC}"
+        if [ -z "$budget" ]; then
+            echo -e "${RED}✗ No budget for $mode $category in $SYSCOUNT_BUDGET${NC}"
+            TESTS_FAILED=$((TESTS_FAILED + 1))
+            continue
+        fi
+
+        local per_file
+        per_file=$(awk -v n="$count" -v f="$files" 'BEGIN { printf "%.2f", n / f }')
+        if awk -v p="$per_file" -v b="$budget" 'BEGIN { exit !(p <= b) }'; then
+            echo -e "${GREEN}✓ $per_file <= $budget ($count calls, $files files)${NC}"
+            TESTS_PASSED=$((TESTS_PASSED + 1))
+        else
+            echo -e "${RED}✗ $per_file > $budget ($count calls, $files files)${NC}"
+            TESTS_FAILED=$((TESTS_FAILED + 1))
+        fi
+    done <<< "$call_counts"
+}
+
+if [ "$(uname -s)" != "Linux" ] || [ ! -f "$SYSCOUNT_LIB" ] || [ ! -x "$GEN_PROJECT" ]; then
+    echo -e "${YELLOW}Skipping syscall budget tests (needs Linux and 'make tools')${NC}"
+else
+    project="$TEST_DATA/syscount_project"
+    totals=$("$GEN_PROJECT" --seed 7 --depth 2 --fanout 3 --files 5 \
+        --size 2048 --dist fixed --comments 0.2 --extensionless 0.3 "$project")
+    files=$(echo "$totals" | sed 's/.*files=\([0-9]*\).*/\1/')
+
+    count_calls --check "$project"
+    test_call_budget "check" "$files"
+    count_calls "$project"
+    test_call_budget "collate" "$files"
+
+    find "$project" -name .index -type f -exec rm -f {} +
+    count_calls --init --check "$project"
+    test_call_budget "init" "$files"
+
+    rm -rf "$project" "$TEST_DATA/syscount.out"
+fi
@@ -0,0 +1,112 @@
+#!/bin/bash
+
+# Initialize test counters (required by run_tests.sh)
+TESTS_RUN=0
+TESTS_PASSED=0
+TESTS_FAILED=0
+
+# Test helper that runs colette with --trace and checks the trace file
+# contains the expected number of events of a given kind
+test_trace_events() {
+    local project_dir="$1"
+    local mode_flag="$2"
+    local event_name="$3"
+    local expected_count="$4"
+    local test_name="$5"
+    local trace_file="$TEST_DATA/trace.json"
+
+    TESTS_RUN=$((TESTS_RUN + 1))
+    echo -e "\n${YELLOW}Test $TESTS_RUN: $test_name${NC}"
+
+    rm -f "$trace_file"
+    # shellcheck disable=SC2086
+    $COLETTE $mode_flag --trace "$trace_file" "$project_dir" > /dev/null 2>&1
+    local status=$?
+
+    if [ $status -ne 0 ] || [ ! -f "$trace_file" ]; then
+        echo -e "${RED}✗ Expected trace file, got status $status${NC}"
+        TESTS_FAILED=$((TESTS_FAILED + 1))
+        return
+    fi
+
+    local count
+    count=$(grep -c "\"name\":\"$event_name\"" "$trace_file")
+    if [ "$count" -eq "$expected_count" ] &&
+        head -n 1 "$trace_file" | grep -q '^{"traceEvents":\[' &&
+        tail -n 1 "$trace_file" | grep -q '"droppedEvents":0}}$'; then
+        echo -e "${GREEN}✓ Found $count $event_name events${NC}"
+        TESTS_PASSED=$((TESTS_PASSED + 1))
+    else
+        echo -e "${RED}✗ Expected $expected_count $event_name events, got $count${NC}"
+        TESTS_FAILED=$((TESTS_FAILED + 1))
+    fi
+}
+
+setup_trace_project() {
+    local dir="$TEST_DATA/trace_project"
+    mkdir -p "$dir/chapter1"
+
+    echo "intro.md" > "$dir/.index"
+    echo "chapter1" >> "$dir/.index"
+    echo "scene1" > "$dir/chapter1/.index"
+    echo "scene2.md" >> "$dir/chapter1/.index"
+
+    echo "Introduction" > "$dir/intro.md"
+    echo "Scene 1" > "$dir/chapter1/scene1.md"
+    echo "Scene 2" > "$dir/chapter1/scene2.md"
+}
+
+setup_trace_project
+
+test_trace_events "$TEST_DATA/trace_project" "" "handler" 3 \
+    "Collate records one handler span per project file"
+
+test_trace_events "$TEST_DATA/trace_project" "" "resolveFile" 4 \
+    "Collate records one resolveFile span per index entry"
+
+test_trace_events "$TEST_DATA/trace_project" "--check" "openIndexFile" 2 \
+    "Check records one openIndexFile span per directory"
+
+test_trace_events "$TEST_DATA/trace_project" "--check" "parseIndex" 2 \
+    "Check records one parseIndex span per directory"
+
+test_trace_events "$TEST_DATA/trace_project" "--check" "handler" 3 \
+    "Check records one handler span per validated file"
+
+# Collate handler spans carry the number of bytes copied
+TESTS_RUN=$((TESTS_RUN + 1))
+echo -e "\n${YELLOW}Test $TESTS_RUN: Handler spans include byte counts${NC}"
+$COLETTE --trace "$TEST_DATA/trace.json" "$TEST_DATA/trace_project" > /dev/null 2>&1
+if grep -q '"path":"[^"]*intro.md","bytes":13}' "$TEST_DATA/trace.json"; then
+    echo -e "${GREEN}✓ Byte count recorded${NC}"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}✗ Byte count missing from handler span${NC}"
+    TESTS_FAILED=$((TESTS_FAILED + 1))
+fi
+
+# a trace that can't be written fails the run even when the project didn't
+test_unwritable_trace() {
+    local trace_file="$1"
+    local test_name="$2"
+
+    TESTS_RUN=$((TESTS_RUN + 1))
+    echo -e "\n${YELLOW}Test $TESTS_RUN: $test_name${NC}"
+    $COLETTE --trace "$trace_file" "$TEST_DATA/trace_project" > /dev/null 2>&1
+    local status=$?
+    if [ $status -ne 0 ]; then
+        echo -e "${GREEN}✓ Exited with status $status${NC}"
+        TESTS_PASSED=$((TESTS_PASSED + 1))
+    else
+        echo -e "${RED}✗ Expected a non-zero exit status${NC}"
+        TESTS_FAILED=$((TESTS_FAILED + 1))
+    fi
+}
+
+test_unwritable_trace "$TEST_DATA/no_such_dir/trace.json" \
+    "Trace file in a missing directory fails the run"
+if [ -w /dev/full ]; then
+    test_unwritable_trace /dev/full "Trace file on a full device fails the run"
+fi
+
+rm -rf "$TEST_DATA/trace_project" "$TEST_DATA/trace.json"